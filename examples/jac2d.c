@@ -66,6 +66,22 @@ void setBoundary(int size, Laik_Partitioning *pWrite, Laik_Data* dWrite)
     }
 }
 
+// jacobi update of cells in [x1;x2[ x [y1;y2[ (local indexes of baseW)
+void update(double* baseR, uint64_t ystrideR, double* baseW, uint64_t ystrideW,
+            int64_t x1, int64_t x2, int64_t y1, int64_t y2)
+{
+    double newValue;
+    for(int64_t y = y1; y < y2; y++) {
+        for(int64_t x = x1; x < x2; x++) {
+            newValue = 0.25 * ( baseR[ (y-1) * ystrideR + x    ] +
+                                baseR[  y    * ystrideR + x - 1] +
+                                baseR[  y    * ystrideR + x + 1] +
+                                baseR[ (y+1) * ystrideR + x    ] );
+            baseW[y * ystrideW + x] = newValue;
+        }
+    }
+}
+
 // to deliberately change block partitioning (if arg 3 provided)
 double getTW(int rank, const void* userData)
 {
@@ -88,6 +104,7 @@ int main(int argc, char* argv[])
     bool do_reservation = false;
     bool do_exec = false;
     bool do_actions = false;
+    bool do_overlap = false;
 
     int arg = 1;
     while ((argc > arg) && (argv[arg][0] == '-')) {
@@ -97,6 +114,7 @@ int main(int argc, char* argv[])
         if (argv[arg][1] == 'r') do_reservation = true;
         if (argv[arg][1] == 'e') do_exec = true;
         if (argv[arg][1] == 'a') do_actions = true;
+        if (argv[arg][1] == 'o') do_overlap = true;
         if (argv[arg][1] == 'h') {
             printf("Usage: %s [options] <side width> <maxiter> <repart>\n\n"
                    "Options:\n"
@@ -106,6 +124,7 @@ int main(int argc, char* argv[])
                    " -r        : do space reservation before iteration loop\n"
                    " -e        : pre-calculate transitions to exec in iteration loop\n"
                    " -a        : pre-calculate action sequence to exec (includes -e)\n"
+                   " -o        : overlap halo exchange with update of inner cells\n"
                    " -h : print this help text and exit\n",
                    argv[0]);
             exit(1);
@@ -257,7 +276,10 @@ int main(int argc, char* argv[])
         // (3) with pre-calculated action sequence for transitions: execute it
         // with (3), it is especially beneficial to use a reservation, as
         // the actions usually directly refer to e.g. MPI calls
+        // with (4), a split-phase switch is used to overlap the halo exchange
+        // with the update of inner cells (not in iterations with residuum)
 
+        Laik_SwitchHandle* halo = 0;
         if (do_actions) {
             // case (3): pre-calculated action sequences
             if (dRead == data1) {
@@ -275,6 +297,11 @@ int main(int argc, char* argv[])
             laik_exec_transition(dRead, toHaloTransition);
             laik_exec_transition(dWrite, toExclTransition);
         }
+        else if (do_overlap && ((iter % 10) != 0)) {
+            // case (4): split-phase switch, completed after inner update
+            laik_switchto_partitioning(dWrite, pWrite, LAIK_DF_None, LAIK_RO_None);
+            halo = laik_switch_begin(dRead, pRead, LAIK_DF_Preserve, LAIK_RO_None);
+        }
         else {
             // case (1): no pre-calculation: switch to partitionings
             laik_switchto_partitioning(dRead,  pRead,  LAIK_DF_Preserve, LAIK_RO_None);
@@ -370,18 +397,29 @@ int main(int argc, char* argv[])
 
             if (res < .001) break;
         }
-        else {
-            double newValue;
-            for(int64_t y = y1; y < y2; y++) {
-                for(int64_t x = x1; x < x2; x++) {
-                    newValue = 0.25 * ( baseR[ (y-1) * ystrideR + x    ] +
-                                        baseR[  y    * ystrideR + x - 1] +
-                                        baseR[  y    * ystrideR + x + 1] +
-                                        baseR[ (y+1) * ystrideR + x    ] );
-                    baseW[y * ystrideW + x] = newValue;
-                }
+        else if (halo) {
+            // inner cells do not need halo values
+            int64_t iy1 = (y1 > 1) ? y1 : 1;
+            int64_t ix1 = (x1 > 1) ? x1 : 1;
+            int64_t iy2 = (y2 < (int64_t) ysizeW - 1) ? y2 : (int64_t) ysizeW - 1;
+            int64_t ix2 = (x2 < (int64_t) xsizeW - 1) ? x2 : (int64_t) xsizeW - 1;
+            if ((iy1 >= iy2) || (ix1 >= ix2)) {
+                // no inner cells
+                iy1 = iy2 = y1;
+                ix1 = ix2 = x1;
             }
+            update(baseR, ystrideR, baseW, ystrideW, ix1, ix2, iy1, iy2);
+
+            laik_switch_end(halo);
+
+            // border cells: rows above/below inner cells, columns left/right
+            update(baseR, ystrideR, baseW, ystrideW, x1, x2, y1, iy1);
+            update(baseR, ystrideR, baseW, ystrideW, x1, x2, iy2, y2);
+            update(baseR, ystrideR, baseW, ystrideW, x1, ix1, iy1, iy2);
+            update(baseR, ystrideR, baseW, ystrideW, ix2, x2, iy1, iy2);
         }
+        else
+            update(baseR, ystrideR, baseW, ystrideW, x1, x2, y1, y2);
 
         // TODO: allow repartitioning
     }
@@ -210,10 +210,18 @@ struct _Laik_ActionSeq {
     // the backend gets called for clean-up when the sequence is destroyed
     Laik_Backend* backend;
 
-    // actions can refer to different transition contexts
-#define ASEQ_CONTEXTS_MAX 1
+    // set before preparing if the sequence will be executed multiple times:
+    // backends may then do more costly setup for faster execution
+    bool reuse;
+
+    // actions can refer to different transition contexts (see tid in
+    // Laik_Action). All contexts must use transitions on the same group
+#define ASEQ_CONTEXTS_MAX 64
     void* context[ASEQ_CONTEXTS_MAX];
     int contextCount;
+    // context ID given to actions appended by the laik_aseq_add* helpers.
+    // transformations set it to the ID of the action they replace
+    int currentTid;
 
     // each call to laik_aseq_allocBuffer() allocates another buffer
 #define ASEQ_BUFFER_MAX 5
@@ -234,6 +242,8 @@ struct _Laik_ActionSeq {
     Laik_Action* action;
     // how many rounds
     int roundCount;
+    // for split-phase execution by backend: next action to execute
+    unsigned int execPos;
 
     // temporary action sequence storage used during generation by
     // laik_aseq_addAction(). Call laik_aseq_finish to make it active
@@ -250,6 +260,8 @@ struct _Laik_ActionSeq {
     uint64_t elemSendCount, elemRecvCount, elemReduceCount;
     uint64_t byteSendCount, byteRecvCount, byteReduceCount;
     uint64_t initOpCount, reduceOpCount, byteBufCopyCount;
+    // set by backend during execution if it compresses messages
+    uint64_t byteCompRawCount, byteCompCount;
 };
 
 
@@ -281,6 +293,7 @@ Laik_BackendAction* laik_aseq_addBAction(Laik_ActionSeq* as, int round);
 
 
 // returns the transaction ID
+// (all contexts of a sequence must use transitions on the same group)
 int laik_aseq_addTContext(Laik_ActionSeq* as,
                           Laik_Data* d, Laik_Transition* transition,
                           Laik_MappingList* fromList,
@@ -463,6 +476,9 @@ void laik_aseq_addSends(Laik_ActionSeq* as, int round,
 // works in-place, only call once
 bool laik_aseq_allocBuffer(Laik_ActionSeq* as);
 
+// allocate a buffer owned by the action sequence, return its address
+char* laik_aseq_newBuffer(Laik_ActionSeq* as, size_t size);
+
 
 //
 // generic transformation passes for action sequences
@@ -488,9 +504,21 @@ bool laik_aseq_sort_rounds(Laik_ActionSeq* as);
 // transform MapPackAndSend/MapRecvAndUnpack into simple Send/Recv actions
 bool laik_aseq_flattenPacking(Laik_ActionSeq* as);
 
+// same, but keep MapPackAndSend/MapRecvAndUnpack for ranges larger than
+// <maxSize> bytes (0: no limit)
+bool laik_aseq_flattenPackingMax(Laik_ActionSeq* as, uint64_t maxSize);
+
 // transformation for split reduce actions into basic multiple actions
 bool laik_aseq_splitReduce(Laik_ActionSeq* as);
 
+// same, but reduce hierarchically within nodes first if possible, using
+// node IDs <node> indexed by location ID
+bool laik_aseq_splitReduceNodes(Laik_ActionSeq* as, int* node);
+
+// leaders of nodes for hierarchical reduction (see action.c)
+bool laik_trans_nodeLeaders(Laik_Transition* t, int inputGroup,
+                            int outputGroup, int* node, int* leader);
+
 // replace group reduction actions with all-reduction actions if possible
 bool laik_aseq_replaceWithAllReduce(Laik_ActionSeq* as);
 
@@ -58,6 +58,17 @@ struct _Laik_Backend {
   // execute a action sequence
   void (*exec)(Laik_ActionSeq*);
 
+  // split-phase execution of an action sequence (see laik_switch_begin),
+  // all can be NULL. Without exec_start, exec is used instead.
+  // - exec_start: start execution, return without waiting for
+  //   completion of communication (e.g. after posting sends/receives)
+  // - exec_test: make progress without blocking, return true if done
+  // - exec_finish: complete execution, may block
+  // The execution state is kept in the action sequence (see execPos)
+  void (*exec_start)(Laik_ActionSeq*);
+  bool (*exec_test)(Laik_ActionSeq*);
+  void (*exec_finish)(Laik_ActionSeq*);
+
   // update backend specific data for group if needed
   void (*updateGroup)(Laik_Group*);
 
@@ -67,6 +78,11 @@ struct _Laik_Backend {
   // log backend-specific action, return true if handled (see laik_log_Action)
   bool (*log_action)(Laik_Action* a);
 
+  // peer rank of backend-specific send/recv action, setting <isSend>,
+  // or -1 if not a send/recv action. Used for sorting to avoid deadlocks
+  // (see laik_aseq_sort_2phases). Can be NULL
+  int (*action_peer)(Laik_Action* a, bool* isSend);
+
   // ensure progress in backend, can be NULL
   void (*make_progress)();
 
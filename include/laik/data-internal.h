@@ -63,7 +63,10 @@ struct _Laik_SwitchStat
     uint64_t elemSendCount, elemRecvCount, elemReduceCount;
     uint64_t byteSendCount, byteRecvCount, byteReduceCount;
     uint64_t initOpCount, reduceOpCount, byteBufCopyCount;
-
+    // compressed messages: raw bytes, bytes after compression
+    uint64_t byteCompRawCount, byteCompCount;
+    // transition cache: hits with/without prepared action sequence, misses
+    int transCacheHits, aseqCacheHits, transCacheMisses;
 };
 
 Laik_SwitchStat* laik_newSwitchStat(void);
@@ -91,6 +94,25 @@ struct _Laik_Reservation {
     Laik_MappingList* mList; // mappings for reservations
 };
 
+// number of transitions cached per data container
+#define TRANSCACHE_ENTRIES 8
+
+// cached transition for switching between partitionings of a container,
+// with action sequence prepared by backend if mappings are stable
+// (i.e. allocated from reservations). Entry is unused if <t> is 0
+typedef struct _Laik_TransCacheEntry {
+    Laik_Partitioning *fromP, *toP;
+    Laik_DataFlow flow;
+    Laik_ReductionOperation redOp;
+    Laik_Transition* t;
+
+    // prepared action sequence (0 if not available), with mappings used
+    Laik_ActionSeq* as;
+    Laik_MappingList *fromList, *toList;
+
+    unsigned int lastUse; // for LRU replacement
+} Laik_TransCacheEntry;
+
 // a data container
 struct _Laik_Data {
     char* name;
@@ -124,8 +146,31 @@ struct _Laik_Data {
 
     // statistics
     Laik_SwitchStat* stat;
+
+    // cache for transitions/action sequences used in switches
+    Laik_TransCacheEntry transCache[TRANSCACHE_ENTRIES];
+    unsigned int transCacheUse;
+
+    // outstanding split-phase switch (0 if none)
+    Laik_SwitchHandle* pendingSwitch;
+};
+
+// state of a split-phase switch (see laik_switch_begin)
+struct _Laik_SwitchHandle {
+    Laik_Data* data;
+    Laik_Transition* t; // 0 if nothing to do
+    Laik_ActionSeq* as; // 0 if no communication required
+    Laik_MappingList *fromList, *toList;
+
+    bool ownTransition; // transition not from cache: free at end
+    bool ownASeq;       // action sequence not from cache: free at end
+    bool commPending;   // backend execution not completed yet
 };
 
+// invalidate cached transitions referring to partitioning <p>,
+// in all containers of the instance. Called if <p> is freed or migrated
+void laik_data_invalidate_partitioning(Laik_Partitioning* p);
+
 
 
 // a mapping of data elements for global index range given by <validRange>,
@@ -143,6 +143,49 @@ void laik_switchto_partitioning(Laik_Data* d,
                                 Laik_Partitioning* toP,
                                 Laik_DataFlow flow, Laik_ReductionOperation redOp);
 
+// a switch of a container between partitionings,
+// see laik_plan_switches() and laik_switchto_batch()
+typedef struct _Laik_SwitchRequest {
+    Laik_Data* data;
+    Laik_Partitioning *fromP, *toP;
+    Laik_DataFlow flow;
+    Laik_ReductionOperation redOp;
+} Laik_SwitchRequest;
+
+// calculate transitions for switches expected to happen (e.g. all switches
+// of an iteration) in advance, concurrently using <threads> threads
+// (0: number of CPUs). Transitions are stored in the transition caches of
+// the containers and used when switching to the partitionings later
+void laik_plan_switches(int n, Laik_SwitchRequest* req, int threads);
+
+// switch multiple containers at once, each from its active partitioning
+// (<fromP> in a request must be 0 or the active one) to <toP>. Backends
+// combine data going to the same peer into one message, e.g. to exchange
+// halos of many fields with one message per neighbor
+void laik_switchto_batch(int n, Laik_SwitchRequest* req);
+
+// handle for a split-phase switch, see laik_switch_begin()
+typedef struct _Laik_SwitchHandle Laik_SwitchHandle;
+
+// start switching container <d> to partitioning <toP>, without waiting
+// for communication to complete: sends/receives are posted (if supported
+// by the backend), local copy/init actions are done while messages are in
+// flight, and <toP> becomes the active partitioning. Until the switch is
+// completed by laik_switch_end(), only ranges not written by communication
+// (e.g. inner cells without halo) may be accessed. All tasks must begin
+// split switches in the same order. Only one switch per container can be
+// outstanding; no other switch of <d> is allowed in between.
+Laik_SwitchHandle* laik_switch_begin(Laik_Data* d, Laik_Partitioning* toP,
+                                     Laik_DataFlow flow,
+                                     Laik_ReductionOperation redOp);
+
+// make progress on a split-phase switch without blocking.
+// Returns true if the communication of the switch is completed
+bool laik_switch_test(Laik_SwitchHandle* h);
+
+// complete a split-phase switch, blocking if needed. Frees the handle
+void laik_switch_end(Laik_SwitchHandle* h);
+
 // switch to use another data flow, keep access phase/partitioning
 void laik_switchto_flow(Laik_Data* d, Laik_DataFlow flow, Laik_ReductionOperation redOp);
 
@@ -371,6 +414,21 @@ Laik_Layout* laik_new_layout_lex(int n, Laik_Range* ranges);
 // return stride for dimension <d> in lex layout mapping <n>
 uint64_t laik_layout_lex_stride(Laik_Layout* l, int n, int d);
 
+// is <l> a lexicographical layout?
+bool laik_layout_is_lex(Laik_Layout* l);
+
+// is range <r> stored contiguously in memory (in lex traversal order)
+// in map <n> of lex layout <l>? If yes, set <off> to offset of <r>.from
+bool laik_layout_lex_contiguous(Laik_Layout* l, int n, Laik_Range* r, int64_t* off);
+
+// is range <r> stored in map <n> of lex layout <l> as <count> blocks of
+// <blocklen> contiguous elements each, <stride> elements apart (i.e.
+// contiguous up to a single stride)? If yes, set <off> to offset of r.from.
+// Includes contiguous ranges (with <count> 1)
+bool laik_layout_lex_strided(Laik_Layout* l, int n, Laik_Range* r,
+                             int64_t* off, uint64_t* count,
+                             uint64_t* blocklen, uint64_t* stride);
+
 
 //----------------------------------
 // Allocator interface
@@ -90,6 +90,13 @@ struct _Laik_TaskRange {
 };
 
 
+// entry of a spatial index over the ranges of a range list
+typedef struct _Laik_RangeIdxEntry {
+    int64_t from;   // start of range in dimension 0
+    int64_t maxTo;  // maximum of range ends in dim 0 up to this entry
+    unsigned int off; // offset of range in range list
+} Laik_RangeIdxEntry;
+
 // an ordered sequence of ranges assigned to task ids
 // ordered by task id, then mapping id, then index ordering
 struct _Laik_RangeList {
@@ -109,6 +116,10 @@ struct _Laik_RangeList {
     int map_tid;  // typically used for "own" task id
     unsigned int map_count; // number of mappings needed for ranges of <maptask>
     unsigned int* map_off;  // offsets into own ranges for same mapping
+
+    // spatial index for intersection queries, calculated lazily:
+    // ranges sorted by start in dimension 0
+    Laik_RangeIdxEntry* idx;
 };
 
 
@@ -179,6 +190,15 @@ struct _Laik_Partitioning {
 void laik_free_partitioning(Laik_Partitioning* p);
 void laik_updateMapOffsets(Laik_RangeList* list, int tid);
 
+// calculate spatial index of range list if not yet done
+void laik_rangelist_updateIndex(Laik_RangeList* list);
+
+// find ranges in <list> which may intersect with <range>, using spatial
+// index: candidates are list->idx[*first] to list->idx[*first + count - 1]
+unsigned int laik_rangelist_candidates(Laik_RangeList* list,
+                                       const Laik_Range* range,
+                                       unsigned int* first);
+
 
 
 //
@@ -284,6 +304,23 @@ Laik_Transition* do_calc_transition(Laik_Space* space,
                                     Laik_Partitioning* fromP, Laik_Partitioning* toP,
                                     Laik_DataFlow flow, Laik_ReductionOperation redOp);
 
+// context for transition calculation with temporary buffers.
+// do_calc_transition uses a default planner: to calculate transitions
+// concurrently, each thread needs its own planner
+typedef struct _Laik_TransPlanner Laik_TransPlanner;
+
+Laik_TransPlanner* laik_transplanner_new(void);
+void laik_transplanner_free(Laik_TransPlanner* tp);
+
+// same as do_calc_transition, using buffers of planner <tp>
+Laik_Transition* laik_transplanner_calc(Laik_TransPlanner* tp, Laik_Space* space,
+                                        Laik_Partitioning* fromP, Laik_Partitioning* toP,
+                                        Laik_DataFlow flow, Laik_ReductionOperation redOp);
+
+// calculate lazily created data of partitionings required for transition
+// calculation. Needs to be done before calculating concurrently
+void laik_transplanner_prepare(Laik_Partitioning* fromP, Laik_Partitioning* toP);
+
 // return size of task group with ID <subgroup> in transition <t>
 int laik_trans_groupCount(Laik_Transition* t, int subgroup);
 
@@ -178,6 +178,10 @@ bool laik_range_isEmpty(Laik_Range*);
 // get the intersection of two ranges; return 0 if intersection is empty
 Laik_Range* laik_range_intersect(const Laik_Range* r1, const Laik_Range* r2);
 
+// same as laik_range_intersect, but store intersection in <r> (reentrant)
+Laik_Range* laik_range_intersect_r(const Laik_Range* r1, const Laik_Range* r2,
+                                   Laik_Range* r);
+
 // expand range <dst> such that it contains <src>
 void laik_range_expand(Laik_Range* dst, Laik_Range* src);
 
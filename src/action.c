@@ -41,10 +41,12 @@ Laik_ActionSeq* laik_aseq_new(Laik_Instance *inst)
 
     as->inst = inst;
     as->backend = 0;
+    as->reuse = false;
 
     for(int i = 0; i < ASEQ_CONTEXTS_MAX; i++)
         as->context[i] = 0;
     as->contextCount = 0;
+    as->currentTid = 0;
 
     for(int i = 0; i < ASEQ_BUFFER_MAX; i++) {
         as->buf[i] = 0;
@@ -62,6 +64,7 @@ Laik_ActionSeq* laik_aseq_new(Laik_Instance *inst)
     as->bytesUsed = 0;
     as->action = 0;
     as->roundCount = 0;
+    as->execPos = 0;
 
     as->newAction = 0;
     as->newActionCount = 0;
@@ -203,7 +206,8 @@ Laik_BackendAction* laik_aseq_addBAction(Laik_ActionSeq* as, int round)
     Laik_BackendAction* ba;
     ba = (Laik_BackendAction*) laik_aseq_addAction(as,
                                                    sizeof(Laik_BackendAction),
-                                                   LAIK_AT_Invalid, round, 0);
+                                                   LAIK_AT_Invalid, round,
+                                                   as->currentTid);
     return ba;
 }
 
@@ -224,6 +228,11 @@ int laik_aseq_addTContext(Laik_ActionSeq* as,
     tc->prepToList = 0;
 
     assert(as->contextCount < ASEQ_CONTEXTS_MAX);
+    if (as->contextCount > 0) {
+        // actions of different contexts are combined into same messages
+        Laik_TransitionContext* tc0 = as->context[0];
+        assert(tc0->transition->group == transition->group);
+    }
     int contextID = as->contextCount;
     as->contextCount++;
 
@@ -289,7 +298,8 @@ void laik_aseq_addRBufSend(Laik_ActionSeq* as, int round,
 {
     Laik_A_RBufSend* a;
     a = (Laik_A_RBufSend*) laik_aseq_addAction(as, sizeof(*a),
-                                               LAIK_AT_RBufSend, round, 0);
+                                               LAIK_AT_RBufSend, round,
+                                               as->currentTid);
     a->bufID = bufID;
     a->offset = byteOffset;
     a->count = count;
@@ -303,7 +313,8 @@ void laik_aseq_addRBufRecv(Laik_ActionSeq* as, int round,
 {
     Laik_A_RBufRecv* a;
     a = (Laik_A_RBufRecv*) laik_aseq_addAction(as, sizeof(*a),
-                                               LAIK_AT_RBufRecv, round, 0);
+                                               LAIK_AT_RBufRecv, round,
+                                               as->currentTid);
     a->bufID = bufID;
     a->offset = byteOffset;
     a->count = count;
@@ -394,7 +405,8 @@ void laik_aseq_addBufSend(Laik_ActionSeq* as, int round,
 {
     Laik_A_BufSend* a;
     a = (Laik_A_BufSend*) laik_aseq_addAction(as, sizeof(*a),
-                                              LAIK_AT_BufSend, round, 0);
+                                              LAIK_AT_BufSend, round,
+                                               as->currentTid);
     a->buf = fromBuf;
     a->count = count;
     a->to_rank = to;
@@ -420,7 +432,8 @@ void laik_aseq_addBufRecv(Laik_ActionSeq* as, int round,
 {
     Laik_A_BufRecv* a;
     a = (Laik_A_BufRecv*) laik_aseq_addAction(as, sizeof(*a),
-                                              LAIK_AT_BufRecv, round, 0);
+                                              LAIK_AT_BufRecv, round,
+                                               as->currentTid);
     a->buf = toBuf;
     a->count = count;
     a->from_rank = from;
@@ -479,7 +492,7 @@ void laik_aseq_addMapPackAndSend(Laik_ActionSeq* as, int round,
     Laik_A_MapPackAndSend* a;
     a = (Laik_A_MapPackAndSend*) laik_aseq_addAction(as, sizeof(*a),
                                                      LAIK_AT_MapPackAndSend,
-                                                     round, 0);
+                                                     round, as->currentTid);
     uint64_t count = laik_range_size(range);
     assert(count > 0);
 
@@ -575,7 +588,7 @@ void laik_aseq_addMapRecvAndUnpack(Laik_ActionSeq* as, int round,
     Laik_A_MapRecvAndUnpack* a;
     a = (Laik_A_MapRecvAndUnpack*) laik_aseq_addAction(as, sizeof(*a),
                                                        LAIK_AT_MapRecvAndUnpack,
-                                                       round, 0);
+                                                       round, as->currentTid);
     uint64_t count = laik_range_size(range);
     assert(count > 0);
 
@@ -788,10 +801,11 @@ bool laik_action_isRecv(Laik_Action* a)
 
 
 // add all reduce ops from a transition to an ActionSeq.
+// the transition must be the one of context <currentTid>
 void laik_aseq_addReds(Laik_ActionSeq* as, int round,
                        Laik_Data* data, Laik_Transition* t)
 {
-    Laik_TransitionContext* tc = as->context[0];
+    Laik_TransitionContext* tc = as->context[as->currentTid];
     assert(tc->data == data);
     assert(tc->transition == t);
     assert(t->group->myid >= 0);
@@ -810,7 +824,7 @@ void laik_aseq_addReds(Laik_ActionSeq* as, int round,
 void laik_aseq_addRecvs(Laik_ActionSeq* as, int round,
                         Laik_Data* data, Laik_Transition* t)
 {
-    Laik_TransitionContext* tc = as->context[0];
+    Laik_TransitionContext* tc = as->context[as->currentTid];
     assert(tc->data == data);
     assert(tc->transition == t);
     assert(t->group->myid >= 0);
@@ -827,7 +841,7 @@ void laik_aseq_addRecvs(Laik_ActionSeq* as, int round,
 void laik_aseq_addSends(Laik_ActionSeq* as, int round,
                         Laik_Data* data, Laik_Transition* t)
 {
-    Laik_TransitionContext* tc = as->context[0];
+    Laik_TransitionContext* tc = as->context[as->currentTid];
     assert(tc->data == data);
     assert(tc->transition == t);
     assert(t->group->myid >= 0);
@@ -848,8 +862,8 @@ bool laik_aseq_allocBuffer(Laik_ActionSeq* as)
     assert(as->bufferCount < ASEQ_BUFFER_MAX);
     assert(as->buf[as->bufferCount] == 0); // nothing allocated yet
 
+    // buffer allocation is accounted to data of first context
     Laik_TransitionContext* tc = as->context[0];
-    unsigned int elemsize = tc->data->elemsize;
 
     Laik_A_BufReserve** resAction;
     resAction = malloc(as->bufReserveCount * sizeof(Laik_A_BufReserve*));
@@ -929,6 +943,8 @@ bool laik_aseq_allocBuffer(Laik_ActionSeq* as)
             Laik_A_BufReserve* ra = resAction[*pBufID - 100];
             assert(ra != 0);
             assert(count > 0);
+            unsigned int elemsize;
+            elemsize = ((Laik_TransitionContext*) as->context[a->tid])->data->elemsize;
             assert(*pOffset + (uint64_t)(count * elemsize) <= (uint64_t) ra->size);
 
             *pOffset += ra->offset;
@@ -958,6 +974,7 @@ bool laik_aseq_allocBuffer(Laik_ActionSeq* as)
     a = as->action;
     for(unsigned int i = 0; i < as->actionCount; i++, a = nextAction(a)) {
         Laik_BackendAction* ba = (Laik_BackendAction*) a;
+        as->currentTid = a->tid;
         switch(a->type) {
         case LAIK_AT_BufReserve:
             // BufReserve actions processed, can be removed
@@ -1055,6 +1072,30 @@ bool laik_aseq_allocBuffer(Laik_ActionSeq* as)
     return true;
 }
 
+// allocate a buffer of <size> bytes owned by <as> (freed with <as>),
+// e.g. for use by backend-specific actions. Returns buffer address
+char* laik_aseq_newBuffer(Laik_ActionSeq* as, size_t size)
+{
+    assert(as->bufferCount < ASEQ_BUFFER_MAX);
+    assert(as->buf[as->bufferCount] == 0); // nothing allocated yet
+
+    char* buf = malloc(size);
+    if (!buf) {
+        laik_panic("Out of memory allocating action sequence buffer");
+        exit(1); // not actually needed, laik_panic never returns
+    }
+    // update allocation statistics
+    Laik_TransitionContext* tc = as->context[0];
+    laik_switchstat_malloc(tc->data->stat, size);
+
+    laik_log(1, "Buffer alloc %d: %llu bytes at %p", as->bufferCount,
+             (long long unsigned) size, (void*) buf);
+
+    as->bufSize[as->bufferCount] = size;
+    as->buf[as->bufferCount] = buf;
+    as->bufferCount++;
+    return buf;
+}
 
 // append actions to <as>
 // allows to change round of added action when <round> >= 0
@@ -1092,24 +1133,41 @@ void laik_aseq_copySeq(Laik_ActionSeq* as)
 
 // helpers for action combining
 
+// element size of data in transition context of action <a>
+static unsigned int actionElemsize(Laik_ActionSeq* as, Laik_Action* a)
+{
+    Laik_TransitionContext* tc = as->context[a->tid];
+    return tc->data->elemsize;
+}
+
+// check that actions <a1> and <a2> work on data of same type.
+// This allows to combine actions of different containers
+static bool isSameType(Laik_ActionSeq* as, Laik_Action* a1, Laik_Action* a2)
+{
+    if (a1->tid == a2->tid) return true;
+    Laik_TransitionContext* tc1 = as->context[a1->tid];
+    Laik_TransitionContext* tc2 = as->context[a2->tid];
+    return tc1->data->type == tc2->data->type;
+}
+
 // check that <a> is a BufSend action with same round and peer rank as <bsa>
-static bool isSameBufSend(Laik_A_BufSend* bsa, Laik_Action* a)
+static bool isSameBufSend(Laik_ActionSeq* as, Laik_A_BufSend* bsa, Laik_Action* a)
 {
     assert(bsa->h.type == LAIK_AT_BufSend);
     if (a->type != LAIK_AT_BufSend) return false;
     if (a->round != bsa->h.round) return false;
     if ( ((Laik_A_BufSend*)a)->to_rank != bsa->to_rank) return false;
-    return true;
+    return isSameType(as, &(bsa->h), a);
 }
 
 // check that <a> is a BufRecv action with same round and peer rank as <bra>
-static bool isSameBufRecv(Laik_A_BufRecv* bra, Laik_Action* a)
+static bool isSameBufRecv(Laik_ActionSeq* as, Laik_A_BufRecv* bra, Laik_Action* a)
 {
     assert(bra->h.type == LAIK_AT_BufRecv);
     if (a->type != LAIK_AT_BufRecv) return false;
     if (a->round != bra->h.round) return false;
     if ( ((Laik_A_BufRecv*)a)->from_rank != bra->from_rank) return false;
-    return true;
+    return isSameType(as, &(bra->h), a);
 }
 
 static bool isSameGroupReduce(Laik_BackendAction* ba, Laik_Action* a)
@@ -1117,6 +1175,8 @@ static bool isSameGroupReduce(Laik_BackendAction* ba, Laik_Action* a)
     assert(ba->h.type == LAIK_AT_GroupReduce);
     if (a->type != LAIK_AT_GroupReduce) return false;
     if (a->round != ba->h.round) return false;
+    // input/output group IDs are specific to a transition
+    if (a->tid != ba->h.tid) return false;
 
     Laik_BackendAction* ba2 = (Laik_BackendAction*) a;
     if (ba2->inputGroup != ba->inputGroup) return false;
@@ -1125,7 +1185,7 @@ static bool isSameGroupReduce(Laik_BackendAction* ba, Laik_Action* a)
     return true;
 }
 
-static bool isSameReduce(Laik_BackendAction* ba, Laik_Action* a)
+static bool isSameReduce(Laik_ActionSeq* as, Laik_BackendAction* ba, Laik_Action* a)
 {
     assert(ba->h.type == LAIK_AT_Reduce);
     if (a->type != LAIK_AT_Reduce) return false;
@@ -1134,14 +1194,16 @@ static bool isSameReduce(Laik_BackendAction* ba, Laik_Action* a)
     Laik_BackendAction* ba2 = (Laik_BackendAction*) a;
     if (ba2->rank != ba->rank) return false;
     if (ba2->redOp != ba->redOp) return false;
-    return true;
+    return isSameType(as, &(ba->h), a);
 }
 
 
 /* Merge send/recv/groupReduce/reduce actions from "oldAS" into "as".
  *
  * We merge actions with same communication partners, marking actions
- * already merged.
+ * already merged. Actions from different transition contexts (ie. multiple
+ * containers switched at once) are merged if the data types match, such
+ * that all data going to the same peer in a round is sent in one message.
  * A merging of similar actions results in up to 3 new actions:
  * - a multi-copy actions with copy ranges, to copy into a temporary buffer
  *   (only if this process provides input)
@@ -1169,11 +1231,11 @@ bool laik_aseq_combineActions(Laik_ActionSeq* as)
     // must not have new actions, we want to start a new build
     assert(as->newActionCount == 0);
 
+    // all contexts are for transitions on the same group
     Laik_TransitionContext* tc = as->context[0];
-    Laik_Data* d = tc->data;
-    unsigned int elemsize = d->elemsize;
     // used for combining GroupReduce actions
     int myid = tc->transition->group->myid;
+    unsigned int elemsize;
 
     // unmark all actions first
     // all actions will be marked on combining, to not process them twice
@@ -1181,13 +1243,18 @@ bool laik_aseq_combineActions(Laik_ActionSeq* as)
     for(unsigned int i = 0; i < as->actionCount; i++, a = nextAction(a))
         a->mark = 0;
 
-    // first pass: how much buffer space / copy range elements is needed?
+    // first pass: how much buffer space (in bytes) / copy range elements
+    // is needed?
     unsigned int bufSize = 0, copyRanges = 0;
     a = as->action;
     for(unsigned int i = 0; i < as->actionCount; i++, a = nextAction(a)) {
         // skip already combined actions
         if (a->mark == 1) continue;
 
+        // combined actions all have same element size
+        elemsize = actionElemsize(as, a);
+        tc = as->context[a->tid];
+
         switch(a->type) {
         case LAIK_AT_BufSend: {
             // combine all BufSend actions in same round with same target rank
@@ -1196,14 +1263,14 @@ bool laik_aseq_combineActions(Laik_ActionSeq* as)
             unsigned int actionCount = 0;
             Laik_Action* a2 = a;
             for(unsigned int j = i; j < as->actionCount; j++, a2 = nextAction(a2)) {
-                if (!isSameBufSend(bsa, a2)) continue;
+                if (!isSameBufSend(as, bsa, a2)) continue;
 
                 a2->mark = 1;
                 countSum += ((Laik_A_BufSend*)a2)->count;
                 actionCount++;
             }
             if (actionCount > 1) {
-                bufSize += countSum;
+                bufSize += countSum * elemsize;
                 copyRanges += actionCount;
             }
             break;
@@ -1216,14 +1283,14 @@ bool laik_aseq_combineActions(Laik_ActionSeq* as)
             unsigned int actionCount = 0;
             Laik_Action* a2 = a;
             for(unsigned int j = i; j < as->actionCount; j++, a2 = nextAction(a2)) {
-                if (!isSameBufRecv(bra, a2)) continue;
+                if (!isSameBufRecv(as, bra, a2)) continue;
 
                 a2->mark = 1;
                 countSum += ((Laik_A_BufRecv*)a2)->count;
                 actionCount++;
             }
             if (actionCount > 1) {
-                bufSize += countSum;
+                bufSize += countSum * elemsize;
                 copyRanges += actionCount;
             }
             break;
@@ -1244,7 +1311,7 @@ bool laik_aseq_combineActions(Laik_ActionSeq* as)
                 actionCount++;
             }
             if (actionCount > 1) {
-                bufSize += countSum;
+                bufSize += countSum * elemsize;
                 if (laik_trans_isInGroup(tc->transition, ba->inputGroup, myid))
                     copyRanges += actionCount;
                 if (laik_trans_isInGroup(tc->transition, ba->outputGroup, myid))
@@ -1260,14 +1327,14 @@ bool laik_aseq_combineActions(Laik_ActionSeq* as)
             unsigned int actionCount = 0;
             Laik_Action* a2 = a;
             for(unsigned int j = i; j < as->actionCount; j++, a2 = nextAction(a2)) {
-                if (!isSameReduce(ba, a2)) continue;
+                if (!isSameReduce(as, ba, a2)) continue;
 
                 a2->mark = 1;
                 countSum += ((Laik_BackendAction*)a2)->count;
                 actionCount++;
             }
             if (actionCount > 1) {
-                bufSize += countSum;
+                bufSize += countSum * elemsize;
                 // always providing input, copy input ranges
                 copyRanges += actionCount;
                 // if I want result, we can reuse the input ranges
@@ -1298,17 +1365,17 @@ bool laik_aseq_combineActions(Laik_ActionSeq* as)
     as->ceCount++;
     as->ceRanges += copyRanges;
 
-    int bufID = laik_aseq_addBufReserve(as, bufSize * elemsize, -1);
+    int bufID = laik_aseq_addBufReserve(as, bufSize, -1);
 
-    laik_log(1, "Reservation for combined actions: length %d x %d, ranges %d",
-             bufSize, elemsize, copyRanges);
+    laik_log(1, "Reservation for combined actions: length %d bytes, ranges %d",
+             bufSize, copyRanges);
 
     // unmark all actions: restart for finding same type of actions
     a = as->action;
     for(unsigned int i = 0; i < as->actionCount; i++, a = nextAction(a))
         a->mark = 0;
 
-    // second pass: add merged actions
+    // second pass: add merged actions (buffer offsets in bytes)
     unsigned int bufOff = 0;
     unsigned int rangeOff = 0;
 
@@ -1317,6 +1384,10 @@ bool laik_aseq_combineActions(Laik_ActionSeq* as)
         // skip already processed actions
         if (a->mark == 1) continue;
 
+        elemsize = actionElemsize(as, a);
+        tc = as->context[a->tid];
+        as->currentTid = a->tid;
+
         switch(a->type) {
         case LAIK_AT_BufSend: {
             Laik_A_BufSend* bsa = (Laik_A_BufSend*) a;
@@ -1324,7 +1395,7 @@ bool laik_aseq_combineActions(Laik_ActionSeq* as)
             unsigned int actionCount = 0;
             Laik_Action* a2 = a;
             for(unsigned int j = i; j < as->actionCount; j++, a2 = nextAction(a2)) {
-                if (!isSameBufSend(bsa, a2)) continue;
+                if (!isSameBufSend(as, bsa, a2)) continue;
 
                 a2->mark = 1;
                 countSum += ((Laik_A_BufSend*)a2)->count;
@@ -1338,19 +1409,19 @@ bool laik_aseq_combineActions(Laik_ActionSeq* as)
                                         bufID, 0,
                                         actionCount);
                 laik_aseq_addRBufSend(as, 3 * a->round + 1,
-                                      bufID, bufOff * elemsize,
+                                      bufID, bufOff,
                                       countSum, bsa->to_rank);
                 unsigned int oldRangeOff = rangeOff;
                 Laik_Action* a2 = a;
                 for(unsigned int k = i; k < as->actionCount; k++, a2 = nextAction(a2)) {
-                    if (!isSameBufSend(bsa, a2)) continue;
+                    if (!isSameBufSend(as, bsa, a2)) continue;
 
                     Laik_A_BufSend* bsa2 = (Laik_A_BufSend*) a2;
                     assert(rangeOff < copyRanges);
                     ce[rangeOff].ptr = bsa2->buf;
                     ce[rangeOff].bytes = bsa2->count * elemsize;
-                    ce[rangeOff].offset = bufOff * elemsize;
-                    bufOff += bsa2->count;
+                    ce[rangeOff].offset = bufOff;
+                    bufOff += bsa2->count * elemsize;
                     rangeOff++;
                 }
                 assert(oldRangeOff + actionCount == rangeOff);
@@ -1367,7 +1438,7 @@ bool laik_aseq_combineActions(Laik_ActionSeq* as)
             unsigned int actionCount = 0;
             Laik_Action* a2 = a;
             for(unsigned int j = i; j < as->actionCount; j++, a2 = nextAction(a2)) {
-                if (!isSameBufRecv(bra, a2)) continue;
+                if (!isSameBufRecv(as, bra, a2)) continue;
 
                 a2->mark = 1;
                 countSum += ((Laik_A_BufRecv*)a2)->count;
@@ -1375,7 +1446,7 @@ bool laik_aseq_combineActions(Laik_ActionSeq* as)
             }
             if (actionCount > 1) {
                 laik_aseq_addRBufRecv(as, 3 * a->round + 1,
-                                      bufID, bufOff * elemsize,
+                                      bufID, bufOff,
                                       countSum, bra->from_rank);
                 laik_aseq_addCopyFromRBuf(as, 3 * a->round + 2,
                                           ce + rangeOff,
@@ -1384,14 +1455,14 @@ bool laik_aseq_combineActions(Laik_ActionSeq* as)
                 unsigned int oldRangeOff = rangeOff;
                 Laik_Action* a2 = a;
                 for(unsigned int k = i; k < as->actionCount; k++, a2 = nextAction(a2)) {
-                    if (!isSameBufRecv(bra, a2)) continue;
+                    if (!isSameBufRecv(as, bra, a2)) continue;
 
                     Laik_A_BufRecv* bra2 = (Laik_A_BufRecv*) a2;
                     assert(rangeOff < copyRanges);
                     ce[rangeOff].ptr = bra2->buf;
                     ce[rangeOff].bytes = bra2->count * elemsize;
-                    ce[rangeOff].offset = bufOff * elemsize;
-                    bufOff += bra2->count;
+                    ce[rangeOff].offset = bufOff;
+                    bufOff += bra2->count * elemsize;
                     rangeOff++;
                 }
                 assert(oldRangeOff + actionCount == rangeOff);
@@ -1434,18 +1505,18 @@ bool laik_aseq_combineActions(Laik_ActionSeq* as)
                         assert(rangeOff < copyRanges);
                         ce[rangeOff].ptr = ba2->fromBuf;
                         ce[rangeOff].bytes = ba2->count * elemsize;
-                        ce[rangeOff].offset = bufOff * elemsize;
-                        bufOff += ba2->count;
+                        ce[rangeOff].offset = bufOff;
+                        bufOff += ba2->count * elemsize;
                         rangeOff++;
                     }
                     assert(oldRangeOff + actionCount == rangeOff);
-                    assert(startBufOff + countSum == bufOff);
+                    assert(startBufOff + countSum * elemsize == bufOff);
                 }
 
                 // use temporary buffer for both input and output
                 laik_aseq_addRBufGroupReduce(as, 3 * a->round + 1,
                                              ba->inputGroup, ba->outputGroup,
-                                             bufID, startBufOff * elemsize,
+                                             bufID, startBufOff,
                                              countSum, ba->redOp);
 
                 // if I want output: copy pieces from temporary buffer
@@ -1464,14 +1535,14 @@ bool laik_aseq_combineActions(Laik_ActionSeq* as)
                         assert(rangeOff < copyRanges);
                         ce[rangeOff].ptr = ba2->toBuf;
                         ce[rangeOff].bytes = ba2->count * elemsize;
-                        ce[rangeOff].offset = bufOff * elemsize;
-                        bufOff += ba2->count;
+                        ce[rangeOff].offset = bufOff;
+                        bufOff += ba2->count * elemsize;
                         rangeOff++;
                     }
                     assert(oldRangeOff + actionCount == rangeOff);
-                    assert(startBufOff + countSum == bufOff);
+                    assert(startBufOff + countSum * elemsize == bufOff);
                 }
-                bufOff = startBufOff + countSum;
+                bufOff = startBufOff + countSum * elemsize;
             }
             else
                 laik_aseq_addGroupReduce(as, 3 * a->round + 1,
@@ -1487,7 +1558,7 @@ bool laik_aseq_combineActions(Laik_ActionSeq* as)
             unsigned int actionCount = 0;
             Laik_Action* a2 = a;
             for(unsigned int j = i; j < as->actionCount; j++, a2 = nextAction(a2)) {
-                if (!isSameReduce(ba, a2)) continue;
+                if (!isSameReduce(as, ba, a2)) continue;
 
                 a2->mark = 1;
                 countSum += ((Laik_BackendAction*)a2)->count;
@@ -1506,22 +1577,22 @@ bool laik_aseq_combineActions(Laik_ActionSeq* as)
                 unsigned int oldRangeOff = rangeOff;
                 Laik_Action* a2 = a;
                 for(unsigned int k = i; k < as->actionCount; k++, a2 = nextAction(a2)) {
-                    if (!isSameReduce(ba, a2)) continue;
+                    if (!isSameReduce(as, ba, a2)) continue;
 
                     Laik_BackendAction* ba2 = (Laik_BackendAction*) a2;
                     assert(rangeOff < copyRanges);
                     ce[rangeOff].ptr = ba2->fromBuf;
                     ce[rangeOff].bytes = ba2->count * elemsize;
-                    ce[rangeOff].offset = bufOff * elemsize;
-                    bufOff += ba2->count;
+                    ce[rangeOff].offset = bufOff;
+                    bufOff += ba2->count * elemsize;
                     rangeOff++;
                 }
                 assert(oldRangeOff + actionCount == rangeOff);
-                assert(startBufOff + countSum == bufOff);
+                assert(startBufOff + countSum * elemsize == bufOff);
 
                 // use temporary buffer for both input and output
                 laik_aseq_addRBufReduce(as, 3 * a->round + 1,
-                                           bufID, startBufOff * elemsize,
+                                           bufID, startBufOff,
                                            countSum, ba->rank, ba->redOp);
 
                 // if I want result, copy output ranges
@@ -1536,20 +1607,20 @@ bool laik_aseq_combineActions(Laik_ActionSeq* as)
                     unsigned int oldRangeOff = rangeOff;
                     Laik_Action* a2 = a;
                     for(unsigned int k = i; k < as->actionCount; k++, a2 = nextAction(a2)) {
-                        if (!isSameReduce(ba, a2)) continue;
+                        if (!isSameReduce(as, ba, a2)) continue;
 
                         Laik_BackendAction* ba2 = (Laik_BackendAction*) a2;
                         assert(rangeOff < copyRanges);
                         ce[rangeOff].ptr = ba2->toBuf;
                         ce[rangeOff].bytes = ba2->count * elemsize;
-                        ce[rangeOff].offset = bufOff * elemsize;
-                        bufOff += ba2->count;
+                        ce[rangeOff].offset = bufOff;
+                        bufOff += ba2->count * elemsize;
                         rangeOff++;
                     }
                     assert(oldRangeOff + actionCount == rangeOff);
-                    assert(startBufOff + countSum == bufOff);
+                    assert(startBufOff + countSum * elemsize == bufOff);
                 }
-                bufOff = startBufOff + countSum;
+                bufOff = startBufOff + countSum * elemsize;
             }
             else
                 laik_aseq_addReduce(as, 3 * a->round + 1,
@@ -1621,6 +1692,29 @@ int getActionPeer(Laik_Action* a)
 
 // used by compare functions, set directly before sort
 static int myid4cmp;
+static Laik_Backend* backend4cmp;
+
+// return peer rank of a send/recv action for sorting, and set <isSend> and
+// <isRecv>. Backend-specific actions are asked via action_peer hook
+static
+int msgPeer4cmp(Laik_Action* a, bool* isSend, bool* isRecv)
+{
+    *isSend = laik_action_isSend(a);
+    *isRecv = laik_action_isRecv(a);
+    if (*isSend || *isRecv)
+        return getActionPeer(a);
+
+    if ((a->type >= LAIK_AT_Backend) && backend4cmp &&
+        backend4cmp->action_peer) {
+        int peer = (backend4cmp->action_peer)(a, isSend);
+        if (peer >= 0) {
+            *isRecv = !*isSend;
+            return peer;
+        }
+        *isSend = false;
+    }
+    return 0;
+}
 
 static
 int cmp2phase(const void* aptr1, const void* aptr2)
@@ -1631,12 +1725,9 @@ int cmp2phase(const void* aptr1, const void* aptr2)
     if (a1->round != a2->round)
         return a1->round - a2->round;
 
-    bool a1isSend = laik_action_isSend(a1);
-    bool a2isSend = laik_action_isSend(a2);
-    bool a1isRecv = laik_action_isRecv(a1);
-    bool a2isRecv = laik_action_isRecv(a2);
-    int a1peer = (a1isSend || a1isRecv) ? getActionPeer(a1) : 0;
-    int a2peer = (a2isSend || a2isRecv) ? getActionPeer(a2) : 0;
+    bool a1isSend, a1isRecv, a2isSend, a2isRecv;
+    int a1peer = msgPeer4cmp(a1, &a1isSend, &a1isRecv);
+    int a2peer = msgPeer4cmp(a2, &a2isSend, &a2isRecv);
 
     int a1phase = 0;
     if (a1isRecv) a1phase = (a1peer < myid4cmp) ? 1 : 4;
@@ -1692,6 +1783,7 @@ bool laik_aseq_sort_2phases(Laik_ActionSeq* as)
 
     Laik_TransitionContext* tc = as->context[0];
     myid4cmp = tc->transition->group->myid;
+    backend4cmp = as->backend;
     qsort(order, as->actionCount, sizeof(void*), cmp2phase);
 
     // check if something changed
@@ -1720,12 +1812,9 @@ int cmp_rankdigits(const void* aptr1, const void* aptr2)
     if (a1->round != a2->round)
         return a1->round - a2->round;
 
-    bool a1isSend = laik_action_isSend(a1);
-    bool a2isSend = laik_action_isSend(a2);
-    bool a1isRecv = laik_action_isRecv(a1);
-    bool a2isRecv = laik_action_isRecv(a2);
-    int a1peer = getActionPeer(a1);
-    int a2peer = getActionPeer(a2);
+    bool a1isSend, a1isRecv, a2isSend, a2isRecv;
+    int a1peer = msgPeer4cmp(a1, &a1isSend, &a1isRecv);
+    int a2peer = msgPeer4cmp(a2, &a2isSend, &a2isRecv);
 
     // phase number is number of lower digits equal to my rank
     int a1phase = 0, a2phase = 0, mask = 0;
@@ -1789,6 +1878,7 @@ bool laik_aseq_sort_rankdigits(Laik_ActionSeq* as)
 
     Laik_TransitionContext* tc = as->context[0];
     myid4cmp = tc->transition->group->myid;
+    backend4cmp = as->backend;
     qsort(order, as->actionCount, sizeof(void*), cmp_rankdigits);
 
     // check if something changed
@@ -1862,6 +1952,7 @@ bool laik_aseq_sort_rounds(Laik_ActionSeq* as)
 /*
  * transform MapPackAndSend/MapRecvAndUnpack into simple Send/Recv actions
  * if mapping is known and direct send/recv is possible
+ * (1d ranges, or ranges stored contiguously in an allocated lex layout)
  *
  * we enforce the following rounds:
  * - round 0: eventually pack from container to buffer
@@ -1870,9 +1961,14 @@ bool laik_aseq_sort_rounds(Laik_ActionSeq* as)
  * All action round numbers are spreaded by *3+1, allowing space for added
  * pack/unpack copy actions before/after.
  *
+ * With <maxSize> > 0, actions for ranges with more than <maxSize> bytes
+ * are kept, to be executed by the backend with chunked packing. As this
+ * only depends on range size, the decision is the same at sender and
+ * receiver.
+ *
  * return true if action sequence changed
 */
-bool laik_aseq_flattenPacking(Laik_ActionSeq* as)
+bool laik_aseq_flattenPackingMax(Laik_ActionSeq* as, uint64_t maxSize)
 {
     bool changed = false;
 
@@ -1883,18 +1979,22 @@ bool laik_aseq_flattenPacking(Laik_ActionSeq* as)
     // must not have new actions, we want to start a new build
     assert(as->newActionCount == 0);
 
-    Laik_TransitionContext* tc = as->context[0];
-    unsigned int elemsize = tc->data->elemsize;
-    int myid = tc->transition->group->myid;
-
     Laik_Action* a = as->action;
     for(unsigned int i = 0; i < as->actionCount; i++, a = nextAction(a)) {
         Laik_BackendAction* ba = (Laik_BackendAction*) a;
         bool handled = false;
 
+        // mappings and element size are given by context of action
+        Laik_TransitionContext* tc = as->context[a->tid];
+        unsigned int elemsize = tc->data->elemsize;
+        int myid = tc->transition->group->myid;
+        as->currentTid = a->tid;
+
         switch(a->type) {
         case LAIK_AT_MapPackAndSend: {
             Laik_A_MapPackAndSend* aa = (Laik_A_MapPackAndSend*) a;
+            if ((maxSize > 0) && ((uint64_t) aa->count * elemsize > maxSize))
+                break;
 
             if (tc->fromList)
                 assert(aa->fromMapNo < tc->fromList->count);
@@ -1923,6 +2023,16 @@ bool laik_aseq_flattenPacking(Laik_ActionSeq* as)
                                          count, aa->to_rank);
                 }
             }
+            else if (fromMap && fromMap->base &&
+                     laik_layout_lex_contiguous(fromMap->layout,
+                                                fromMap->layoutSection,
+                                                aa->range, &from)) {
+                // 2d/3d range contiguous in memory (e.g. full rows/planes):
+                // direct send from mapping without packing
+                laik_aseq_addBufSend(as, 3 * a->round + 1,
+                                     fromMap->start + from * elemsize,
+                                     aa->count, aa->to_rank);
+            }
             else {
                 // split off packing and sending, using a buffer of required size
                 int bufID = laik_aseq_addBufReserve(as, aa->count * elemsize, -1);
@@ -1942,6 +2052,8 @@ bool laik_aseq_flattenPacking(Laik_ActionSeq* as)
 
         case LAIK_AT_MapRecvAndUnpack: {
             Laik_A_MapRecvAndUnpack* aa = (Laik_A_MapRecvAndUnpack*) a;
+            if ((maxSize > 0) && ((uint64_t) aa->count * elemsize > maxSize))
+                break;
 
             if (tc->toList)
                 assert(aa->toMapNo < tc->toList->count);
@@ -1970,6 +2082,16 @@ bool laik_aseq_flattenPacking(Laik_ActionSeq* as)
                                          count, aa->from_rank);
                 }
             }
+            else if (toMap && toMap->base &&
+                     laik_layout_lex_contiguous(toMap->layout,
+                                                toMap->layoutSection,
+                                                aa->range, &from)) {
+                // 2d/3d range contiguous in memory (e.g. full rows/planes):
+                // direct receive into mapping without unpacking
+                laik_aseq_addBufRecv(as, 3 * a->round + 1,
+                                     toMap->start + from * elemsize,
+                                     aa->count, aa->from_rank);
+            }
             else {
                 // split off receiving and unpacking, using buffer of required size
                 int bufID = laik_aseq_addBufReserve(as, aa->count * elemsize, -1);
@@ -2058,13 +2180,18 @@ bool laik_aseq_flattenPacking(Laik_ActionSeq* as)
     return changed;
 }
 
+bool laik_aseq_flattenPacking(Laik_ActionSeq* as)
+{
+    return laik_aseq_flattenPackingMax(as, 0);
+}
+
 // helpers for splitReduce transformation
 
 // add actions for 3-step manual reduction for a group-reduce action
-// spread rounds by 3
+// starting at <round>, spread rounds by 3
 // round 0: send to reduce task, round 1: reduction, round 2: send back
 static
-void laik_aseq_addReduce3Rounds(Laik_ActionSeq* as,
+void laik_aseq_addReduce3Rounds(Laik_ActionSeq* as, int round,
                                 Laik_TransitionContext* tc, Laik_BackendAction* ba)
 {
     assert(ba->h.type == LAIK_AT_GroupReduce);
@@ -2080,13 +2207,13 @@ void laik_aseq_addReduce3Rounds(Laik_ActionSeq* as,
 
         if (laik_trans_isInGroup(t, ba->inputGroup, myid)) {
             // send action in round 0
-            laik_aseq_addBufSend(as, 3 * ba->h.round,
+            laik_aseq_addBufSend(as, round,
                                  ba->fromBuf, ba->count, reduceTask);
         }
 
         if (laik_trans_isInGroup(t, ba->outputGroup, myid)) {
             // recv action only in round 2
-            laik_aseq_addBufRecv(as, 3 * ba->h.round + 2,
+            laik_aseq_addBufRecv(as, round + 2,
                                  ba->toBuf, ba->count, reduceTask);
         }
 
@@ -2128,7 +2255,7 @@ void laik_aseq_addReduce3Rounds(Laik_ActionSeq* as,
         int inTask = laik_trans_taskInGroup(t, ba->inputGroup, i);
         if (inTask == myid) continue;
 
-        laik_aseq_addRBufRecv(as, 3 * ba->h.round,
+        laik_aseq_addRBufRecv(as, round,
                               bufID, off, ba->count, inTask);
         bufOff[ii++] = off;
         off += byteCount;
@@ -2138,7 +2265,7 @@ void laik_aseq_addReduce3Rounds(Laik_ActionSeq* as,
 
     if (inCount == 0) {
         // no input: add init action for neutral element of reduction
-        laik_aseq_addBufInit(as, 3 * ba->h.round + 1,
+        laik_aseq_addBufInit(as, round + 1,
                              data->type, ba->redOp, ba->toBuf, ba->count);
     }
     else {
@@ -2146,19 +2273,19 @@ void laik_aseq_addReduce3Rounds(Laik_ActionSeq* as,
         if (inputFromMe) {
             if (ba->fromBuf != ba->toBuf) {
                 // if my input is not already at a->toBuf, copy it
-                laik_aseq_addBufCopy(as, 3 * ba->h.round + 1,
+                laik_aseq_addBufCopy(as, round + 1,
                                      ba->fromBuf, ba ->toBuf, ba->count);
             }
         }
         else {
             // copy first input to a->toBuf
-            laik_aseq_addRBufCopy(as,  3 * ba->h.round + 1,
+            laik_aseq_addRBufCopy(as,  round + 1,
                                   bufID, bufOff[0], ba->toBuf, ba->count);
         }
 
         // do reduction with other inputs
         for(int t = 1; t < inCount; t++)
-            laik_aseq_addRBufLocalReduce(as, 3 * ba->h.round + 1,
+            laik_aseq_addRBufLocalReduce(as, round + 1,
                                          data->type, ba->redOp,
                                          bufID, bufOff[t],
                                          ba->toBuf, ba->count);
@@ -2173,16 +2300,17 @@ void laik_aseq_addReduce3Rounds(Laik_ActionSeq* as,
             continue;
         }
 
-        laik_aseq_addBufSend(as,  3 * ba->h.round + 2,
+        laik_aseq_addBufSend(as,  round + 2,
                              ba->toBuf, ba->count, outTask);
     }
 }
 
 // add actions for 2-step manual reduction for a group-reduce action
-// intermixed with 3-step reduction, thus need to spread rounds by 3
+// starting at <round>, intermixed with 3-step reduction, thus need to
+// spread rounds by 3
 // round 0: send/recv, round 1: reduction
 static
-void laik_aseq_addReduce2Rounds(Laik_ActionSeq* as,
+void laik_aseq_addReduce2Rounds(Laik_ActionSeq* as, int round,
                                 Laik_TransitionContext* tc, Laik_BackendAction* ba)
 {
     assert(ba->h.type == LAIK_AT_GroupReduce);
@@ -2203,7 +2331,7 @@ void laik_aseq_addReduce2Rounds(Laik_ActionSeq* as,
                 continue;
             }
 
-            laik_aseq_addBufSend(as,  3 * ba->h.round,
+            laik_aseq_addBufSend(as,  round,
                                  ba->fromBuf, ba->count, outTask);
         }
     }
@@ -2244,7 +2372,7 @@ void laik_aseq_addReduce2Rounds(Laik_ActionSeq* as,
         int inTask = laik_trans_taskInGroup(t, ba->inputGroup, i);
         if (inTask == myid) continue;
 
-        laik_aseq_addRBufRecv(as, 3 * ba->h.round,
+        laik_aseq_addRBufRecv(as, round,
                               bufID, off, ba->count, inTask);
         bufOff[ii++] = off;
         off += byteCount;
@@ -2254,7 +2382,7 @@ void laik_aseq_addReduce2Rounds(Laik_ActionSeq* as,
 
     if (inCount == 0) {
         // no input: add init action for neutral element of reduction
-        laik_aseq_addBufInit(as, 3 * ba->h.round + 1,
+        laik_aseq_addBufInit(as, round + 1,
                              data->type, ba->redOp, ba->toBuf, ba->count);
     }
     else {
@@ -2262,37 +2390,235 @@ void laik_aseq_addReduce2Rounds(Laik_ActionSeq* as,
         if (inputFromMe) {
             if (ba->fromBuf != ba->toBuf) {
                 // if my input is not already at a->toBuf, copy it
-                laik_aseq_addBufCopy(as, 3 * ba->h.round +1,
+                laik_aseq_addBufCopy(as, round +1,
                                      ba->fromBuf, ba ->toBuf, ba->count);
             }
         }
         else {
             // copy first input to a->toBuf
-            laik_aseq_addRBufCopy(as, 3 * ba->h.round + 1,
+            laik_aseq_addRBufCopy(as, round + 1,
                                   bufID, bufOff[0], ba->toBuf, ba->count);
         }
 
         // do reduction with other inputs
         for(int t = 1; t < inCount; t++)
-            laik_aseq_addRBufLocalReduce(as, 3 * ba->h.round +1,
+            laik_aseq_addRBufLocalReduce(as, round +1,
                                          data->type, ba->redOp,
                                          bufID, bufOff[t],
                                          ba->toBuf, ba->count);
     }
 }
 
+// add actions to receive the inputs of <count> tasks <from> in <round> into
+// a new buffer and reduce them in <round>+1 together with own input at
+// <myBuf> (if not 0) into toBuf. Without any input, set neutral element
+static
+void laik_aseq_addReduceFrom(Laik_ActionSeq* as, Laik_Data* data,
+                             Laik_BackendAction* ba, int round,
+                             int count, int* from, char* myBuf)
+{
+    unsigned int byteCount = ba->count * data->elemsize;
+    int bufID = -1;
+    if (count > 0)
+        bufID = laik_aseq_addBufReserve(as, count * byteCount, -1);
+    for(int i = 0; i < count; i++)
+        laik_aseq_addRBufRecv(as, round,
+                              bufID, i * byteCount, ba->count, from[i]);
+
+    int first = 0;
+    if (myBuf) {
+        // reduce on own input, which is not overwritten before
+        if (myBuf != ba->toBuf)
+            laik_aseq_addBufCopy(as, round + 1, myBuf, ba->toBuf, ba->count);
+    }
+    else if (count > 0) {
+        laik_aseq_addRBufCopy(as, round + 1, bufID, 0, ba->toBuf, ba->count);
+        first = 1;
+    }
+    else
+        laik_aseq_addBufInit(as, round + 1,
+                             data->type, ba->redOp, ba->toBuf, ba->count);
+
+    for(int i = first; i < count; i++)
+        laik_aseq_addRBufLocalReduce(as, round + 1, data->type, ba->redOp,
+                                     bufID, i * byteCount,
+                                     ba->toBuf, ba->count);
+}
+
+// calculate node leaders for a hierarchical reduction from <inputGroup>
+// to <outputGroup> in transition <t>, with node IDs <node> indexed by
+// location ID. The leader of a node is the smallest task of the output
+// group on that node. Sets <leader>[task] (array of group size) to the
+// leader of the node of <task>, or -1 if <task> is not involved.
+// Returns false if not applicable: if there is a node with input but no
+// output tasks, or no node with more than one task involved (then, a
+// hierarchical reduction has no advantage)
+bool laik_trans_nodeLeaders(Laik_Transition* t, int inputGroup,
+                            int outputGroup, int* node, int* leader)
+{
+    Laik_Group* g = t->group;
+    bool applicable = true;
+    int involved = 0, leaders = 0;
+    for(int pass = 0; pass < 2; pass++) {
+        // pass 0: tasks in output group, pass 1: remaining input tasks
+        for(int task = 0; task < g->size; task++) {
+            if (pass == 0) {
+                leader[task] = -1;
+                if (!laik_trans_isInGroup(t, outputGroup, task)) continue;
+            }
+            else {
+                if (leader[task] >= 0) continue;
+                if (!laik_trans_isInGroup(t, inputGroup, task)) continue;
+            }
+            int n = node[g->locationid[task]];
+            for(int j = 0; j < task; j++) {
+                if (leader[j] != j) continue;
+                if (node[g->locationid[j]] != n) continue;
+                leader[task] = j;
+                break;
+            }
+            if (leader[task] < 0) {
+                if (pass == 1) applicable = false;
+                leader[task] = task;
+                leaders++;
+            }
+            involved++;
+        }
+    }
+    return applicable && (leaders > 0) && (leaders < involved);
+}
+
+// add actions for hierarchical reduction for a group-reduce action, using
+// node IDs <node> of process locations: first reduce on node leaders (see
+// laik_trans_nodeLeaders), then across leaders on the reduce task, and
+// finally send the result back to the tasks in the output group via their
+// node leaders. Only leaders communicate across nodes, with at most one
+// message per node in each direction.
+// Spread rounds by 6:
+// round 0: send to node leader, round 1: reduction on leaders,
+// round 2: send to reduce task, round 3: reduction, round 4: send back
+// to node leaders, round 5: send to tasks on same node.
+// Returns false without adding actions if not applicable
+static
+bool laik_aseq_addReduceNodes(Laik_ActionSeq* as, Laik_TransitionContext* tc,
+                              Laik_BackendAction* ba, int* node)
+{
+    assert(ba->h.type == LAIK_AT_GroupReduce);
+    Laik_Transition* t = tc->transition;
+    Laik_Group* g = t->group;
+    int myid = g->myid;
+
+    // hasInput[task]: for leaders, does any task on its node provide input?
+    int* leader = malloc(2 * g->size * sizeof(int));
+    if (!leader) {
+        laik_panic("Out of memory allocating reduction leader array");
+        exit(1); // not actually needed, laik_panic never returns
+    }
+    int* hasInput = leader + g->size;
+
+    if (!laik_trans_nodeLeaders(t, ba->inputGroup, ba->outputGroup,
+                                node, leader)) {
+        free(leader);
+        return false;
+    }
+    for(int task = 0; task < g->size; task++)
+        hasInput[task] = 0;
+    for(int task = 0; task < g->size; task++)
+        if (laik_trans_isInGroup(t, ba->inputGroup, task))
+            hasInput[leader[task]] = 1;
+
+    if ((myid < 0) || (leader[myid] < 0)) {
+        // not involved
+        free(leader);
+        return true;
+    }
+
+    // smallest task in output group always is a leader
+    int reduceTask = laik_trans_taskInGroup(t, ba->outputGroup, 0);
+    assert(leader[reduceTask] == reduceTask);
+    int round = 6 * ba->h.round;
+    bool inputFromMe = laik_trans_isInGroup(t, ba->inputGroup, myid);
+    bool outputToMe = laik_trans_isInGroup(t, ba->outputGroup, myid);
+
+    if (leader[myid] != myid) {
+        // not a leader: eventually send input and recv result
+        if (inputFromMe)
+            laik_aseq_addBufSend(as, round, ba->fromBuf, ba->count,
+                                 leader[myid]);
+        if (outputToMe)
+            laik_aseq_addBufRecv(as, round + 5, ba->toBuf, ba->count,
+                                 leader[myid]);
+        free(leader);
+        return true;
+    }
+
+    // we are a leader (always in output group): reduce inputs of our node
+    assert(outputToMe);
+    int* from = malloc(g->size * sizeof(int));
+    if (!from) {
+        laik_panic("Out of memory allocating reduction input array");
+        exit(1); // not actually needed, laik_panic never returns
+    }
+    int count = 0;
+    for(int task = 0; task < g->size; task++)
+        if ((task != myid) && (leader[task] == myid) &&
+            laik_trans_isInGroup(t, ba->inputGroup, task))
+            from[count++] = task;
+    if (hasInput[myid])
+        laik_aseq_addReduceFrom(as, tc->data, ba, round, count, from,
+                                inputFromMe ? ba->fromBuf : 0);
+
+    if (myid != reduceTask) {
+        if (hasInput[myid])
+            laik_aseq_addBufSend(as, round + 2, ba->toBuf, ba->count,
+                                 reduceTask);
+        laik_aseq_addBufRecv(as, round + 4, ba->toBuf, ba->count,
+                             reduceTask);
+    }
+    else {
+        // reduce task: reduce partial results of other nodes
+        count = 0;
+        for(int task = 0; task < g->size; task++)
+            if ((task != myid) && (leader[task] == task) && hasInput[task])
+                from[count++] = task;
+        laik_aseq_addReduceFrom(as, tc->data, ba, round + 2, count, from,
+                                hasInput[myid] ? ba->toBuf : 0);
+
+        for(int task = 0; task < g->size; task++)
+            if ((task != myid) && (leader[task] == task))
+                laik_aseq_addBufSend(as, round + 4, ba->toBuf, ba->count,
+                                     task);
+    }
+
+    // send result to tasks in output group on our node
+    for(int task = 0; task < g->size; task++)
+        if ((task != myid) && (leader[task] == myid) &&
+            laik_trans_isInGroup(t, ba->outputGroup, task))
+            laik_aseq_addBufSend(as, round + 5, ba->toBuf, ba->count, task);
+
+    free(from);
+    free(leader);
+    return true;
+}
+
 // transformation for split reduce actions into basic multiple actions.
 // action round numbers are spreaded by *3+1, allowing space for 3-step
 // return true if sequence changed
 bool laik_aseq_splitReduce(Laik_ActionSeq* as)
+{
+    return laik_aseq_splitReduceNodes(as, 0);
+}
+
+// same, but with node IDs <node> for process locations (indexed by location
+// ID), use hierarchical reduction to reduce messages between nodes where
+// applicable. Then, rounds are spreaded by *6+1
+bool laik_aseq_splitReduceNodes(Laik_ActionSeq* as, int* node)
 {
     bool reduceFound = false;
 
     // must not have new actions, we want to start a new build
     assert(as->newActionCount == 0);
 
-    Laik_TransitionContext* tc = as->context[0];
-
     Laik_Action* a = as->action;
     for(unsigned int i = 0; i < as->actionCount; i++, a = nextAction(a)) {
         if (a->type == LAIK_AT_GroupReduce) {
@@ -2303,25 +2629,31 @@ bool laik_aseq_splitReduce(Laik_ActionSeq* as)
     if (!reduceFound)
         return false;
 
+    int spread = node ? 6 : 3;
+
     a = as->action;
     for(unsigned int i = 0; i < as->actionCount; i++, a = nextAction(a)) {
         Laik_BackendAction* ba = (Laik_BackendAction*) a;
 
         switch(a->type) {
         case LAIK_AT_GroupReduce: {
+            Laik_TransitionContext* tc = as->context[a->tid];
+            as->currentTid = a->tid;
+            if (node && laik_aseq_addReduceNodes(as, tc, ba, node))
+                break;
             int inCount, outCount;
             inCount = laik_trans_groupCount(tc->transition, ba->inputGroup);
             outCount = laik_trans_groupCount(tc->transition, ba->inputGroup);
             // use simple 3-step reduction if too many messages for 2-step
             if (inCount * outCount > 4 * (inCount + outCount))
-                laik_aseq_addReduce3Rounds(as, tc, ba);
+                laik_aseq_addReduce3Rounds(as, spread * a->round, tc, ba);
             else
-                laik_aseq_addReduce2Rounds(as, tc, ba);
+                laik_aseq_addReduce2Rounds(as, spread * a->round, tc, ba);
             break;
         }
 
         default:
-            laik_aseq_add(a, as, 3 * a->round + 1);
+            laik_aseq_add(a, as, spread * a->round + 1);
             break;
         }
     }
@@ -2337,12 +2669,12 @@ bool laik_aseq_replaceWithAllReduce(Laik_ActionSeq* as)
     bool changed = false;
     assert(as->newActionCount == 0);
 
-    Laik_TransitionContext* tc = as->context[0];
-    Laik_Transition* t = tc->transition;
-
     Laik_Action* a = as->action;
     for(unsigned int i = 0; i < as->actionCount; i++, a = nextAction(a)) {
         Laik_BackendAction* ba = (Laik_BackendAction*) a;
+        Laik_TransitionContext* tc = as->context[a->tid];
+        Laik_Transition* t = tc->transition;
+        as->currentTid = a->tid;
 
         switch(a->type) {
         // TODO: LAIK_AT_MapGroupReduce
@@ -2386,7 +2718,6 @@ bool laik_aseq_splitTransitionExecs(Laik_ActionSeq* as)
     // must not have new actions, we want to start a new build
     assert(as->newActionCount == 0);
 
-    Laik_TransitionContext* tc = as->context[0];
     bool found = false;
     Laik_Action* a = as->action;
     for(unsigned int i = 0; i < as->actionCount; i++, a = nextAction(a)) {
@@ -2401,12 +2732,14 @@ bool laik_aseq_splitTransitionExecs(Laik_ActionSeq* as)
     a = as->action;
     for(unsigned int i = 0; i < as->actionCount; i++, a = nextAction(a)) {
         switch(a->type) {
-        case LAIK_AT_TExec:
-            assert(a->tid == 0);
+        case LAIK_AT_TExec: {
+            Laik_TransitionContext* tc = as->context[a->tid];
+            as->currentTid = a->tid;
             laik_aseq_addReds(as, a->round, tc->data, tc->transition);
             laik_aseq_addSends(as, a->round, tc->data, tc->transition);
             laik_aseq_addRecvs(as, a->round, tc->data, tc->transition);
             break;
+        }
 
         default:
             laik_aseq_add(a, as, -1);
@@ -2444,15 +2777,16 @@ int laik_aseq_calc_stats(Laik_ActionSeq* as)
     as->initOpCount = 0;
     as->reduceOpCount = 0;
     as->byteBufCopyCount = 0;
+    as->byteCompRawCount = 0;
+    as->byteCompCount = 0;
 
-    // TODO: we only allow 1 transition at the moment
-    Laik_TransitionContext* tc = as->context[0];
-    int current_tid = 0;
-    as->transitionCount = 1;
+    // each context is one transition
+    as->transitionCount = as->contextCount;
 
     Laik_Action* a = as->action;
     for(unsigned int i = 0; i < as->actionCount; i++, a = nextAction(a)) {
-        assert(a->tid == current_tid); // TODO: only assumes actions from one transition
+        assert(a->tid < as->contextCount);
+        Laik_TransitionContext* tc = as->context[a->tid];
 
         switch(a->type) {
         case LAIK_AT_TExec:
@@ -22,6 +22,7 @@
 #include "laik-backend-mpi.h"
 
 #include <assert.h>
+#include <limits.h>
 #include <stdlib.h>
 #include <mpi.h>
 #include <stdio.h>
@@ -38,8 +39,12 @@ static void laik_mpi_finalize(Laik_Instance*);
 static void laik_mpi_prepare(Laik_ActionSeq*);
 static void laik_mpi_cleanup(Laik_ActionSeq*);
 static void laik_mpi_exec(Laik_ActionSeq* as);
+static void laik_mpi_exec_start(Laik_ActionSeq* as);
+static bool laik_mpi_exec_test(Laik_ActionSeq* as);
+static void laik_mpi_exec_finish(Laik_ActionSeq* as);
 static void laik_mpi_updateGroup(Laik_Group*);
 static bool laik_mpi_log_action(Laik_Action* a);
+static int laik_mpi_action_peer(Laik_Action* a, bool* isSend);
 static void laik_mpi_sync(Laik_KVStore* kvs);
 
 // C guarantees that unset function pointers are NULL
@@ -49,8 +54,12 @@ static Laik_Backend laik_backend_mpi = {
     .prepare     = laik_mpi_prepare,
     .cleanup     = laik_mpi_cleanup,
     .exec        = laik_mpi_exec,
+    .exec_start  = laik_mpi_exec_start,
+    .exec_test   = laik_mpi_exec_test,
+    .exec_finish = laik_mpi_exec_finish,
     .updateGroup = laik_mpi_updateGroup,
     .log_action  = laik_mpi_log_action,
+    .action_peer = laik_mpi_action_peer,
     .sync        = laik_mpi_sync
 };
 
@@ -63,6 +72,7 @@ typedef struct {
 
 typedef struct {
     MPI_Comm comm;
+    MPI_Win win; // dynamic window for RMA mode, MPI_WIN_NULL if not used
 } MPIGroupData;
 
 //----------------------------------------------------------------
@@ -75,6 +85,90 @@ static int mpi_reduce = 1;
 // LAIK_MPI_ASYNC: convert send/recv to isend/irecv? Default: Yes
 static int mpi_async = 1;
 
+// LAIK_MPI_IREDUCE: with LAIK_MPI_ASYNC, also start reductions done with
+// MPI_(All)reduce as non-blocking collectives, waiting for completion only
+// in the next round. With split-phase switches, a reduction can overlap
+// with independent computation. Default: No
+static int mpi_ireduce = 0;
+
+// LAIK_MPI_PERSISTENT: use persistent requests for isend/irecv,
+// created once when preparing an action sequence? Only done for sequences
+// executed multiple times (cached or from laik_calc_actions), as for a
+// single execution, persistent requests only add overhead. Default: Yes
+static int mpi_persistent = 1;
+
+// LAIK_MPI_DATATYPES: send/recv 2d/3d ranges of lexicographical layouts
+// directly from/to container memory using MPI derived datatypes instead
+// of packing into buffers? Requires LAIK_MPI_ASYNC. Default: No
+static int mpi_datatypes = 0;
+
+// LAIK_MPI_STRIDED: send/recv ranges contiguous up to a single stride in
+// lexicographical layouts (e.g. partial rows of a 2d range) directly
+// from/to container memory using an MPI vector datatype, even without
+// LAIK_MPI_DATATYPES. Requires LAIK_MPI_ASYNC. Not used with
+// LAIK_MPI_RMA, LAIK_MPI_NEIGHBOR, LAIK_MPI_ALLTOALL or LAIK_MPI_AGGREGATE,
+// which need messages from/to buffers. Default: Yes
+static int mpi_strided = 1;
+
+// LAIK_MPI_PIPELINE: number of rotating buffers for pipelined packing and
+// sending of ranges larger than LAIK_MPI_CHUNKSIZE bytes in chunks, such
+// that packing of a chunk overlaps with transfer of previous ones (same
+// for receiving and unpacking). Must be same on all processes.
+// Default: 0 (off, whole range packed into one buffer)
+#define MPI_PIPELINE_MAX 8
+static int mpi_pipeline = 0;
+static int mpi_chunksize = 1024*1024;
+
+// LAIK_MPI_RMA: execute messages of prepared action sequences as one-sided
+// MPI_Put into receive buffers, exposed in a dynamic window per group.
+// Each communication round becomes a PSCW epoch (general active target
+// synchronization) among the processes exchanging data in that round, so
+// no sorting for deadlock avoidance is needed. Target addresses are
+// exchanged when preparing a sequence; windows/attached memory are reused
+// as long as the sequence lives (i.e. across iterations with reservations).
+// Takes precedence over LAIK_MPI_DATATYPES and LAIK_MPI_PIPELINE.
+// Must be same on all processes. Default: 0 (off)
+static int mpi_rma = 0;
+
+// LAIK_MPI_NEIGHBOR: exchange all messages of a prepared action sequence
+// with one MPI_Neighbor_alltoallw on a distributed graph communicator
+// connecting the processes which exchange data. Derived datatypes per
+// neighbor directly describe the message buffers. Only used for containers
+// with reservation (sequences get cached and reused), with all messages in
+// one round from/to buffers known when preparing, as the setup is
+// collective over the group and costly. Otherwise, falls back to
+// point-to-point messages. Must be same on all processes. Default: 0 (off)
+static int mpi_neighbor = 0;
+
+// LAIK_MPI_ALLTOALL: if > 0, exchange all messages of a prepared action
+// sequence with one MPI_Alltoallv on packed buffers if some process has
+// messages with at least this number of peers (dense exchange, e.g. when
+// switching between unrelated partitionings), instead of many point-to-point
+// messages sorted in 2 phases. Same restrictions on the action sequence as
+// for LAIK_MPI_NEIGHBOR, but for all sequences (not only cached ones),
+// as the setup is cheaper. Checked after LAIK_MPI_NEIGHBOR.
+// Must be same on all processes. Default: 0 (off)
+static int mpi_alltoall = 0;
+
+// LAIK_MPI_NODES: node-aware group reductions with own algorithm (i.e. not
+// replaced by MPI_(All)reduce, see LAIK_MPI_REDUCE): reduce within nodes
+// first on node leaders, then across leaders, and send results back via
+// leaders, such that only one message per node crosses node boundaries.
+// 1: nodes from MPI_Comm_split_type(MPI_COMM_TYPE_SHARED), k > 1: emulate
+// nodes with k consecutive ranks each (for testing). Default: 0 (off)
+static int mpi_nodes = 0;
+// node ID (smallest rank on node) for each location ID, if enabled
+static int* mpi_node = 0;
+
+// LAIK_MPI_AGGREGATE: if > 0 and LAIK_MPI_NODES is set, point-to-point
+// messages of at most this number of bytes between processes on different
+// nodes are aggregated per pair of nodes: packed and forwarded via node
+// leaders, such that only one message per node pair crosses node boundaries.
+// Same restrictions on the action sequence as for LAIK_MPI_ALLTOALL, and not
+// used with collective exchanges or LAIK_MPI_RMA. Must be same on all
+// processes. Default: 0 (off)
+static int mpi_aggregate = 0;
+
 
 //----------------------------------------------------------------
 // buffer space for messages if packing/unpacking from/to not-1d layout
@@ -83,6 +177,33 @@ static int mpi_async = 1;
 //#define PACKBUFSIZE (10*800)
 static char packbuf[PACKBUFSIZE];
 
+// cache of derived datatypes for ranges in lexicographical layouts,
+// keyed by element type, range size and strides (independent of the
+// mapping address). Datatypes are freed in laik_mpi_finalize()
+typedef struct {
+    MPI_Datatype base;
+    int dims;
+    uint64_t size[3];
+    uint64_t stride[3];
+    MPI_Datatype dtype;
+} MPITypeCacheEntry;
+
+static MPITypeCacheEntry* mpi_typeCache = 0;
+static int mpi_typeCacheCount = 0, mpi_typeCacheSize = 0;
+
+// memory regions attached to dynamic RMA windows. Different action sequences
+// may receive into the same mapping, but MPI forbids overlapping attachments:
+// regions are reference counted and detached when no longer used
+typedef struct {
+    MPI_Win win;
+    char* start;
+    uint64_t size;
+    int refs;
+} MPIRmaRegion;
+
+static MPIRmaRegion* mpi_rmaRegion = 0;
+static int mpi_rmaRegionCount = 0, mpi_rmaRegionSize = 0;
+
 
 //----------------------------------------------------------------------------
 // MPI-specific actions + transformation
@@ -91,73 +212,329 @@ static char packbuf[PACKBUFSIZE];
 #define LAIK_AT_MpiIrecv (LAIK_AT_Backend + 1)
 #define LAIK_AT_MpiIsend (LAIK_AT_Backend + 2)
 #define LAIK_AT_MpiWait  (LAIK_AT_Backend + 3)
+#define LAIK_AT_MpiStart (LAIK_AT_Backend + 4)
+#define LAIK_AT_MpiWaitAll (LAIK_AT_Backend + 5)
+#define LAIK_AT_MpiTypeSend (LAIK_AT_Backend + 6)
+#define LAIK_AT_MpiTypeRecv (LAIK_AT_Backend + 7)
+#define LAIK_AT_MpiPipeSend (LAIK_AT_Backend + 8)
+#define LAIK_AT_MpiPipeRecv (LAIK_AT_Backend + 9)
+#define LAIK_AT_MpiRmaWin (LAIK_AT_Backend + 10)
+#define LAIK_AT_MpiRmaStart (LAIK_AT_Backend + 11)
+#define LAIK_AT_MpiPut (LAIK_AT_Backend + 12)
+#define LAIK_AT_MpiRmaComplete (LAIK_AT_Backend + 13)
+#define LAIK_AT_MpiRmaWait (LAIK_AT_Backend + 14)
+#define LAIK_AT_MpiNeighbor (LAIK_AT_Backend + 15)
+#define LAIK_AT_MpiAlltoallv (LAIK_AT_Backend + 16)
+#define LAIK_AT_MpiIallreduce (LAIK_AT_Backend + 17)
+#define LAIK_AT_MpiIreduce (LAIK_AT_Backend + 18)
 
 // action structs must be packed
 #pragma pack(push,1)
 
 // ReqBuf action: provide base address for MPI_Request array
-// referenced in following IRecv/Wait actions via req_it operands
+// referenced in following IRecv/Wait actions via req_it operands.
+// With <persistent> set, the array holds persistent requests
 typedef struct {
     Laik_Action h;
     unsigned int count;
+    int persistent;
     MPI_Request* req;
 } Laik_A_MpiReq;
 
-// IRecv action
+// IRecv action. With derived datatype <dtype> (not MPI_DATATYPE_NULL),
+// one instance of <dtype> covering <count> elements is received
 typedef struct {
     Laik_Action h;
     unsigned int count;
     int from_rank;
     int req_id;
+    MPI_Datatype dtype;
     char* buf;
 } Laik_A_MpiIrecv;
 
-// ISend action
+// ISend action, <dtype> as with IRecv
 typedef struct {
     Laik_Action h;
     unsigned int count;
     int to_rank;
     int req_id;
+    MPI_Datatype dtype;
     char* buf;
 } Laik_A_MpiIsend;
 
+// TypeSend/TypeRecv action: send/recv <count> elements at <buf> described
+// by derived datatype <dtype>, to/from <rank>
+typedef struct {
+    Laik_Action h;
+    unsigned int count;
+    int rank;
+    MPI_Datatype dtype;
+    char* buf;
+} Laik_A_MpiTypeMsg;
+
+// Start/WaitAll action: start/wait for persistent requests with IDs
+// in [req_id; req_id+count[
+typedef struct {
+    Laik_Action h;
+    int req_id;
+    int count;
+} Laik_A_MpiReqRange;
+
+// PipeSend/PipeRecv action: send/recv <range> (<count> elements) of map
+// <mapNo> to/from <rank> in chunks of <chunk> elements, using <bufCount>
+// rotating buffers (each for one chunk) at <buf>
+typedef struct {
+    Laik_Action h;
+    int mapNo;
+    int rank;
+    unsigned int count;
+    unsigned int chunk;
+    int bufCount;
+    char* buf;
+    Laik_Range* range;
+} Laik_A_MpiPipe;
+
+// RmaWin action: start addresses of <count> memory regions attached to the
+// RMA window of the group for receiving, detached in laik_mpi_cleanup()
+typedef struct {
+    Laik_Action h;
+    MPI_Win win;
+    int count;
+    char** region;
+} Laik_A_MpiRmaWin;
+
+// RmaStart/RmaComplete/RmaWait action: begin/end a PSCW epoch with group
+// <origins> of processes putting into our memory (exposure epoch) and
+// group <targets> we put to (access epoch). MPI_GROUP_NULL if empty
+typedef struct {
+    Laik_Action h;
+    MPI_Group origins;
+    MPI_Group targets;
+} Laik_A_MpiRmaEpoch;
+
+// Put action: put <count> elements at <buf> (or at <offset> in map <mapNo>
+// if <mapNo> >= 0) to displacement <disp> in the RMA window of <to_rank>
+typedef struct {
+    Laik_Action h;
+    unsigned int count;
+    int to_rank;
+    int mapNo;
+    unsigned int offset;
+    char* buf;
+    MPI_Aint disp;
+} Laik_A_MpiPut;
+
+// Neighbor action: exchange messages with all neighbors in distributed
+// graph communicator <comm> by one neighborhood collective. Per neighbor,
+// a datatype with absolute addresses of all its messages: first <inCount>
+// for sources, then <outCount> for destinations. <count> (all 1) and
+// <displ> (all 0) are parameters for the call, in one allocation with
+// the datatypes, starting at <displ>
+typedef struct {
+    Laik_Action h;
+    MPI_Comm comm;
+    int inCount;
+    int outCount;
+    MPI_Datatype* type;
+    int* count;
+    MPI_Aint* displ;
+} Laik_A_MpiNeighbor;
+
+// Alltoallv action: exchange bytes packed into <sendBuf>/<recvBuf> with all
+// <size> processes in <comm> (the processes of the group with messages).
+// Byte counts/displacements per rank in <comm> are in one allocation,
+// starting at <sendCount>; <recvBuf> is in the allocation of <sendBuf>
+typedef struct {
+    Laik_Action h;
+    MPI_Comm comm;
+    int size;
+    int* sendCount;
+    int* sendDispl;
+    int* recvCount;
+    int* recvDispl;
+    char* sendBuf;
+    char* recvBuf;
+} Laik_A_MpiAlltoallv;
+
+// Iallreduce/Ireduce action: start reduction of <count> elements from
+// <fromBuf> into <toBuf> (at <root> for Ireduce) with request <req_id>
+typedef struct {
+    Laik_Action h;
+    int req_id;
+    unsigned int count;
+    int root;
+    Laik_ReductionOperation redOp;
+    char* fromBuf;
+    char* toBuf;
+} Laik_A_MpiIreduce;
+
 #pragma pack(pop)
 
 static
 void laik_mpi_addMpiReq(Laik_ActionSeq* as, int round,
-                        unsigned int count, MPI_Request* buf)
+                        unsigned int count, MPI_Request* buf, int persistent)
 {
     Laik_A_MpiReq* a;
     a = (Laik_A_MpiReq*) laik_aseq_addAction(as, sizeof(*a),
                                              LAIK_AT_MpiReq, round, 0);
     a->count = count;
+    a->persistent = persistent;
     a->req = buf;
 }
 
 static
 void laik_mpi_addMpiIrecv(Laik_ActionSeq* as, int round,
-                          char* toBuf, unsigned int count, int from, int req_id)
+                          char* toBuf, unsigned int count, int from, int req_id,
+                          MPI_Datatype dtype)
 {
     Laik_A_MpiIrecv* a;
     a = (Laik_A_MpiIrecv*) laik_aseq_addAction(as, sizeof(*a),
-                                               LAIK_AT_MpiIrecv, round, 0);
+                                               LAIK_AT_MpiIrecv, round,
+                                               as->currentTid);
     a->buf = toBuf;
     a->count = count;
     a->from_rank = from;
     a->req_id = req_id;
+    a->dtype = dtype;
 }
 
 static
 void laik_mpi_addMpiIsend(Laik_ActionSeq* as, int round,
-                          char* fromBuf, unsigned int count, int to, int req_id)
+                          char* fromBuf, unsigned int count, int to, int req_id,
+                          MPI_Datatype dtype)
 {
     Laik_A_MpiIsend* a;
     a = (Laik_A_MpiIsend*) laik_aseq_addAction(as, sizeof(*a),
-                                               LAIK_AT_MpiIsend, round, 0);
+                                               LAIK_AT_MpiIsend, round,
+                                               as->currentTid);
     a->buf = fromBuf;
     a->count = count;
     a->to_rank = to;
     a->req_id = req_id;
+    a->dtype = dtype;
+}
+
+static
+void laik_mpi_addMpiTypeMsg(Laik_ActionSeq* as, Laik_ActionType type,
+                            int round, char* buf, unsigned int count,
+                            int rank, MPI_Datatype dtype)
+{
+    Laik_A_MpiTypeMsg* a;
+    a = (Laik_A_MpiTypeMsg*) laik_aseq_addAction(as, sizeof(*a), type, round,
+                                                 as->currentTid);
+    a->buf = buf;
+    a->count = count;
+    a->rank = rank;
+    a->dtype = dtype;
+}
+
+static
+void laik_mpi_addMpiPipe(Laik_ActionSeq* as, Laik_ActionType type, int round,
+                         int mapNo, Laik_Range* range, unsigned int count,
+                         int rank, char* buf, unsigned int chunk, int bufCount)
+{
+    Laik_A_MpiPipe* a;
+    a = (Laik_A_MpiPipe*) laik_aseq_addAction(as, sizeof(*a), type, round,
+                                              as->currentTid);
+    a->mapNo = mapNo;
+    a->range = range;
+    a->count = count;
+    a->rank = rank;
+    a->buf = buf;
+    a->chunk = chunk;
+    a->bufCount = bufCount;
+}
+
+static
+void laik_mpi_addMpiRmaWin(Laik_ActionSeq* as, MPI_Win win,
+                           int count, char** region)
+{
+    Laik_A_MpiRmaWin* a;
+    a = (Laik_A_MpiRmaWin*) laik_aseq_addAction(as, sizeof(*a),
+                                                LAIK_AT_MpiRmaWin, 0, 0);
+    a->win = win;
+    a->count = count;
+    a->region = region;
+}
+
+static
+void laik_mpi_addMpiRmaEpoch(Laik_ActionSeq* as, Laik_ActionType type,
+                             int round, MPI_Group origins, MPI_Group targets)
+{
+    Laik_A_MpiRmaEpoch* a;
+    a = (Laik_A_MpiRmaEpoch*) laik_aseq_addAction(as, sizeof(*a), type,
+                                                  round, as->currentTid);
+    a->origins = origins;
+    a->targets = targets;
+}
+
+static
+void laik_mpi_addMpiPut(Laik_ActionSeq* as, int round,
+                        char* buf, int mapNo, unsigned int offset,
+                        unsigned int count, int to, MPI_Aint disp)
+{
+    Laik_A_MpiPut* a;
+    a = (Laik_A_MpiPut*) laik_aseq_addAction(as, sizeof(*a),
+                                             LAIK_AT_MpiPut, round,
+                                             as->currentTid);
+    a->buf = buf;
+    a->mapNo = mapNo;
+    a->offset = offset;
+    a->count = count;
+    a->to_rank = to;
+    a->disp = disp;
+}
+
+static
+void laik_mpi_addMpiNeighbor(Laik_ActionSeq* as, int round, MPI_Comm comm,
+                             int inCount, int outCount, MPI_Aint* displ)
+{
+    Laik_A_MpiNeighbor* a;
+    a = (Laik_A_MpiNeighbor*) laik_aseq_addAction(as, sizeof(*a),
+                                                  LAIK_AT_MpiNeighbor, round,
+                                                  as->currentTid);
+    int n = inCount + outCount;
+    a->comm = comm;
+    a->inCount = inCount;
+    a->outCount = outCount;
+    a->displ = displ;
+    a->type = (MPI_Datatype*) (displ + n);
+    a->count = (int*) (a->type + n);
+}
+
+static
+void laik_mpi_addMpiAlltoallv(Laik_ActionSeq* as, int round, MPI_Comm comm,
+                              int size, int* counts, char* buf)
+{
+    Laik_A_MpiAlltoallv* a;
+    a = (Laik_A_MpiAlltoallv*) laik_aseq_addAction(as, sizeof(*a),
+                                                   LAIK_AT_MpiAlltoallv, round,
+                                                   as->currentTid);
+    a->comm = comm;
+    a->size = size;
+    a->sendCount = counts;
+    a->sendDispl = counts + size;
+    a->recvCount = counts + 2 * size;
+    a->recvDispl = counts + 3 * size;
+    a->sendBuf = buf;
+    a->recvBuf = buf + counts[size - 1] + counts[2 * size - 1];
+}
+
+static
+void laik_mpi_addMpiIreduce(Laik_ActionSeq* as, int round,
+                            Laik_BackendAction* ba, int req_id)
+{
+    Laik_A_MpiIreduce* a;
+    Laik_ActionType type;
+    type = (ba->rank < 0) ? LAIK_AT_MpiIallreduce : LAIK_AT_MpiIreduce;
+    a = (Laik_A_MpiIreduce*) laik_aseq_addAction(as, sizeof(*a), type,
+                                                 round, as->currentTid);
+    a->req_id = req_id;
+    a->count = ba->count;
+    a->root = ba->rank;
+    a->redOp = ba->redOp;
+    a->fromBuf = ba->fromBuf;
+    a->toBuf = ba->toBuf;
 }
 
 // Wait action
@@ -175,27 +552,88 @@ void laik_mpi_addMpiWait(Laik_ActionSeq* as, int round, int req_id)
     a->req_id = req_id;
 }
 
+// add Start/WaitAll action for request <req_id>, or extend action <last>
+// (given as offset into new actions, -1 if none) if request IDs follow.
+// Returns offset of action covering the request
+static
+int laik_mpi_addMpiReqRange(Laik_ActionSeq* as, Laik_ActionType type,
+                            int round, int req_id, int last)
+{
+    Laik_A_MpiReqRange* a;
+    if (last >= 0) {
+        a = (Laik_A_MpiReqRange*) (((char*)as->newAction) + last);
+        if ((a->h.type == type) && (a->h.round == round) &&
+            (a->req_id + a->count == req_id)) {
+            a->count++;
+            return last;
+        }
+    }
+    last = (int) as->newBytesUsed;
+    a = (Laik_A_MpiReqRange*) laik_aseq_addAction(as, sizeof(*a),
+                                                  type, round, as->currentTid);
+    a->req_id = req_id;
+    a->count = 1;
+    return last;
+}
+
+// peer of MPI-specific send/recv actions existing before sorting
+// for deadlock avoidance (see laik_aseq_sort_2phases)
+static
+int laik_mpi_action_peer(Laik_Action* a, bool* isSend)
+{
+    switch(a->type) {
+    case LAIK_AT_MpiTypeSend:
+    case LAIK_AT_MpiTypeRecv:
+        *isSend = (a->type == LAIK_AT_MpiTypeSend);
+        return ((Laik_A_MpiTypeMsg*) a)->rank;
+    case LAIK_AT_MpiPipeSend:
+    case LAIK_AT_MpiPipeRecv:
+        *isSend = (a->type == LAIK_AT_MpiPipeSend);
+        return ((Laik_A_MpiPipe*) a)->rank;
+    default:
+        break;
+    }
+    return -1;
+}
+
 static
 bool laik_mpi_log_action(Laik_Action* a)
 {
     switch(a->type) {
     case LAIK_AT_MpiReq: {
         Laik_A_MpiReq* aa = (Laik_A_MpiReq*) a;
-        laik_log_append("MPI-Req: count %d, req %p", aa->count, aa->req);
+        laik_log_append("MPI-Req: count %d, req %p%s", aa->count, aa->req,
+                        aa->persistent ? " (persistent)" : "");
         break;
     }
 
     case LAIK_AT_MpiIsend: {
         Laik_A_MpiIsend* aa = (Laik_A_MpiIsend*) a;
-        laik_log_append("MPI-ISend: from %p ==> T%d, count %d, reqid %d",
-                        aa->buf, aa->to_rank, aa->count, aa->req_id);
+        laik_log_append("MPI-ISend: from %p ==> T%d, count %d, reqid %d%s",
+                        aa->buf, aa->to_rank, aa->count, aa->req_id,
+                        (aa->dtype != MPI_DATATYPE_NULL) ? " (derived type)" : "");
         break;
     }
 
     case LAIK_AT_MpiIrecv: {
         Laik_A_MpiIrecv* aa = (Laik_A_MpiIrecv*) a;
-        laik_log_append("MPI-IRecv: T%d ==> to %p, count %d, reqid %d",
-                        aa->from_rank, aa->buf, aa->count, aa->req_id);
+        laik_log_append("MPI-IRecv: T%d ==> to %p, count %d, reqid %d%s",
+                        aa->from_rank, aa->buf, aa->count, aa->req_id,
+                        (aa->dtype != MPI_DATATYPE_NULL) ? " (derived type)" : "");
+        break;
+    }
+
+    case LAIK_AT_MpiTypeSend: {
+        Laik_A_MpiTypeMsg* aa = (Laik_A_MpiTypeMsg*) a;
+        laik_log_append("MPI-TypeSend: from %p ==> T%d, count %d",
+                        aa->buf, aa->rank, aa->count);
+        break;
+    }
+
+    case LAIK_AT_MpiTypeRecv: {
+        Laik_A_MpiTypeMsg* aa = (Laik_A_MpiTypeMsg*) a;
+        laik_log_append("MPI-TypeRecv: T%d ==> to %p, count %d",
+                        aa->rank, aa->buf, aa->count);
         break;
     }
 
@@ -205,6 +643,99 @@ bool laik_mpi_log_action(Laik_Action* a)
         break;
     }
 
+    case LAIK_AT_MpiPipeSend: {
+        Laik_A_MpiPipe* aa = (Laik_A_MpiPipe*) a;
+        laik_log_append("MPI-PipeSend: from map %d ", aa->mapNo);
+        laik_log_Range(aa->range);
+        laik_log_append(" ==> T%d, count %d (chunks of %d, %d bufs at %p)",
+                        aa->rank, aa->count, aa->chunk, aa->bufCount, aa->buf);
+        break;
+    }
+
+    case LAIK_AT_MpiPipeRecv: {
+        Laik_A_MpiPipe* aa = (Laik_A_MpiPipe*) a;
+        laik_log_append("MPI-PipeRecv: T%d ==> to map %d ", aa->rank, aa->mapNo);
+        laik_log_Range(aa->range);
+        laik_log_append(", count %d (chunks of %d, %d bufs at %p)",
+                        aa->count, aa->chunk, aa->bufCount, aa->buf);
+        break;
+    }
+
+    case LAIK_AT_MpiRmaWin: {
+        Laik_A_MpiRmaWin* aa = (Laik_A_MpiRmaWin*) a;
+        laik_log_append("MPI-RmaWin: %d regions attached", aa->count);
+        break;
+    }
+
+    case LAIK_AT_MpiRmaStart:
+    case LAIK_AT_MpiRmaComplete:
+    case LAIK_AT_MpiRmaWait: {
+        Laik_A_MpiRmaEpoch* aa = (Laik_A_MpiRmaEpoch*) a;
+        int origins = 0, targets = 0;
+        if (aa->origins != MPI_GROUP_NULL) MPI_Group_size(aa->origins, &origins);
+        if (aa->targets != MPI_GROUP_NULL) MPI_Group_size(aa->targets, &targets);
+        laik_log_append("MPI-Rma%s: %d origins, %d targets",
+                        (a->type == LAIK_AT_MpiRmaStart) ? "Start" :
+                        (a->type == LAIK_AT_MpiRmaComplete) ? "Complete" : "Wait",
+                        origins, targets);
+        break;
+    }
+
+    case LAIK_AT_MpiPut: {
+        Laik_A_MpiPut* aa = (Laik_A_MpiPut*) a;
+        if (aa->mapNo >= 0)
+            laik_log_append("MPI-Put: from map %d offset %d",
+                            aa->mapNo, aa->offset);
+        else
+            laik_log_append("MPI-Put: from %p", aa->buf);
+        laik_log_append(" ==> T%d disp %llx, count %d", aa->to_rank,
+                        (unsigned long long) aa->disp, aa->count);
+        break;
+    }
+
+    case LAIK_AT_MpiNeighbor: {
+        Laik_A_MpiNeighbor* aa = (Laik_A_MpiNeighbor*) a;
+        laik_log_append("MPI-Neighbor: %d sources, %d destinations",
+                        aa->inCount, aa->outCount);
+        break;
+    }
+
+    case LAIK_AT_MpiAlltoallv: {
+        Laik_A_MpiAlltoallv* aa = (Laik_A_MpiAlltoallv*) a;
+        int n = aa->size;
+        laik_log_append("MPI-Alltoallv: %d processes, send %d bytes from %p, "
+                        "recv %d bytes to %p", n,
+                        aa->sendDispl[n - 1] + aa->sendCount[n - 1], aa->sendBuf,
+                        aa->recvDispl[n - 1] + aa->recvCount[n - 1], aa->recvBuf);
+        break;
+    }
+
+    case LAIK_AT_MpiIallreduce:
+    case LAIK_AT_MpiIreduce: {
+        Laik_A_MpiIreduce* aa = (Laik_A_MpiIreduce*) a;
+        laik_log_append("MPI-I%sreduce: count %d, from %p, to %p",
+                        (a->type == LAIK_AT_MpiIallreduce) ? "all" : "",
+                        aa->count, aa->fromBuf, aa->toBuf);
+        if (a->type == LAIK_AT_MpiIreduce)
+            laik_log_append(", root %d", aa->root);
+        laik_log_append(", reqid %d", aa->req_id);
+        break;
+    }
+
+    case LAIK_AT_MpiStart: {
+        Laik_A_MpiReqRange* aa = (Laik_A_MpiReqRange*) a;
+        laik_log_append("MPI-Start: reqid %d - %d",
+                        aa->req_id, aa->req_id + aa->count - 1);
+        break;
+    }
+
+    case LAIK_AT_MpiWaitAll: {
+        Laik_A_MpiReqRange* aa = (Laik_A_MpiReqRange*) a;
+        laik_log_append("MPI-WaitAll: reqid %d - %d",
+                        aa->req_id, aa->req_id + aa->count - 1);
+        break;
+    }
+
     default:
         return false;
     }
@@ -214,6 +745,8 @@ bool laik_mpi_log_action(Laik_Action* a)
 // transformation: split send/recv actions into isend/irecv + wait
 // - replace send with isend and wait for completion at end
 // - replace recv with irecv at begin and wait at original position
+// - with LAIK_MPI_IREDUCE, replace reduce with non-blocking collective
+//   at original position and wait in next round
 bool laik_mpi_asyncSendRecv(Laik_ActionSeq* as)
 {
     // must not have new actions, we want to start a new build
@@ -224,7 +757,10 @@ bool laik_mpi_asyncSendRecv(Laik_ActionSeq* as)
     Laik_Action* a = as->action;
     for(unsigned int i = 0; i < as->actionCount; i++, a = nextAction(a)) {
         if (a->round > maxround) maxround = a->round;
-        if ((a->type == LAIK_AT_BufRecv) || (a->type == LAIK_AT_BufSend))
+        if ((a->type == LAIK_AT_BufRecv) || (a->type == LAIK_AT_BufSend) ||
+            (a->type == LAIK_AT_MpiTypeRecv) || (a->type == LAIK_AT_MpiTypeSend))
+            count++;
+        if ((a->type == LAIK_AT_Reduce) && mpi_ireduce)
             count++;
     }
 
@@ -235,16 +771,25 @@ bool laik_mpi_asyncSendRecv(Laik_ActionSeq* as)
     // - round maxround+2 gets Waits from MpiISend actions
 
     MPI_Request* buf = malloc(count * sizeof(MPI_Request));
-    laik_mpi_addMpiReq(as, 0, count, buf);
+    if (!buf) {
+        laik_panic("Out of memory allocating MPI requests");
+        exit(1); // not actually needed, laik_panic never returns
+    }
+    // requests of non-blocking collectives only get set when executed:
+    // cleanup must be able to skip them if never run
+    for(unsigned int i = 0; i < count; i++)
+        buf[i] = MPI_REQUEST_NULL;
+    laik_mpi_addMpiReq(as, 0, count, buf, 0);
 
     int req_id = 0;
     a = as->action;
     for(unsigned int i = 0; i < as->actionCount; i++, a = nextAction(a)) {
+        as->currentTid = a->tid;
         switch(a->type) {
         case LAIK_AT_BufSend: {
             Laik_A_BufSend* aa = (Laik_A_BufSend*) a;
-            laik_mpi_addMpiIsend(as, a->round + 1,
-                                 aa->buf, aa->count, aa->to_rank, req_id);
+            laik_mpi_addMpiIsend(as, a->round + 1, aa->buf, aa->count,
+                                 aa->to_rank, req_id, MPI_DATATYPE_NULL);
             laik_mpi_addMpiWait(as, maxround + 2, req_id);
             req_id++;
             break;
@@ -252,13 +797,43 @@ bool laik_mpi_asyncSendRecv(Laik_ActionSeq* as)
 
         case LAIK_AT_BufRecv: {
             Laik_A_BufRecv* aa = (Laik_A_BufRecv*) a;
-            laik_mpi_addMpiIrecv(as, 0,
-                                 aa->buf, aa->count, aa->from_rank, req_id);
+            laik_mpi_addMpiIrecv(as, 0, aa->buf, aa->count,
+                                 aa->from_rank, req_id, MPI_DATATYPE_NULL);
+            laik_mpi_addMpiWait(as, a->round + 1, req_id);
+            req_id++;
+            break;
+        }
+
+        case LAIK_AT_MpiTypeSend: {
+            Laik_A_MpiTypeMsg* aa = (Laik_A_MpiTypeMsg*) a;
+            laik_mpi_addMpiIsend(as, a->round + 1, aa->buf, aa->count,
+                                 aa->rank, req_id, aa->dtype);
+            laik_mpi_addMpiWait(as, maxround + 2, req_id);
+            req_id++;
+            break;
+        }
+
+        case LAIK_AT_MpiTypeRecv: {
+            Laik_A_MpiTypeMsg* aa = (Laik_A_MpiTypeMsg*) a;
+            laik_mpi_addMpiIrecv(as, 0, aa->buf, aa->count,
+                                 aa->rank, req_id, aa->dtype);
             laik_mpi_addMpiWait(as, a->round + 1, req_id);
             req_id++;
             break;
         }
 
+        case LAIK_AT_Reduce:
+            if (!mpi_ireduce) {
+                laik_aseq_add(a, as, a->round + 1);
+                break;
+            }
+            // actions of next round may depend on the result
+            laik_mpi_addMpiIreduce(as, a->round + 1,
+                                   (Laik_BackendAction*) a, req_id);
+            laik_mpi_addMpiWait(as, a->round + 2, req_id);
+            req_id++;
+            break;
+
         default:
             // all rounds up by one due to new round 0
             laik_aseq_add(a, as, a->round + 1);
@@ -288,6 +863,58 @@ void laik_mpi_panic(int err)
     exit(1);
 }
 
+// create dynamic RMA window for group data <gd> if RMA mode is on.
+// Collective over the communicator of the group. Not needed (and not
+// supported by all MPI implementations) for groups with one process
+static
+void laik_mpi_createWin(MPIGroupData* gd)
+{
+    gd->win = MPI_WIN_NULL;
+    if (!mpi_rma || (gd->comm == MPI_COMM_NULL)) return;
+
+    int size;
+    int err = MPI_Comm_size(gd->comm, &size);
+    if (err != MPI_SUCCESS) laik_mpi_panic(err);
+    if (size < 2) return;
+
+    err = MPI_Win_create_dynamic(MPI_INFO_NULL, gd->comm, &(gd->win));
+    if (err != MPI_SUCCESS) laik_mpi_panic(err);
+    err = MPI_Win_set_errhandler(gd->win, MPI_ERRORS_RETURN);
+    if (err != MPI_SUCCESS) laik_mpi_panic(err);
+}
+
+
+// calculate node IDs of all processes in <comm> (ranks = location IDs)
+// as smallest rank on same node, according to <mpi_nodes>. Collective
+static
+void laik_mpi_calcNodes(MPI_Comm comm, int size, int rank)
+{
+    int err, myNode = rank - rank % mpi_nodes;
+    if (mpi_nodes == 1) {
+        MPI_Comm shm;
+        err = MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, rank,
+                                  MPI_INFO_NULL, &shm);
+        if (err != MPI_SUCCESS) laik_mpi_panic(err);
+        err = MPI_Allreduce(&rank, &myNode, 1, MPI_INT, MPI_MIN, shm);
+        if (err != MPI_SUCCESS) laik_mpi_panic(err);
+        MPI_Comm_free(&shm);
+    }
+
+    mpi_node = malloc(size * sizeof(int));
+    if (!mpi_node) {
+        laik_panic("Out of memory allocating MPI node IDs");
+        exit(1); // not actually needed, laik_panic never returns
+    }
+    err = MPI_Allgather(&myNode, 1, MPI_INT, mpi_node, 1, MPI_INT, comm);
+    if (err != MPI_SUCCESS) laik_mpi_panic(err);
+
+    int nodes = 0;
+    for(int i = 0; i < size; i++)
+        if (mpi_node[i] == i) nodes++;
+    laik_log(1, "MPI backend: %d processes on %d nodes, my node %d",
+             size, nodes, myNode);
+}
+
 
 //----------------------------------------------------------------------------
 // backend interface implementation: initialization
@@ -372,6 +999,61 @@ Laik_Instance* laik_init_mpi(int* argc, char*** argv)
     str = getenv("LAIK_MPI_ASYNC");
     if (str) mpi_async = atoi(str);
 
+    // non-blocking collectives for reductions?
+    str = getenv("LAIK_MPI_IREDUCE");
+    if (str) mpi_ireduce = atoi(str);
+
+    // use persistent requests?
+    str = getenv("LAIK_MPI_PERSISTENT");
+    if (str) mpi_persistent = atoi(str);
+
+    // use derived datatypes instead of packing?
+    str = getenv("LAIK_MPI_DATATYPES");
+    if (str) mpi_datatypes = atoi(str);
+    str = getenv("LAIK_MPI_STRIDED");
+    if (str) mpi_strided = atoi(str);
+
+    // pipelined packing and sending of large ranges?
+    str = getenv("LAIK_MPI_PIPELINE");
+    if (str) mpi_pipeline = atoi(str);
+    if (mpi_pipeline < 0) mpi_pipeline = 0;
+    if (mpi_pipeline == 1) mpi_pipeline = 2; // need at least 2 for overlap
+    if (mpi_pipeline > MPI_PIPELINE_MAX) mpi_pipeline = MPI_PIPELINE_MAX;
+    str = getenv("LAIK_MPI_CHUNKSIZE");
+    if (str) mpi_chunksize = atoi(str);
+    if (mpi_chunksize < 64) mpi_chunksize = 64;
+
+    // one-sided communication with PSCW epochs?
+    str = getenv("LAIK_MPI_RMA");
+    if (str) mpi_rma = atoi(str);
+    if (mpi_rma) {
+        mpi_datatypes = 0;
+        mpi_pipeline = 0;
+    }
+    laik_mpi_createWin(gd);
+
+    // neighborhood collective for exchanges in cached sequences?
+    str = getenv("LAIK_MPI_NEIGHBOR");
+    if (str) mpi_neighbor = atoi(str);
+
+    // all-to-all collective for dense exchanges?
+    str = getenv("LAIK_MPI_ALLTOALL");
+    if (str) mpi_alltoall = atoi(str);
+
+    // node-aware own reduction algorithm?
+    str = getenv("LAIK_MPI_NODES");
+    if (str) mpi_nodes = atoi(str);
+    if (mpi_nodes > 0)
+        laik_mpi_calcNodes(d->comm, size, rank);
+
+    // aggregation of small messages between nodes?
+    str = getenv("LAIK_MPI_AGGREGATE");
+    if (str) mpi_aggregate = atoi(str);
+
+    // these modes need messages from/to buffers
+    if (mpi_rma || mpi_neighbor || mpi_alltoall || (mpi_aggregate && mpi_node))
+        mpi_strided = 0;
+
     mpi_instance = inst;
     return inst;
 }
@@ -393,6 +1075,30 @@ void laik_mpi_finalize(Laik_Instance* inst)
 {
     assert(inst == mpi_instance);
 
+    for(int i = 0; i < mpi_typeCacheCount; i++)
+        MPI_Type_free(&(mpi_typeCache[i].dtype));
+    free(mpi_typeCache);
+    mpi_typeCache = 0;
+    mpi_typeCacheCount = 0;
+    mpi_typeCacheSize = 0;
+
+    // windows of groups derived from world are kept, as their communicators
+    int finalized;
+    MPI_Finalized(&finalized);
+    for(int i = 0; i < mpi_rmaRegionCount && !finalized; i++)
+        MPI_Win_detach(mpi_rmaRegion[i].win, mpi_rmaRegion[i].start);
+    free(mpi_rmaRegion);
+    mpi_rmaRegion = 0;
+    mpi_rmaRegionCount = 0;
+    mpi_rmaRegionSize = 0;
+    free(mpi_node);
+    mpi_node = 0;
+    MPIGroupData* gd = mpiGroupData(inst->world);
+    if ((gd->win != MPI_WIN_NULL) && !finalized) {
+        int err = MPI_Win_free(&(gd->win));
+        if (err != MPI_SUCCESS) laik_mpi_panic(err);
+    }
+
     if (mpiData(mpi_instance)->didInit) {
         int err = MPI_Finalize();
         if (err != MPI_SUCCESS) laik_mpi_panic(err);
@@ -434,6 +1140,8 @@ void laik_mpi_updateGroup(Laik_Group* g)
     int err = MPI_Comm_split(gdParent->comm, g->myid < 0 ? MPI_UNDEFINED : 0,
                              g->myid, &(gd->comm));
     if (err != MPI_SUCCESS) laik_mpi_panic(err);
+
+    laik_mpi_createWin(gd);
 }
 
 static
@@ -469,52 +1177,111 @@ MPI_Op getMPIOp(Laik_ReductionOperation redOp)
     return mpiRedOp;
 }
 
+// return address of range <r> in <map> if stored contiguously, otherwise 0
+static
+char* contiguousRange(Laik_Mapping* map, Laik_Range* r)
+{
+    int64_t off;
+    if (!laik_layout_lex_contiguous(map->layout, map->layoutSection, r, &off))
+        return 0;
+    return map->start + off * map->data->elemsize;
+}
+
+// pack range of <map> and send it to <to_rank> in chunks of <chunk> elements,
+// using <bufCount> rotating buffers at <buf> (each for one chunk): packing
+// of a chunk overlaps with the transfer of previous ones.
+// If the range is stored contiguously, chunks are sent without packing
 static
 void laik_mpi_exec_packAndSend(Laik_Mapping* map, Laik_Range* range,
                                int to_rank, uint64_t slc_size,
+                               char* buf, unsigned int chunk, int bufCount,
                                MPI_Datatype dataType, int tag, MPI_Comm comm)
 {
+    MPI_Request req[MPI_PIPELINE_MAX];
+    int elemsize = map->data->elemsize;
+    char* ptr = contiguousRange(map, range);
+    int err;
+
+    assert((bufCount > 0) && (bufCount <= MPI_PIPELINE_MAX));
+    for(int b = 0; b < bufCount; b++)
+        req[b] = MPI_REQUEST_NULL;
+
     Laik_Index idx = range->from;
-    int dims = range->space->dims;
-    unsigned int packed;
     uint64_t count = 0;
-    while(1) {
-        packed = (map->layout->pack)(map, range, &idx,
-                                     packbuf, PACKBUFSIZE);
-        assert(packed > 0);
-        int err = MPI_Send(packbuf, (int) packed,
-                           dataType, to_rank, tag, comm);
+    for(int k = 0; count < slc_size; k++) {
+        // wait until buffer for this chunk can be reused
+        int b = k % bufCount;
+        err = MPI_Wait(req + b, MPI_STATUS_IGNORE);
         if (err != MPI_SUCCESS) laik_mpi_panic(err);
 
-        count += packed;
-        if (laik_index_isEqual(dims, &idx, &(range->to))) break;
+        char* chunkBuf;
+        unsigned int n;
+        if (ptr) {
+            chunkBuf = ptr + count * elemsize;
+            n = (slc_size - count < chunk) ? (unsigned int) (slc_size - count) : chunk;
+        }
+        else {
+            chunkBuf = buf + (uint64_t) b * chunk * elemsize;
+            n = (map->layout->pack)(map, range, &idx, chunkBuf, chunk * elemsize);
+            assert(n > 0);
+        }
+        err = MPI_Isend(chunkBuf, (int) n, dataType, to_rank, tag, comm, req + b);
+        if (err != MPI_SUCCESS) laik_mpi_panic(err);
+        count += n;
     }
     assert(count == slc_size);
+    assert(ptr || laik_index_isEqual(range->space->dims, &idx, &(range->to)));
+
+    err = MPI_Waitall(bufCount, req, MPI_STATUSES_IGNORE);
+    if (err != MPI_SUCCESS) laik_mpi_panic(err);
 }
 
+// receive range of <map> from <from_rank> in chunks of <chunk> elements and
+// unpack them, with receives for up to <bufCount> chunks (into rotating
+// buffers at <buf>) posted in advance, overlapping unpacking and transfer.
+// If the range is stored contiguously, chunks are received in place
 static
 void laik_mpi_exec_recvAndUnpack(Laik_Mapping* map, Laik_Range* range,
                                  int from_rank, uint64_t slc_size,
-                                 int elemsize,
+                                 char* buf, unsigned int chunk, int bufCount,
                                  MPI_Datatype dataType, int tag, MPI_Comm comm)
 {
+    MPI_Request req[MPI_PIPELINE_MAX];
     MPI_Status st;
+    int elemsize = map->data->elemsize;
+    char* ptr = contiguousRange(map, range);
+    uint64_t chunks = (slc_size + chunk - 1) / chunk;
+    int err, recvCount;
+
+    assert((bufCount > 0) && (bufCount <= MPI_PIPELINE_MAX));
     Laik_Index idx = range->from;
-    int dims = range->space->dims;
-    int recvCount, unpacked;
     uint64_t count = 0;
-    while(1) {
-        int err = MPI_Recv(packbuf, PACKBUFSIZE / elemsize,
-                           dataType, from_rank, tag, comm, &st);
-        if (err != MPI_SUCCESS) laik_mpi_panic(err);
-        err = MPI_Get_count(&st, dataType, &recvCount);
-        if (err != MPI_SUCCESS) laik_mpi_panic(err);
-
-        unpacked = (map->layout->unpack)(map, range, &idx,
-                                         packbuf, recvCount * elemsize);
-        assert(recvCount == unpacked);
-        count += unpacked;
-        if (laik_index_isEqual(dims, &idx, &(range->to))) break;
+    for(uint64_t k = 0; k < chunks + bufCount; k++) {
+        int b = k % bufCount;
+        if (k >= (uint64_t) bufCount) {
+            // wait for chunk k - bufCount and unpack it
+            err = MPI_Wait(req + b, &st);
+            if (err != MPI_SUCCESS) laik_mpi_panic(err);
+            err = MPI_Get_count(&st, dataType, &recvCount);
+            if (err != MPI_SUCCESS) laik_mpi_panic(err);
+            if (!ptr) {
+                unsigned int unpacked;
+                unpacked = (map->layout->unpack)(map, range, &idx,
+                                                 buf + (uint64_t) b * chunk * elemsize,
+                                                 recvCount * elemsize);
+                assert(recvCount == (int) unpacked);
+            }
+            count += recvCount;
+        }
+        if (k < chunks) {
+            // post receive for chunk k
+            uint64_t left = slc_size - k * chunk;
+            int n = (left < chunk) ? (int) left : (int) chunk;
+            char* chunkBuf = ptr ? (ptr + k * chunk * elemsize) :
+                                   (buf + (uint64_t) b * chunk * elemsize);
+            err = MPI_Irecv(chunkBuf, n, dataType, from_rank, tag, comm, req + b);
+            if (err != MPI_SUCCESS) laik_mpi_panic(err);
+        }
     }
     assert(count == slc_size);
 }
@@ -562,6 +1329,35 @@ void laik_mpi_exec_reduce(Laik_TransitionContext* tc, Laik_BackendAction* a,
 // which are interested in the result. All other processes with input
 // send their data to him, he does the reduction, and sends to all processes
 // interested in the result
+// start reduction of Iallreduce/Ireduce action <a> with request <req>
+static
+void laik_mpi_exec_ireduce(Laik_TransitionContext* tc, Laik_A_MpiIreduce* a,
+                           MPI_Datatype dataType, MPI_Comm comm,
+                           MPI_Request* req)
+{
+    MPI_Op mpiRedOp = getMPIOp(a->redOp);
+    const void* fromBuf = a->fromBuf;
+    int err;
+
+    if (a->h.type == LAIK_AT_MpiIallreduce) {
+        if (a->fromBuf == a->toBuf) fromBuf = MPI_IN_PLACE;
+        laik_log(1, "      exec MPI_Iallreduce%s, count %d",
+                 (fromBuf == MPI_IN_PLACE) ? " in-place" : "", a->count);
+        err = MPI_Iallreduce(fromBuf, a->toBuf, (int) a->count,
+                             dataType, mpiRedOp, comm, req);
+    }
+    else {
+        if ((a->fromBuf == a->toBuf) && (tc->transition->group->myid == a->root))
+            fromBuf = MPI_IN_PLACE;
+        laik_log(1, "      exec MPI_Ireduce%s, count %d, root %d",
+                 (fromBuf == MPI_IN_PLACE) ? " in-place" : "",
+                 a->count, a->root);
+        err = MPI_Ireduce(fromBuf, a->toBuf, (int) a->count,
+                          dataType, mpiRedOp, a->root, comm, req);
+    }
+    if (err != MPI_SUCCESS) laik_mpi_panic(err);
+}
+
 static
 void laik_mpi_exec_groupReduce(Laik_TransitionContext* tc,
                                Laik_BackendAction* a,
@@ -677,6 +1473,9 @@ void laik_mpi_exec_groupReduce(Laik_TransitionContext* tc,
     }
 }
 
+// forward decl
+static bool laik_mpi_exec_actions(Laik_ActionSeq* as, bool block);
+
 static
 void laik_mpi_exec(Laik_ActionSeq* as)
 {
@@ -708,33 +1507,104 @@ void laik_mpi_exec(Laik_ActionSeq* as)
         laik_log_flush(0);
     }
 
-    // TODO: use transition context given by each action
-    Laik_TransitionContext* tc = as->context[0];
-    Laik_MappingList* fromList = tc->fromList;
-    Laik_MappingList* toList = tc->toList;
-    int elemsize = tc->data->elemsize;
+    as->execPos = 0;
+    laik_mpi_exec_actions(as, true);
+}
+
+// split-phase execution: post communication and return at the first
+// wait for a request which is not completed yet.
+// Sends/receives are only posted early if the sequence was prepared
+// with asynchronous send/recv (LAIK_MPI_ASYNC, default)
+static
+void laik_mpi_exec_start(Laik_ActionSeq* as)
+{
+    if (as->backend == 0) {
+        // not prepared by us: no split execution
+        laik_mpi_exec(as);
+        return;
+    }
+
+    if (laik_log_begin(1)) {
+        laik_log_append("MPI backend exec start:\n");
+        laik_log_ActionSeq(as, false);
+        laik_log_flush(0);
+    }
+
+    as->execPos = 0;
+    laik_mpi_exec_actions(as, false);
+}
+
+// split-phase execution: continue without blocking, return true if done
+static
+bool laik_mpi_exec_test(Laik_ActionSeq* as)
+{
+    if (as->execPos >= as->actionCount) return true;
+    return laik_mpi_exec_actions(as, false);
+}
+
+// split-phase execution: execute remaining actions
+static
+void laik_mpi_exec_finish(Laik_ActionSeq* as)
+{
+    if (as->execPos < as->actionCount)
+        laik_mpi_exec_actions(as, true);
+}
 
-    // common for all MPI calls: tag, comm, datatype
+// execute actions of <as>, starting at position <as->execPos>.
+// If <block> is false, stop at a wait action for a request not completed
+// yet, remembering the position. Return true if all actions are done
+static
+bool laik_mpi_exec_actions(Laik_ActionSeq* as, bool block)
+{
+    // common for all MPI calls: tag, comm
+    // (all transition contexts are on the same group)
+    Laik_TransitionContext* tc = as->context[0];
     int tag = 1;
     MPIGroupData* gd = mpiGroupData(tc->transition->group);
     assert(gd);
     MPI_Comm comm = gd->comm;
-    MPI_Datatype dataType = getMPIDataType(tc->data);
     MPI_Status st;
     int err, count;
 
-    // MPI_Request array: not set yet
+    // mappings and datatype depend on transition context of an action
+    int current_tid = -1;
+    Laik_MappingList* fromList = 0;
+    Laik_MappingList* toList = 0;
+    int elemsize = 0;
+    MPI_Datatype dataType = MPI_DATATYPE_NULL;
+
+    // MPI_Request array: set by first action, if existing
+    // (also needed when continuing a split-phase execution)
     int req_count = 0;
     MPI_Request* req = 0;
+    if ((as->actionCount > 0) && (as->action->type == LAIK_AT_MpiReq)) {
+        Laik_A_MpiReq* aa = (Laik_A_MpiReq*) as->action;
+        req_count = aa->count;
+        req = aa->req;
+    }
 
+    // skip actions already executed
     Laik_Action* a = as->action;
-    for(unsigned int i = 0; i < as->actionCount; i++, a = nextAction(a)) {
+    unsigned int pos = 0;
+    for(; pos < as->execPos; pos++)
+        a = nextAction(a);
+
+    for(; pos < as->actionCount; pos++, a = nextAction(a)) {
         Laik_BackendAction* ba = (Laik_BackendAction*) a;
         if (laik_log_begin(1)) {
             laik_log_Action(a, as);
             laik_log_flush(0);
         }
 
+        if (a->tid != current_tid) {
+            current_tid = a->tid;
+            tc = as->context[current_tid];
+            fromList = tc->fromList;
+            toList = tc->toList;
+            elemsize = tc->data->elemsize;
+            dataType = getMPIDataType(tc->data);
+        }
+
         switch(a->type) {
         case LAIK_AT_BufReserve:
         case LAIK_AT_Nop:
@@ -755,8 +1625,12 @@ void laik_mpi_exec(Laik_ActionSeq* as)
             // MPI-specific action: call MPI_Isend
             Laik_A_MpiIsend* aa = (Laik_A_MpiIsend*) a;
             assert(aa->req_id < req_count);
-            err = MPI_Isend(aa->buf, aa->count,
-                            dataType, aa->to_rank, tag, comm, req + aa->req_id);
+            if (aa->dtype != MPI_DATATYPE_NULL)
+                err = MPI_Isend(aa->buf, 1, aa->dtype,
+                                aa->to_rank, tag, comm, req + aa->req_id);
+            else
+                err = MPI_Isend(aa->buf, aa->count, dataType,
+                                aa->to_rank, tag, comm, req + aa->req_id);
             if (err != MPI_SUCCESS) laik_mpi_panic(err);
             break;
         }
@@ -765,17 +1639,160 @@ void laik_mpi_exec(Laik_ActionSeq* as)
             // MPI-specific action: exec MPI_IRecv
             Laik_A_MpiIrecv* aa = (Laik_A_MpiIrecv*) a;
             assert(aa->req_id < req_count);
-            err = MPI_Irecv(aa->buf, aa->count,
-                            dataType, aa->from_rank, tag, comm, req + aa->req_id);
+            if (aa->dtype != MPI_DATATYPE_NULL)
+                err = MPI_Irecv(aa->buf, 1, aa->dtype,
+                                aa->from_rank, tag, comm, req + aa->req_id);
+            else
+                err = MPI_Irecv(aa->buf, aa->count, dataType,
+                                aa->from_rank, tag, comm, req + aa->req_id);
             if (err != MPI_SUCCESS) laik_mpi_panic(err);
             break;
         }
 
-        case LAIK_AT_MpiWait: {
-            // MPI-specific action: wait for request
-            Laik_A_MpiWait* aa = (Laik_A_MpiWait*) a;
-            assert(aa->req_id < req_count);
-            err = MPI_Wait(req + aa->req_id, &st);
+        case LAIK_AT_MpiTypeSend: {
+            // MPI-specific action: send with derived datatype
+            Laik_A_MpiTypeMsg* aa = (Laik_A_MpiTypeMsg*) a;
+            err = MPI_Send(aa->buf, 1, aa->dtype, aa->rank, tag, comm);
+            if (err != MPI_SUCCESS) laik_mpi_panic(err);
+            break;
+        }
+
+        case LAIK_AT_MpiTypeRecv: {
+            // MPI-specific action: recv with derived datatype
+            Laik_A_MpiTypeMsg* aa = (Laik_A_MpiTypeMsg*) a;
+            err = MPI_Recv(aa->buf, 1, aa->dtype, aa->rank, tag, comm, &st);
+            if (err != MPI_SUCCESS) laik_mpi_panic(err);
+            break;
+        }
+
+        case LAIK_AT_MpiStart: {
+            // MPI-specific action: start persistent requests
+            Laik_A_MpiReqRange* aa = (Laik_A_MpiReqRange*) a;
+            assert(aa->req_id + aa->count <= req_count);
+            if (aa->count == 1)
+                err = MPI_Start(req + aa->req_id);
+            else
+                err = MPI_Startall(aa->count, req + aa->req_id);
+            if (err != MPI_SUCCESS) laik_mpi_panic(err);
+            break;
+        }
+
+        case LAIK_AT_MpiWaitAll: {
+            // MPI-specific action: wait for range of requests
+            Laik_A_MpiReqRange* aa = (Laik_A_MpiReqRange*) a;
+            assert(aa->req_id + aa->count <= req_count);
+            if (!block) {
+                int done;
+                err = MPI_Testall(aa->count, req + aa->req_id, &done,
+                                  MPI_STATUSES_IGNORE);
+                if (err != MPI_SUCCESS) laik_mpi_panic(err);
+                if (!done) {
+                    // continue here on next call
+                    as->execPos = pos;
+                    return false;
+                }
+                break;
+            }
+            err = MPI_Waitall(aa->count, req + aa->req_id, MPI_STATUSES_IGNORE);
+            if (err != MPI_SUCCESS) laik_mpi_panic(err);
+            break;
+        }
+
+        case LAIK_AT_MpiWait: {
+            // MPI-specific action: wait for request
+            Laik_A_MpiWait* aa = (Laik_A_MpiWait*) a;
+            assert(aa->req_id < req_count);
+            if (!block) {
+                int done;
+                err = MPI_Test(req + aa->req_id, &done, &st);
+                if (err != MPI_SUCCESS) laik_mpi_panic(err);
+                if (!done) {
+                    // continue here on next call
+                    as->execPos = pos;
+                    return false;
+                }
+                break;
+            }
+            err = MPI_Wait(req + aa->req_id, &st);
+            if (err != MPI_SUCCESS) laik_mpi_panic(err);
+            break;
+        }
+
+        case LAIK_AT_MpiRmaWin:
+            // memory got attached to the window when preparing
+            break;
+
+        case LAIK_AT_MpiRmaStart: {
+            // MPI-specific action: open exposure and/or access epoch
+            Laik_A_MpiRmaEpoch* aa = (Laik_A_MpiRmaEpoch*) a;
+            if (aa->origins != MPI_GROUP_NULL) {
+                err = MPI_Win_post(aa->origins, 0, gd->win);
+                if (err != MPI_SUCCESS) laik_mpi_panic(err);
+            }
+            if (aa->targets != MPI_GROUP_NULL) {
+                err = MPI_Win_start(aa->targets, 0, gd->win);
+                if (err != MPI_SUCCESS) laik_mpi_panic(err);
+            }
+            break;
+        }
+
+        case LAIK_AT_MpiPut: {
+            // MPI-specific action: put into receive buffer of target
+            Laik_A_MpiPut* aa = (Laik_A_MpiPut*) a;
+            char* buf = aa->buf;
+            if (aa->mapNo >= 0) {
+                assert(aa->mapNo < fromList->count);
+                Laik_Mapping* fromMap = &(fromList->map[aa->mapNo]);
+                assert(fromMap->base != 0);
+                buf = fromMap->base + aa->offset;
+            }
+            err = MPI_Put(buf, (int) aa->count, dataType, aa->to_rank,
+                          aa->disp, (int) aa->count, dataType, gd->win);
+            if (err != MPI_SUCCESS) laik_mpi_panic(err);
+            break;
+        }
+
+        case LAIK_AT_MpiRmaComplete:
+            // MPI-specific action: close access epoch, puts are done
+            err = MPI_Win_complete(gd->win);
+            if (err != MPI_SUCCESS) laik_mpi_panic(err);
+            break;
+
+        case LAIK_AT_MpiRmaWait:
+            // MPI-specific action: close exposure epoch, data has arrived.
+            // Always blocking: only one exposure epoch can be active on the
+            // window, but split-phase switches of multiple containers may
+            // be in flight
+            err = MPI_Win_wait(gd->win);
+            if (err != MPI_SUCCESS) laik_mpi_panic(err);
+            break;
+
+        case LAIK_AT_MpiIallreduce:
+        case LAIK_AT_MpiIreduce: {
+            // MPI-specific action: start non-blocking reduction
+            Laik_A_MpiIreduce* aa = (Laik_A_MpiIreduce*) a;
+            assert(aa->req_id < req_count);
+            laik_mpi_exec_ireduce(tc, aa, dataType, comm, req + aa->req_id);
+            break;
+        }
+
+        case LAIK_AT_MpiNeighbor: {
+            // MPI-specific action: all messages by one collective
+            Laik_A_MpiNeighbor* aa = (Laik_A_MpiNeighbor*) a;
+            err = MPI_Neighbor_alltoallw(MPI_BOTTOM, aa->count, aa->displ,
+                                         aa->type + aa->inCount,
+                                         MPI_BOTTOM, aa->count, aa->displ,
+                                         aa->type, aa->comm);
+            if (err != MPI_SUCCESS) laik_mpi_panic(err);
+            break;
+        }
+
+        case LAIK_AT_MpiAlltoallv: {
+            // MPI-specific action: packed messages by one collective
+            Laik_A_MpiAlltoallv* aa = (Laik_A_MpiAlltoallv*) a;
+            err = MPI_Alltoallv(aa->sendBuf, aa->sendCount, aa->sendDispl,
+                                MPI_BYTE, aa->recvBuf, aa->recvCount,
+                                aa->recvDispl, MPI_BYTE, aa->comm);
             if (err != MPI_SUCCESS) laik_mpi_panic(err);
             break;
         }
@@ -894,6 +1911,7 @@ void laik_mpi_exec(Laik_ActionSeq* as)
             Laik_Mapping* fromMap = &(fromList->map[aa->fromMapNo]);
             assert(fromMap->base != 0);
             laik_mpi_exec_packAndSend(fromMap, aa->range, aa->to_rank, aa->count,
+                                      packbuf, PACKBUFSIZE / 2 / elemsize, 2,
                                       dataType, tag, comm);
             break;
         }
@@ -901,25 +1919,53 @@ void laik_mpi_exec(Laik_ActionSeq* as)
         case LAIK_AT_PackAndSend:
             laik_mpi_exec_packAndSend(ba->map, ba->range, ba->rank,
                                       (uint64_t) ba->count,
+                                      packbuf, PACKBUFSIZE / 2 / elemsize, 2,
                                       dataType, tag, comm);
             break;
 
+        case LAIK_AT_MpiPipeSend: {
+            // MPI-specific action: pipelined packing and sending.
+            // Chunks use own tag to not get mixed up with other messages
+            Laik_A_MpiPipe* aa = (Laik_A_MpiPipe*) a;
+            assert(aa->mapNo < fromList->count);
+            Laik_Mapping* fromMap = &(fromList->map[aa->mapNo]);
+            assert(fromMap->base != 0);
+            laik_mpi_exec_packAndSend(fromMap, aa->range, aa->rank, aa->count,
+                                      aa->buf, aa->chunk, aa->bufCount,
+                                      dataType, tag + 1, comm);
+            break;
+        }
+
         case LAIK_AT_MapRecvAndUnpack: {
             Laik_A_MapRecvAndUnpack* aa = (Laik_A_MapRecvAndUnpack*) a;
             assert(aa->toMapNo < toList->count);
             Laik_Mapping* toMap = &(toList->map[aa->toMapNo]);
             assert(toMap->base);
             laik_mpi_exec_recvAndUnpack(toMap, aa->range, aa->from_rank, aa->count,
-                                        elemsize, dataType, tag, comm);
+                                        packbuf, PACKBUFSIZE / 2 / elemsize, 2,
+                                        dataType, tag, comm);
             break;
         }
 
         case LAIK_AT_RecvAndUnpack:
             laik_mpi_exec_recvAndUnpack(ba->map, ba->range, ba->rank,
                                         (uint64_t) ba->count,
-                                        elemsize, dataType, tag, comm);
+                                        packbuf, PACKBUFSIZE / 2 / elemsize, 2,
+                                        dataType, tag, comm);
             break;
 
+        case LAIK_AT_MpiPipeRecv: {
+            // MPI-specific action: pipelined receiving and unpacking
+            Laik_A_MpiPipe* aa = (Laik_A_MpiPipe*) a;
+            assert(aa->mapNo < toList->count);
+            Laik_Mapping* toMap = &(toList->map[aa->mapNo]);
+            assert(toMap->base != 0);
+            laik_mpi_exec_recvAndUnpack(toMap, aa->range, aa->rank, aa->count,
+                                        aa->buf, aa->chunk, aa->bufCount,
+                                        dataType, tag + 1, comm);
+            break;
+        }
+
         case LAIK_AT_Reduce:
             laik_mpi_exec_reduce(tc, ba, dataType, comm);
             break;
@@ -956,19 +2002,312 @@ void laik_mpi_exec(Laik_ActionSeq* as)
         }
     }
     assert( ((char*)as->action) + as->bytesUsed == ((char*)a) );
+    as->execPos = as->actionCount;
+    return true;
+}
+
+
+// return committed derived datatype covering range <range> in mapping <m>
+// with lexicographical layout, created on first use
+static
+MPI_Datatype getRangeDataType(Laik_Mapping* m, Laik_Range* range)
+{
+    MPI_Datatype base = getMPIDataType(m->data);
+    int dims = range->space->dims;
+    uint64_t size[3] = {0, 0, 0}, stride[3] = {1, 0, 0};
+    uint64_t count, blocklen, bstride;
+    if (laik_layout_lex_strided(m->layout, m->layoutSection, range, 0,
+                                &count, &blocklen, &bstride)) {
+        // single stride: same as 2d range of <count> rows
+        dims = 2;
+        size[0] = blocklen;
+        size[1] = count;
+        stride[1] = bstride;
+    }
+    else {
+        for(int d = 0; d < dims; d++) {
+            size[d] = (uint64_t) (range->to.i[d] - range->from.i[d]);
+            stride[d] = laik_layout_lex_stride(m->layout, m->layoutSection, d);
+        }
+    }
+
+    for(int i = 0; i < mpi_typeCacheCount; i++) {
+        MPITypeCacheEntry* e = &(mpi_typeCache[i]);
+        if ((e->base == base) && (e->dims == dims) &&
+            (e->size[0] == size[0]) && (e->size[1] == size[1]) &&
+            (e->size[2] == size[2]) && (e->stride[1] == stride[1]) &&
+            (e->stride[2] == stride[2]))
+            return e->dtype;
+    }
+
+    // 2d: vector of rows; 3d: hvector of such 2d planes
+    int err;
+    MPI_Datatype plane, dtype;
+    err = MPI_Type_vector((int) size[1], (int) size[0], (int) stride[1],
+                          base, &plane);
+    if (err != MPI_SUCCESS) laik_mpi_panic(err);
+    if (dims == 3) {
+        MPI_Aint zstride = (MPI_Aint) (stride[2] * m->data->elemsize);
+        err = MPI_Type_create_hvector((int) size[2], 1, zstride, plane, &dtype);
+        if (err != MPI_SUCCESS) laik_mpi_panic(err);
+        MPI_Type_free(&plane);
+    }
+    else
+        dtype = plane;
+    err = MPI_Type_commit(&dtype);
+    if (err != MPI_SUCCESS) laik_mpi_panic(err);
+
+    if (mpi_typeCacheCount == mpi_typeCacheSize) {
+        mpi_typeCacheSize = (mpi_typeCacheSize + 8) * 2;
+        mpi_typeCache = realloc(mpi_typeCache,
+                                mpi_typeCacheSize * sizeof(MPITypeCacheEntry));
+        if (!mpi_typeCache) {
+            laik_panic("Out of memory allocating MPI datatype cache");
+            exit(1); // not actually needed, laik_panic never returns
+        }
+    }
+    MPITypeCacheEntry* e = &(mpi_typeCache[mpi_typeCacheCount++]);
+    e->base = base;
+    e->dims = dims;
+    for(int d = 0; d < 3; d++) {
+        e->size[d] = size[d];
+        e->stride[d] = stride[d];
+    }
+    e->dtype = dtype;
+
+    if (laik_log_begin(1)) {
+        laik_log_append("MPI backend: new derived datatype for range ");
+        laik_log_Range(range);
+        laik_log_flush(" (strides %llu/%llu)", (unsigned long long) stride[1],
+                       (unsigned long long) stride[2]);
+    }
+    return dtype;
+}
+
+// can range <range> of mapping <m> be sent/received directly with a
+// derived datatype?
+static
+bool useRangeDataType(Laik_Mapping* m, Laik_Range* range)
+{
+    if (!m || (m->base == 0)) return false;
+    if (range->space->dims < 2) return false; // 1d: direct send/recv anyway
+    if (!laik_layout_is_lex(m->layout)) return false;
+    // large ranges are sent in chunks when pipelining, also at receiver
+    if (mpi_pipeline &&
+        (laik_range_size(range) * m->data->elemsize > (uint64_t) mpi_chunksize))
+        return false;
+    // contiguous ranges: direct send/recv (see laik_aseq_flattenPacking)
+    if (laik_layout_lex_contiguous(m->layout, m->layoutSection, range, 0))
+        return false;
+    if (mpi_datatypes) return true;
+    // without LAIK_MPI_DATATYPES: only ranges with a single stride
+    uint64_t count, blocklen, stride;
+    return mpi_strided &&
+           laik_layout_lex_strided(m->layout, m->layoutSection, range, 0,
+                                   &count, &blocklen, &stride);
+}
+
+// transformation: replace pack+send and recv+unpack actions for 2d/3d
+// ranges in lexicographical layouts by send/recv actions using derived
+// datatypes, directly accessing container memory (only for ranges with a
+// single stride without LAIK_MPI_DATATYPES, see useRangeDataType).
+// Within each transition, send actions come before recv actions. To be
+// deadlock-free, the resulting actions must be converted to isend/irecv
+// (see laik_mpi_asyncSendRecv)
+static
+bool laik_mpi_useDatatypes(Laik_ActionSeq* as)
+{
+    bool changed = false;
+
+    // must not have new actions, we want to start a new build
+    assert(as->newActionCount == 0);
+
+    Laik_Action* a = as->action;
+    for(unsigned int i = 0; i < as->actionCount; i++, a = nextAction(a)) {
+        Laik_TransitionContext* tc = as->context[a->tid];
+        unsigned int elemsize = tc->data->elemsize;
+        bool handled = false;
+        as->currentTid = a->tid;
+
+        switch(a->type) {
+        case LAIK_AT_MapPackAndSend: {
+            Laik_A_MapPackAndSend* aa = (Laik_A_MapPackAndSend*) a;
+            Laik_Mapping* m = 0;
+            if (tc->fromList) {
+                assert(aa->fromMapNo < tc->fromList->count);
+                m = &(tc->fromList->map[aa->fromMapNo]);
+            }
+            if (!useRangeDataType(m, aa->range)) break;
+
+            int64_t off = laik_offset(m->layout, m->layoutSection,
+                                      &(aa->range->from));
+            laik_mpi_addMpiTypeMsg(as, LAIK_AT_MpiTypeSend, a->round,
+                                   m->start + off * elemsize, aa->count,
+                                   aa->to_rank, getRangeDataType(m, aa->range));
+            handled = true;
+            break;
+        }
+
+        case LAIK_AT_MapRecvAndUnpack: {
+            Laik_A_MapRecvAndUnpack* aa = (Laik_A_MapRecvAndUnpack*) a;
+            Laik_Mapping* m = 0;
+            if (tc->toList) {
+                assert(aa->toMapNo < tc->toList->count);
+                m = &(tc->toList->map[aa->toMapNo]);
+            }
+            if (!useRangeDataType(m, aa->range)) break;
+
+            int64_t off = laik_offset(m->layout, m->layoutSection,
+                                      &(aa->range->from));
+            laik_mpi_addMpiTypeMsg(as, LAIK_AT_MpiTypeRecv, a->round,
+                                   m->start + off * elemsize, aa->count,
+                                   aa->from_rank, getRangeDataType(m, aa->range));
+            handled = true;
+            break;
+        }
+
+        default: break;
+        }
+
+        if (!handled)
+            laik_aseq_add(a, as, a->round);
+        else
+            changed = true;
+    }
+
+    if (changed)
+        laik_aseq_activateNewActions(as);
+    else
+        laik_aseq_discardNewActions(as);
+
+    return changed;
 }
 
+// transformation: use persistent requests for isend/irecv.
+// Requests are created here, bound to the buffers of the isend/irecv
+// actions, which are replaced by starting the requests on each execution.
+// Requests get renumbered in order of their start actions, such that
+// start/wait actions following each other in a round can be combined into
+// MPI_Startall/MPI_Waitall calls. Requests are freed in laik_mpi_cleanup()
+static
+bool laik_mpi_persistentRequests(Laik_ActionSeq* as)
+{
+    // must not have new actions, we want to start a new build
+    assert(as->newActionCount == 0);
+
+    // requires isend/irecv actions from laik_mpi_asyncSendRecv
+    if ((as->actionCount == 0) || (as->action->type != LAIK_AT_MpiReq))
+        return false;
+    Laik_A_MpiReq* ra = (Laik_A_MpiReq*) as->action;
+    if (ra->persistent) return false;
+    unsigned int count = ra->count;
+    MPI_Request* req = ra->req;
+
+    // new request IDs in order of isend/irecv actions
+    int* newID = malloc(count * sizeof(int));
+    if (!newID) {
+        laik_panic("Out of memory allocating memory for MPI request IDs");
+        exit(1); // not actually needed, laik_panic never returns
+    }
+    unsigned int nextID = 0;
+    Laik_Action* a = as->action;
+    for(unsigned int i = 0; i < as->actionCount; i++, a = nextAction(a)) {
+        if (a->type == LAIK_AT_MpiIsend)
+            newID[((Laik_A_MpiIsend*)a)->req_id] = nextID++;
+        else if (a->type == LAIK_AT_MpiIrecv)
+            newID[((Laik_A_MpiIrecv*)a)->req_id] = nextID++;
+        else if ((a->type == LAIK_AT_MpiIallreduce) ||
+                 (a->type == LAIK_AT_MpiIreduce))
+            newID[((Laik_A_MpiIreduce*)a)->req_id] = nextID++;
+    }
+    assert(nextID == count);
+
+    // all transition contexts are on the same group
+    Laik_TransitionContext* tc = as->context[0];
+    MPIGroupData* gd = mpiGroupData(tc->transition->group);
+    assert(gd);
+    MPI_Comm comm = gd->comm;
+    int tag = 1;
+    int err, id;
+
+    int last = -1; // offset of last start/wait action, for combining
+    a = as->action;
+    for(unsigned int i = 0; i < as->actionCount; i++, a = nextAction(a)) {
+        as->currentTid = a->tid;
+        tc = as->context[a->tid];
+        switch(a->type) {
+        case LAIK_AT_MpiReq:
+            laik_mpi_addMpiReq(as, a->round, count, req, 1);
+            last = -1;
+            break;
+
+        case LAIK_AT_MpiIsend: {
+            Laik_A_MpiIsend* aa = (Laik_A_MpiIsend*) a;
+            id = newID[aa->req_id];
+            if (aa->dtype != MPI_DATATYPE_NULL)
+                err = MPI_Send_init(aa->buf, 1, aa->dtype,
+                                    aa->to_rank, tag, comm, req + id);
+            else
+                err = MPI_Send_init(aa->buf, aa->count, getMPIDataType(tc->data),
+                                    aa->to_rank, tag, comm, req + id);
+            if (err != MPI_SUCCESS) laik_mpi_panic(err);
+            last = laik_mpi_addMpiReqRange(as, LAIK_AT_MpiStart,
+                                           a->round, id, last);
+            break;
+        }
+
+        case LAIK_AT_MpiIrecv: {
+            Laik_A_MpiIrecv* aa = (Laik_A_MpiIrecv*) a;
+            id = newID[aa->req_id];
+            if (aa->dtype != MPI_DATATYPE_NULL)
+                err = MPI_Recv_init(aa->buf, 1, aa->dtype,
+                                    aa->from_rank, tag, comm, req + id);
+            else
+                err = MPI_Recv_init(aa->buf, aa->count, getMPIDataType(tc->data),
+                                    aa->from_rank, tag, comm, req + id);
+            if (err != MPI_SUCCESS) laik_mpi_panic(err);
+            last = laik_mpi_addMpiReqRange(as, LAIK_AT_MpiStart,
+                                           a->round, id, last);
+            break;
+        }
+
+        case LAIK_AT_MpiWait: {
+            Laik_A_MpiWait* aa = (Laik_A_MpiWait*) a;
+            last = laik_mpi_addMpiReqRange(as, LAIK_AT_MpiWaitAll, a->round,
+                                           newID[aa->req_id], last);
+            break;
+        }
+
+        case LAIK_AT_MpiIallreduce:
+        case LAIK_AT_MpiIreduce: {
+            // not persistent: request is started on each execution
+            Laik_A_MpiIreduce* aa = (Laik_A_MpiIreduce*) a;
+            aa->req_id = newID[aa->req_id];
+            laik_aseq_add(a, as, a->round);
+            last = -1;
+            break;
+        }
+
+        default:
+            laik_aseq_add(a, as, a->round);
+            last = -1;
+            break;
+        }
+    }
+    free(newID);
+
+    laik_aseq_activateNewActions(as);
+    return true;
+}
 
 // calc statistics updates for MPI-specific actions
 static
 void laik_mpi_aseq_calc_stats(Laik_ActionSeq* as)
 {
     unsigned int count;
-    Laik_TransitionContext* tc = as->context[0];
-    int current_tid = 0;
     Laik_Action* a = as->action;
     for(unsigned int i = 0; i < as->actionCount; i++, a = nextAction(a)) {
-        assert(a->tid == current_tid); // TODO: only assumes actions from one transition
+        Laik_TransitionContext* tc = as->context[a->tid];
         switch(a->type) {
         case LAIK_AT_MpiIsend:
             count = ((Laik_A_MpiIsend*)a)->count;
@@ -982,84 +2321,1458 @@ void laik_mpi_aseq_calc_stats(Laik_ActionSeq* as)
             as->elemRecvCount += count;
             as->byteRecvCount += count * tc->data->elemsize;
             break;
+        case LAIK_AT_MpiIallreduce:
+        case LAIK_AT_MpiIreduce:
+            count = ((Laik_A_MpiIreduce*)a)->count;
+            as->msgReduceCount++;
+            as->elemReduceCount += count;
+            as->byteReduceCount += count * tc->data->elemsize;
+            break;
         default: break;
         }
     }
 }
 
-
+// transformation: replace pack+send and recv+unpack actions kept for large
+// ranges (see laik_aseq_flattenPackingMax) by pipelined variants, using
+// a buffer owned by the action sequence for <mpi_pipeline> chunks.
+// Done after sorting for deadlock avoidance, as pipelined actions do
+// blocking send/recv
 static
-void laik_mpi_prepare(Laik_ActionSeq* as)
+bool laik_mpi_pipelinePacking(Laik_ActionSeq* as)
 {
-    if (laik_log_begin(1)) {
-        laik_log_append("MPI backend prepare:\n");
-        laik_log_ActionSeq(as, false);
-        laik_log_flush(0);
-    }
-
-    // mark as prepared by MPI backend: for MPI-specific cleanup + action logging
-    as->backend = &laik_backend_mpi;
+    // must not have new actions, we want to start a new build
+    assert(as->newActionCount == 0);
 
-    bool changed = laik_aseq_splitTransitionExecs(as);
-    laik_log_ActionSeqIfChanged(changed, as, "After splitting transition execs");
-    if (as->actionCount == 0) {
-        laik_aseq_calc_stats(as);
-        return;
-    }
+    unsigned int count = 0;
+    Laik_Action* a = as->action;
+    for(unsigned int i = 0; i < as->actionCount; i++, a = nextAction(a))
+        if ((a->type == LAIK_AT_MapPackAndSend) ||
+            (a->type == LAIK_AT_MapRecvAndUnpack))
+            count++;
+    if (count == 0) return false;
 
-    changed = laik_aseq_flattenPacking(as);
-    laik_log_ActionSeqIfChanged(changed, as, "After flattening actions");
+    // actions are executed one after the other: use same buffer for all
+    char* buf = laik_aseq_newBuffer(as, (size_t) mpi_pipeline * mpi_chunksize);
 
-    if (mpi_reduce) {
-        // detect group reduce actions which can be replaced by all-reduce
-        // can be prohibited by setting LAIK_MPI_REDUCE=0
-        changed = laik_aseq_replaceWithAllReduce(as);
-        laik_log_ActionSeqIfChanged(changed, as, "After all-reduce detection");
-    }
+    a = as->action;
+    for(unsigned int i = 0; i < as->actionCount; i++, a = nextAction(a)) {
+        Laik_TransitionContext* tc = as->context[a->tid];
+        unsigned int chunk = mpi_chunksize / tc->data->elemsize;
+        assert(chunk > 0);
+        as->currentTid = a->tid;
 
-    changed = laik_aseq_combineActions(as);
-    laik_log_ActionSeqIfChanged(changed, as, "After combining actions 1");
+        switch(a->type) {
+        case LAIK_AT_MapPackAndSend: {
+            Laik_A_MapPackAndSend* aa = (Laik_A_MapPackAndSend*) a;
+            laik_mpi_addMpiPipe(as, LAIK_AT_MpiPipeSend, a->round,
+                                aa->fromMapNo, aa->range, aa->count,
+                                aa->to_rank, buf, chunk, mpi_pipeline);
+            break;
+        }
 
-    changed = laik_aseq_allocBuffer(as);
-    laik_log_ActionSeqIfChanged(changed, as, "After buffer allocation 1");
+        case LAIK_AT_MapRecvAndUnpack: {
+            Laik_A_MapRecvAndUnpack* aa = (Laik_A_MapRecvAndUnpack*) a;
+            laik_mpi_addMpiPipe(as, LAIK_AT_MpiPipeRecv, a->round,
+                                aa->toMapNo, aa->range, aa->count,
+                                aa->from_rank, buf, chunk, mpi_pipeline);
+            break;
+        }
 
-    changed = laik_aseq_splitReduce(as);
-    laik_log_ActionSeqIfChanged(changed, as, "After splitting reduce actions");
+        default:
+            laik_aseq_add(a, as, a->round);
+            break;
+        }
+    }
+    laik_aseq_activateNewActions(as);
 
-    changed = laik_aseq_allocBuffer(as);
-    laik_log_ActionSeqIfChanged(changed, as, "After buffer allocation 2");
+    return true;
+}
 
-    changed = laik_aseq_sort_rounds(as);
-    laik_log_ActionSeqIfChanged(changed, as, "After sorting rounds");
+//----------------------------------------------------------------------------
+// RMA mode (LAIK_MPI_RMA)
 
-    changed = laik_aseq_combineActions(as);
-    laik_log_ActionSeqIfChanged(changed, as, "After combining actions 2");
+// attach memory [<start>; <start>+<size>[ to window <win>, or increment the
+// reference count of an attached region containing it.
+// Returns start address of the region, to be given to laik_mpi_rmaDetach()
+static
+char* laik_mpi_rmaAttach(MPI_Win win, char* start, uint64_t size)
+{
+    for(int i = 0; i < mpi_rmaRegionCount; i++) {
+        MPIRmaRegion* r = &(mpi_rmaRegion[i]);
+        if ((r->win == win) && (start >= r->start) &&
+            (start + size <= r->start + r->size)) {
+            r->refs++;
+            return r->start;
+        }
+    }
 
-    changed = laik_aseq_allocBuffer(as);
-    laik_log_ActionSeqIfChanged(changed, as, "After buffer allocation 3");
+    if (mpi_rmaRegionCount == mpi_rmaRegionSize) {
+        mpi_rmaRegionSize = mpi_rmaRegionSize ? 2 * mpi_rmaRegionSize : 16;
+        mpi_rmaRegion = realloc(mpi_rmaRegion,
+                                mpi_rmaRegionSize * sizeof(MPIRmaRegion));
+        if (!mpi_rmaRegion) {
+            laik_panic("Out of memory allocating MPI RMA region list");
+            exit(1); // not actually needed, laik_panic never returns
+        }
+    }
+    int err = MPI_Win_attach(win, start, (MPI_Aint) size);
+    if (err != MPI_SUCCESS) laik_mpi_panic(err);
 
-    changed = laik_aseq_sort_2phases(as);
-    //changed = laik_aseq_sort_rankdigits(as);
-    laik_log_ActionSeqIfChanged(changed, as, "After sorting for deadlock avoidance");
+    MPIRmaRegion* r = &(mpi_rmaRegion[mpi_rmaRegionCount++]);
+    r->win = win;
+    r->start = start;
+    r->size = size;
+    r->refs = 1;
+    laik_log(1, "MPI RMA: attached %llu bytes at %p",
+             (unsigned long long) size, (void*) start);
+    return start;
+}
 
-    if (mpi_async) {
-        changed = laik_mpi_asyncSendRecv(as);
-        laik_log_ActionSeqIfChanged(changed, as, "After makeing send/recv async");
+// decrement reference count of region at <start> attached to <win>,
+// detaching it when not used any more
+static
+void laik_mpi_rmaDetach(MPI_Win win, char* start)
+{
+    for(int i = 0; i < mpi_rmaRegionCount; i++) {
+        MPIRmaRegion* r = &(mpi_rmaRegion[i]);
+        if ((r->win != win) || (r->start != start)) continue;
+        if (--(r->refs) > 0) return;
 
-        changed = laik_aseq_sort_rounds(as);
-        laik_log_ActionSeqIfChanged(changed, as, "After sorting rounds 2");
+        int err = MPI_Win_detach(win, start);
+        if (err != MPI_SUCCESS) laik_mpi_panic(err);
+        laik_log(1, "MPI RMA: detached region at %p", (void*) start);
+        mpi_rmaRegion[i] = mpi_rmaRegion[--mpi_rmaRegionCount];
+        return;
     }
-    laik_aseq_freeTempSpace(as);
-
-    laik_aseq_calc_stats(as);
-    laik_mpi_aseq_calc_stats(as);
+    // not found: already detached in laik_mpi_finalize()
 }
 
-static void laik_mpi_cleanup(Laik_ActionSeq* as)
+// return memory region to attach for receiving <bytes> at <p>: the mapping
+// containing it (or the mapping it is embedded in), or a buffer of the
+// action sequence. Falls back to the message buffer itself
+static
+char* laik_mpi_rmaRegion(Laik_ActionSeq* as, Laik_TransitionContext* tc,
+                         char* p, uint64_t bytes, uint64_t* size)
 {
-    if (laik_log_begin(1)) {
-        laik_log_append("MPI backend cleanup:\n");
-        laik_log_ActionSeq(as, false);
+    for(int i = 0; tc->toList && (i < tc->toList->count); i++) {
+        Laik_Mapping* m = &(tc->toList->map[i]);
+        while(m->baseMapping) m = m->baseMapping;
+        if (m->start && (p >= m->start) &&
+            (p + bytes <= m->start + m->capacity)) {
+            *size = m->capacity;
+            return m->start;
+        }
+    }
+    for(int i = 0; i < ASEQ_BUFFER_MAX; i++) {
+        if (as->buf[i] && (p >= as->buf[i]) &&
+            (p + bytes <= as->buf[i] + as->bufSize[i])) {
+            *size = as->bufSize[i];
+            return as->buf[i];
+        }
+    }
+    *size = bytes;
+    return p;
+}
+
+// return peer of send/recv action <a>, setting <isSend>. -1 if no message
+static
+int laik_mpi_msgPeer(Laik_Action* a, bool* isSend)
+{
+    *isSend = true;
+    switch(a->type) {
+    case LAIK_AT_BufSend:  return ((Laik_A_BufSend*) a)->to_rank;
+    case LAIK_AT_RBufSend: return ((Laik_A_RBufSend*) a)->to_rank;
+    case LAIK_AT_MapSend:  return ((Laik_BackendAction*) a)->rank;
+    default: break;
+    }
+    *isSend = false;
+    switch(a->type) {
+    case LAIK_AT_BufRecv:  return ((Laik_A_BufRecv*) a)->from_rank;
+    case LAIK_AT_RBufRecv: return ((Laik_A_RBufRecv*) a)->from_rank;
+    case LAIK_AT_MapRecv:  return ((Laik_BackendAction*) a)->rank;
+    default: break;
+    }
+    return -1;
+}
+
+// return group of ranks with <flag> set in <mark>, MPI_GROUP_NULL if empty
+static
+MPI_Group laik_mpi_rmaGroup(MPI_Group g, int* mark, int flag,
+                            int size, int* ranks)
+{
+    int n = 0;
+    for(int p = 0; p < size; p++)
+        if (mark[p] & flag) ranks[n++] = p;
+    if (n == 0) return MPI_GROUP_NULL;
+
+    MPI_Group res;
+    int err = MPI_Group_incl(g, n, ranks, &res);
+    if (err != MPI_SUCCESS) laik_mpi_panic(err);
+    return res;
+}
+
+// transformation for RMA mode: replace send/recv actions by puts into the
+// receive buffers of targets.
+// Receivers attach memory to receive into to the window of the group and
+// tell each sender the displacements of its messages (point-to-point, in
+// message order, as used for matching of send/recv). Each round with
+// messages becomes a PSCW epoch, opened at begin and closed at end of the
+// round. As epochs between two processes are matched in order, messages
+// from one process to another must be grouped into rounds the same way at
+// sender and receiver (round numbers may differ), which is checked.
+// Attached memory is detached in laik_mpi_cleanup()
+static
+bool laik_mpi_rmaPut(Laik_ActionSeq* as)
+{
+    // must not have new actions, we want to start a new build
+    assert(as->newActionCount == 0);
+
+    // all transition contexts are on the same group
+    Laik_TransitionContext* tc = as->context[0];
+    Laik_Group* g = tc->transition->group;
+    MPIGroupData* gd = mpiGroupData(g);
+    assert(gd && (gd->win != MPI_WIN_NULL));
+    int size = g->size;
+
+    // per peer: message counts, next message index, last round with
+    // messages, and number of epochs (rounds with messages) so far
+    int* sendCount = calloc(10 * (size_t) size, sizeof(int));
+    if (!sendCount) {
+        laik_panic("Out of memory allocating memory for MPI RMA peers");
+        exit(1); // not actually needed, laik_panic never returns
+    }
+    int* recvCount = sendCount + size;
+    int* sendPos = recvCount + size;
+    int* recvPos = sendPos + size;
+    int* sendRound = recvPos + size;
+    int* recvRound = sendRound + size;
+    int* sendEpoch = recvRound + size;
+    int* recvEpoch = sendEpoch + size;
+    int* mark = recvEpoch + size;
+    int* ranks = mark + size;
+
+    unsigned int sends = 0, recvs = 0;
+    bool isSend;
+    int p;
+    Laik_Action* a = as->action;
+    for(unsigned int i = 0; i < as->actionCount; i++, a = nextAction(a)) {
+        p = laik_mpi_msgPeer(a, &isSend);
+        if (p < 0) continue;
+        assert(p < size);
+        if (isSend) { sendCount[p]++; sends++; }
+        else        { recvCount[p]++; recvs++; }
+    }
+    if (sends + recvs == 0) {
+        free(sendCount);
+        return false;
+    }
+    for(p = 0, sends = 0, recvs = 0; p < size; p++) {
+        sendPos[p] = (int) sends;
+        recvPos[p] = (int) recvs;
+        sendRound[p] = recvRound[p] = -1;
+        sendEpoch[p] = recvEpoch[p] = -1;
+        sends += (unsigned) sendCount[p];
+        recvs += (unsigned) recvCount[p];
+    }
+
+    // (displacement, count, epoch) for each received/sent message
+    MPI_Aint* recvInfo = malloc(3 * (sends + recvs + 1) * sizeof(MPI_Aint));
+    MPI_Aint* sendInfo = recvInfo + 3 * recvs;
+    char** region = malloc((recvs + 1) * sizeof(char*));
+    MPI_Request* req = malloc(2 * (size_t) size * sizeof(MPI_Request));
+    if (!recvInfo || !region || !req) {
+        laik_panic("Out of memory allocating memory for MPI RMA setup");
+        exit(1); // not actually needed, laik_panic never returns
+    }
+
+    // attach memory for receiving, and collect displacements
+    int err, regionCount = 0;
+    a = as->action;
+    for(unsigned int i = 0; i < as->actionCount; i++, a = nextAction(a)) {
+        p = laik_mpi_msgPeer(a, &isSend);
+        if ((p < 0) || isSend) continue;
+
+        Laik_TransitionContext* atc = as->context[a->tid];
+        unsigned int count;
+        char* buf;
+        switch(a->type) {
+        case LAIK_AT_BufRecv:
+            buf = ((Laik_A_BufRecv*) a)->buf;
+            count = ((Laik_A_BufRecv*) a)->count;
+            break;
+        case LAIK_AT_RBufRecv: {
+            Laik_A_RBufRecv* aa = (Laik_A_RBufRecv*) a;
+            assert(aa->bufID < ASEQ_BUFFER_MAX);
+            buf = as->buf[aa->bufID] + aa->offset;
+            count = aa->count;
+            break;
+        }
+        default: {
+            Laik_BackendAction* ba = (Laik_BackendAction*) a;
+            assert(a->type == LAIK_AT_MapRecv);
+            assert(ba->toMapNo < atc->toList->count);
+            Laik_Mapping* toMap = &(atc->toList->map[ba->toMapNo]);
+            if (toMap->base == 0) {
+                laik_panic("MPI backend: RMA mode needs mappings to be "
+                           "allocated when preparing");
+                exit(1); // not actually needed, laik_panic never returns
+            }
+            buf = toMap->base + ba->offset;
+            count = ba->count;
+            break;
+        }
+        }
+
+        uint64_t bytes = (uint64_t) count * atc->data->elemsize;
+        uint64_t rsize;
+        char* rstart = laik_mpi_rmaRegion(as, atc, buf, bytes, &rsize);
+        region[regionCount++] = laik_mpi_rmaAttach(gd->win, rstart, rsize);
+
+        if (recvRound[p] != a->round) {
+            recvRound[p] = a->round;
+            recvEpoch[p]++;
+        }
+        int k = recvPos[p]++;
+        err = MPI_Get_address(buf, &(recvInfo[3 * k]));
+        if (err != MPI_SUCCESS) laik_mpi_panic(err);
+        recvInfo[3 * k + 1] = count;
+        recvInfo[3 * k + 2] = recvEpoch[p];
+    }
+
+    // tell senders where to put their messages
+    // (own tag to not get mixed up with messages of other sequences)
+    int tag = 3, reqCount = 0;
+    for(p = 0; p < size; p++) {
+        if (recvCount[p] > 0) {
+            int k = recvPos[p] - recvCount[p];
+            err = MPI_Isend(recvInfo + 3 * k, 3 * recvCount[p], MPI_AINT,
+                            p, tag, gd->comm, req + reqCount++);
+            if (err != MPI_SUCCESS) laik_mpi_panic(err);
+        }
+        if (sendCount[p] > 0) {
+            err = MPI_Irecv(sendInfo + 3 * sendPos[p], 3 * sendCount[p],
+                            MPI_AINT, p, tag, gd->comm, req + reqCount++);
+            if (err != MPI_SUCCESS) laik_mpi_panic(err);
+        }
+    }
+    err = MPI_Waitall(reqCount, req, MPI_STATUSES_IGNORE);
+    if (err != MPI_SUCCESS) laik_mpi_panic(err);
+
+    MPI_Group winGroup;
+    err = MPI_Win_get_group(gd->win, &winGroup);
+    if (err != MPI_SUCCESS) laik_mpi_panic(err);
+
+    laik_mpi_addMpiRmaWin(as, gd->win, regionCount, region);
+
+    a = as->action;
+    unsigned int i = 0;
+    while(i < as->actionCount) {
+        // actions [i;j[ belong to same round: find peers for epoch
+        int round = a->round;
+        unsigned int j = i;
+        Laik_Action* b = a;
+        memset(mark, 0, size * sizeof(int));
+        for(; (j < as->actionCount) && (b->round == round); j++, b = nextAction(b)) {
+            p = laik_mpi_msgPeer(b, &isSend);
+            if (p >= 0) mark[p] |= isSend ? 2 : 1;
+        }
+        MPI_Group origins = laik_mpi_rmaGroup(winGroup, mark, 1, size, ranks);
+        MPI_Group targets = laik_mpi_rmaGroup(winGroup, mark, 2, size, ranks);
+        as->currentTid = a->tid;
+        if ((origins != MPI_GROUP_NULL) || (targets != MPI_GROUP_NULL))
+            laik_mpi_addMpiRmaEpoch(as, LAIK_AT_MpiRmaStart, round,
+                                    origins, targets);
+
+        for(; i < j; i++, a = nextAction(a)) {
+            as->currentTid = a->tid;
+            p = laik_mpi_msgPeer(a, &isSend);
+            if (p < 0) {
+                laik_aseq_add(a, as, a->round);
+                continue;
+            }
+            // receive actions are not needed any more
+            if (!isSend) continue;
+
+            char* buf = 0;
+            int mapNo = -1;
+            unsigned int offset = 0, count;
+            switch(a->type) {
+            case LAIK_AT_BufSend:
+                buf = ((Laik_A_BufSend*) a)->buf;
+                count = ((Laik_A_BufSend*) a)->count;
+                break;
+            case LAIK_AT_RBufSend: {
+                Laik_A_RBufSend* aa = (Laik_A_RBufSend*) a;
+                assert(aa->bufID < ASEQ_BUFFER_MAX);
+                buf = as->buf[aa->bufID] + aa->offset;
+                count = aa->count;
+                break;
+            }
+            default: {
+                // mapping may get allocated later: resolved on execution
+                Laik_BackendAction* ba = (Laik_BackendAction*) a;
+                assert(a->type == LAIK_AT_MapSend);
+                mapNo = ba->fromMapNo;
+                offset = ba->offset;
+                count = ba->count;
+                break;
+            }
+            }
+
+            if (sendRound[p] != round) {
+                sendRound[p] = round;
+                sendEpoch[p]++;
+            }
+            int k = sendPos[p]++;
+            if ((sendInfo[3 * k + 1] != count) ||
+                (sendInfo[3 * k + 2] != sendEpoch[p])) {
+                laik_log(LAIK_LL_Panic,
+                         "MPI backend RMA: message to T%d with count %d in "
+                         "epoch %d, receiver expects count %d in epoch %d",
+                         p, count, sendEpoch[p], (int) sendInfo[3 * k + 1],
+                         (int) sendInfo[3 * k + 2]);
+                exit(1);
+            }
+            laik_mpi_addMpiPut(as, round, buf, mapNo, offset, count,
+                               p, sendInfo[3 * k]);
+        }
+
+        // first finish own puts, then wait for puts of others
+        if (targets != MPI_GROUP_NULL)
+            laik_mpi_addMpiRmaEpoch(as, LAIK_AT_MpiRmaComplete, round,
+                                    origins, targets);
+        if (origins != MPI_GROUP_NULL)
+            laik_mpi_addMpiRmaEpoch(as, LAIK_AT_MpiRmaWait, round,
+                                    origins, targets);
+    }
+    MPI_Group_free(&winGroup);
+    free(req);
+    free(recvInfo);
+    free(sendCount);
+
+    laik_aseq_activateNewActions(as);
+    return true;
+}
+
+
+//----------------------------------------------------------------------------
+// neighborhood collective mode (LAIK_MPI_NEIGHBOR)
+
+// do all containers of <as> use a reservation? Then sequences usually get
+// cached for reuse. Must be the same on all processes: do not check the
+// mapping lists, as processes without own ranges do not use reservations
+static
+bool laik_mpi_isStable(Laik_ActionSeq* as)
+{
+    for(int i = 0; i < as->contextCount; i++) {
+        Laik_TransitionContext* tc = as->context[i];
+        if (!tc->data->activeReservation) return false;
+    }
+    return true;
+}
+
+// return buffer of send/recv action <a> and set <count>. 0 if the address
+// is not known yet (message from/to mapping, may get allocated later)
+static
+char* laik_mpi_msgBuf(Laik_ActionSeq* as, Laik_Action* a, unsigned int* count)
+{
+    switch(a->type) {
+    case LAIK_AT_BufSend:
+        *count = ((Laik_A_BufSend*) a)->count;
+        return ((Laik_A_BufSend*) a)->buf;
+    case LAIK_AT_BufRecv:
+        *count = ((Laik_A_BufRecv*) a)->count;
+        return ((Laik_A_BufRecv*) a)->buf;
+    case LAIK_AT_RBufSend: {
+        Laik_A_RBufSend* aa = (Laik_A_RBufSend*) a;
+        assert(aa->bufID < ASEQ_BUFFER_MAX);
+        *count = aa->count;
+        return as->buf[aa->bufID] + aa->offset;
+    }
+    case LAIK_AT_RBufRecv: {
+        Laik_A_RBufRecv* aa = (Laik_A_RBufRecv*) a;
+        assert(aa->bufID < ASEQ_BUFFER_MAX);
+        *count = aa->count;
+        return as->buf[aa->bufID] + aa->offset;
+    }
+    default: break;
+    }
+    *count = 0;
+    return 0;
+}
+
+// can the messages of <as> be done with one collective operation?
+// Supported: messages from/to buffers known now, all in one round without
+// other actions, no reductions and no MPI-specific actions.
+// Sets number of messages received from/sent to each process of the group
+// in <recvs>/<sends>, and returns the total number of messages and bytes
+static
+bool laik_mpi_collectiveMsgs(Laik_ActionSeq* as, int* recvs, int* sends,
+                             int* msgs, uint64_t* bytes)
+{
+    bool ok = true;
+    int round = -1;
+    bool isSend;
+    unsigned int count;
+    *msgs = 0;
+    *bytes = 0;
+    Laik_Action* a = as->action;
+    for(unsigned int i = 0; i < as->actionCount; i++, a = nextAction(a)) {
+        if ((a->type == LAIK_AT_Nop) || (a->type == LAIK_AT_BufReserve))
+            continue;
+        int p = laik_mpi_msgPeer(a, &isSend);
+        if ((p < 0) || (laik_mpi_msgBuf(as, a, &count) == 0)) {
+            switch(a->type) {
+            case LAIK_AT_PackAndSend: case LAIK_AT_MapPackAndSend:
+            case LAIK_AT_RecvAndUnpack: case LAIK_AT_MapRecvAndUnpack:
+            case LAIK_AT_MapSend: case LAIK_AT_MapRecv:
+            case LAIK_AT_Reduce: case LAIK_AT_RBufReduce:
+            case LAIK_AT_GroupReduce: case LAIK_AT_RBufGroupReduce:
+            case LAIK_AT_MapGroupReduce:
+                ok = false;
+                break;
+            default:
+                if (a->type >= LAIK_AT_Backend) ok = false;
+                break;
+            }
+            continue;
+        }
+        if (*msgs == 0)
+            round = a->round;
+        else if (a->round != round)
+            ok = false;
+        if (isSend) sends[p]++;
+        else        recvs[p]++;
+        Laik_TransitionContext* tc = as->context[a->tid];
+        *bytes += (uint64_t) count * tc->data->elemsize;
+        (*msgs)++;
+    }
+    a = as->action;
+    for(unsigned int i = 0; i < as->actionCount; i++, a = nextAction(a)) {
+        if ((a->round != round) || (a->type == LAIK_AT_Nop)) continue;
+        if (laik_mpi_msgPeer(a, &isSend) < 0) ok = false;
+    }
+    return ok;
+}
+
+// setup for exchanging the messages of <as> with one neighborhood
+// collective. Collective over the group of <as>.
+// Returns true if supported by the actions of all processes. Then, <comm>
+// is set to a distributed graph communicator among the processes with
+// messages (ranks of sources and destinations ordered as in the group), or
+// MPI_COMM_NULL if this process has no messages
+static
+bool laik_mpi_neighborComm(Laik_ActionSeq* as, MPI_Comm* comm)
+{
+    // all transition contexts are on the same group
+    Laik_TransitionContext* tc = as->context[0];
+    Laik_Group* g = tc->transition->group;
+    MPIGroupData* gd = mpiGroupData(g);
+    assert(gd);
+    int size = g->size;
+
+    // per peer: number of messages as weight
+    int* sourceWeights = calloc(4 * (size_t) size, sizeof(int));
+    if (!sourceWeights) {
+        laik_panic("Out of memory allocating memory for MPI neighbors");
+        exit(1); // not actually needed, laik_panic never returns
+    }
+    int* destWeights = sourceWeights + size;
+    int* sources = destWeights + size;
+    int* dests = sources + size;
+
+    int msgs;
+    uint64_t bytes;
+    int ok = laik_mpi_collectiveMsgs(as, sourceWeights, destWeights,
+                                     &msgs, &bytes);
+    int allOk;
+    int err = MPI_Allreduce(&ok, &allOk, 1, MPI_INT, MPI_LAND, gd->comm);
+    if (err != MPI_SUCCESS) laik_mpi_panic(err);
+    *comm = MPI_COMM_NULL;
+    if (!allOk) {
+        free(sourceWeights);
+        return false;
+    }
+
+    // processes without messages do not take part in the exchange
+    MPI_Comm sub;
+    err = MPI_Comm_split(gd->comm, (msgs > 0) ? 0 : MPI_UNDEFINED,
+                         g->myid, &sub);
+    if (err != MPI_SUCCESS) laik_mpi_panic(err);
+    if (msgs > 0) {
+        int inCount = 0, outCount = 0;
+        for(int p = 0; p < size; p++) {
+            if (sourceWeights[p] > 0) {
+                sourceWeights[inCount] = sourceWeights[p];
+                sources[inCount++] = p;
+            }
+            if (destWeights[p] > 0) {
+                destWeights[outCount] = destWeights[p];
+                dests[outCount++] = p;
+            }
+        }
+        MPI_Group group, subGroup;
+        MPI_Comm_group(gd->comm, &group);
+        MPI_Comm_group(sub, &subGroup);
+        MPI_Group_translate_ranks(group, inCount, sources, subGroup, sources);
+        MPI_Group_translate_ranks(group, outCount, dests, subGroup, dests);
+        MPI_Group_free(&group);
+        MPI_Group_free(&subGroup);
+
+        err = MPI_Dist_graph_create_adjacent(sub, inCount, sources,
+                                             sourceWeights, outCount, dests,
+                                             destWeights, MPI_INFO_NULL,
+                                             0, comm);
+        if (err != MPI_SUCCESS) laik_mpi_panic(err);
+        MPI_Comm_free(&sub);
+        laik_log(1, "MPI neighbor: graph with %d sources, %d destinations",
+                 inCount, outCount);
+    }
+    free(sourceWeights);
+    return true;
+}
+
+// setup for exchanging the messages of <as> with one MPI_Alltoallv if the
+// exchange is dense enough (see LAIK_MPI_ALLTOALL). Collective over the
+// group of <as>.
+// Returns true if to be used. Then, <comm> is set to a communicator of the
+// processes with messages (ordered as in the group), or MPI_COMM_NULL if
+// this process has no messages
+static
+bool laik_mpi_alltoallComm(Laik_ActionSeq* as, MPI_Comm* comm)
+{
+    Laik_TransitionContext* tc = as->context[0];
+    Laik_Group* g = tc->transition->group;
+    MPIGroupData* gd = mpiGroupData(g);
+    assert(gd);
+    int size = g->size;
+
+    int* recvs = calloc(2 * (size_t) size, sizeof(int));
+    if (!recvs) {
+        laik_panic("Out of memory allocating memory for MPI all-to-all");
+        exit(1); // not actually needed, laik_panic never returns
+    }
+    int* sends = recvs + size;
+
+    int msgs;
+    uint64_t bytes;
+    bool ok = laik_mpi_collectiveMsgs(as, recvs, sends, &msgs, &bytes);
+    int peers = 0;
+    for(int p = 0; p < size; p++)
+        if ((recvs[p] > 0) || (sends[p] > 0)) peers++;
+    free(recvs);
+
+    // displacements in bytes must fit into int
+    if (bytes > INT_MAX) ok = false;
+
+    // minimum of (ok, -peers): all ok and maximum of peers
+    int v[2] = { ok ? 1 : 0, -peers }, res[2];
+    int err = MPI_Allreduce(v, res, 2, MPI_INT, MPI_MIN, gd->comm);
+    if (err != MPI_SUCCESS) laik_mpi_panic(err);
+    *comm = MPI_COMM_NULL;
+    if (!res[0] || (-res[1] < mpi_alltoall))
+        return false;
+
+    // processes without messages do not take part in the exchange
+    err = MPI_Comm_split(gd->comm, (msgs > 0) ? 0 : MPI_UNDEFINED,
+                         g->myid, comm);
+    if (err != MPI_SUCCESS) laik_mpi_panic(err);
+    laik_log(1, "MPI all-to-all: %d peers (max %d)", peers, -res[1]);
+    return true;
+}
+
+// check if messages of <as> are to be exchanged with one collective
+// operation, and do the setup, returning the communicator to use in
+// <nbComm> (neighborhood collective) or <a2aComm> (all-to-all).
+// Collective over the group: must be called by all processes preparing
+// the sequence, even without actions. Sorts actions by round
+static
+void laik_mpi_collectiveSetup(Laik_ActionSeq* as,
+                              MPI_Comm* nbComm, MPI_Comm* a2aComm)
+{
+    *nbComm = MPI_COMM_NULL;
+    *a2aComm = MPI_COMM_NULL;
+    if (!mpi_neighbor && !mpi_alltoall) return;
+
+    bool changed = laik_aseq_sort_rounds(as);
+    laik_log_ActionSeqIfChanged(changed, as, "After sorting rounds 2");
+
+    // same decisions on all processes
+    if (mpi_neighbor && laik_mpi_isStable(as))
+        if (laik_mpi_neighborComm(as, nbComm)) return;
+    if (mpi_alltoall)
+        laik_mpi_alltoallComm(as, a2aComm);
+}
+
+// transformation for neighbor mode: replace all send/recv actions by one
+// action doing a neighborhood collective on graph communicator <comm>
+// (from laik_mpi_neighborComm), placed at the first message.
+// The communicator is freed in laik_mpi_cleanup()
+static
+bool laik_mpi_neighborExchange(Laik_ActionSeq* as, MPI_Comm comm)
+{
+    // must not have new actions, we want to start a new build
+    assert(as->newActionCount == 0);
+
+    Laik_TransitionContext* tc = as->context[0];
+    int size = tc->transition->group->size;
+
+    // per peer: number of messages from/to it. Neighbors in group order
+    int* recvCount = calloc(4 * (size_t) size, sizeof(int));
+    if (!recvCount) {
+        laik_panic("Out of memory allocating memory for MPI neighbors");
+        exit(1); // not actually needed, laik_panic never returns
+    }
+    int* sendCount = recvCount + size;
+    int* recvIdx = sendCount + size;
+    int* sendIdx = recvIdx + size;
+
+    unsigned int msgs = 0, count;
+    bool isSend;
+    int p;
+    Laik_Action* a = as->action;
+    for(unsigned int i = 0; i < as->actionCount; i++, a = nextAction(a)) {
+        p = laik_mpi_msgPeer(a, &isSend);
+        if (p < 0) continue;
+        if (isSend) sendCount[p]++;
+        else        recvCount[p]++;
+        msgs++;
+    }
+    int inCount = 0, outCount = 0;
+    for(p = 0; p < size; p++) {
+        recvIdx[p] = recvCount[p] ? inCount++ : -1;
+        sendIdx[p] = sendCount[p] ? outCount++ : -1;
+    }
+    int n = inCount + outCount;
+
+    // parameters for the collective, and per neighbor the start of its
+    // messages in the arrays for creating struct datatypes
+    MPI_Aint* displ = malloc(n * (sizeof(MPI_Aint) + sizeof(MPI_Datatype) +
+                                  sizeof(int)));
+    int* start = malloc(2 * (n + 1) * sizeof(int));
+    int* blocklen = malloc(msgs * sizeof(int));
+    MPI_Aint* addr = malloc(msgs * sizeof(MPI_Aint));
+    MPI_Datatype* mtype = malloc(msgs * sizeof(MPI_Datatype));
+    if (!displ || !start || !blocklen || !addr || !mtype) {
+        laik_panic("Out of memory allocating memory for MPI neighbors");
+        exit(1); // not actually needed, laik_panic never returns
+    }
+    MPI_Datatype* type = (MPI_Datatype*) (displ + n);
+    int* ones = (int*) (type + n);
+    int* fill = start + n + 1;
+    start[0] = 0;
+    for(p = 0; p < size; p++) {
+        if (recvIdx[p] >= 0) start[recvIdx[p] + 1] = recvCount[p];
+        if (sendIdx[p] >= 0) start[inCount + sendIdx[p] + 1] = sendCount[p];
+    }
+    for(int k = 0; k < n; k++) {
+        start[k + 1] += start[k];
+        fill[k] = start[k];
+    }
+
+    // messages to/from a neighbor in action order, as with send/recv
+    int err;
+    a = as->action;
+    for(unsigned int i = 0; i < as->actionCount; i++, a = nextAction(a)) {
+        p = laik_mpi_msgPeer(a, &isSend);
+        if (p < 0) continue;
+        int k = fill[isSend ? inCount + sendIdx[p] : recvIdx[p]]++;
+        char* buf = laik_mpi_msgBuf(as, a, &count);
+        assert(buf != 0);
+        err = MPI_Get_address(buf, &(addr[k]));
+        if (err != MPI_SUCCESS) laik_mpi_panic(err);
+        blocklen[k] = (int) count;
+        Laik_TransitionContext* atc = as->context[a->tid];
+        mtype[k] = getMPIDataType(atc->data);
+    }
+    for(int k = 0; k < n; k++) {
+        err = MPI_Type_create_struct(start[k + 1] - start[k],
+                                     blocklen + start[k], addr + start[k],
+                                     mtype + start[k], &(type[k]));
+        if (err != MPI_SUCCESS) laik_mpi_panic(err);
+        err = MPI_Type_commit(&(type[k]));
+        if (err != MPI_SUCCESS) laik_mpi_panic(err);
+        ones[k] = 1;
+        displ[k] = 0;
+    }
+
+    bool added = false;
+    a = as->action;
+    for(unsigned int i = 0; i < as->actionCount; i++, a = nextAction(a)) {
+        p = laik_mpi_msgPeer(a, &isSend);
+        if (p < 0) {
+            laik_aseq_add(a, as, a->round);
+            continue;
+        }
+        if (added) continue;
+        as->currentTid = a->tid;
+        laik_mpi_addMpiNeighbor(as, a->round, comm, inCount, outCount, displ);
+        added = true;
+    }
+    free(mtype);
+    free(addr);
+    free(blocklen);
+    free(start);
+    free(recvCount);
+
+    laik_aseq_activateNewActions(as);
+    return true;
+}
+
+// transformation for all-to-all mode: replace all send/recv actions by one
+// MPI_Alltoallv on communicator <comm> (from laik_mpi_alltoallComm), with
+// copy actions packing sent messages before and unpacking received
+// messages after, placed at the first message.
+// Buffers and communicator are freed in laik_mpi_cleanup()
+static
+bool laik_mpi_alltoallvExchange(Laik_ActionSeq* as, MPI_Comm comm)
+{
+    // must not have new actions, we want to start a new build
+    assert(as->newActionCount == 0);
+
+    Laik_TransitionContext* tc = as->context[0];
+    Laik_Group* g = tc->transition->group;
+    MPIGroupData* gd = mpiGroupData(g);
+    int size = g->size;
+
+    // rank in <comm> for each process of the group
+    int commSize;
+    MPI_Comm_size(comm, &commSize);
+    int* rank = malloc(2 * (size_t) size * sizeof(int));
+    int* counts = calloc(6 * (size_t) commSize, sizeof(int));
+    if (!rank || !counts) {
+        laik_panic("Out of memory allocating memory for MPI all-to-all");
+        exit(1); // not actually needed, laik_panic never returns
+    }
+    int* ranks = rank + size;
+    for(int p = 0; p < size; p++)
+        ranks[p] = p;
+    MPI_Group group, commGroup;
+    MPI_Comm_group(gd->comm, &group);
+    MPI_Comm_group(comm, &commGroup);
+    MPI_Group_translate_ranks(group, size, ranks, commGroup, rank);
+    MPI_Group_free(&group);
+    MPI_Group_free(&commGroup);
+
+    // bytes to send/receive per rank, and displacements
+    int* sendCount = counts;
+    int* sendDispl = counts + commSize;
+    int* recvCount = counts + 2 * commSize;
+    int* recvDispl = counts + 3 * commSize;
+    int* sendPos = counts + 4 * commSize;
+    int* recvPos = counts + 5 * commSize;
+    bool isSend;
+    unsigned int count;
+    int p;
+    Laik_Action* a = as->action;
+    for(unsigned int i = 0; i < as->actionCount; i++, a = nextAction(a)) {
+        p = laik_mpi_msgPeer(a, &isSend);
+        if (p < 0) continue;
+        assert(rank[p] != MPI_UNDEFINED);
+        Laik_TransitionContext* atc = as->context[a->tid];
+        laik_mpi_msgBuf(as, a, &count);
+        int bytes = (int) (count * atc->data->elemsize);
+        if (isSend) sendCount[rank[p]] += bytes;
+        else        recvCount[rank[p]] += bytes;
+    }
+    int sendBytes = 0, recvBytes = 0;
+    for(int r = 0; r < commSize; r++) {
+        sendDispl[r] = sendPos[r] = sendBytes;
+        recvDispl[r] = recvPos[r] = recvBytes;
+        sendBytes += sendCount[r];
+        recvBytes += recvCount[r];
+    }
+    char* buf = malloc((size_t) sendBytes + (size_t) recvBytes + 1);
+    if (!buf) {
+        laik_panic("Out of memory allocating buffer for MPI all-to-all");
+        exit(1); // not actually needed, laik_panic never returns
+    }
+
+    // messages to/from a process in action order, as with send/recv
+    bool added = false;
+    a = as->action;
+    for(unsigned int i = 0; i < as->actionCount; i++, a = nextAction(a)) {
+        p = laik_mpi_msgPeer(a, &isSend);
+        if (p < 0) {
+            laik_aseq_add(a, as, a->round);
+            continue;
+        }
+        if (added) continue;
+
+        int round = a->round;
+        Laik_Action* b = a;
+        for(unsigned int j = i; j < as->actionCount; j++, b = nextAction(b)) {
+            p = laik_mpi_msgPeer(b, &isSend);
+            if ((p < 0) || !isSend) continue;
+            Laik_TransitionContext* btc = as->context[b->tid];
+            char* from = laik_mpi_msgBuf(as, b, &count);
+            char* to = buf + sendPos[rank[p]];
+            sendPos[rank[p]] += (int) (count * btc->data->elemsize);
+            as->currentTid = b->tid;
+            if (count > 0)
+                laik_aseq_addBufCopy(as, round, from, to, count);
+        }
+        as->currentTid = a->tid;
+        laik_mpi_addMpiAlltoallv(as, round, comm, commSize, counts, buf);
+        b = a;
+        for(unsigned int j = i; j < as->actionCount; j++, b = nextAction(b)) {
+            p = laik_mpi_msgPeer(b, &isSend);
+            if ((p < 0) || isSend) continue;
+            Laik_TransitionContext* btc = as->context[b->tid];
+            char* to = laik_mpi_msgBuf(as, b, &count);
+            char* from = buf + sendBytes + recvPos[rank[p]];
+            recvPos[rank[p]] += (int) (count * btc->data->elemsize);
+            as->currentTid = b->tid;
+            if (count > 0)
+                laik_aseq_addBufCopy(as, round, from, to, count);
+        }
+        added = true;
+    }
+    free(rank);
+
+    laik_aseq_activateNewActions(as);
+    return true;
+}
+
+//----------------------------------------------------------------------------
+// aggregation of small messages between nodes (LAIK_MPI_AGGREGATE)
+
+// small message between tasks on different nodes, identified by context
+// <tid>, source/destination task and index among such messages from
+// <src> to <dst>. <buf> is the send/recv buffer (only for own messages),
+// <blob> the position in the blob exchanged between node leaders, <mblob>
+// the position in the blob exchanged between node leader and <src>/<dst>.
+// <group> is a sort key, see laik_mpi_aggSort()
+typedef struct {
+    int tid, src, dst, idx;
+    unsigned int count;
+    int group;
+    char* buf;
+    char* blob;
+    char* mblob;
+} MPIAggMsg;
+
+static
+int aggMsg_cmp(const void* p1, const void* p2)
+{
+    const MPIAggMsg* m1 = (const MPIAggMsg*) p1;
+    const MPIAggMsg* m2 = (const MPIAggMsg*) p2;
+    if (m1->tid != m2->tid) return m1->tid - m2->tid;
+    if (m1->group != m2->group) return m1->group - m2->group;
+    if (m1->src != m2->src) return m1->src - m2->src;
+    if (m1->dst != m2->dst) return m1->dst - m2->dst;
+    return m1->idx - m2->idx;
+}
+
+// sort messages <m> into blob layout: by context, group, source, destination
+// and index. The group is destination (<byDst>) or source task, or its node
+// leader if <leader> is given. All messages of a blob have same context and
+// group, and both sides exchanging a blob get the same order
+static
+void laik_mpi_aggSort(MPIAggMsg* m, int n, bool byDst, int* leader)
+{
+    for(int i = 0; i < n; i++) {
+        m[i].group = byDst ? m[i].dst : m[i].src;
+        if (leader) m[i].group = leader[m[i].group];
+    }
+    qsort(m, (size_t) n, sizeof(MPIAggMsg), aggMsg_cmp);
+}
+
+// return index after messages in same blob as message <s> in sorted <m>
+static
+int laik_mpi_aggNext(MPIAggMsg* m, int n, int s)
+{
+    int e = s + 1;
+    while((e < n) && (m[e].tid == m[s].tid) && (m[e].group == m[s].group))
+        e++;
+    return e;
+}
+
+// element size of data in context <tid> of <as>
+static
+unsigned int laik_mpi_elemsize(Laik_ActionSeq* as, int tid)
+{
+    Laik_TransitionContext* tc = as->context[tid];
+    return tc->data->elemsize;
+}
+
+// peer of send/recv action <a> if it is to be aggregated: non-empty message
+// with at most LAIK_MPI_AGGREGATE bytes from/to buffer known now, peer on other
+// node than this process (according to node leaders <leader>). Sets
+// <isSend>, <buf> and <count>. Otherwise, returns -1
+static
+int laik_mpi_aggPeer(Laik_ActionSeq* as, Laik_Action* a, int* leader,
+                     bool* isSend, char** buf, unsigned int* count)
+{
+    int p = laik_mpi_msgPeer(a, isSend);
+    if (p < 0) return -1;
+    *buf = laik_mpi_msgBuf(as, a, count);
+    if ((*buf == 0) || (*count == 0)) return -1;
+
+    Laik_TransitionContext* tc = as->context[a->tid];
+    if (leader[p] == leader[tc->transition->group->myid]) return -1;
+    if ((uint64_t) *count * tc->data->elemsize > (uint64_t) mpi_aggregate)
+        return -1;
+    return p;
+}
+
+// transformation: aggregate small messages between tasks on different nodes
+// per pair of nodes (see LAIK_MPI_AGGREGATE). Node leaders (smallest task
+// of the group on a node) collect the messages of tasks on their node into
+// one blob per destination node and context, exchange blobs with other
+// leaders, and distribute received messages to the tasks on their node.
+// Collective over the group: must be called by all processes preparing the
+// sequence, even without actions, as leaders forward messages of others.
+// Same restrictions as for collective exchanges (laik_mpi_collectiveMsgs).
+// Rounds after the message round R are shifted by 6, with new rounds:
+// R: pack own messages into blob to leader (leader: into blobs to nodes),
+// R+1: send blob to leader, R+2: leader packs blobs to nodes,
+// R+3: exchange between leaders, R+4: leader unpacks into blobs to tasks,
+// R+5: send blobs to tasks, R+6: unpack into recv buffers.
+static
+bool laik_mpi_aggregateMsgs(Laik_ActionSeq* as)
+{
+    if ((mpi_aggregate <= 0) || !mpi_node || mpi_rma) return false;
+
+    // must not have new actions, we want to start a new build
+    assert(as->newActionCount == 0);
+
+    // all transition contexts are on the same group
+    Laik_TransitionContext* tc = as->context[0];
+    Laik_Group* g = tc->transition->group;
+    MPIGroupData* gd = mpiGroupData(g);
+    assert(gd);
+    int size = g->size;
+    int myid = g->myid;
+
+    // leader[task]: smallest task of group on same node as <task>
+    int* leader = malloc(3 * (size_t) size * sizeof(int));
+    if (!leader) {
+        laik_panic("Out of memory allocating memory for MPI aggregation");
+        exit(1); // not actually needed, laik_panic never returns
+    }
+    int* recvs = leader + size;
+    int* sends = recvs + size;
+    for(int t = 0; t < size; t++) {
+        int n = mpi_node[g->locationid[t]];
+        leader[t] = t;
+        for(int j = 0; j < t; j++) {
+            if (mpi_node[g->locationid[j]] != n) continue;
+            leader[t] = j;
+            break;
+        }
+    }
+    int myLeader = leader[myid];
+
+    int msgs;
+    uint64_t bytes;
+    for(int t = 0; t < 2 * size; t++)
+        recvs[t] = 0;
+    bool ok = laik_mpi_collectiveMsgs(as, recvs, sends, &msgs, &bytes);
+    // needs a new buffer for blobs
+    if (as->bufferCount >= ASEQ_BUFFER_MAX) ok = false;
+
+    // own small messages between nodes, with index per peer and direction,
+    // message round R (after all actions if there are no messages)
+    MPIAggMsg* own = malloc((size_t) (msgs + 1) * sizeof(MPIAggMsg));
+    if (!own) {
+        laik_panic("Out of memory allocating memory for MPI aggregation");
+        exit(1); // not actually needed, laik_panic never returns
+    }
+    for(int t = 0; t < 2 * size; t++)
+        recvs[t] = 0;
+    int n = 0, round = -1, maxround = 0;
+    bool isSend;
+    char* buf;
+    unsigned int count;
+    Laik_Action* a = as->action;
+    for(unsigned int i = 0; i < as->actionCount; i++, a = nextAction(a)) {
+        if (a->round > maxround) maxround = a->round;
+        if (laik_mpi_msgPeer(a, &isSend) >= 0) round = a->round;
+        int p = laik_mpi_aggPeer(as, a, leader, &isSend, &buf, &count);
+        if ((p < 0) || !ok) continue;
+        assert(n < msgs);
+        MPIAggMsg* m = own + n++;
+        m->tid = a->tid;
+        m->src = isSend ? myid : p;
+        m->dst = isSend ? p : myid;
+        m->idx = isSend ? sends[p]++ : recvs[p]++;
+        m->count = count;
+        m->buf = buf;
+    }
+    if (round < 0) round = maxround + 1;
+
+    // minimum of (ok, -n): all ok and maximum of small messages
+    int v[2] = { ok ? 1 : 0, -n }, res[2];
+    int err = MPI_Allreduce(v, res, 2, MPI_INT, MPI_MIN, gd->comm);
+    if (err != MPI_SUCCESS) laik_mpi_panic(err);
+    if (!res[0] || (res[1] == 0)) {
+        free(own);
+        free(leader);
+        return false;
+    }
+
+    // node leaders gather the small messages of tasks on their node
+    MPI_Comm nodeComm;
+    err = MPI_Comm_split(gd->comm, myLeader, myid, &nodeComm);
+    if (err != MPI_SUCCESS) laik_mpi_panic(err);
+    int nodeSize;
+    MPI_Comm_size(nodeComm, &nodeSize);
+    int* info = malloc((5 * (size_t) n + 2 * (size_t) nodeSize) * sizeof(int));
+    if (!info) {
+        laik_panic("Out of memory allocating memory for MPI aggregation");
+        exit(1); // not actually needed, laik_panic never returns
+    }
+    int* counts = info + 5 * n;
+    int* displs = counts + nodeSize;
+    for(int i = 0; i < n; i++) {
+        info[5*i]     = own[i].tid;
+        info[5*i + 1] = own[i].src;
+        info[5*i + 2] = own[i].dst;
+        info[5*i + 3] = own[i].idx;
+        info[5*i + 4] = (int) own[i].count;
+    }
+    int infoCount = 5 * n, allCount = 0;
+    err = MPI_Gather(&infoCount, 1, MPI_INT, counts, 1, MPI_INT, 0, nodeComm);
+    if (err != MPI_SUCCESS) laik_mpi_panic(err);
+    if (myid == myLeader) {
+        for(int i = 0; i < nodeSize; i++) {
+            displs[i] = allCount;
+            allCount += counts[i];
+        }
+    }
+    int* all = malloc(((size_t) allCount + 1) * sizeof(int));
+    if (!all) {
+        laik_panic("Out of memory allocating memory for MPI aggregation");
+        exit(1); // not actually needed, laik_panic never returns
+    }
+    err = MPI_Gatherv(info, infoCount, MPI_INT,
+                      all, counts, displs, MPI_INT, 0, nodeComm);
+    if (err != MPI_SUCCESS) laik_mpi_panic(err);
+    MPI_Comm_free(&nodeComm);
+
+    // split into outgoing/incoming messages of own node (leader) or own ones.
+    // Leader: entries of tasks on node from gathered info, own ones with buffer
+    int total = (myid == myLeader) ? n + (allCount - counts[0]) / 5 : n;
+    MPIAggMsg* out = malloc(2 * ((size_t) total + 1) * sizeof(MPIAggMsg));
+    if (!out) {
+        laik_panic("Out of memory allocating memory for MPI aggregation");
+        exit(1); // not actually needed, laik_panic never returns
+    }
+    MPIAggMsg* in = out + total + 1;
+    int outCount = 0, inCount = 0;
+    uint64_t blobBytes = 0;
+    for(int i = 0; i < total; i++) {
+        MPIAggMsg m;
+        if (i < n)
+            m = own[i];
+        else {
+            int* e = all + counts[0] + 5 * (i - n);
+            m.tid = e[0];
+            m.src = e[1];
+            m.dst = e[2];
+            m.idx = e[3];
+            m.count = (unsigned int) e[4];
+            m.buf = 0;
+        }
+        m.blob = 0;
+        m.mblob = 0;
+        // leader: messages of other tasks go through 2 blobs
+        uint64_t b = (uint64_t) m.count * laik_mpi_elemsize(as, m.tid);
+        blobBytes += (m.buf != 0) ? b : 2 * b;
+        if (leader[m.src] == myLeader)
+            out[outCount++] = m;
+        else
+            in[inCount++] = m;
+    }
+    free(all);
+    free(info);
+    free(own);
+
+    if (outCount + inCount == 0) {
+        free(out);
+        free(leader);
+        return false;
+    }
+
+    // keep all actions but aggregated messages, with rounds after R shifted
+    a = as->action;
+    for(unsigned int i = 0; i < as->actionCount; i++, a = nextAction(a)) {
+        if (laik_mpi_aggPeer(as, a, leader, &isSend, &buf, &count) >= 0)
+            continue;
+        laik_aseq_add(a, as, (a->round > round) ? a->round + 6 : a->round);
+    }
+
+    char* pos = laik_aseq_newBuffer(as, blobBytes);
+    if (myid != myLeader) {
+        // pack own messages into one blob to leader per context
+        laik_mpi_aggSort(out, outCount, false, 0);
+        for(int s = 0, e; s < outCount; s = e) {
+            e = laik_mpi_aggNext(out, outCount, s);
+            unsigned int elemsize = laik_mpi_elemsize(as, out[s].tid);
+            char* start = pos;
+            as->currentTid = out[s].tid;
+            for(int i = s; i < e; i++) {
+                laik_aseq_addBufCopy(as, round, out[i].buf, pos, out[i].count);
+                pos += out[i].count * elemsize;
+            }
+            laik_aseq_addBufSend(as, round + 1, start,
+                                 (unsigned int) ((pos - start) / elemsize),
+                                 myLeader);
+        }
+
+        // receive one blob from leader per context, unpack into recv buffers
+        laik_mpi_aggSort(in, inCount, true, 0);
+        for(int s = 0, e; s < inCount; s = e) {
+            e = laik_mpi_aggNext(in, inCount, s);
+            unsigned int elemsize = laik_mpi_elemsize(as, in[s].tid);
+            char* start = pos;
+            as->currentTid = in[s].tid;
+            for(int i = s; i < e; i++) {
+                laik_aseq_addBufCopy(as, round + 6, pos, in[i].buf, in[i].count);
+                pos += in[i].count * elemsize;
+            }
+            laik_aseq_addBufRecv(as, round + 5, start,
+                                 (unsigned int) ((pos - start) / elemsize),
+                                 myLeader);
+        }
+    }
+    else {
+        // receive blobs of tasks on node
+        laik_mpi_aggSort(out, outCount, false, 0);
+        for(int s = 0, e; s < outCount; s = e) {
+            e = laik_mpi_aggNext(out, outCount, s);
+            if (out[s].src == myid) continue;
+            unsigned int elemsize = laik_mpi_elemsize(as, out[s].tid);
+            char* start = pos;
+            for(int i = s; i < e; i++) {
+                out[i].mblob = pos;
+                pos += out[i].count * elemsize;
+            }
+            as->currentTid = out[s].tid;
+            laik_aseq_addBufRecv(as, round + 1, start,
+                                 (unsigned int) ((pos - start) / elemsize),
+                                 out[s].src);
+        }
+
+        // pack messages into blobs to node leaders, and send them
+        laik_mpi_aggSort(out, outCount, true, leader);
+        for(int s = 0, e; s < outCount; s = e) {
+            e = laik_mpi_aggNext(out, outCount, s);
+            unsigned int elemsize = laik_mpi_elemsize(as, out[s].tid);
+            char* start = pos;
+            as->currentTid = out[s].tid;
+            for(int i = s; i < e; i++) {
+                if (out[i].src == myid)
+                    laik_aseq_addBufCopy(as, round, out[i].buf, pos,
+                                         out[i].count);
+                else
+                    laik_aseq_addBufCopy(as, round + 2, out[i].mblob, pos,
+                                         out[i].count);
+                pos += out[i].count * elemsize;
+            }
+            laik_aseq_addBufSend(as, round + 3, start,
+                                 (unsigned int) ((pos - start) / elemsize),
+                                 out[s].group);
+        }
+
+        // receive blobs from node leaders
+        laik_mpi_aggSort(in, inCount, false, leader);
+        for(int s = 0, e; s < inCount; s = e) {
+            e = laik_mpi_aggNext(in, inCount, s);
+            unsigned int elemsize = laik_mpi_elemsize(as, in[s].tid);
+            char* start = pos;
+            for(int i = s; i < e; i++) {
+                in[i].blob = pos;
+                pos += in[i].count * elemsize;
+            }
+            as->currentTid = in[s].tid;
+            laik_aseq_addBufRecv(as, round + 3, start,
+                                 (unsigned int) ((pos - start) / elemsize),
+                                 in[s].group);
+        }
+
+        // unpack into own recv buffers and blobs to tasks, and send them
+        laik_mpi_aggSort(in, inCount, true, 0);
+        for(int s = 0, e; s < inCount; s = e) {
+            e = laik_mpi_aggNext(in, inCount, s);
+            as->currentTid = in[s].tid;
+            if (in[s].dst == myid) {
+                for(int i = s; i < e; i++)
+                    laik_aseq_addBufCopy(as, round + 4, in[i].blob, in[i].buf,
+                                         in[i].count);
+                continue;
+            }
+            unsigned int elemsize = laik_mpi_elemsize(as, in[s].tid);
+            char* start = pos;
+            for(int i = s; i < e; i++) {
+                laik_aseq_addBufCopy(as, round + 4, in[i].blob, pos,
+                                     in[i].count);
+                pos += in[i].count * elemsize;
+            }
+            laik_aseq_addBufSend(as, round + 5, start,
+                                 (unsigned int) ((pos - start) / elemsize),
+                                 in[s].dst);
+        }
+    }
+    assert(pos == as->buf[as->bufferCount - 1] + blobBytes);
+
+    laik_log(1, "MPI aggregation: %d outgoing, %d incoming small messages "
+             "between nodes%s", outCount, inCount,
+             (myid == myLeader) ? " (as node leader)" : "");
+
+    free(out);
+    free(leader);
+    laik_aseq_activateNewActions(as);
+    return true;
+}
+
+// remaining steps of laik_mpi_prepare after setup of collective exchange
+// (communicators <nbComm>/<a2aComm>, see laik_mpi_collectiveSetup)
+static
+void laik_mpi_prepareExchange(Laik_ActionSeq* as,
+                              MPI_Comm nbComm, MPI_Comm a2aComm)
+{
+    bool changed;
+    if ((nbComm != MPI_COMM_NULL) || (a2aComm != MPI_COMM_NULL)) {
+        // no sorting needed: one collective for all messages
+    }
+    else if (mpi_rma) {
+        // with RMA, no sorting for deadlock avoidance needed: epochs
+        // synchronize only peers. But epochs cover actions of a round,
+        // which must be adjacent
+        changed = laik_aseq_sort_rounds(as);
+        laik_log_ActionSeqIfChanged(changed, as, "After sorting rounds 2");
+    }
+    else {
+        changed = laik_aseq_sort_2phases(as);
+        //changed = laik_aseq_sort_rankdigits(as);
+        laik_log_ActionSeqIfChanged(changed, as, "After sorting for deadlock avoidance");
+
+        if (mpi_async) {
+            changed = laik_mpi_asyncSendRecv(as);
+            laik_log_ActionSeqIfChanged(changed, as, "After makeing send/recv async");
+
+            changed = laik_aseq_sort_rounds(as);
+            laik_log_ActionSeqIfChanged(changed, as, "After sorting rounds 2");
+        }
+    }
+
+    laik_aseq_calc_stats(as);
+    laik_mpi_aseq_calc_stats(as);
+
+    // done after statistics, which are based on send/recv actions
+    if (nbComm != MPI_COMM_NULL) {
+        changed = laik_mpi_neighborExchange(as, nbComm);
+        laik_log_ActionSeqIfChanged(changed, as, "After using neighborhood collective");
+    }
+    else if (a2aComm != MPI_COMM_NULL) {
+        changed = laik_mpi_alltoallvExchange(as, a2aComm);
+        laik_log_ActionSeqIfChanged(changed, as, "After using all-to-all collective");
+    }
+    else if (mpi_rma) {
+        changed = laik_mpi_rmaPut(as);
+        laik_log_ActionSeqIfChanged(changed, as, "After using RMA puts");
+    }
+
+    // done after statistics, which are based on isend/irecv actions
+    if (mpi_persistent && as->reuse) {
+        changed = laik_mpi_persistentRequests(as);
+        laik_log_ActionSeqIfChanged(changed, as, "After using persistent requests");
+    }
+    if (mpi_pipeline) {
+        changed = laik_mpi_pipelinePacking(as);
+        laik_log_ActionSeqIfChanged(changed, as, "After pipelining packing");
+    }
+    laik_aseq_freeTempSpace(as);
+}
+
+static
+void laik_mpi_prepare(Laik_ActionSeq* as)
+{
+    if (laik_log_begin(1)) {
+        laik_log_append("MPI backend prepare:\n");
+        laik_log_ActionSeq(as, false);
+        laik_log_flush(0);
+    }
+
+    // mark as prepared by MPI backend: for MPI-specific cleanup + action logging
+    as->backend = &laik_backend_mpi;
+
+    bool changed = laik_aseq_splitTransitionExecs(as);
+    laik_log_ActionSeqIfChanged(changed, as, "After splitting transition execs");
+    if (as->actionCount == 0) {
+        // still take part in setup of collective exchange of others
+        MPI_Comm nbComm, a2aComm;
+        laik_mpi_collectiveSetup(as, &nbComm, &a2aComm);
+        assert((nbComm == MPI_COMM_NULL) && (a2aComm == MPI_COMM_NULL));
+        // as node leader, may forward aggregated messages of others
+        if (laik_mpi_aggregateMsgs(as)) {
+            laik_log_ActionSeqIfChanged(true, as, "After aggregating messages between nodes");
+            laik_mpi_prepareExchange(as, nbComm, a2aComm);
+            return;
+        }
+        laik_aseq_calc_stats(as);
+        return;
+    }
+
+    if ((mpi_datatypes || mpi_strided) && mpi_async) {
+        // before flattening, which splits off packing into buffers
+        changed = laik_mpi_useDatatypes(as);
+        laik_log_ActionSeqIfChanged(changed, as, "After using derived datatypes");
+    }
+
+    // with pipelining, keep packing actions for large ranges
+    changed = laik_aseq_flattenPackingMax(as, mpi_pipeline ? mpi_chunksize : 0);
+    laik_log_ActionSeqIfChanged(changed, as, "After flattening actions");
+
+    if (mpi_reduce) {
+        // detect group reduce actions which can be replaced by all-reduce
+        // can be prohibited by setting LAIK_MPI_REDUCE=0
+        changed = laik_aseq_replaceWithAllReduce(as);
+        laik_log_ActionSeqIfChanged(changed, as, "After all-reduce detection");
+    }
+
+    changed = laik_aseq_combineActions(as);
+    laik_log_ActionSeqIfChanged(changed, as, "After combining actions 1");
+
+    changed = laik_aseq_allocBuffer(as);
+    laik_log_ActionSeqIfChanged(changed, as, "After buffer allocation 1");
+
+    changed = laik_aseq_splitReduceNodes(as, mpi_node);
+    laik_log_ActionSeqIfChanged(changed, as, "After splitting reduce actions");
+
+    changed = laik_aseq_allocBuffer(as);
+    laik_log_ActionSeqIfChanged(changed, as, "After buffer allocation 2");
+
+    changed = laik_aseq_sort_rounds(as);
+    laik_log_ActionSeqIfChanged(changed, as, "After sorting rounds");
+
+    changed = laik_aseq_combineActions(as);
+    laik_log_ActionSeqIfChanged(changed, as, "After combining actions 2");
+
+    changed = laik_aseq_allocBuffer(as);
+    laik_log_ActionSeqIfChanged(changed, as, "After buffer allocation 3");
+
+    // collective over the group: decision must be the same on all processes
+    MPI_Comm nbComm, a2aComm;
+    laik_mpi_collectiveSetup(as, &nbComm, &a2aComm);
+
+    if ((nbComm == MPI_COMM_NULL) && (a2aComm == MPI_COMM_NULL)) {
+        // also collective over the group
+        changed = laik_mpi_aggregateMsgs(as);
+        laik_log_ActionSeqIfChanged(changed, as, "After aggregating messages between nodes");
+    }
+
+    laik_mpi_prepareExchange(as, nbComm, a2aComm);
+}
+
+static void laik_mpi_cleanup(Laik_ActionSeq* as)
+{
+    if (laik_log_begin(1)) {
+        laik_log_append("MPI backend cleanup:\n");
+        laik_log_ActionSeq(as, false);
         laik_log_flush(0);
     }
 
@@ -1067,9 +3780,51 @@ static void laik_mpi_cleanup(Laik_ActionSeq* as)
 
     if ((as->actionCount > 0) && (as->action->type == LAIK_AT_MpiReq)) {
         Laik_A_MpiReq* aa = (Laik_A_MpiReq*) as->action;
+        int finalized;
+        MPI_Finalized(&finalized);
+        if (aa->persistent && !finalized) {
+            for(unsigned int i = 0; i < aa->count; i++) {
+                // requests of non-blocking collectives are not persistent
+                if (aa->req[i] == MPI_REQUEST_NULL) continue;
+                int err = MPI_Request_free(aa->req + i);
+                if (err != MPI_SUCCESS) laik_mpi_panic(err);
+            }
+        }
         free(aa->req);
         laik_log(1, "  freed MPI_Request array with %d entries", aa->count);
     }
+
+    // RMA mode: detach memory, free groups of epochs.
+    // Neighbor/all-to-all mode: free datatypes, buffers and communicator
+    int finalized;
+    MPI_Finalized(&finalized);
+    Laik_Action* a = as->action;
+    for(unsigned int i = 0; i < as->actionCount; i++, a = nextAction(a)) {
+        if (a->type == LAIK_AT_MpiRmaWin) {
+            Laik_A_MpiRmaWin* aa = (Laik_A_MpiRmaWin*) a;
+            for(int j = 0; (j < aa->count) && !finalized; j++)
+                laik_mpi_rmaDetach(aa->win, aa->region[j]);
+            free(aa->region);
+        }
+        else if ((a->type == LAIK_AT_MpiRmaStart) && !finalized) {
+            Laik_A_MpiRmaEpoch* aa = (Laik_A_MpiRmaEpoch*) a;
+            if (aa->origins != MPI_GROUP_NULL) MPI_Group_free(&(aa->origins));
+            if (aa->targets != MPI_GROUP_NULL) MPI_Group_free(&(aa->targets));
+        }
+        else if (a->type == LAIK_AT_MpiNeighbor) {
+            Laik_A_MpiNeighbor* aa = (Laik_A_MpiNeighbor*) a;
+            for(int j = 0; (j < aa->inCount + aa->outCount) && !finalized; j++)
+                MPI_Type_free(&(aa->type[j]));
+            if (!finalized) MPI_Comm_free(&(aa->comm));
+            free(aa->displ);
+        }
+        else if (a->type == LAIK_AT_MpiAlltoallv) {
+            Laik_A_MpiAlltoallv* aa = (Laik_A_MpiAlltoallv*) a;
+            if (!finalized) MPI_Comm_free(&(aa->comm));
+            free(aa->sendCount);
+            free(aa->sendBuf);
+        }
+    }
 }
 
 
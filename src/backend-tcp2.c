@@ -27,7 +27,58 @@
  * to be announced at registration time, so it is easy to fall back to ASCII
  * with nc/telnet. Also, data packages are only accepted if permission is given
  * by receiver. This enables immediate consumption of all messages without
- * blocking.
+ * blocking. Binary data is framed either with 'B' and a 16-bit byte count,
+ * or with 'L' and a 64-bit byte count (little endian). LAIK processes send
+ * a range as one 'L' frame, written directly from the mapping.
+ *
+ * Flow control for binary data is credit-based: each process may send up to
+ * LAIK_TCP2_CREDIT bytes (default 256 KB, must be same for all processes)
+ * to a peer without permission. Such eager data is sent with an 'E' frame
+ * (same format as 'L') and is staged at the receiver if no matching receive
+ * is posted yet. After consumption, the receiver returns the credit via
+ * "flowcredit". Only ranges larger than the credit window need permission
+ * via "allowsend" before sending.
+ *
+ * Binary data between processes on the same host (see check_local) goes via
+ * shared memory if both announced flag 's' at registration. On first binary
+ * send to such a peer, the sender creates a POSIX shared memory ring of
+ * LAIK_TCP2_SHM bytes and asks the peer to map it ("useshm open <name>").
+ * Default is 0 (off): opt-in, as rings of crashed processes may be left in
+ * /dev/shm. After "useshm ok", the payload of 'E'/'L' frames is
+ * written into the ring and announced by 'S' frames (8-byte count) on the
+ * connection. This keeps ordering with commands and works with the event
+ * loop. A sender waiting for free space in the ring sleeps on a futex in the
+ * ring header, which is woken by the receiver after consumption.
+ *
+ * With LAIK_TCP2_COMPRESS=<bytes>, a process announces flag 'z' and binary
+ * data frames of at least the given size sent via TCP to peers which also
+ * announced 'z' are compressed with a simple LZ-style codec (see lz_compress).
+ * A compressed frame is 'Z' + 8-byte count, followed by the 8-byte count of
+ * uncompressed bytes and the compressed stream. The receiver decompresses
+ * the whole frame and handles the result like eager data. Frames which do
+ * not get smaller are sent uncompressed.
+ *
+ * Group reductions use binomial trees for reduce and broadcast. All-reduce
+ * (same input and output group) uses recursive doubling for small data and
+ * a ring algorithm for large vectors. If processes run on multiple hosts
+ * (taken from location strings), a node-aware algorithm is preferred: reduce
+ * within hosts first, then across one leader per host. LAIK_TCP2_NODES=0
+ * disables node awareness, k > 1 emulates hosts with k consecutive LIDs.
+ * LAIK_TCP2_REDUCE can force an algorithm (1: linear via one process,
+ * 2: tree, 3: recursive doubling, 4: ring, 5: node-aware).
+ *
+ * With LAIK_TCP2_THREAD=1, a progress thread handles incoming commands while
+ * the application is outside of LAIK (accepting connections, registrations,
+ * flow control, staging of eager data). The main thread holds a lock on
+ * the instance data while in any backend function.
+ *
+ * Connections among peers are opened on first use by default. With
+ * LAIK_TCP2_CONNECT=1, all connections are opened in parallel (non-blocking
+ * connect) right after startup and after each resize. With
+ * LAIK_TCP2_CONNECT=2, only peers referenced by an action sequence are
+ * connected, when the sequence is prepared. To avoid duplicate connections,
+ * only peers with lower LID are connected. LAIK_TCP2_SOCKBUF sets send and
+ * receive buffer sizes of sockets (default: OS setting).
  *
  * Startup (master)
  * - master process (location ID 0) is the process started on LAIK_TCP2_HOST
@@ -93,7 +144,9 @@
  *   to each process
  * - the registering and all existing processes sends back "ok" as response
  * - master sends compute phase and epoch to just registered process via
- *   "phase <phaseid> <epoch>\n", which allows process to start peer connections
+ *   "phase <phaseid> <epoch> <credit>\n", which allows process to start peer connections
+ *   - <credit> is the credit window of the master (LAIK_TCP2_CREDIT), which must
+ *     be same on all processes: a process with a different setting uses it
  *   - the epoch increments for each process world change
  *   - the phase id allows new joining processes to know where to start
  *   - in startup phase, master only can do this after getting the permission
@@ -137,14 +190,16 @@
  * - connections can be used bidirectionally
  *
  * KVS Sync:
- * - two phases:
- *   - send changed objects to home process
- *   - receiving changes from home process
- * - start with "sync <id>\n"
- * - multiple "object <type> <name> <version> <refcount>[ <value>]\n"
- *   sending <value> is optional if only <refcount> changes
- * - end with "done\n"
- * - objects may be released if all <refcounts> are 0
+ * - two phases along a binomial tree over the processes of the world:
+ *   - gather: merge own changes with changes from children, send to parent
+ *   - broadcast: receive merged changes from parent, forward to children
+ * - changes are sent as one binary frame: 'K' + 8 bytes length, followed by
+ *   number of offsets and data bytes (4 bytes each), offsets, and data of the
+ *   change journal (see Laik_KVS_Changes)
+ * - if any process does not accept binary data, changes are sent one by one
+ *   to/from master via "kvs changes <count>" and "kvs data <key> <value>",
+ *   with master requesting changes of one process after the other via
+ *   "kvs allow <name>"
  *
  * Deregistration: todo
  *
@@ -159,7 +214,10 @@
 
 #include <assert.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
 #include <signal.h>
 #include <stdlib.h>
 #include <string.h>
@@ -167,6 +225,14 @@
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <time.h>
+#include <sys/uio.h>
 #include <arpa/inet.h>
 #include <netinet/tcp.h>
 // for VSC to see def of addrinfo
@@ -179,8 +245,11 @@
 // defaults
 #define TCP2_PORT 7777
 
-#define MAX_PEERS 256
-#define MAX_FDS 256
+#define MAX_PEERS 1024
+// backlog of pending connections at listening socket
+#define LISTEN_BACKLOG 128
+// maximal number of events handled per epoll_wait call
+#define MAX_EVENTS 64
 // receive buffer length
 #define RBUF_LEN 8*1024
 
@@ -190,6 +259,7 @@ void tcp2_sync(Laik_KVStore* kvs);
 Laik_Group* tcp2_resize(Laik_ResizeRequests*);
 void tcp2_finish_resize();
 void tcp2_make_progress();
+void tcp2_finalize(Laik_Instance* inst);
 
 typedef struct _InstData InstData;
 
@@ -200,7 +270,8 @@ static Laik_Backend laik_backend = {
     .sync = tcp2_sync,
     .resize = tcp2_resize,
     .finish_resize = tcp2_finish_resize,
-    .make_progress = tcp2_make_progress
+    .make_progress = tcp2_make_progress,
+    .finalize = tcp2_finalize
 };
 
 static Laik_Instance* instance = 0;
@@ -233,6 +304,25 @@ typedef enum _PeerState {
     PS_InResizeRemove3 // master: peer marked for removal, got confirmation
 } PeerState;
 
+// shared memory ring for data from one process to another on the same host
+// written by sender only, apart from the header fields set by the receiver
+typedef struct _ShmRing {
+    uint64_t size;     // size of data area
+    uint64_t tail;     // bytes consumed by receiver
+    uint32_t seq;      // futex word, incremented by receiver on consumption
+    uint32_t waiting;  // set by sender while waiting for free space
+    char pad[40];      // data area starts at next cache line
+    char data[];
+} ShmRing;
+
+// state of shared memory ring for sending data to a peer
+typedef enum _ShmState {
+    SHM_Unknown = 0, // not checked yet
+    SHM_None,        // not possible, use TCP connection
+    SHM_Pending,     // ring created, waiting for peer to map it
+    SHM_Active       // binary data is sent via ring
+} ShmState;
+
 // communicating peer
 // can be connected (fd >=0) or not
 typedef struct _Peer {
@@ -244,6 +334,16 @@ typedef struct _Peer {
 
     // capabilities
     bool accepts_bin_data; // accepts binary data
+    bool accepts_shm;      // accepts binary data via shared memory
+    bool accepts_zip;      // accepts compressed binary data
+
+    // shared memory rings (only with peers on same host)
+    ShmState shm_state; // state of ring for sending to peer
+    ShmRing* sring;     // ring for sending to peer (created by us)
+    uint64_t shead;     // bytes written into sring
+    char* sname;        // name of sring, until peer mapped it
+    ShmRing* rring;     // ring for receiving from peer (created by peer)
+    uint64_t rtail;     // bytes consumed from rring
 
     // data we are currently receiving from peer
     int rcount;    // element count in receive
@@ -252,11 +352,24 @@ typedef struct _Peer {
     Laik_Mapping* rmap; // mapping to write received data to
     Laik_Range* rcv_range; // range to write received data to
     Laik_Index rcv_idx; // index representing receive progress
+    char* rcv_ptr; // if range contiguous in mapping: address of first element
+    uint64_t rbytes; // bytes received at rcv_ptr (only used without reduction)
+    char* ebuf;        // staging buffer for eager data without posted receive
+    uint64_t ebuf_used, ebuf_size;
     Laik_ReductionOperation rro; // reduction with existing value
 
     // allowed to send data to peer?
     int scount;    // element count allowed to send, 0 if not
     int selemsize; // byte count expected per element
+    uint64_t scredit; // bytes allowed to send eagerly
+
+    // KVS changes frame received from peer (one per sync phase)
+    char* kvs_buf;    // 0 if no frame pending
+    uint64_t kvs_len, kvs_got;
+
+    // compressed frame currently received from peer
+    char* zbuf;
+    uint64_t zbuf_len, zbuf_got;
 
     // info on early-entered resize phase (only used at master)
     int phase, epoch;
@@ -265,6 +378,7 @@ typedef struct _Peer {
 // registrations for active fds in event loop
 typedef void (*loop_cb_t)(InstData* d, int fd);
 typedef struct {
+    int fd;           // file descriptor this state belongs to
     PeerState state;  // state if no LID assigned
     int lid;          // LID (location id) of peer
     loop_cb_t cb;
@@ -274,9 +388,32 @@ typedef struct {
     int rbuf_used;
     char* rbuf;
     // if > 0 we are in binary data receive mode, outstanding bytes
-    int outstanding_bin;
+    int64_t outstanding_bin;
+    bool eager_bin; // binary data is eager, may need staging
+    bool kvs_bin;   // binary data is KVS changes frame
+    bool zip_bin;   // binary data is compressed frame
 } FDState;
 
+// algorithms for group reductions (see exec_reduce)
+typedef enum _ReduceAlg {
+    RA_Auto = 0,    // select by group shape and message size
+    RA_Linear,      // all to one process, result sent one by one
+    RA_Tree,        // binomial tree reduce + binomial tree broadcast
+    RA_RecDoubling, // recursive doubling (input group = output group)
+    RA_Ring,        // ring reduce-scatter + allgather (input = output group)
+    RA_Nodes        // within nodes first, then across node leaders
+} ReduceAlg;
+
+// up to this size, recursive doubling is used for all-reduce
+#define REDUCE_RD_MAX (64*1024)
+
+// when to open connections to peers
+typedef enum _ConnectMode {
+    CM_Lazy = 0,    // on first use
+    CM_All,         // to all peers after startup and resize
+    CM_Neighbors    // to peers referenced by action sequence, on preparation
+} ConnectMode;
+
 struct _InstData {
     PeerState mystate;
     int mylid;        // my location ID
@@ -288,12 +425,30 @@ struct _InstData {
     int phase;        // current phase
     int epoch;        // current epoch
     bool accept_bin_data; // configured to accept binary data
+    uint64_t credit;  // credit window for eager data per peer (bytes)
+    uint64_t shm_size; // size of shared memory rings to peers, 0 disables
+    uint64_t compress; // min. size of frames to compress, 0 disables
+    char* zbuf;        // buffer for compressing frames to send
+    uint64_t zbuf_size;
+    Laik_ActionSeq* exec_as; // action sequence in execution (for statistics)
+    ReduceAlg reduce_alg; // algorithm for group reductions
+    int nodes;        // node awareness: 0 off, 1 by host, k: emulated size
+    ConnectMode connect_mode; // when to open connections to peers
+    int sockbuf;      // socket buffer sizes (bytes), 0 for OS default
 
     // event loop
-    int maxfds;       // highest fd in rset
-    fd_set rset;      // read set for select
+    int epfd;         // epoll instance with registered fds
     int exit;         // set to exit event loop
-    FDState fds[MAX_FDS];
+    int fdsSize;      // size of fds table (indexed by fd, grows on demand)
+    FDState** fds;    // states are allocated once and never moved
+
+    // optional progress thread
+    bool use_thread;  // configured to use progress thread
+    bool in_thread;   // set while progress thread handles events
+    pthread_t thread;
+    pthread_mutex_t lock; // held by thread handling events
+    int tepfd;        // epoll instance of progress thread (epfd + stopfd)
+    int stopfd;       // eventfd to request progress thread termination
 
     // currently synced KVS (usually NULL)
     Laik_KVStore* kvs;
@@ -351,6 +506,21 @@ char* istr(int dims, Laik_Index* idx)
     return str;
 }
 
+// flags announced by peer <p>: 'b' binary data, 's' shared memory,
+// 'z' compressed binary data
+static
+char* peer_flags(Peer* p)
+{
+    static char flags[4];
+    int i = 0;
+    if (p->accepts_bin_data) flags[i++] = 'b';
+    if (p->accepts_shm) flags[i++] = 's';
+    if (p->accepts_zip) flags[i++] = 'z';
+    if (i == 0) flags[i++] = '-';
+    flags[i] = 0;
+    return flags;
+}
+
 static
 char* get_statestring(PeerState st)
 {
@@ -450,68 +620,199 @@ char* get_statestring(PeerState st)
 
 // event loop functions
 
+// return true if <fd> is registered with the event loop
+static
+bool has_rfd(InstData* d, int fd)
+{
+    return (fd >= 0) && (fd < d->fdsSize) && d->fds[fd] && d->fds[fd]->cb;
+}
+
+// register <fd> with callback <cb> for incoming data.
+// Notification is edge-triggered: callbacks must consume all available input
 void add_rfd(InstData* d, int fd, loop_cb_t cb)
 {
-    assert(fd < MAX_FDS);
-    assert(d->fds[fd].cb == 0);
+    assert(fd >= 0);
+    if (fd >= d->fdsSize) {
+        // grow table: no limit on fd numbers
+        int newSize = (d->fdsSize > 0) ? d->fdsSize : 64;
+        while(newSize <= fd) newSize *= 2;
+        d->fds = realloc(d->fds, newSize * sizeof(FDState*));
+        if (!d->fds) {
+            laik_panic("TCP2 Out of memory allocating FD table");
+            exit(1); // not actually needed, laik_panic never returns
+        }
+        for(int i = d->fdsSize; i < newSize; i++)
+            d->fds[i] = 0;
+        d->fdsSize = newSize;
+    }
+    if (d->fds[fd] == 0) {
+        // pointers to FD states are handed out (join requests): never free
+        d->fds[fd] = malloc(sizeof(FDState));
+        if (!d->fds[fd]) {
+            laik_panic("TCP2 Out of memory allocating FD state");
+            exit(1); // not actually needed, laik_panic never returns
+        }
+        d->fds[fd]->fd = fd;
+        d->fds[fd]->state = PS_Invalid;
+        d->fds[fd]->cb = 0;
+    }
+    FDState* fds = d->fds[fd];
+    assert(fds->cb == 0);
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.fd = fd;
+    if (epoll_ctl(d->epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        laik_panic("TCP2 cannot add FD to epoll instance");
+        exit(1); // not actually needed, laik_panic never returns
+    }
 
-    FD_SET(fd, &d->rset);
-    if (fd > d->maxfds) d->maxfds = fd;
-    d->fds[fd].cb = cb;
-    d->fds[fd].lid = -1;
-    d->fds[fd].cmd = 0; // no unprocessed command
-    d->fds[fd].rbuf = malloc(RBUF_LEN);
-    d->fds[fd].rbuf_used = 0;
-    d->fds[fd].outstanding_bin = 0;
+    fds->cb = cb;
+    fds->lid = -1;
+    fds->cmd = 0; // no unprocessed command
+    fds->rbuf = malloc(RBUF_LEN);
+    fds->rbuf_used = 0;
+    fds->outstanding_bin = 0;
+    fds->eager_bin = false;
+    fds->kvs_bin = false;
+    fds->zip_bin = false;
 }
 
 void rm_rfd(InstData* d, int fd)
 {
-    assert(fd < MAX_FDS);
-    assert(d->fds[fd].cb != 0);
+    assert(has_rfd(d, fd));
+
+    // fd may be closed already, which removes it from epoll automatically
+    epoll_ctl(d->epfd, EPOLL_CTL_DEL, fd, 0);
+    d->fds[fd]->cb = 0;
+    d->fds[fd]->state = PS_Invalid;
+    free(d->fds[fd]->rbuf);
+    d->fds[fd]->rbuf = 0;
+}
 
-    FD_CLR(fd, &d->rset);
-    if (fd == d->maxfds)
-        while(!FD_ISSET(d->maxfds, &d->rset)) d->maxfds--;
-    d->fds[fd].cb = 0;
-    d->fds[fd].state = PS_Invalid;
-    free(d->fds[fd].rbuf);
-    d->fds[fd].rbuf = 0;
+// wait for events (with <timeout> in ms, -1 for blocking) and call
+// callbacks of ready fds. Returns number of events
+static
+int wait_events(InstData* d, int timeout)
+{
+    struct epoll_event ev[MAX_EVENTS];
+    int ready = epoll_wait(d->epfd, ev, MAX_EVENTS, timeout);
+    if (ready < 0) {
+        if (errno == EINTR) return 0;
+        laik_panic("TCP2 error in epoll_wait");
+        exit(1); // not actually needed, laik_panic never returns
+    }
+    for(int i = 0; i < ready; i++) {
+        int fd = ev[i].data.fd;
+        // may have been removed by a callback for an event before
+        if (!has_rfd(d, fd)) continue;
+        (d->fds[fd]->cb)(d, fd);
+    }
+    return ready;
 }
 
 // run event loop until an event handler asks to exit
 void run_loop(InstData* d)
 {
     d->exit = 0;
-    while(d->exit == 0) {
-        fd_set rset = d->rset;
-        if (select(d->maxfds+1, &rset, 0, 0, 0) >= 0) {
-            for(int i = 0; i <= d->maxfds; i++)
-                if (FD_ISSET(i, &rset)) {
-                    assert(d->fds[i].cb != 0);
-                    (d->fds[i].cb)(d, i);
-                }
-        }
-    }
+    while(d->exit == 0)
+        wait_events(d, -1);
 }
 
 // handle queued input and return immediatly
 void check_loop(InstData* d)
 {
-    struct timeval tv = {0,0}; // zero timeout: do not block
+    while(wait_events(d, 0) > 0);
+}
 
+// progress thread: handle events while the main thread is outside of LAIK.
+// The epoll instance of the event loop becomes readable if events are
+// pending, without consuming them. If the main thread is inside LAIK, it
+// holds the lock and handles the events itself.
+static
+void* progress_thread(void* arg)
+{
+    InstData* d = (InstData*) arg;
+    struct epoll_event ev[2];
     while(1) {
-        fd_set rset = d->rset;
-        int ready = select(d->maxfds+1, &rset, 0, 0, &tv);
-        if (ready >= 0) {
-            for(int i = 0; i <= d->maxfds; i++)
-                if (FD_ISSET(i, &rset)) {
-                    assert(d->fds[i].cb != 0);
-                    (d->fds[i].cb)(d, i);
-                }
+        int ready = epoll_wait(d->tepfd, ev, 2, -1);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            laik_panic("TCP2 error in epoll_wait of progress thread");
+            exit(1); // not actually needed, laik_panic never returns
         }
-        if (ready == 0) break;
+        for(int i = 0; i < ready; i++)
+            if (ev[i].data.fd == d->stopfd) return 0;
+
+        pthread_mutex_lock(&(d->lock));
+        d->in_thread = true;
+        check_loop(d);
+        d->in_thread = false;
+        pthread_mutex_unlock(&(d->lock));
+    }
+}
+
+static
+void start_progress_thread(InstData* d)
+{
+    // debug logging is not thread-safe
+    if (laik_log_shown(1)) {
+        laik_log(1, "TCP2 no progress thread with debug logging");
+        d->use_thread = false;
+        return;
+    }
+
+    d->tepfd = epoll_create1(EPOLL_CLOEXEC);
+    d->stopfd = eventfd(0, EFD_CLOEXEC);
+    if ((d->tepfd < 0) || (d->stopfd < 0)) {
+        laik_panic("TCP2 cannot create epoll instance for progress thread");
+        exit(1); // not actually needed, laik_panic never returns
+    }
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.fd = d->epfd;
+    int res1 = epoll_ctl(d->tepfd, EPOLL_CTL_ADD, d->epfd, &ev);
+    ev.data.fd = d->stopfd;
+    int res2 = epoll_ctl(d->tepfd, EPOLL_CTL_ADD, d->stopfd, &ev);
+    if ((res1 < 0) || (res2 < 0)) {
+        laik_panic("TCP2 cannot add FD to epoll instance of progress thread");
+        exit(1); // not actually needed, laik_panic never returns
+    }
+
+    if (pthread_create(&(d->thread), 0, progress_thread, d) != 0) {
+        laik_panic("TCP2 cannot create progress thread");
+        exit(1); // not actually needed, laik_panic never returns
+    }
+    laik_log(1, "TCP2 progress thread started");
+}
+
+static
+void stop_progress_thread(InstData* d)
+{
+    uint64_t v = 1;
+    if (write(d->stopfd, &v, sizeof(v)) != sizeof(v)) {
+        laik_panic("TCP2 cannot signal progress thread");
+        exit(1); // not actually needed, laik_panic never returns
     }
+    pthread_join(d->thread, 0);
+    close(d->stopfd);
+    close(d->tepfd);
+    d->use_thread = false;
+}
+
+// lock instance data against progress thread, on entry of backend functions
+static
+void lock_inst(InstData* d)
+{
+    if (d->use_thread)
+        pthread_mutex_lock(&(d->lock));
+}
+
+static
+void unlock_inst(InstData* d)
+{
+    if (d->use_thread)
+        pthread_mutex_unlock(&(d->lock));
 }
 
 
@@ -555,6 +856,43 @@ bool check_local(char* host)
 void got_bytes(InstData* d, int fd);
 void send_cmd(InstData* d, int lid, char* cmd);
 
+// set options for socket <fd>: disable nagle's algorithm for faster TCP
+// communication, and set buffer sizes if requested. Must be called before
+// connect/listen for buffer sizes to be used in TCP window scaling
+static
+void set_sockopts(InstData* d, int fd)
+{
+    if (setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &(int){1}, sizeof(int)) < 0) {
+        laik_panic("TCP2 cannot set TCP_NODELAY");
+        exit(1); // not actually needed, laik_panic never returns
+    }
+    if (d->sockbuf <= 0) return;
+
+    // not fatal: sizes may be limited by OS
+    if ((setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &(d->sockbuf), sizeof(int)) < 0) ||
+        (setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &(d->sockbuf), sizeof(int)) < 0))
+        laik_log(1, "TCP2 cannot set socket buffer size to %d: %s",
+                 d->sockbuf, strerror(errno));
+}
+
+// use connected socket <fd> for peer <lid>, and announce mylid
+static
+void add_conn(InstData* d, int lid, int fd)
+{
+    d->peer[lid].fd = fd;
+    add_rfd(d, fd, got_bytes);
+    d->fds[fd]->lid = lid;
+    laik_log(1, "TCP2 connected to LID %d (host %s, port %d)",
+             lid, d->peer[lid].host, d->peer[lid].port);
+
+    if (d->mylid >= 0) {
+        // make myself known to peer: send my location id
+        char msg[20];
+        sprintf(msg, "myid %d", d->mylid);
+        send_cmd(d, lid, msg);
+    }
+}
+
 // make sure we have an open connection to peer <lid>
 // if not, connect to listening port of peer, and announce mylid
 void ensure_conn(InstData* d, int lid)
@@ -591,6 +929,7 @@ void ensure_conn(InstData* d, int lid)
     for(p = info; p; p = p->ai_next) {
         fd = socket(p->ai_family, p->ai_socktype, p->ai_protocol);
         if (fd == -1) continue;
+        set_sockopts(d, fd);
         if (connect(fd, p->ai_addr, p->ai_addrlen) == 0) break;
         close(fd);
     }
@@ -601,24 +940,99 @@ void ensure_conn(InstData* d, int lid)
         return;
     }
 
-    // disable nagle's algorithm for faster TCP communication
-    if (setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &(int){1}, sizeof(int)) < 0) {
-        laik_panic("TCP2 cannot set TCP_NODELAY");
-        exit(1); // not actually needed, laik_panic never returns
+    add_conn(d, lid, fd);
+}
+
+// start non-blocking connect to peer <lid>
+// returns socket, or -1 on failure
+static
+int start_conn(InstData* d, int lid)
+{
+    char port[20];
+    sprintf(port, "%d", d->peer[lid].port);
+
+    struct addrinfo hints, *info, *p;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(d->peer[lid].host, port, &hints, &info) != 0)
+        return -1;
+
+    int fd = -1;
+    for(p = info; p; p = p->ai_next) {
+        fd = socket(p->ai_family, p->ai_socktype | SOCK_NONBLOCK, p->ai_protocol);
+        if (fd == -1) continue;
+        set_sockopts(d, fd);
+        if ((connect(fd, p->ai_addr, p->ai_addrlen) == 0) ||
+            (errno == EINPROGRESS)) break;
+        close(fd);
     }
+    freeaddrinfo(info);
+    return p ? fd : -1;
+}
 
-    d->peer[lid].fd = fd;
-    add_rfd(d, fd, got_bytes);
-    d->fds[fd].lid = lid;
-    laik_log(1, "TCP2 connected to LID %d (host %s, port %d)",
-             lid, d->peer[lid].host, d->peer[lid].port);
+// open connections to peers marked in <want> which are not connected yet.
+// Only peers with lower LID are connected to avoid duplicate connections,
+// the others connect to us. Connects are done in parallel. Failures are not
+// fatal: ensure_conn() tries again on first use
+static
+void connect_peers(InstData* d, bool* want)
+{
+    struct pollfd pfd[MAX_PEERS];
+    int lids[MAX_PEERS];
+    int count = 0;
 
-    if (d->mylid >= 0) {
-        // make myself known to peer: send my location id
-        char msg[20];
-        sprintf(msg, "myid %d", d->mylid);
-        send_cmd(d, lid, msg);
+    for(int lid = 0; lid < d->mylid; lid++) {
+        Peer* p = &(d->peer[lid]);
+        if (!want[lid] || (p->fd >= 0) || (p->port < 0)) continue;
+        if ((p->state != PS_Ready) && (p->state != PS_ReadyRemove)) continue;
+        int fd = start_conn(d, lid);
+        if (fd < 0) continue;
+        pfd[count].fd = fd;
+        pfd[count].events = POLLOUT;
+        lids[count] = lid;
+        count++;
     }
+    if (count == 0) return;
+    laik_log(1, "TCP2 connecting to %d peers", count);
+
+    int open = count;
+    while(open > 0) {
+        if (poll(pfd, count, -1) < 0) {
+            if (errno == EINTR) continue;
+            laik_panic("TCP2 error in poll");
+            exit(1); // not actually needed, laik_panic never returns
+        }
+        for(int i = 0; i < count; i++) {
+            int fd = pfd[i].fd;
+            if ((fd < 0) || (pfd[i].revents == 0)) continue;
+            pfd[i].fd = -1; // done, ignored by poll
+            open--;
+
+            int err = 0;
+            socklen_t len = sizeof(err);
+            getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len);
+            if (err != 0) {
+                laik_log(1, "TCP2 cannot connect to LID %d: %s",
+                         lids[i], strerror(err));
+                close(fd);
+                continue;
+            }
+            // back to blocking writes
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+            add_conn(d, lids[i], fd);
+        }
+    }
+}
+
+// connect to all peers
+static
+void connect_all(InstData* d)
+{
+    bool want[MAX_PEERS];
+    for(int lid = 0; lid < MAX_PEERS; lid++)
+        want[lid] = true;
+    connect_peers(d, want);
 }
 
 // send command <cmd> to peer <lid>
@@ -665,6 +1079,31 @@ void send_cmd(InstData* d, int lid, char* cmd)
     }
 }
 
+// return credit of <bytes> for consumed eager data to peer <lid>
+// the peer does not wait for credit after its last send and may already
+// have closed the connection: write errors are not fatal here
+void send_credit(InstData* d, int lid, uint64_t bytes)
+{
+    Peer* p = &(d->peer[lid]);
+    if ((p->fd < 0) || (p->state == PS_Error)) return;
+
+    char msg[50];
+    int len = sprintf(msg, "flowcredit %llu\n", (unsigned long long) bytes);
+    laik_log(1, "TCP2 Sent cmd '%s' (len %d) to LID %d (FD %d)\n",
+             msg, len, lid, p->fd);
+
+    int res, written = 0;
+    while(written < len) {
+        res = write(p->fd, msg + written, len - written);
+        if (res < 0) {
+            laik_log(1, "TCP2 cannot return credit to LID %d: %s\n",
+                     lid, strerror(errno));
+            return;
+        }
+        written += res;
+    }
+}
+
 void send_bin(InstData* d, int lid, char* buf, int len)
 {
     ensure_conn(d, lid);
@@ -692,6 +1131,44 @@ void send_bin(InstData* d, int lid, char* buf, int len)
     }
 }
 
+// send <cnt> buffers given by <iov> to process <lid> using writev
+// the iovec entries get modified to cope with partial writes
+void send_binv(InstData* d, int lid, struct iovec* iov, int cnt)
+{
+    ensure_conn(d, lid);
+    if (d->peer[lid].state == PS_Error) {
+        laik_log(1, "TCP2 Send binv (%d bufs) to LID %d: Cannot send, broken connection\n",
+                 cnt, lid);
+        return;
+    }
+
+    int fd = d->peer[lid].fd;
+    laik_log(1, "TCP2 Sent binv (%d bufs) to LID %d (FD %d)\n",
+             cnt, lid, fd);
+
+    // cope with partial writes and errors
+    ssize_t res = 0;
+    while(cnt > 0) {
+        res = writev(fd, iov, cnt);
+        if (res < 0) break;
+        // skip completely written buffers, adjust partially written one
+        while((cnt > 0) && ((size_t) res >= iov->iov_len)) {
+            res -= iov->iov_len;
+            iov++;
+            cnt--;
+        }
+        if (cnt > 0) {
+            iov->iov_base = (char*) iov->iov_base + res;
+            iov->iov_len -= res;
+        }
+    }
+    if (res < 0) {
+        int e = errno;
+        laik_log(LAIK_LL_Panic, "TCP2 write error on FD %d: %s\n",
+                 fd, strerror(e));
+    }
+}
+
 int got_binary_data(InstData* d, int lid, char* buf, int len)
 {
     laik_log(1, "TCP2 got binary data (from LID %d, len %d)", lid, len);
@@ -706,29 +1183,74 @@ int got_binary_data(InstData* d, int lid, char* buf, int len)
     Laik_Mapping* m = p->rmap;
     assert(m != 0);
     Laik_Layout* ll = m->layout;
+    Laik_Range* r = p->rcv_range;
     bool inTraversal = true;
     int consumed = 0;
+
+    // staged eager data may contain data for further receives: do not
+    // consume more than expected
+    bool direct = p->rcv_ptr && (p->rro == LAIK_RO_None);
+    uint64_t left = (uint64_t) p->rcount * esize;
+    left -= direct ? p->rbytes : (uint64_t) p->roff * esize;
+    if ((uint64_t) len > left) len = (int) left;
+
+    if (direct) {
+        // contiguous receive range without reduction: copy all bytes, even
+        // partial elements, to allow direct receive into the mapping
+        consumed = len;
+        memcpy(p->rcv_ptr + p->rbytes, buf, consumed);
+        p->rbytes += consumed;
+        p->roff = (int) (p->rbytes / esize);
+        len = 0; // skip row-wise traversal below
+    }
+    else if (p->rcv_ptr) {
+        // contiguous receive range with reduction: reduce all complete
+        // elements with one call, even across rows
+        int n = len / esize;
+        if (n > 0) {
+            Laik_Type* t = m->data->type;
+            assert(t->reduce);
+            char* ptr = p->rcv_ptr + (uint64_t) p->roff * esize;
+            (t->reduce)(ptr, ptr, buf, n, p->rro);
+            consumed = n * esize;
+            p->roff += n;
+            laik_log(1, " reduced %d elems at offset %d", n, p->roff - n);
+        }
+        len = 0; // skip row-wise traversal below
+    }
+
+    // row-wise traversal: copy/reduce complete elements up to end of row,
+    // in one go if the row is contiguous in the layout
     while(len - consumed >= esize) {
         assert(inTraversal);
         int64_t off = ll->offset(ll, m->layoutSection, &(p->rcv_idx));
-        char* idxPtr = m->start + off * p->relemsize;
+        char* idxPtr = m->start + off * esize;
+        Laik_Index last = p->rcv_idx;
+        last.i[0] = r->to.i[0] - 1;
+        int64_t n = last.i[0] - p->rcv_idx.i[0] + 1;
+        if (ll->offset(ll, m->layoutSection, &last) - off + 1 != n)
+            n = 1; // row not contiguous in layout
+        if (n > (len - consumed) / esize) n = (len - consumed) / esize;
+
         if (p->rro == LAIK_RO_None)
-            memcpy(idxPtr, buf, esize);
+            memcpy(idxPtr, buf, n * esize);
         else {
-            Laik_Type* t = p->rmap->data->type;
+            Laik_Type* t = m->data->type;
             assert(t->reduce);
-            (t->reduce)(idxPtr, idxPtr, buf, 1, p->rro);
+            (t->reduce)(idxPtr, idxPtr, buf, n, p->rro);
         }
         if ((esize == 8) && laik_log_begin(1)) {
             char pstr[70];
-            int dims = p->rcv_range->space->dims;
+            int dims = r->space->dims;
             sprintf(pstr, "(%d:%s)", p->roff, istr(dims, &(p->rcv_idx)));
-            laik_log(1, " pos %s: in %f res %f\n", pstr, *((double*)buf), *((double*)idxPtr));
+            laik_log(1, " pos %s: %d elems, in %f res %f\n",
+                     pstr, (int) n, *((double*)buf), *((double*)idxPtr));
         }
-        buf += p->relemsize;
-        consumed += p->relemsize;
-        p->roff++;
-        inTraversal = next_lex(p->rcv_range, &(p->rcv_idx));
+        buf += n * esize;
+        consumed += n * esize;
+        p->roff += n;
+        p->rcv_idx.i[0] += n - 1;
+        inTraversal = next_lex(r, &(p->rcv_idx));
     }
     assert(p->roff <= p->rcount);
 
@@ -740,69 +1262,579 @@ int got_binary_data(InstData* d, int lid, char* buf, int len)
     return consumed;
 }
 
-// "data" command received
-// return false if command cannot be processed yet, no matching receive
-void got_data(InstData* d, int lid, char* msg)
+// consume staged eager data from <lid> for the posted receive
+static
+void drain_staged(InstData* d, int lid)
 {
-    // data <len> <hexbyte> ...
-    char cmd[21];
-    int len, i;
-    if (sscanf(msg, "%20s %d %n", cmd, &len, &i) < 2) {
-        laik_log(LAIK_LL_Warning, "cannot parse data command '%s'; ignoring", msg);
-        return;
+    Peer* p = &(d->peer[lid]);
+    if (p->ebuf_used == 0) return;
+
+    int consumed = 0;
+    while((p->roff < p->rcount) && ((uint64_t) consumed < p->ebuf_used)) {
+        uint64_t len = p->ebuf_used - consumed;
+        if (len > 0x40000000) len = 0x40000000; // got_binary_data takes int
+        int n = got_binary_data(d, lid, p->ebuf + consumed, (int) len);
+        if (n == 0) break; // only partial element available
+        consumed += n;
     }
+    p->ebuf_used -= consumed;
+    if (p->ebuf_used > 0)
+        memmove(p->ebuf, p->ebuf + consumed, p->ebuf_used);
+    laik_log(1, "TCP2 consumed %d staged bytes from LID %d, %llu left",
+             consumed, lid, (unsigned long long) p->ebuf_used);
+}
 
+// append <len> bytes of data from <lid> to staging buffer of peer
+static
+void stage_data(InstData* d, int lid, char* buf, int len)
+{
     Peer* p = &(d->peer[lid]);
-    if ((p->rcount == 0) || (p->rcount == p->roff)) {
-        laik_log(LAIK_LL_Warning, "TCP2 ignoring data from LID %d without send permission", lid);
-        return;
+    if (p->ebuf_used + len > p->ebuf_size) {
+        uint64_t size = p->ebuf_size ? 2 * p->ebuf_size : d->credit;
+        while(size < p->ebuf_used + len) size *= 2;
+        p->ebuf = realloc(p->ebuf, size);
+        if (!p->ebuf) {
+            laik_panic("TCP2 Out of memory allocating staging buffer");
+            exit(1); // not actually needed, laik_panic never returns
+        }
+        p->ebuf_size = size;
     }
+    memcpy(p->ebuf + p->ebuf_used, buf, len);
+    p->ebuf_used += len;
+    laik_log(1, "TCP2 staged %d bytes eager data from LID %d (%llu staged)",
+             len, lid, (unsigned long long) p->ebuf_used);
+}
 
-    // assume only one element per data command
-    assert(p->relemsize == len);
-    Laik_Mapping* m = p->rmap;
-    assert(m != 0);
-    Laik_Layout* ll = m->layout;
-    int64_t off = ll->offset(ll, m->layoutSection, &(p->rcv_idx));
-    char* idxPtr = m->start + off * p->relemsize;
+// eager binary data received from <lid>: deliver into posted receive if
+// nothing staged before, otherwise append to staging buffer of peer
+// return consumed bytes
+int got_eager_data(InstData* d, int lid, char* buf, int len)
+{
+    Peer* p = &(d->peer[lid]);
+    bool posted = (p->rcount > 0) && (p->roff < p->rcount);
+    if (posted && (p->ebuf_used == 0))
+        return got_binary_data(d, lid, buf, len);
+
+    stage_data(d, lid, buf, len);
+    if (posted)
+        drain_staged(d, lid);
+    return len;
+}
 
-    // position string for check
-    char pstr[70];
-    int dims = p->rcv_range->space->dims;
-    int s = sprintf(pstr, "(%d:%s)", p->roff, istr(dims, &(p->rcv_idx)));
+// shared memory transport
 
-    if (msg[i] == '(') {
-        assert(strncmp(msg+i, pstr, s) == 0);
-        i += s;
-        while(msg[i] && (msg[i] == ' ')) i++;
-    }
+static
+void futex_wait(uint32_t* addr, uint32_t val, int ms)
+{
+    struct timespec ts = { 0, ms * 1000000L };
+    syscall(SYS_futex, addr, FUTEX_WAIT, val, &ts, 0, 0);
+}
 
-    char data_in[100];
-    assert(len < 100);
-    int l = 0;
+static
+void futex_wake(uint32_t* addr)
+{
+    syscall(SYS_futex, addr, FUTEX_WAKE, 1, 0, 0, 0);
+}
 
-    // parse hex bytes
-    unsigned char c;
-    int v = 0;
-    while(1) {
-        c = msg[i++];
-        if ((c == ' ') || (c == 0)) {
-            assert(l < len);
-            data_in[l++] = v;
-            v = 0;
-            if ((c == 0) || (l == len)) break;
-            continue;
-        }
-        assert((c >= '0') && (c <= 'f'));
-        assert((c <= '9') || (c >= 'a'));
-        v = 16 * v + ((c > '9') ? c - 'a' + 10 : c - '0');
+// check if binary data to peer <lid> can go via shared memory. If so, create
+// a ring and ask the peer to map it. It is used after the peer acknowledged
+static
+void start_shm(InstData* d, int lid)
+{
+    Peer* p = &(d->peer[lid]);
+    p->shm_state = SHM_None;
+    if ((d->shm_size == 0) || !p->accepts_shm) return;
+    if ((p->host == 0) || !check_local(p->host)) return;
+
+    char name[50];
+    sprintf(name, "/laik-tcp2-%d-%d", getpid(), lid);
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        laik_log(1, "TCP2 cannot create shared memory '%s': %s",
+                 name, strerror(errno));
+        return;
+    }
+    size_t len = sizeof(ShmRing) + d->shm_size;
+    void* ptr = MAP_FAILED;
+    if (ftruncate(fd, len) == 0)
+        ptr = mmap(0, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED) {
+        laik_log(1, "TCP2 cannot map shared memory '%s': %s",
+                 name, strerror(errno));
+        shm_unlink(name);
+        return;
     }
-    assert(l == len);
 
-    assert(l == p->relemsize);
-    if (p->rro == LAIK_RO_None)
-        memcpy(idxPtr, data_in, len);
-    else {
+    // new shared memory is zero-filled
+    p->sring = (ShmRing*) ptr;
+    p->sring->size = d->shm_size;
+    p->shead = 0;
+    p->sname = strdup(name);
+    p->shm_state = SHM_Pending;
+    laik_log(1, "TCP2 created shared memory ring '%s' for LID %d (%llu bytes)",
+             name, lid, (unsigned long long) d->shm_size);
+
+    char msg[80];
+    sprintf(msg, "useshm open %s\n", name);
+    send_cmd(d, lid, msg);
+}
+
+// map shared memory ring <name> created by peer <lid> for receiving
+static
+bool map_shm(InstData* d, int lid, char* name)
+{
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0) {
+        laik_log(1, "TCP2 cannot open shared memory '%s': %s",
+                 name, strerror(errno));
+        return false;
+    }
+    struct stat st;
+    void* ptr = MAP_FAILED;
+    if ((fstat(fd, &st) == 0) && ((size_t) st.st_size > sizeof(ShmRing)))
+        ptr = mmap(0, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED) {
+        laik_log(1, "TCP2 cannot map shared memory '%s'", name);
+        return false;
+    }
+    ShmRing* r = (ShmRing*) ptr;
+    if (sizeof(ShmRing) + r->size != (size_t) st.st_size) {
+        laik_log(1, "TCP2 shared memory '%s' has wrong size", name);
+        munmap(ptr, st.st_size);
+        return false;
+    }
+
+    d->peer[lid].rring = r;
+    d->peer[lid].rtail = 0;
+    laik_log(1, "TCP2 mapped shared memory ring '%s' from LID %d", name, lid);
+    return true;
+}
+
+// "useshm" command received
+void got_useshm(InstData* d, int lid, char* msg)
+{
+    // useshm open <name> / useshm ok / useshm fail
+    char cmd[21], sub[21], name[51];
+    int res = sscanf(msg, "%20s %20s %50s", cmd, sub, name);
+    if (res < 2) {
+        laik_log(LAIK_LL_Warning, "cannot parse useshm command '%s'; ignoring", msg);
+        return;
+    }
+
+    Peer* p = &(d->peer[lid]);
+    if (strcmp(sub, "open") == 0) {
+        if (res < 3) {
+            laik_log(LAIK_LL_Warning, "cannot parse useshm command '%s'; ignoring", msg);
+            return;
+        }
+        bool ok = (d->shm_size > 0) && (p->rring == 0) && map_shm(d, lid, name);
+        send_cmd(d, lid, ok ? "useshm ok\n" : "useshm fail\n");
+        return;
+    }
+
+    if (p->shm_state != SHM_Pending) {
+        laik_log(LAIK_LL_Warning, "TCP2 unexpected '%s' from LID %d; ignoring", msg, lid);
+        return;
+    }
+    // peer has mapped the ring (or failed to): name not needed any more
+    shm_unlink(p->sname);
+    free(p->sname);
+    p->sname = 0;
+    d->exit = 1;
+
+    if (strcmp(sub, "ok") == 0) {
+        laik_log(1, "TCP2 sending binary data to LID %d via shared memory", lid);
+        p->shm_state = SHM_Active;
+        return;
+    }
+    laik_log(1, "TCP2 LID %d cannot use shared memory, staying with TCP", lid);
+    munmap(p->sring, sizeof(ShmRing) + p->sring->size);
+    p->sring = 0;
+    p->shm_state = SHM_None;
+}
+
+// announce <len> bytes written into shared memory ring to <lid>
+static
+void announce_shm(InstData* d, int lid, uint64_t len)
+{
+    if (len == 0) return;
+
+    char hdr[9];
+    hdr[0] = 'S';
+    for(int i = 1; i < 9; i++)
+        hdr[i] = (len >> (8 * (i - 1))) & 255;
+    // make ring data visible before announcement
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    send_bin(d, lid, hdr, 9);
+}
+
+// wait for receiver to consume data from full ring <r>. Incoming commands
+// are handled meanwhile, and the futex wait is bounded to not miss them
+static
+void wait_shm(InstData* d, ShmRing* r, uint64_t head)
+{
+    uint32_t seq = __atomic_load_n(&(r->seq), __ATOMIC_SEQ_CST);
+    __atomic_store_n(&(r->waiting), 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&(r->tail), __ATOMIC_SEQ_CST) + r->size == head) {
+        check_loop(d);
+        futex_wait(&(r->seq), seq, 1);
+    }
+    __atomic_store_n(&(r->waiting), 0, __ATOMIC_SEQ_CST);
+}
+
+// write <cnt> buffers given by <iov> into shared memory ring to process <lid>
+// and announce them. If the ring is full, announce what was written so far
+// and wait for free space
+static
+void send_shmv(InstData* d, int lid, struct iovec* iov, int cnt)
+{
+    Peer* p = &(d->peer[lid]);
+    ShmRing* r = p->sring;
+    uint64_t written = 0; // not yet announced
+
+    for(int i = 0; i < cnt; i++) {
+        char* buf = (char*) iov[i].iov_base;
+        uint64_t len = iov[i].iov_len;
+        while(len > 0) {
+            uint64_t tail = __atomic_load_n(&(r->tail), __ATOMIC_ACQUIRE);
+            uint64_t avail = r->size - (p->shead - tail);
+            if (avail == 0) {
+                announce_shm(d, lid, written);
+                written = 0;
+                wait_shm(d, r, p->shead);
+                continue;
+            }
+            uint64_t pos = p->shead % r->size;
+            uint64_t n = r->size - pos;
+            if (n > avail) n = avail;
+            if (n > len) n = len;
+            memcpy(r->data + pos, buf, n);
+            p->shead += n;
+            written += n;
+            buf += n;
+            len -= n;
+        }
+    }
+    laik_log(1, "TCP2 wrote %d bufs into shared memory ring to LID %d", cnt, lid);
+    announce_shm(d, lid, written);
+}
+
+// 'S' frame received: <len> bytes of binary data from <lid> are in ring.
+// All bytes are consumed (with staging if needed) to free the ring space
+static
+void got_shm_data(InstData* d, int lid, uint64_t len)
+{
+    Peer* p = (lid >= 0) ? &(d->peer[lid]) : 0;
+    ShmRing* r = p ? p->rring : 0;
+    if (r == 0) {
+        laik_log(LAIK_LL_Warning, "TCP2 ignoring shared memory data from LID %d without ring", lid);
+        return;
+    }
+    laik_log(1, "TCP2 got %llu bytes via shared memory from LID %d",
+             (unsigned long long) len, lid);
+
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    while(len > 0) {
+        uint64_t pos = p->rtail % r->size;
+        uint64_t n = r->size - pos;
+        if (n > len) n = len;
+        int consumed = got_eager_data(d, lid, r->data + pos, (int) n);
+        if ((uint64_t) consumed < n)
+            stage_data(d, lid, r->data + pos + consumed, (int) n - consumed);
+        p->rtail += n;
+        len -= n;
+    }
+
+    __atomic_store_n(&(r->tail), p->rtail, __ATOMIC_SEQ_CST);
+    __atomic_add_fetch(&(r->seq), 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&(r->waiting), __ATOMIC_SEQ_CST))
+        futex_wake(&(r->seq));
+}
+
+
+// compression of binary data frames
+//
+// LZ-style codec: sequences of a token byte (upper 4 bits: literal count,
+// lower 4 bits: match length - LZ_MIN_MATCH, value 15 followed by extension
+// bytes added until a byte != 255), literals, 2-byte match offset, with the
+// last sequence only consisting of literals. Matches are found via a hash
+// table of recent positions of 4-byte sequences, which is fast and works well
+// for runs of zeros and repeated patterns (e.g. sparse data)
+
+#define LZ_HASH_BITS 12
+#define LZ_MIN_MATCH 4
+#define LZ_MAX_OFFSET 65535
+// frames larger than this are sent uncompressed
+#define ZIP_MAX 0x40000000
+
+static
+uint32_t lz_hash(const unsigned char* p)
+{
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+// write extension bytes of length <len> (without the 15 in token)
+static
+unsigned char* lz_putlen(unsigned char* op, uint64_t len)
+{
+    while(len >= 255) {
+        *op++ = 255;
+        len -= 255;
+    }
+    *op++ = (unsigned char) len;
+    return op;
+}
+
+// compress <len> bytes at <in> into <out>, using at most <max> bytes.
+// Returns compressed size, or 0 if output does not fit
+static
+uint64_t lz_compress(const char* in, uint64_t len, char* out, uint64_t max)
+{
+    uint32_t table[1 << LZ_HASH_BITS];
+    memset(table, 0, sizeof(table));
+
+    const unsigned char* ibase = (const unsigned char*) in;
+    const unsigned char* ip = ibase;
+    const unsigned char* anchor = ibase;
+    const unsigned char* iend = ibase + len;
+    unsigned char* op = (unsigned char*) out;
+    unsigned char* oend = op + max;
+    uint64_t lit;
+
+    while(iend - ip >= LZ_MIN_MATCH) {
+        uint32_t h = lz_hash(ip);
+        const unsigned char* ref = ibase + table[h];
+        table[h] = (uint32_t) (ip - ibase);
+        if ((ref >= ip) || (ip - ref > LZ_MAX_OFFSET) ||
+            (memcmp(ref, ip, LZ_MIN_MATCH) != 0)) {
+            ip++;
+            continue;
+        }
+
+        // extend match
+        const unsigned char* mp = ip + LZ_MIN_MATCH;
+        const unsigned char* rp = ref + LZ_MIN_MATCH;
+        while((mp < iend) && (*mp == *rp)) {
+            mp++;
+            rp++;
+        }
+        lit = (uint64_t) (ip - anchor);
+        uint64_t mlen = (uint64_t) (mp - ip) - LZ_MIN_MATCH;
+        if ((uint64_t) (oend - op) < lit + lit / 255 + mlen / 255 + 5)
+            return 0;
+
+        unsigned char* token = op++;
+        *token = (unsigned char) (((lit >= 15) ? 15 : lit) << 4);
+        if (lit >= 15) op = lz_putlen(op, lit - 15);
+        memcpy(op, anchor, lit);
+        op += lit;
+        uint64_t off = (uint64_t) (ip - ref);
+        *op++ = (unsigned char) (off & 255);
+        *op++ = (unsigned char) (off >> 8);
+        *token |= (unsigned char) ((mlen >= 15) ? 15 : mlen);
+        if (mlen >= 15) op = lz_putlen(op, mlen - 15);
+
+        ip = mp;
+        anchor = ip;
+    }
+
+    // last literals
+    lit = (uint64_t) (iend - anchor);
+    if ((uint64_t) (oend - op) < lit + lit / 255 + 2)
+        return 0;
+    *op++ = (unsigned char) (((lit >= 15) ? 15 : lit) << 4);
+    if (lit >= 15) op = lz_putlen(op, lit - 15);
+    memcpy(op, anchor, lit);
+    op += lit;
+
+    return (uint64_t) (op - (unsigned char*) out);
+}
+
+// decompress <len> bytes at <in> into <out> with space for <max> bytes
+// Returns decompressed size, or -1 on corrupt input
+static
+int64_t lz_decompress(const char* in, uint64_t len, char* out, uint64_t max)
+{
+    const unsigned char* ip = (const unsigned char*) in;
+    const unsigned char* iend = ip + len;
+    unsigned char* op = (unsigned char*) out;
+    unsigned char* oend = op + max;
+    unsigned char b;
+
+    while(ip < iend) {
+        unsigned int token = *ip++;
+        uint64_t lit = token >> 4;
+        if (lit == 15) {
+            do {
+                if (ip == iend) return -1;
+                b = *ip++;
+                lit += b;
+            } while(b == 255);
+        }
+        if ((lit > (uint64_t) (iend - ip)) || (lit > (uint64_t) (oend - op)))
+            return -1;
+        memcpy(op, ip, lit);
+        op += lit;
+        ip += lit;
+        if (ip == iend) break; // last sequence: only literals
+
+        if (iend - ip < 2) return -1;
+        uint64_t off = ip[0] | ((uint64_t) ip[1] << 8);
+        ip += 2;
+        uint64_t mlen = token & 15;
+        if (mlen == 15) {
+            do {
+                if (ip == iend) return -1;
+                b = *ip++;
+                mlen += b;
+            } while(b == 255);
+        }
+        mlen += LZ_MIN_MATCH;
+        if ((off == 0) || (off > (uint64_t) (op - (unsigned char*) out)) ||
+            (mlen > (uint64_t) (oend - op)))
+            return -1;
+
+        // match may overlap with output: copy byte-wise
+        const unsigned char* mp = op - off;
+        for(uint64_t i = 0; i < mlen; i++)
+            *op++ = *mp++;
+    }
+    return (int64_t) (op - (unsigned char*) out);
+}
+
+// 'Z' frame header received: compressed data of <len> bytes from <lid> follows
+static
+void got_zip_frame(InstData* d, int lid, uint64_t len)
+{
+    if (lid < 0) return; // data will be ignored
+    Peer* p = &(d->peer[lid]);
+    assert(p->zbuf == 0);
+    p->zbuf = malloc(len);
+    if (!p->zbuf) {
+        laik_panic("TCP2 Out of memory allocating receive buffer for compressed data");
+        exit(1); // not actually needed, laik_panic never returns
+    }
+    p->zbuf_len = len;
+    p->zbuf_got = 0;
+}
+
+// compressed frame from <lid> completely received: decompress and handle
+// resulting binary data like eager data
+static
+void unzip_frame(InstData* d, int lid)
+{
+    Peer* p = &(d->peer[lid]);
+    assert(p->zbuf_len >= 8);
+    uint64_t len = 0;
+    for(int i = 7; i >= 0; i--)
+        len = (len << 8) | ((unsigned char*)p->zbuf)[i];
+
+    char* buf = malloc(len);
+    if (!buf) {
+        laik_panic("TCP2 Out of memory allocating buffer for decompression");
+        exit(1); // not actually needed, laik_panic never returns
+    }
+    int64_t res = lz_decompress(p->zbuf + 8, p->zbuf_len - 8, buf, len);
+    if (res != (int64_t) len) {
+        laik_log(LAIK_LL_Panic, "TCP2 corrupt compressed data from LID %d", lid);
+        exit(1);
+    }
+    laik_log(1, "TCP2 got %llu bytes compressed to %llu from LID %d",
+             (unsigned long long) len, (unsigned long long) p->zbuf_len - 8, lid);
+    free(p->zbuf);
+    p->zbuf = 0;
+
+    // uncompressed size is limited by ZIP_MAX, fitting into int
+    int consumed = got_eager_data(d, lid, buf, (int) len);
+    if ((uint64_t) consumed < len)
+        stage_data(d, lid, buf + consumed, (int) len - consumed);
+    free(buf);
+}
+
+// bytes of compressed frame received from <lid>, return consumed bytes
+static
+int got_zip_bytes(InstData* d, int lid, char* buf, int len)
+{
+    if (lid < 0) {
+        laik_log(LAIK_LL_Warning, "TCP2 ignoring compressed data from unknown peer");
+        return len;
+    }
+    Peer* p = &(d->peer[lid]);
+    assert(p->zbuf_got + len <= p->zbuf_len);
+    memcpy(p->zbuf + p->zbuf_got, buf, len);
+    p->zbuf_got += len;
+    if (p->zbuf_got == p->zbuf_len)
+        unzip_frame(d, lid);
+    return len;
+}
+
+// "data" command received
+// return false if command cannot be processed yet, no matching receive
+void got_data(InstData* d, int lid, char* msg)
+{
+    // data <len> <hexbyte> ...
+    char cmd[21];
+    int len, i;
+    if (sscanf(msg, "%20s %d %n", cmd, &len, &i) < 2) {
+        laik_log(LAIK_LL_Warning, "cannot parse data command '%s'; ignoring", msg);
+        return;
+    }
+
+    Peer* p = &(d->peer[lid]);
+    if ((p->rcount == 0) || (p->rcount == p->roff)) {
+        laik_log(LAIK_LL_Warning, "TCP2 ignoring data from LID %d without send permission", lid);
+        return;
+    }
+
+    // assume only one element per data command
+    assert(p->relemsize == len);
+    Laik_Mapping* m = p->rmap;
+    assert(m != 0);
+    Laik_Layout* ll = m->layout;
+    int64_t off = ll->offset(ll, m->layoutSection, &(p->rcv_idx));
+    char* idxPtr = m->start + off * p->relemsize;
+
+    // position string for check
+    char pstr[70];
+    int dims = p->rcv_range->space->dims;
+    int s = sprintf(pstr, "(%d:%s)", p->roff, istr(dims, &(p->rcv_idx)));
+
+    if (msg[i] == '(') {
+        assert(strncmp(msg+i, pstr, s) == 0);
+        i += s;
+        while(msg[i] && (msg[i] == ' ')) i++;
+    }
+
+    char data_in[100];
+    assert(len < 100);
+    int l = 0;
+
+    // parse hex bytes
+    unsigned char c;
+    int v = 0;
+    while(1) {
+        c = msg[i++];
+        if ((c == ' ') || (c == 0)) {
+            assert(l < len);
+            data_in[l++] = v;
+            v = 0;
+            if ((c == 0) || (l == len)) break;
+            continue;
+        }
+        assert((c >= '0') && (c <= 'f'));
+        assert((c <= '9') || (c >= 'a'));
+        v = 16 * v + ((c > '9') ? c - 'a' + 10 : c - '0');
+    }
+    assert(l == len);
+
+    assert(l == p->relemsize);
+    if (p->rro == LAIK_RO_None)
+        memcpy(idxPtr, data_in, len);
+    else {
         Laik_Type* t = p->rmap->data->type;
         assert(t->reduce);
         (t->reduce)(idxPtr, idxPtr, data_in, 1, p->rro);
@@ -843,10 +1875,10 @@ void got_register(InstData* d, int fd, int lid, char* msg)
     if ((d->mystate != PS_InStartup) &&
         (d->mystate != PS_InResize1)) {
         // after startup: process later in resize()
-        assert(d->fds[fd].cmd == 0);
+        assert(d->fds[fd]->cmd == 0);
 
-        d->fds[fd].state = PS_RegReceived;
-        d->fds[fd].cmd = strdup(msg);
+        d->fds[fd]->state = PS_RegReceived;
+        d->fds[fd]->cmd = strdup(msg);
         laik_log(1, "TCP2 queued for later processing: '%s'", msg);
         return;
     }
@@ -874,15 +1906,20 @@ void got_register(InstData* d, int fd, int lid, char* msg)
     }
 
     bool accepts_bin_data = false;
+    bool accepts_shm = false;
+    bool accepts_zip = false;
     if (res == 5) {
         // parse optional flags
-        for(int i = 0; (i < 5) && flags[i]; i++)
+        for(int i = 0; (i < 5) && flags[i]; i++) {
             if (flags[i] == 'b') accepts_bin_data = true;
+            if (flags[i] == 's') accepts_shm = true;
+            if (flags[i] == 'z') accepts_zip = true;
+        }
     }
 
     lid = ++d->maxid;
     assert(fd >= 0);
-    d->fds[fd].lid = lid;
+    d->fds[fd]->lid = lid;
     assert(lid < MAX_PEERS);
 
     char loc[70];
@@ -898,13 +1935,16 @@ void got_register(InstData* d, int fd, int lid, char* msg)
     d->peer[lid].location = strdup(loc);
     d->peer[lid].port = p;
     d->peer[lid].accepts_bin_data = accepts_bin_data;
+    d->peer[lid].accepts_shm = accepts_shm;
+    d->peer[lid].accepts_zip = accepts_zip;
     // first time we use this id for a peer: init receive
     d->peer[lid].rcount = 0;
     d->peer[lid].scount = 0;
+    d->peer[lid].scredit = d->credit;
 
     // send response to registering process: notify about assigned LID
     char str[150];
-    sprintf(str, "id %d %s %s %d %s", lid, loc, h, p, accepts_bin_data ? "b":"-");
+    sprintf(str, "id %d %s %s %d %s", lid, loc, h, p, peer_flags(&(d->peer[lid])));
     send_cmd(d, lid, str);
 
     d->peers++;
@@ -943,9 +1983,16 @@ void got_myid(InstData* d, int fd, int lid, char* msg)
     lid = peerid;
     assert((lid >= 0) && (lid < MAX_PEERS));
     assert(lid <= d->maxid);
-    d->peer[lid].fd = fd;
     assert(fd >= 0);
-    d->fds[fd].lid = lid;
+    d->fds[fd]->lid = lid;
+    if (d->peer[lid].fd >= 0) {
+        // both sides connected at the same time: we keep sending via our
+        // own connection, the new one is only used by the peer
+        laik_log(1, "TCP2 LID %d also connected via FD %d (we send via FD %d)",
+                 lid, fd, d->peer[lid].fd);
+        return;
+    }
+    d->peer[lid].fd = fd;
 
     // must already be known, announced by master
     assert(d->peer[lid].location != 0);
@@ -962,12 +2009,13 @@ void got_cutoff(InstData* d, int fd, char* msg)
 {
     // cutoff <location pattern>
 
-    if (instance == 0) {
-        // no instance yet to queue remove requests, need to replay
-        assert(d->fds[fd].cmd == 0);
+    if ((instance == 0) || d->in_thread) {
+        // no instance yet to queue remove requests, or in progress thread
+        // which must not call into LAIK: need to replay
+        assert(d->fds[fd]->cmd == 0);
 
-        d->fds[fd].state = PS_CutoffReceived;
-        d->fds[fd].cmd = strdup(msg);
+        d->fds[fd]->state = PS_CutoffReceived;
+        d->fds[fd]->cmd = strdup(msg);
         laik_log(1, "TCP2 queued for later processing: '%s'", msg);
         return;
     }
@@ -1037,11 +2085,13 @@ void got_help(InstData* d, int fd, int lid)
     send_cmd(d, lid, "#  allowsend <count> <esize>    : give send right");
     send_cmd(d, lid, "#  data <len> [pos] <hex> ...   : data from a LAIK container");
     send_cmd(d, lid, "#  enterresize <phase> <epoch>  : enter resize phase at compute phase/epoch");
+    send_cmd(d, lid, "#  flowcredit <bytes>           : return credit for eager data");
     send_cmd(d, lid, "#  getready                     : request to finish registration");
     send_cmd(d, lid, "#  id <id> <loc> <host> <port> <flags> : announce location id info");
     send_cmd(d, lid, "#  kvs allow <name>             : allow to send changes for KVS");
     send_cmd(d, lid, "#  kvs changes <count>          : announce number of changes for KVS");
     send_cmd(d, lid, "#  kvs data <key> <value>       : send changed KVS entry");
+    send_cmd(d, lid, "#  (binary KVS changes are sent as frame 'K' + 8 bytes length)");
     send_cmd(d, lid, "#  myid <id>                    : identify your location id");
     send_cmd(d, lid, "#  ok                           : positive response to a request");
     send_cmd(d, lid, "#  phase <phase> <epoch>        : announce current phase/epoch");
@@ -1083,9 +2133,9 @@ void got_status(InstData* d, int fd, int lid)
 
     send_cmd(d, lid, "# Known peers:");
     for(int i = 0; i <= d->maxid; i++) {
-        sprintf(msg, "#  LID%2d loc '%s' at host '%s' port %d flags %c", i,
+        sprintf(msg, "#  LID%2d loc '%s' at host '%s' port %d flags %s", i,
                     d->peer[i].location, d->peer[i].host, d->peer[i].port,
-                    d->peer[i].accepts_bin_data ? 'b':'-');
+                    peer_flags(&(d->peer[i])));
         send_cmd(d, lid, msg);
         if (d->peer[i].fd >= 0) {
             sprintf(msg, "#        open connection at FD %d", d->peer[i].fd);
@@ -1096,19 +2146,19 @@ void got_status(InstData* d, int fd, int lid)
         send_cmd(d, lid, msg);
     }
     bool header_sent = false;
-    for(int i = 0; i < MAX_FDS; i++) {
-        if (d->fds[i].state == PS_Invalid) continue;
-        if (d->fds[i].lid >= 0) continue;
+    for(int i = 0; i < d->fdsSize; i++) {
+        if (!d->fds[i] || (d->fds[i]->state == PS_Invalid)) continue;
+        if (d->fds[i]->lid >= 0) continue;
         if (!header_sent) {
             send_cmd(d, lid, "# Unknown peers:");
             header_sent = true;
         }
         sprintf(msg, "#  at FD%2d%s state '%s'", i,
                 (i == fd) ? " (this connection)":"",
-                get_statestring(d->fds[i].state));
+                get_statestring(d->fds[i]->state));
         send_cmd(d, lid, msg);
-        if (d->fds[i].cmd) {
-            sprintf(msg, "#        queued for processing: '%s'", d->fds[i].cmd);
+        if (d->fds[i]->cmd) {
+            sprintf(msg, "#        queued for processing: '%s'", d->fds[i]->cmd);
             send_cmd(d, lid, msg);
         }
     }
@@ -1136,8 +2186,13 @@ void got_id(InstData* d, int from_lid, char* msg)
 
     // parse flags
     bool accepts_bin_data = false;
-    for(int i = 0; (i < 5) && flags[i]; i++)
+    bool accepts_shm = false;
+    bool accepts_zip = false;
+    for(int i = 0; (i < 5) && flags[i]; i++) {
         if (flags[i] == 'b') accepts_bin_data = true;
+        if (flags[i] == 's') accepts_shm = true;
+        if (flags[i] == 'z') accepts_zip = true;
+    }
 
     assert((lid >= 0) && (lid < MAX_PEERS));
     if (lid > d->maxid) d->maxid = lid;
@@ -1162,6 +2217,8 @@ void got_id(InstData* d, int from_lid, char* msg)
         d->peer[lid].location = d->location;
         d->peer[lid].port     = d->listenport;
         d->peer[lid].accepts_bin_data = accepts_bin_data;
+        d->peer[lid].accepts_shm = accepts_shm;
+        d->peer[lid].accepts_zip = accepts_zip;
 
         laik_log(1, "TCP2 got my LID %d assigned (location %s, at %s, port %d, flags %c)",
              lid, l, h, p, accepts_bin_data ? 'b':'-');
@@ -1193,10 +2250,13 @@ void got_id(InstData* d, int from_lid, char* msg)
     d->peer[lid].location = strdup(l);
     d->peer[lid].port = p;
     d->peer[lid].accepts_bin_data = accepts_bin_data;
+    d->peer[lid].accepts_shm = accepts_shm;
+    d->peer[lid].accepts_zip = accepts_zip;
 
     // first time we see this peer: init receive
     d->peer[lid].rcount = 0;
     d->peer[lid].scount = 0;
+    d->peer[lid].scredit = d->credit;
 
     d->peers++;
 
@@ -1206,7 +2266,7 @@ void got_id(InstData* d, int from_lid, char* msg)
 
 void got_phase(InstData* d, char* msg)
 {
-    // phase <phase> <epoch>
+    // phase <phase> <epoch> [<credit>]
 
     // ignore if master
     if (d->mylid == 0) {
@@ -1216,7 +2276,9 @@ void got_phase(InstData* d, char* msg)
 
     char cmd[21];
     int phase, epoch;
-    if (sscanf(msg, "%20s %d %d", cmd, &phase, &epoch) < 3) {
+    unsigned long long credit;
+    int res = sscanf(msg, "%20s %d %d %llu", cmd, &phase, &epoch, &credit);
+    if (res < 3) {
         laik_log(LAIK_LL_Warning, "cannot parse phase command '%s'; ignoring", msg);
         return;
     }
@@ -1224,6 +2286,20 @@ void got_phase(InstData* d, char* msg)
     d->phase = phase;
     d->epoch = epoch;
 
+    if ((res == 4) && (credit != d->credit)) {
+        // credit window must be same on all processes: use the master's.
+        // Only can differ on first phase after registration, before any
+        // data exchange: no credit is in use yet
+        laik_log(LAIK_LL_Warning,
+                 "TCP2 LAIK_TCP2_CREDIT %llu differs from master (%llu), using %llu",
+                 (unsigned long long) d->credit, credit, credit);
+        for(int i = 0; i < MAX_PEERS; i++) {
+            assert(d->peer[i].scredit == d->credit);
+            d->peer[i].scredit = credit;
+        }
+        d->credit = credit;
+    }
+
     d->exit = 1;
 }
 
@@ -1309,6 +2385,26 @@ void got_allowsend(InstData* d, int lid, char* msg)
     d->exit = 1;
 }
 
+void got_flowcredit(InstData* d, int lid, char* msg)
+{
+    // flowcredit <bytes>
+    char cmd[21];
+    unsigned long long bytes;
+    if (sscanf(msg, "%20s %llu", cmd, &bytes) < 2) {
+        laik_log(LAIK_LL_Warning, "cannot parse flowcredit command '%s'; ignoring", msg);
+        return;
+    }
+
+    laik_log(1, "TCP2 got flowcredit %llu", bytes);
+    d->peer[lid].scredit += bytes;
+    if (d->peer[lid].scredit > d->credit) {
+        // more credit returned than ever given: mismatch of credit windows
+        laik_log(LAIK_LL_Warning, "TCP2 LID %d returned more credit than sent; ignoring excess", lid);
+        d->peer[lid].scredit = d->credit;
+    }
+    d->exit = 1;
+}
+
 void got_kvs_allow(InstData* d, int lid, char* msg)
 {
     if (lid != 0) {
@@ -1389,6 +2485,39 @@ void got_kvs(InstData* d, int lid, char* msg)
     }
 }
 
+// 'K' frame header received: KVS changes with <len> bytes from <lid> follow
+static
+void got_kvs_frame(InstData* d, int lid, uint64_t len)
+{
+    if (lid < 0) return; // data will be ignored
+    Peer* p = &(d->peer[lid]);
+    assert(p->kvs_buf == 0); // previous frame must be consumed
+    p->kvs_buf = malloc(len);
+    if (!p->kvs_buf) {
+        laik_panic("TCP2 Out of memory allocating KVS receive buffer");
+        exit(1); // not actually needed, laik_panic never returns
+    }
+    p->kvs_len = len;
+    p->kvs_got = 0;
+}
+
+// bytes of KVS changes frame received from <lid>, return consumed bytes
+static
+int got_kvs_bytes(InstData* d, int lid, char* buf, int len)
+{
+    if (lid < 0) {
+        laik_log(LAIK_LL_Warning, "TCP2 ignoring KVS changes from unknown peer");
+        return len;
+    }
+    Peer* p = &(d->peer[lid]);
+    assert(p->kvs_got + len <= p->kvs_len);
+    memcpy(p->kvs_buf + p->kvs_got, buf, len);
+    p->kvs_got += len;
+    if (p->kvs_got == p->kvs_len)
+        d->exit = 1;
+    return len;
+}
+
 void got_getready(InstData* d, int lid, char* msg)
 {
     if (lid != 0) {
@@ -1472,7 +2601,7 @@ void got_ok(InstData* d, int lid, char* msg)
 //   this only happens with "data" command without matching receive
 void got_cmd(InstData* d, int fd, char* msg, int len)
 {
-    int lid = d->fds[fd].lid;
+    int lid = d->fds[fd]->lid;
     laik_log(1, "TCP2 Got cmd '%s' (len %d) from LID %d (FD %d)\n",
             msg, len, lid, fd);
     if (len == 0) return;
@@ -1507,10 +2636,12 @@ void got_cmd(InstData* d, int fd, char* msg, int len)
     case 'b': got_backedout(d, lid, msg); return; // backedout <lid>
     case 'p': got_phase(d, msg); return; // phase <phaseid>
     case 'a': got_allowsend(d, lid, msg); return; // allowsend <count> <elemsize>
+    case 'f': got_flowcredit(d, lid, msg); return; // flowcredit <bytes>
     case 'd': got_data(d, lid, msg); return; // data <len> [(<pos>)] <hex> ...
     case 'k': got_kvs(d, lid, msg); return; // kvs ...
     case 'g': got_getready(d, lid, msg); return; // getready
     case 'o': got_ok(d, lid, msg); return; // ok
+    case 'u': got_useshm(d, lid, msg); return; // useshm ...
     default: break;
     }
 
@@ -1519,11 +2650,14 @@ void got_cmd(InstData* d, int fd, char* msg, int len)
 
 void process_rbuf(InstData* d, int fd)
 {
-    assert((fd >= 0) && (fd < MAX_FDS));
-    FDState* fds = &(d->fds[fd]);
+    assert(has_rfd(d, fd));
+    FDState* fds = d->fds[fd];
     char* rbuf = fds->rbuf;
     int used = fds->rbuf_used;
-    int outstanding_bin = fds->outstanding_bin;
+    int64_t outstanding_bin = fds->outstanding_bin;
+    bool eager_bin = fds->eager_bin;
+    bool kvs_bin = fds->kvs_bin;
+    bool zip_bin = fds->zip_bin;
     assert(rbuf != 0);
 
     laik_log(1, "TCP2 handle commands in receive buf of FD %d (LID %d, %d bytes)\n",
@@ -1537,7 +2671,14 @@ void process_rbuf(InstData* d, int fd)
         if (outstanding_bin > 0) {
             if (used - pos1 < outstanding_bin) {
                 // all bytes in receive buffer are in bin mode
-                consumed = got_binary_data(d, fds->lid, rbuf + pos1, used - pos1);
+                if (kvs_bin)
+                    consumed = got_kvs_bytes(d, fds->lid, rbuf + pos1, used - pos1);
+                else if (zip_bin)
+                    consumed = got_zip_bytes(d, fds->lid, rbuf + pos1, used - pos1);
+                else if (eager_bin)
+                    consumed = got_eager_data(d, fds->lid, rbuf + pos1, used - pos1);
+                else
+                    consumed = got_binary_data(d, fds->lid, rbuf + pos1, used - pos1);
                 if (consumed == 0) {
                     // may happen if available chunk too small, need more data
                     pos2 = used;
@@ -1545,7 +2686,14 @@ void process_rbuf(InstData* d, int fd)
                 }
             }
             else {
-                consumed = got_binary_data(d, fds->lid, rbuf + pos1, outstanding_bin);
+                if (kvs_bin)
+                    consumed = got_kvs_bytes(d, fds->lid, rbuf + pos1, (int) outstanding_bin);
+                else if (zip_bin)
+                    consumed = got_zip_bytes(d, fds->lid, rbuf + pos1, (int) outstanding_bin);
+                else if (eager_bin)
+                    consumed = got_eager_data(d, fds->lid, rbuf + pos1, (int) outstanding_bin);
+                else
+                    consumed = got_binary_data(d, fds->lid, rbuf + pos1, (int) outstanding_bin);
                 assert(consumed > 0); // we provided all bytes until end, ensure progress
             }
             outstanding_bin -= consumed;
@@ -1563,11 +2711,60 @@ void process_rbuf(InstData* d, int fd)
             }
             outstanding_bin  = ((int)((unsigned char*)rbuf)[pos1 + 1]);
             outstanding_bin += ((int)((unsigned char*)rbuf)[pos1 + 2]) << 8;
-            laik_log(1, "TCP2 bin mode started with %d bytes\n", outstanding_bin);
+            eager_bin = false;
+            kvs_bin = false;
+            zip_bin = false;
+            laik_log(1, "TCP2 bin mode started with %d bytes\n", (int) outstanding_bin);
             pos1 += 3;
             pos2 = pos1;
             continue;
         }
+        // start of large-frame bin mode?
+        // (E: eager data, K: KVS changes, Z: compressed data)
+        if ((rbuf[pos1] == 'L') || (rbuf[pos1] == 'E') ||
+            (rbuf[pos1] == 'K') || (rbuf[pos1] == 'Z')) {
+            // 9 bytes header: 'L'/'E'/'K'/'Z' + 8 bytes count (little endian)
+            if (pos1 + 8 >= used) {
+                // not enough bytes to cover header: stop
+                pos2 = used;
+                break;
+            }
+            outstanding_bin = 0;
+            for(int i = 8; i > 0; i--)
+                outstanding_bin = (outstanding_bin << 8) |
+                                  ((unsigned char*)rbuf)[pos1 + i];
+            eager_bin = (rbuf[pos1] == 'E');
+            kvs_bin = (rbuf[pos1] == 'K');
+            zip_bin = (rbuf[pos1] == 'Z');
+            laik_log(1, "TCP2 large bin mode started with %lld bytes%s\n",
+                     (long long) outstanding_bin,
+                     eager_bin ? " (eager)" : kvs_bin ? " (KVS)" :
+                     zip_bin ? " (compressed)" : "");
+            if (kvs_bin)
+                got_kvs_frame(d, fds->lid, (uint64_t) outstanding_bin);
+            if (zip_bin)
+                got_zip_frame(d, fds->lid, (uint64_t) outstanding_bin);
+            pos1 += 9;
+            pos2 = pos1;
+            continue;
+        }
+
+        // binary data written into shared memory ring?
+        if (rbuf[pos1] == 'S') {
+            // 9 bytes header: 'S' + 8 bytes count (little endian)
+            if (pos1 + 8 >= used) {
+                // not enough bytes to cover header: stop
+                pos2 = used;
+                break;
+            }
+            uint64_t len = 0;
+            for(int i = 8; i > 0; i--)
+                len = (len << 8) | ((unsigned char*)rbuf)[pos1 + i];
+            pos1 += 9;
+            pos2 = pos1;
+            got_shm_data(d, fds->lid, len);
+            continue;
+        }
 
         if (rbuf[pos2] == 4) { // Ctrl+D: same as "quit"
             got_cmd(d, fd, "quit", 5);
@@ -1591,13 +2788,52 @@ void process_rbuf(InstData* d, int fd)
     }
     fds->rbuf_used = used;
     fds->outstanding_bin = outstanding_bin;
+    fds->eager_bin = eager_bin;
+    fds->kvs_bin = kvs_bin;
+    fds->zip_bin = zip_bin;
 }
 
-void got_bytes(InstData* d, int fd)
+// in binary data receive mode for a range contiguous in the target mapping
+// (without reduction), receive directly into the mapping, bypassing the
+// receive buffer. Returns false if not possible or no input available
+static
+bool got_bytes_direct(InstData* d, int fd, int lid)
+{
+    Peer* p = &(d->peer[lid]);
+    if ((p->rcv_ptr == 0) || (p->rro != LAIK_RO_None) || (p->rcount == 0))
+        return false;
+    if (p->ebuf_used > 0) return false; // staged data must be consumed first
+
+    FDState* fds = d->fds[fd];
+    if (fds->kvs_bin || fds->zip_bin) return false;
+    uint64_t left = (uint64_t) p->rcount * p->relemsize - p->rbytes;
+    if (left > (uint64_t) fds->outstanding_bin) left = fds->outstanding_bin;
+    if (left == 0) return false;
+
+    ssize_t len = recv(fd, p->rcv_ptr + p->rbytes, left, MSG_DONTWAIT);
+    if (len <= 0) {
+        // no data available, error or connection closed: handled via receive buffer
+        return false;
+    }
+    laik_log(1, "TCP2 got_bytes(FD %d, peer LID %d): read %lld bytes directly\n",
+             fd, lid, (long long) len);
+
+    p->rbytes += len;
+    p->roff = (int) (p->rbytes / p->relemsize);
+    fds->outstanding_bin -= len;
+    if (p->roff == p->rcount)
+        d->exit = 1;
+    return true;
+}
+
+// read available bytes from <fd> into its receive buffer and process them.
+// Returns false if there was no input available (or connection closed)
+static
+bool got_bytes_once(InstData* d, int fd)
 {
     // use a per-fd receive buffer to not mix partially sent commands
-    assert((fd >= 0) && (fd < MAX_FDS));
-    int used = d->fds[fd].rbuf_used;
+    assert(has_rfd(d, fd));
+    int used = d->fds[fd]->rbuf_used;
 
     if (used == RBUF_LEN) {
         // buffer not large enough for even 1 command: should not happen
@@ -1605,13 +2841,18 @@ void got_bytes(InstData* d, int fd)
         exit(1);
     }
 
-    char* rbuf = d->fds[fd].rbuf;
-    int len = read(fd, rbuf + used, RBUF_LEN - used);
+    int lid = d->fds[fd]->lid;
+    if ((used == 0) && (d->fds[fd]->outstanding_bin > 0) && (lid >= 0))
+        if (got_bytes_direct(d, fd, lid)) return true;
+
+    char* rbuf = d->fds[fd]->rbuf;
+    int len = recv(fd, rbuf + used, RBUF_LEN - used, MSG_DONTWAIT);
     if (len == -1) {
         int e = errno;
+        if ((e == EAGAIN) || (e == EWOULDBLOCK)) return false;
         laik_log(1, "TCP2 warning: read error on FD %d: %s\n",
                  fd, strerror(e));
-        return;
+        return false;
     }
     if (len == 0) {
         // other side closed connection
@@ -1619,16 +2860,14 @@ void got_bytes(InstData* d, int fd)
         if (used > 0) {
             // process left-over commands, add NL for last command to process
             rbuf[used] = '\n';
-            d->fds[fd].rbuf_used++;
+            d->fds[fd]->rbuf_used++;
             process_rbuf(d, fd);
         }
 
-        int lid = d->fds[fd].lid;
         laik_log(1, "TCP2 FD %d closed (peer LID %d, %d bytes unprocessed)\n",
-                 fd, lid, d->fds[fd].rbuf_used);
+                 fd, lid, d->fds[fd]->rbuf_used);
 
-        if (lid >= 0) {
-            assert(d->peer[lid].fd == fd);
+        if ((lid >= 0) && (d->peer[lid].fd == fd)) {
             // peer may still be alive and just have closed connection to avoid
             // too many open connections: thus, only mark as "not connected"
             d->peer[lid].fd = -1;
@@ -1636,7 +2875,7 @@ void got_bytes(InstData* d, int fd)
 
         close(fd);
         rm_rfd(d, fd);
-        return;
+        return false;
     }
 
     if (laik_log_begin(1)) {
@@ -1648,25 +2887,39 @@ void got_bytes(InstData* d, int fd)
         if (i < len) sprintf(lstr + o, "...");
         assert(o < 100);
         laik_log_flush("TCP2 got_bytes(FD %d, peer LID %d, used %d): read %d bytes (%s)\n",
-                       fd, d->fds[fd].lid, used, len, lstr);
+                       fd, d->fds[fd]->lid, used, len, lstr);
     }
 
-    d->fds[fd].rbuf_used = used + len;
+    d->fds[fd]->rbuf_used = used + len;
     process_rbuf(d, fd);
+    return true;
 }
 
-void got_connect(InstData* d, int fd)
+void got_bytes(InstData* d, int fd)
 {
-    struct sockaddr saddr;
-    socklen_t len = sizeof(saddr);
-    int newfd = accept(fd, &saddr, &len);
-    if (newfd < 0) {
+    // edge-triggered notification: read until no more input available
+    while(has_rfd(d, fd)) {
+        if (!got_bytes_once(d, fd)) break;
+    }
+}
+
+// accept one connection at listening socket <fd>
+// returns false if there was no pending connection request
+static
+bool got_connect_once(InstData* d, int fd)
+{
+    struct sockaddr saddr;
+    socklen_t len = sizeof(saddr);
+    int newfd = accept(fd, &saddr, &len);
+    if (newfd < 0) {
+        // listening socket is non-blocking
+        if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) return false;
         laik_panic("TCP2 Error in accept\n");
         exit(1);
     }
 
     add_rfd(d, newfd, got_bytes);
-    d->fds[newfd].state = PS_Unknown;
+    d->fds[newfd]->state = PS_Unknown;
 
     char str[20];
     if (saddr.sa_family == AF_INET)
@@ -1678,6 +2931,13 @@ void got_connect(InstData* d, int fd)
     char msg[100];
     sprintf(msg, "# Here is LAIK TCP2 LID %d (type 'help' for commands)", d->mylid);
     send_cmd(d, -newfd, msg);
+    return true;
+}
+
+void got_connect(InstData* d, int fd)
+{
+    // edge-triggered notification: accept all pending connections
+    while(got_connect_once(d, fd));
 }
 
 
@@ -1699,6 +2959,9 @@ InstData* new_inst_data(char* host, char* location)
     d->peers = 0; // zero known peers
     d->readyPeers = 0; // zero ready peers
     d->deadPeers = 0;
+    // credit window for eager sending of binary data, 0 disables
+    char* str = getenv("LAIK_TCP2_CREDIT");
+    d->credit = str ? (uint64_t) atoll(str) : 256 * 1024;
     for(int i = 0; i < MAX_PEERS; i++) {
         d->peer[i].state = PS_Invalid;
         d->peer[i].port = -1; // unknown peer
@@ -1706,17 +2969,47 @@ InstData* new_inst_data(char* host, char* location)
         d->peer[i].host = 0;
         d->peer[i].location = 0;
         d->peer[i].accepts_bin_data = false;
+        d->peer[i].accepts_shm = false;
+        d->peer[i].accepts_zip = false;
+        d->peer[i].shm_state = SHM_Unknown;
+        d->peer[i].sring = 0;
+        d->peer[i].shead = 0;
+        d->peer[i].sname = 0;
+        d->peer[i].rring = 0;
+        d->peer[i].rtail = 0;
         d->peer[i].rcount = 0;
         d->peer[i].scount = 0;
+        d->peer[i].scredit = d->credit;
+        d->peer[i].ebuf = 0;
+        d->peer[i].ebuf_used = 0;
+        d->peer[i].ebuf_size = 0;
+        d->peer[i].kvs_buf = 0;
+        d->peer[i].kvs_len = 0;
+        d->peer[i].kvs_got = 0;
+        d->peer[i].zbuf = 0;
+        d->peer[i].zbuf_len = 0;
+        d->peer[i].zbuf_got = 0;
     }
 
-    FD_ZERO(&d->rset);
-    d->maxfds = 0;
-    d->exit = 0;
-    for(int i = 0; i < MAX_FDS; i++) {
-        d->fds[i].state = PS_Invalid;
-        d->fds[i].cb = 0;
+    d->epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (d->epfd < 0) {
+        laik_panic("TCP2 cannot create epoll instance");
+        exit(1); // not actually needed, laik_panic never returns
     }
+    d->exit = 0;
+    d->fdsSize = 0; // FD table allocated on demand
+    // progress thread is started after initialization
+    str = getenv("LAIK_TCP2_THREAD");
+    d->use_thread = str ? atoi(str) : 0;
+    d->in_thread = false;
+    d->tepfd = -1;
+    d->stopfd = -1;
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&(d->lock), &attr);
+    pthread_mutexattr_destroy(&attr);
+    d->fds = 0;
 
     d->host = strdup(host);
     d->location = strdup(location);
@@ -1726,8 +3019,37 @@ InstData* new_inst_data(char* host, char* location)
     d->epoch = -1;    // not set yet
     d->mylid = -1;    // net yet determined
     // announce capability to accept binary data? Defaults to yes, can be switched off
-    char* str = getenv("LAIK_TCP2_BIN");
+    str = getenv("LAIK_TCP2_BIN");
     d->accept_bin_data = str ? atoi(str) : 1;
+    // size of shared memory rings for binary data to peers on same host
+    str = getenv("LAIK_TCP2_SHM");
+    d->shm_size = str ? (uint64_t) atoll(str) : 0;
+    if (d->shm_size > 0x40000000) d->shm_size = 0x40000000;
+    if (!d->accept_bin_data) d->shm_size = 0;
+    // compression of binary data frames with at least given size, 0 disables
+    str = getenv("LAIK_TCP2_COMPRESS");
+    d->compress = str ? (uint64_t) atoll(str) : 0;
+    if (!d->accept_bin_data) d->compress = 0;
+    d->zbuf = 0;
+    d->zbuf_size = 0;
+    d->exec_as = 0;
+    // reduction algorithm: 0 auto, 1 linear, 2 tree, 3 rec.doubling, 4 ring,
+    // 5 node-aware
+    str = getenv("LAIK_TCP2_REDUCE");
+    d->reduce_alg = str ? (ReduceAlg) atoi(str) : RA_Auto;
+    if ((d->reduce_alg < RA_Auto) || (d->reduce_alg > RA_Nodes))
+        d->reduce_alg = RA_Auto;
+    // nodes for node-aware reductions: 0 off, 1 hosts, k > 1 emulated
+    str = getenv("LAIK_TCP2_NODES");
+    d->nodes = str ? atoi(str) : 1;
+    if (d->nodes < 0) d->nodes = 0;
+    // connection setup: 0 lazy, 1 all peers, 2 neighbors in action sequences
+    str = getenv("LAIK_TCP2_CONNECT");
+    d->connect_mode = str ? (ConnectMode) atoi(str) : CM_Lazy;
+    if ((d->connect_mode < CM_Lazy) || (d->connect_mode > CM_Neighbors))
+        d->connect_mode = CM_Lazy;
+    str = getenv("LAIK_TCP2_SOCKBUF");
+    d->sockbuf = str ? atoi(str) : 0;
     d->kvs = 0;       // only set during tcp2_sync()
     d->kvs_changes = 0;
     d->kvs_received = 0;
@@ -1769,7 +3091,7 @@ int startup_master(InstData* d)
     for(int lid = 0; lid <= d->maxid; lid++) {
         sprintf(msg, "newid %d %s %s %d %s", lid,
                 d->peer[lid].location, d->peer[lid].host, d->peer[lid].port,
-                d->peer[lid].accepts_bin_data ? "b":"-");
+                peer_flags(&(d->peer[lid])));
         for(int to_lid = 1; to_lid <= d->maxid; to_lid++) {
             if (lid == to_lid) continue;
             send_cmd(d, to_lid, msg);
@@ -1789,10 +3111,11 @@ int startup_master(InstData* d)
 
     laik_log(1, "TCP2 master: %d peers registered, startup done\n", d->readyPeers);
 
-    // notify all peers to start at phase 0, epoch 0
+    // notify all peers to start at phase 0, epoch 0, with our credit window
+    sprintf(msg, "phase 0 0 %llu", (unsigned long long) d->credit);
     for(int i = 1; i <= d->maxid; i++) {
         assert(d->peer[i].state == PS_Ready);
-        send_cmd(d, i, "phase 0 0");
+        send_cmd(d, i, msg);
     }
 
     return world_size;
@@ -1804,8 +3127,10 @@ int startup_non_master(InstData* d)
 {
     // register with master, get world size
     char msg[100];
-    sprintf(msg, "register %.30s %.30s %d %s",
-            d->location, d->host, d->listenport, d->accept_bin_data ? "bin":"");
+    sprintf(msg, "register %.30s %.30s %d %s%s%s",
+            d->location, d->host, d->listenport,
+            d->accept_bin_data ? "b":"", (d->shm_size > 0) ? "s":"",
+            (d->compress > 0) ? "z":"");
     send_cmd(d, 0, msg);
 
     // wait until "getready" from master, confirmed with "ok", setting myself to ready
@@ -1894,15 +3219,11 @@ Laik_Instance* laik_init_tcp2(int* argc, char*** argv)
         }
 
         // this disables nagle's algorithm on our side of TCP connections for
-        // faster communication. It is enough to set NODELAY for the listening
-        // socket, as this options get inherited to all sockets created in
-        // accepted incoming connections.
-        // NODELAY is also set for sockets on the remote side in ensure_conn
-        if (setsockopt(listenfd, IPPROTO_TCP, TCP_NODELAY,
-                       &(int){1}, sizeof(int)) < 0) {
-            laik_panic("TCP2 cannot set TCP_NODELAY on listening socket");
-            exit(1); // not actually needed, laik_panic never returns
-        }
+        // faster communication, and sets buffer sizes. It is enough to set
+        // these for the listening socket, as the options get inherited to all
+        // sockets created in accepted incoming connections.
+        // They are also set for sockets on the remote side in ensure_conn
+        set_sockopts(d, listenfd);
 
         if (try_master) {
             // mainly for development: avoid wait time to bind to same port
@@ -1919,7 +3240,7 @@ Laik_Instance* laik_init_tcp2(int* argc, char*** argv)
                 // listen on successfully bound socket
                 // if this fails, another process started listening first
                 // and we need to open another socket, as we cannot unbind
-                if (listen(listenfd, 5) < 0) {
+                if (listen(listenfd, LISTEN_BACKLOG) < 0) {
                     laik_log(1,"listen failed, opening new socket");
                     close(listenfd);
                     continue;
@@ -1931,7 +3252,7 @@ Laik_Instance* laik_init_tcp2(int* argc, char*** argv)
             }
         }
         // not bound yet: will bind to random port
-        if (listen(listenfd, 5) < 0) {
+        if (listen(listenfd, LISTEN_BACKLOG) < 0) {
             laik_panic("TCP2 cannot listen on socket");
             exit(1); // not actually needed, laik_panic never returns
         }
@@ -1948,6 +3269,13 @@ Laik_Instance* laik_init_tcp2(int* argc, char*** argv)
     }
     d->listenfd = listenfd;
 
+    // edge-triggered event loop must accept all pending connections
+    int flags = fcntl(listenfd, F_GETFL, 0);
+    if ((flags < 0) || (fcntl(listenfd, F_SETFL, flags | O_NONBLOCK) < 0)) {
+        laik_panic("TCP2 cannot make listening socket non-blocking");
+        exit(1); // not actually needed, laik_panic never returns
+    }
+
     // notify us on connection requests at listening port
     add_rfd(d, d->listenfd, got_connect);
 
@@ -1970,6 +3298,8 @@ Laik_Instance* laik_init_tcp2(int* argc, char*** argv)
         d->peer[0].location = d->location;
         d->peer[0].port     = d->listenport;
         d->peer[0].accepts_bin_data = d->accept_bin_data;
+        d->peer[0].accepts_shm = (d->shm_size > 0);
+        d->peer[0].accepts_zip = (d->compress > 0);
     }
     else {
         // we are non-master: we want to register with master
@@ -2077,6 +3407,12 @@ Laik_Instance* laik_init_tcp2(int* argc, char*** argv)
              d->location, d->mylid, world->myid, world_size,
              d->epoch, d->phase, d->listenport, d->accept_bin_data ? 'b':'-');
 
+    if (d->connect_mode == CM_All)
+        connect_all(d);
+
+    if (d->use_thread)
+        start_progress_thread(d);
+
     return instance;
 }
 
@@ -2107,55 +3443,151 @@ void send_data(int n, int dims, Laik_Index* idx, int toLID, void* p, int s)
     send_cmd((InstData*)instance->backend_data, toLID, str);
 }
 
-// send
-
+// send in binary mode
+//
+// A range is sent as one large frame ('L' + 64-bit byte count), with the
+// data written via writev directly from the runs of the range which are
+// contiguous in the mapping. Small runs are copied into a staging buffer
+// to keep the number of iovec entries low
+
+// maximal number of buffers collected before calling writev
+#define SEND_IOV 64
+// runs smaller than this many bytes are copied into the staging buffer
+#define SEND_COPY_MAX 256
 #define SBUF_LEN 8*1024
-int sbuf_used = 3; // reserve space for header
-int sbuf_toLID = -1;
-char sbuf[SBUF_LEN];
+
+typedef struct {
+    int toLID;
+    bool shm; // write into shared memory ring instead of connection
+    char* zraw; // if set: collect data here for compression
+    uint64_t zraw_used;
+    int iovcnt;
+    struct iovec iov[SEND_IOV];
+    int sbuf_used;
+    char sbuf[SBUF_LEN];
+} SendState;
 
 static
-void send_data_bin_flush(int toLID)
+void send_flush(SendState* ss)
 {
-    if (sbuf_used == 0) return;
-    assert(sbuf_toLID == toLID);
-
-    // prepend data to send with header with byte count
-    int bytes = sbuf_used - 3;
-    sbuf[0] = 'B';
-    sbuf[1] = bytes & 255;
-    sbuf[2] = bytes >> 8;
-    send_bin((InstData*)instance->backend_data, toLID, sbuf, sbuf_used);
-    sbuf_used = 3; // reserve space for header
-    sbuf_toLID = -1;
+    if (ss->iovcnt == 0) return;
+    InstData* d = (InstData*)instance->backend_data;
+    if (ss->shm)
+        send_shmv(d, ss->toLID, ss->iov, ss->iovcnt);
+    else
+        send_binv(d, ss->toLID, ss->iov, ss->iovcnt);
+    ss->iovcnt = 0;
+    ss->sbuf_used = 0;
 }
 
+// add <len> bytes at <p> to data to send
 static
-void send_data_bin(int n, int dims, Laik_Index* idx, int toLID, void* p, int s)
+void send_add(SendState* ss, char* p, size_t len)
 {
-    if (sbuf_used + s > SBUF_LEN)
-        send_data_bin_flush(toLID);
-    if (sbuf_toLID < 0)
-        sbuf_toLID = toLID;
-    else
-        assert(sbuf_toLID == toLID);
+    if (ss->zraw) {
+        memcpy(ss->zraw + ss->zraw_used, p, len);
+        ss->zraw_used += len;
+        return;
+    }
+
+    struct iovec* last = (ss->iovcnt > 0) ? &(ss->iov[ss->iovcnt - 1]) : 0;
+    if (last && ((char*) last->iov_base + last->iov_len == p)) {
+        // directly follows previous run in memory
+        last->iov_len += len;
+        return;
+    }
 
-    memcpy(sbuf + sbuf_used, p, s);
-    sbuf_used += s;
+    if (len < SEND_COPY_MAX) {
+        if (ss->sbuf_used + len > SBUF_LEN) {
+            send_flush(ss);
+            last = 0;
+        }
+        char* sp = ss->sbuf + ss->sbuf_used;
+        memcpy(sp, p, len);
+        ss->sbuf_used += len;
+        if (last && ((char*) last->iov_base + last->iov_len == sp)) {
+            last->iov_len += len;
+            return;
+        }
+        p = sp;
+    }
 
-    if (laik_log_begin(1)) {
-        laik_log_append("TCP2 add %d bytes bin data to LID %d", s, toLID);
-        if (s == 8)
-            laik_log_flush(", pos (%d:%s): %f\n", n, istr(dims, idx), *((double*)p));
-        else
-            laik_log_flush("");
+    if (ss->iovcnt == SEND_IOV) {
+        bool staged = (p >= ss->sbuf) && (p < ss->sbuf + SBUF_LEN);
+        send_flush(ss);
+        if (staged) {
+            // move staged run to start of now unused staging buffer
+            memmove(ss->sbuf, p, len);
+            p = ss->sbuf;
+            ss->sbuf_used = len;
+        }
     }
+    ss->iov[ss->iovcnt].iov_base = p;
+    ss->iov[ss->iovcnt].iov_len = len;
+    ss->iovcnt++;
 }
 
+// send <bytes> bytes collected in <raw> as compressed frame to <lid>, or
+// uncompressed if compression does not reduce the size. <raw> must be
+// followed by space for <bytes> + 17 bytes (see zip_buffer)
+static
+void send_zip(InstData* d, int lid, char* raw, uint64_t bytes, bool eager)
+{
+    char* hdr = raw + bytes;
+    uint64_t zlen = lz_compress(raw, bytes, hdr + 17, bytes);
+    struct iovec iov[2];
+    if (zlen > 0) {
+        // 'Z' + 8 bytes frame length + 8 bytes uncompressed length
+        hdr[0] = 'Z';
+        for(int i = 1; i < 9; i++) {
+            hdr[i] = ((zlen + 8) >> (8 * (i - 1))) & 255;
+            hdr[i + 8] = (bytes >> (8 * (i - 1))) & 255;
+        }
+        iov[0].iov_base = hdr;
+        iov[0].iov_len = 17 + zlen;
+        send_binv(d, lid, iov, 1);
+    }
+    else {
+        hdr[0] = eager ? 'E' : 'L';
+        for(int i = 1; i < 9; i++)
+            hdr[i] = (bytes >> (8 * (i - 1))) & 255;
+        iov[0].iov_base = hdr;
+        iov[0].iov_len = 9;
+        iov[1].iov_base = raw;
+        iov[1].iov_len = bytes;
+        send_binv(d, lid, iov, 2);
+        zlen = bytes;
+    }
+    laik_log(1, "TCP2 compressed %llu bytes to %llu for LID %d",
+             (unsigned long long) bytes, (unsigned long long) zlen, lid);
+
+    if (d->exec_as) {
+        d->exec_as->byteCompRawCount += bytes;
+        d->exec_as->byteCompCount += zlen;
+    }
+}
+
+// return buffer for collecting <bytes> bytes to compress
+static
+char* zip_buffer(InstData* d, uint64_t bytes)
+{
+    uint64_t size = 2 * bytes + 17;
+    if (d->zbuf_size < size) {
+        free(d->zbuf);
+        d->zbuf = malloc(size);
+        if (!d->zbuf) {
+            laik_panic("TCP2 Out of memory allocating compression buffer");
+            exit(1); // not actually needed, laik_panic never returns
+        }
+        d->zbuf_size = size;
+    }
+    return d->zbuf;
+}
 
 // send a range of data from mapping <m> to process <lid>
-// if not yet allowed to send data, we have to wait.
-// the action sequence ordering makes sure that there must
+// if range fits into credit window, it is sent eagerly as soon as enough
+// credit is available. Otherwise, if not yet allowed to send data, we have
+// to wait. The action sequence ordering makes sure that there must
 // be a matching receive action on the receiver side
 static
 void send_range(Laik_Mapping* fromMap, Laik_Range* range, int toLID)
@@ -2167,33 +3599,100 @@ void send_range(Laik_Mapping* fromMap, Laik_Range* range, int toLID)
 
     InstData* d = (InstData*)instance->backend_data;
     Peer* p = &(d->peer[toLID]);
-    if (p->scount == 0) {
-        // we need to wait for right to send data
-        while(p->scount == 0)
+    uint64_t bytes = laik_range_size(range) * esize;
+    bool eager = p->accepts_bin_data && (bytes <= d->credit);
+    if (eager) {
+        // we need to wait for enough credit
+        while(p->scredit < bytes)
             run_loop(d);
+        p->scredit -= bytes;
+    }
+    else {
+        if (p->scount == 0) {
+            // we need to wait for right to send data
+            while(p->scount == 0)
+                run_loop(d);
+        }
+        assert(p->scount == (int) laik_range_size(range));
+        assert(p->selemsize == esize);
     }
-    assert(p->scount == (int) laik_range_size(range));
-    assert(p->selemsize == esize);
 
-    bool send_binary_data = p->accepts_bin_data;
     Laik_Index idx = range->from;
-    int ecount = 0;
+    if (!p->accepts_bin_data) {
+        int ecount = 0;
+        while(1) {
+            int64_t off = l->offset(l, fromMap->layoutSection, &idx);
+            void* idxPtr = fromMap->start + off * esize;
+            send_data(ecount, dims, &idx, toLID, idxPtr, esize);
+            ecount++;
+            if (!next_lex(range, &idx)) break;
+        }
+        assert(ecount == (int) laik_range_size(range));
+
+        // withdraw our right to send further data
+        p->scount = 0;
+        return;
+    }
+
+    // binary mode: send range as one large frame, or via shared memory
+    if (p->shm_state == SHM_Unknown)
+        start_shm(d, toLID);
+
+    static SendState ss;
+    ss.toLID = toLID;
+    ss.shm = (p->shm_state == SHM_Active);
+    ss.iovcnt = 0;
+    ss.sbuf_used = 0;
+
+    // compress frames of large enough size if peer accepts this
+    bool zip = !ss.shm && p->accepts_zip && (d->compress > 0) &&
+               (bytes >= d->compress) && (bytes <= ZIP_MAX);
+    ss.zraw = zip ? zip_buffer(d, bytes) : 0;
+    ss.zraw_used = 0;
+
+    if (!ss.shm && !zip) {
+        char hdr[9];
+        hdr[0] = eager ? 'E' : 'L';
+        for(int i = 1; i < 9; i++)
+            hdr[i] = (bytes >> (8 * (i - 1))) & 255;
+        send_add(&ss, hdr, 9);
+    }
+    laik_log(1, "TCP2 send %llu bytes bin data to LID %d%s%s",
+             (unsigned long long) bytes, toLID, eager ? " (eager)" : "",
+             ss.shm ? " via shared memory" : "");
+
+    // row-wise traversal: rows contiguous in layout are sent without copying.
+    // send_add merges rows following each other in memory, so ranges
+    // contiguous up to a single stride are written as one run per block
+    int64_t rowlen = range->to.i[0] - range->from.i[0];
     while(1) {
         int64_t off = l->offset(l, fromMap->layoutSection, &idx);
-        void* idxPtr = fromMap->start + off * esize;
-        if (send_binary_data)
-            send_data_bin(ecount, dims, &idx, toLID, idxPtr, esize);
-        else
-            send_data(ecount, dims, &idx, toLID, idxPtr, esize);
-        ecount++;
+        Laik_Index last = idx;
+        last.i[0] = range->to.i[0] - 1;
+        if (l->offset(l, fromMap->layoutSection, &last) - off + 1 == rowlen)
+            send_add(&ss, fromMap->start + off * esize, rowlen * esize);
+        else {
+            // row not contiguous in layout: element-wise
+            while(1) {
+                off = l->offset(l, fromMap->layoutSection, &idx);
+                send_add(&ss, fromMap->start + off * esize, esize);
+                if (idx.i[0] == last.i[0]) break;
+                idx.i[0]++;
+            }
+        }
+        idx.i[0] = last.i[0];
         if (!next_lex(range, &idx)) break;
     }
-    assert(ecount == (int) laik_range_size(range));
-    if (send_binary_data)
-        send_data_bin_flush(toLID);
+    if (zip) {
+        assert(ss.zraw_used == bytes);
+        send_zip(d, toLID, ss.zraw, bytes, eager);
+    }
+    else
+        send_flush(&ss);
 
     // withdraw our right to send further data
-    p->scount = 0;
+    if (!eager)
+        p->scount = 0;
 }
 
 // queue receive action and run event loop until all data received
@@ -2217,11 +3716,25 @@ void recv_range(Laik_Range* range, int fromLID, Laik_Mapping* toMap, Laik_Reduct
     p->rcv_range = range;
     p->rcv_idx = range->from;
     p->rro = ro;
+    p->rbytes = 0;
+    int64_t off;
+    if (laik_layout_lex_contiguous(toMap->layout, toMap->layoutSection, range, &off))
+        p->rcv_ptr = toMap->start + off * p->relemsize;
+    else
+        p->rcv_ptr = 0;
 
-    // give peer the right to start sending data consisting of given number of elements
-    char msg[50];
-    sprintf(msg, "allowsend %d %d\n", p->rcount, p->relemsize);
-    send_cmd(d, fromLID, msg);
+    uint64_t bytes = (uint64_t) p->rcount * p->relemsize;
+    bool eager = d->accept_bin_data && (bytes <= d->credit);
+    if (eager) {
+        // peer sends without permission: data may be staged already
+        drain_staged(d, fromLID);
+    }
+    else {
+        // give peer the right to start sending data consisting of given number of elements
+        char msg[50];
+        sprintf(msg, "allowsend %d %d\n", p->rcount, p->relemsize);
+        send_cmd(d, fromLID, msg);
+    }
 
     // wait until all data received from peer
     while(p->roff < p->rcount)
@@ -2229,10 +3742,63 @@ void recv_range(Laik_Range* range, int fromLID, Laik_Mapping* toMap, Laik_Reduct
 
     // done
     p->rcount = 0;
+
+    // return credit for consumed eager data
+    if (eager)
+        send_credit(d, fromLID, bytes);
+}
+
+// temporary mapping for partial results of range <r>, using a lex layout
+static
+void init_tmp_map(Laik_Mapping* tm, Laik_Data* data, Laik_Range* r)
+{
+    memset(tm, 0, sizeof(Laik_Mapping));
+    tm->data = data;
+    tm->mapNo = -1;
+    tm->layout = laik_new_layout_lex(1, r);
+    tm->layoutSection = 0;
+    tm->allocatedRange = *r;
+    tm->requiredRange = *r;
+    tm->count = laik_range_size(r);
+    tm->allocCount = tm->count;
+    tm->capacity = tm->count * data->elemsize;
+    tm->start = malloc(tm->capacity);
+    if (!tm->start) {
+        laik_panic("TCP2 Out of memory allocating reduction buffer");
+        exit(1); // not actually needed, laik_panic never returns
+    }
+    tm->base = tm->start;
+    tm->reusedFor = -1;
+}
+
+static
+void free_tmp_map(Laik_Mapping* tm)
+{
+    free(tm->start);
+    free(tm->layout);
+    tm->start = 0;
+    tm->layout = 0;
+}
+
+// return position of <task> in group with ID <subgroup>, -1 if not in group
+static
+int pos_in_group(Laik_Transition* t, int subgroup, int task)
+{
+    int n = laik_trans_groupCount(t, subgroup);
+    for(int i = 0; i < n; i++)
+        if (laik_trans_taskInGroup(t, subgroup, i) == task) return i;
+    return -1;
+}
+
+// return location ID of <i>'th task in group with ID <subgroup>
+static
+int lid_in_group(Laik_Transition* t, int subgroup, int i)
+{
+    return laik_group_locationid(t->group, laik_trans_taskInGroup(t, subgroup, i));
 }
 
 /* reduction at one process using send/recv
- * 
+ *
  * One process is chosen to do the reduction (reduceProcess): this is selected
  * to be the process with smallest id of all processes which are interested in the
  * result (input group). All other processes with input send their data to the
@@ -2240,10 +3806,9 @@ void recv_range(Laik_Range* range, int fromLID, Laik_Mapping* toMap, Laik_Reduct
  * processes interested in the result (output group)
 */
 static
-void exec_reduce(Laik_TransitionContext* tc,
-                 Laik_BackendAction* a)
+void exec_reduce_linear(Laik_TransitionContext* tc,
+                        Laik_BackendAction* a)
 {
-    assert(a->h.type == LAIK_AT_MapGroupReduce);
     Laik_Transition* t = tc->transition;
 
     // do the manual reduction on smallest rank of output group
@@ -2319,8 +3884,484 @@ void exec_reduce(Laik_TransitionContext* tc,
     }
 }
 
+/* reduction along binomial trees
+ *
+ * Same reduce process as in the linear variant. The reduce process and all
+ * processes with input are ordered (reduce process first), and partial results
+ * are combined along a binomial tree towards the reduce process. Inner nodes
+ * of the tree keep partial results in their output mapping, or in a temporary
+ * buffer if not in the output group. Afterwards, the result is broadcast along
+ * a binomial tree over the output group. Both phases take log(n) steps.
+ */
+static
+void exec_reduce_tree(Laik_TransitionContext* tc,
+                      Laik_BackendAction* a)
+{
+    Laik_Transition* t = tc->transition;
+    int myid = t->group->myid;
+    int reduceTask = laik_trans_taskInGroup(t, a->outputGroup, 0);
+    bool inputFromMe = laik_trans_isInGroup(t, a->inputGroup, myid);
 
-void tcp2_exec(Laik_ActionSeq* as)
+    Laik_Mapping* fromMap = 0;
+    if (inputFromMe) {
+        assert(tc->fromList && (a->fromMapNo < tc->fromList->count));
+        fromMap = &(tc->fromList->map[a->fromMapNo]);
+    }
+    Laik_Mapping* toMap = 0;
+    if (laik_trans_isInGroup(t, a->outputGroup, myid)) {
+        assert(tc->toList && (a->toMapNo < tc->toList->count));
+        toMap = &(tc->toList->map[a->toMapNo]);
+    }
+
+    // reduce phase: reduce process first, then processes with input
+    int inCount = laik_trans_groupCount(t, a->inputGroup);
+    int part[inCount + 1];
+    int n = 0, vrank = -1;
+    part[n++] = reduceTask;
+    for(int i = 0; i < inCount; i++) {
+        int inTask = laik_trans_taskInGroup(t, a->inputGroup, i);
+        if (inTask == reduceTask) continue;
+        part[n++] = inTask;
+    }
+    for(int i = 0; i < n; i++)
+        if (part[i] == myid) vrank = i;
+
+    if (vrank >= 0) {
+        // leafs send their input, others need space for partial results
+        Laik_Mapping tmpMap;
+        Laik_Mapping* acc = fromMap;
+        Laik_ReductionOperation op = a->redOp;
+        bool hasChild = ((vrank & 1) == 0) && (vrank + 1 < n);
+        if (hasChild || (vrank == 0)) {
+            if (toMap)
+                acc = toMap;
+            else {
+                init_tmp_map(&tmpMap, tc->data, a->range);
+                acc = &tmpMap;
+            }
+            if (!inputFromMe)
+                op = LAIK_RO_None; // first receive overwrites
+            else if (fromMap != acc)
+                laik_data_copy(a->range, fromMap, acc);
+        }
+
+        for(int mask = 1; mask < n; mask <<= 1) {
+            if (vrank & mask) {
+                int toLID = laik_group_locationid(t->group, part[vrank - mask]);
+                laik_log(1, "  tree reduce: send to T%d (LID %d)",
+                         part[vrank - mask], toLID);
+                send_range(acc, a->range, toLID);
+                break;
+            }
+            if (vrank + mask >= n) continue;
+
+            int fromLID = laik_group_locationid(t->group, part[vrank + mask]);
+            laik_log(1, "  tree reduce: recv + %s from T%d (LID %d)",
+                     (op == LAIK_RO_None) ? "overwrite":"reduce",
+                     part[vrank + mask], fromLID);
+            recv_range(a->range, fromLID, acc, op);
+            op = a->redOp; // eventually reset to reduction op from None
+        }
+        if (acc == &tmpMap)
+            free_tmp_map(&tmpMap);
+    }
+
+    // broadcast phase over output group, starting at reduce process
+    if (!toMap) return;
+    n = laik_trans_groupCount(t, a->outputGroup);
+    vrank = pos_in_group(t, a->outputGroup, myid);
+    assert(vrank >= 0);
+
+    int mask = 1;
+    for(; mask < n; mask <<= 1) {
+        if ((vrank & mask) == 0) continue;
+
+        int fromLID = lid_in_group(t, a->outputGroup, vrank - mask);
+        laik_log(1, "  tree bcast: recv from LID %d", fromLID);
+        recv_range(a->range, fromLID, toMap, LAIK_RO_None);
+        break;
+    }
+    for(mask >>= 1; mask > 0; mask >>= 1) {
+        if (vrank + mask >= n) continue;
+
+        int toLID = lid_in_group(t, a->outputGroup, vrank + mask);
+        laik_log(1, "  tree bcast: send to LID %d", toLID);
+        send_range(toMap, a->range, toLID);
+    }
+}
+
+/* all-reduce with recursive doubling (input group = output group)
+ *
+ * In each of log(n) steps, pairs of processes exchange partial results and
+ * reduce. Both partners send before receiving, which requires eager sending
+ * (see flow control). If n is not a power of 2, processes beyond the largest
+ * power of 2 hand over their input before, and get the result afterwards.
+ */
+static
+void exec_reduce_rd(Laik_TransitionContext* tc,
+                    Laik_BackendAction* a)
+{
+    Laik_Transition* t = tc->transition;
+    int n = laik_trans_groupCount(t, a->outputGroup);
+    int vrank = pos_in_group(t, a->outputGroup, t->group->myid);
+    if (vrank < 0) return;
+
+    assert(tc->fromList && (a->fromMapNo < tc->fromList->count));
+    Laik_Mapping* fromMap = &(tc->fromList->map[a->fromMapNo]);
+    assert(tc->toList && (a->toMapNo < tc->toList->count));
+    Laik_Mapping* m = &(tc->toList->map[a->toMapNo]);
+    if (fromMap != m)
+        laik_data_copy(a->range, fromMap, m);
+
+    int p2 = 1;
+    while(2 * p2 <= n) p2 *= 2;
+
+    if (vrank >= p2) {
+        int lid = lid_in_group(t, a->outputGroup, vrank - p2);
+        laik_log(1, "  rec.doubling: hand over to LID %d", lid);
+        send_range(m, a->range, lid);
+        recv_range(a->range, lid, m, LAIK_RO_None);
+        return;
+    }
+
+    int extraLID = -1;
+    if (vrank + p2 < n) {
+        extraLID = lid_in_group(t, a->outputGroup, vrank + p2);
+        laik_log(1, "  rec.doubling: take over from LID %d", extraLID);
+        recv_range(a->range, extraLID, m, a->redOp);
+    }
+
+    for(int mask = 1; mask < p2; mask <<= 1) {
+        int lid = lid_in_group(t, a->outputGroup, vrank ^ mask);
+        laik_log(1, "  rec.doubling: exchange with LID %d", lid);
+        send_range(m, a->range, lid);
+        recv_range(a->range, lid, m, a->redOp);
+    }
+
+    if (extraLID >= 0)
+        send_range(m, a->range, extraLID);
+}
+
+// set <c> to chunk <k> of <n> chunks of range <r>, split in outermost dimension
+static
+void ring_chunk(Laik_Range* r, int k, int n, Laik_Range* c)
+{
+    int d = r->space->dims - 1;
+    int64_t ext = r->to.i[d] - r->from.i[d];
+    *c = *r;
+    c->from.i[d] = r->from.i[d] + ext * k / n;
+    c->to.i[d] = r->from.i[d] + ext * (k + 1) / n;
+}
+
+/* all-reduce with ring algorithm (input group = output group)
+ *
+ * The range is split into n chunks. In n-1 reduce-scatter steps, each process
+ * sends one chunk to its right neighbor and reduces another chunk received
+ * from its left neighbor, ending up with one fully reduced chunk. In n-1
+ * allgather steps, the reduced chunks are passed around the ring. Each process
+ * only sends 2(n-1)/n of the data, best for large vectors. Processes at even
+ * positions send first, odd ones receive first, to avoid cyclic waiting.
+ */
+static
+void exec_reduce_ring(Laik_TransitionContext* tc,
+                      Laik_BackendAction* a)
+{
+    Laik_Transition* t = tc->transition;
+    int n = laik_trans_groupCount(t, a->outputGroup);
+    int vrank = pos_in_group(t, a->outputGroup, t->group->myid);
+    if (vrank < 0) return;
+
+    assert(tc->fromList && (a->fromMapNo < tc->fromList->count));
+    Laik_Mapping* fromMap = &(tc->fromList->map[a->fromMapNo]);
+    assert(tc->toList && (a->toMapNo < tc->toList->count));
+    Laik_Mapping* m = &(tc->toList->map[a->toMapNo]);
+    if (fromMap != m)
+        laik_data_copy(a->range, fromMap, m);
+
+    int rightLID = lid_in_group(t, a->outputGroup, (vrank + 1) % n);
+    int leftLID = lid_in_group(t, a->outputGroup, (vrank + n - 1) % n);
+    laik_log(1, "  ring: left LID %d, right LID %d", leftLID, rightLID);
+
+    Laik_Range sc, rc;
+    for(int step = 0; step < 2 * (n - 1); step++) {
+        // from step n-1 on: allgather, received chunks are final
+        bool gather = (step >= n - 1);
+        int s = gather ? (vrank + 1 + n - (step - n + 1)) % n : (vrank + n - step) % n;
+        Laik_ReductionOperation op = gather ? LAIK_RO_None : a->redOp;
+        ring_chunk(a->range, s, n, &sc);
+        ring_chunk(a->range, (s + n - 1) % n, n, &rc);
+        if ((vrank & 1) == 0) {
+            send_range(m, &sc, rightLID);
+            recv_range(&rc, leftLID, m, op);
+        }
+        else {
+            recv_range(&rc, leftLID, m, op);
+            send_range(m, &sc, rightLID);
+        }
+    }
+}
+
+// host part of location string "[L<lid>:]<host>:<pid>", returns length
+static
+int location_host(char* loc, char** host)
+{
+    char* first = strchr(loc, ':');
+    char* last = strrchr(loc, ':');
+    if (!first) {
+        *host = loc;
+        return (int) strlen(loc);
+    }
+    *host = (first != last) ? first + 1 : loc;
+    return (int) (last - *host);
+}
+
+// set node ID for location IDs of tasks in group <g>: LID of first task in
+// <g> on the same host, or first LID of emulated node with d->nodes LIDs
+static
+void calc_nodes(InstData* d, Laik_Group* g, int* node)
+{
+    for(int i = 0; i < g->size; i++) {
+        int lid = g->locationid[i];
+        node[lid] = lid;
+        if (d->nodes > 1) {
+            node[lid] = lid - lid % d->nodes;
+            continue;
+        }
+        char *host, *h;
+        int len = location_host(d->peer[lid].location, &host);
+        for(int j = 0; j < i; j++) {
+            int lid2 = g->locationid[j];
+            int len2 = location_host(d->peer[lid2].location, &h);
+            if ((len == len2) && (strncmp(host, h, len) == 0)) {
+                node[lid] = node[lid2];
+                break;
+            }
+        }
+    }
+}
+
+/* node-aware reduction
+ *
+ * The leader of a node is the process with smallest id of the output group
+ * on that node (see laik_trans_nodeLeaders). Processes send their input to
+ * their leader, which reduces them and sends the partial result to the
+ * reduce process (the leader with smallest id), like in the linear variant.
+ * The result is sent back to the leaders, which forward it to processes in
+ * the output group on their node. Only leaders talk across nodes.
+ */
+static
+void exec_reduce_nodes(Laik_TransitionContext* tc,
+                       Laik_BackendAction* a, int* leader)
+{
+    Laik_Transition* t = tc->transition;
+    Laik_Group* g = t->group;
+    int myid = g->myid;
+    if (leader[myid] < 0) return;
+
+    bool inputFromMe = laik_trans_isInGroup(t, a->inputGroup, myid);
+    int myLeader = leader[myid];
+    if (myLeader != myid) {
+        int lid = laik_group_locationid(g, myLeader);
+        if (inputFromMe) {
+            laik_log(1, "  nodes: send to leader T%d (LID %d)", myLeader, lid);
+            assert(tc->fromList && (a->fromMapNo < tc->fromList->count));
+            send_range(&(tc->fromList->map[a->fromMapNo]), a->range, lid);
+        }
+        if (laik_trans_isInGroup(t, a->outputGroup, myid)) {
+            laik_log(1, "  nodes: recv from leader T%d (LID %d)", myLeader, lid);
+            assert(tc->toList && (a->toMapNo < tc->toList->count));
+            recv_range(a->range, lid, &(tc->toList->map[a->toMapNo]),
+                       LAIK_RO_None);
+        }
+        return;
+    }
+
+    // leaders always are in output group
+    assert(tc->toList && (a->toMapNo < tc->toList->count));
+    Laik_Mapping* m = &(tc->toList->map[a->toMapNo]);
+    Laik_ReductionOperation op = LAIK_RO_None;
+    if (inputFromMe) {
+        assert(tc->fromList && (a->fromMapNo < tc->fromList->count));
+        Laik_Mapping* fromMap = &(tc->fromList->map[a->fromMapNo]);
+        if (fromMap != m)
+            laik_data_copy(a->range, fromMap, m);
+        op = a->redOp;
+    }
+
+    // reduce inputs from my node
+    for(int task = 0; task < g->size; task++) {
+        if ((task == myid) || (leader[task] != myid)) continue;
+        if (!laik_trans_isInGroup(t, a->inputGroup, task)) continue;
+        int lid = laik_group_locationid(g, task);
+        laik_log(1, "  nodes: recv + %s from T%d (LID %d)",
+                 (op == LAIK_RO_None) ? "overwrite":"reduce", task, lid);
+        recv_range(a->range, lid, m, op);
+        op = a->redOp;
+    }
+    bool nodeInput = (op != LAIK_RO_None);
+
+    int reduceTask = laik_trans_taskInGroup(t, a->outputGroup, 0);
+    if (myid != reduceTask) {
+        int lid = laik_group_locationid(g, reduceTask);
+        if (nodeInput) {
+            laik_log(1, "  nodes: send to reduce T%d (LID %d)", reduceTask, lid);
+            send_range(m, a->range, lid);
+        }
+        laik_log(1, "  nodes: recv from reduce T%d (LID %d)", reduceTask, lid);
+        recv_range(a->range, lid, m, LAIK_RO_None);
+    }
+    else {
+        // reduce partial results from leaders of nodes with input
+        bool hasInput[g->size];
+        for(int task = 0; task < g->size; task++)
+            hasInput[task] = false;
+        for(int task = 0; task < g->size; task++)
+            if (laik_trans_isInGroup(t, a->inputGroup, task))
+                hasInput[leader[task]] = true;
+        for(int task = 0; task < g->size; task++) {
+            if ((task == myid) || !hasInput[task]) continue;
+            int lid = laik_group_locationid(g, task);
+            laik_log(1, "  nodes: recv + %s from leader T%d (LID %d)",
+                     (op == LAIK_RO_None) ? "overwrite":"reduce", task, lid);
+            recv_range(a->range, lid, m, op);
+            op = a->redOp;
+        }
+        for(int task = 0; task < g->size; task++) {
+            if ((task == myid) || (leader[task] != task)) continue;
+            int lid = laik_group_locationid(g, task);
+            laik_log(1, "  nodes: send result to leader T%d (LID %d)", task, lid);
+            send_range(m, a->range, lid);
+        }
+    }
+
+    // forward result to processes in output group on my node
+    for(int task = 0; task < g->size; task++) {
+        if ((task == myid) || (leader[task] != myid)) continue;
+        if (!laik_trans_isInGroup(t, a->outputGroup, task)) continue;
+        int lid = laik_group_locationid(g, task);
+        laik_log(1, "  nodes: send result to T%d (LID %d)", task, lid);
+        send_range(m, a->range, lid);
+    }
+}
+
+// group reduction: select algorithm by group shape and message size,
+// unless forced by LAIK_TCP2_REDUCE
+static
+void exec_reduce(Laik_TransitionContext* tc,
+                 Laik_BackendAction* a)
+{
+    assert(a->h.type == LAIK_AT_MapGroupReduce);
+    Laik_Transition* t = tc->transition;
+    InstData* d = (InstData*)instance->backend_data;
+
+    // all-reduce if same input and output group
+    int inCount = laik_trans_groupCount(t, a->inputGroup);
+    int outCount = laik_trans_groupCount(t, a->outputGroup);
+    bool allreduce = (a->inputGroup == a->outputGroup) ||
+                     ((inCount == t->group->size) && (outCount == t->group->size));
+
+    // recursive doubling requires eager sending
+    uint64_t bytes = (uint64_t) a->count * tc->data->elemsize;
+    bool rdPossible = allreduce && d->accept_bin_data && (bytes <= d->credit);
+    // ring requires at least one row per process in outermost dimension
+    int dim = a->range->space->dims - 1;
+    bool ringPossible = allreduce && (outCount > 2) &&
+                        (a->range->to.i[dim] - a->range->from.i[dim] >= outCount);
+
+    // node-aware if tasks share nodes; in auto mode, only across nodes
+    int leader[t->group->size];
+    int leaders = 0;
+    bool nodesPossible = false;
+    if (d->nodes > 0) {
+        int node[instance->locations];
+        calc_nodes(d, t->group, node);
+        nodesPossible = laik_trans_nodeLeaders(t, a->inputGroup,
+                                               a->outputGroup, node, leader);
+        for(int task = 0; task < t->group->size; task++)
+            if (leader[task] == task) leaders++;
+    }
+
+    ReduceAlg alg = d->reduce_alg;
+    if (alg == RA_Auto) {
+        if (nodesPossible && (leaders > 1) &&
+            !(ringPossible && (bytes > REDUCE_RD_MAX)))
+            alg = RA_Nodes;
+        else if (rdPossible && (bytes <= REDUCE_RD_MAX))
+            alg = RA_RecDoubling;
+        else if (ringPossible)
+            alg = RA_Ring;
+        else
+            alg = RA_Tree;
+    }
+    if ((alg == RA_RecDoubling) && !rdPossible) alg = RA_Tree;
+    if ((alg == RA_Ring) && !ringPossible) alg = RA_Tree;
+    if ((alg == RA_Nodes) && !nodesPossible) alg = RA_Tree;
+
+    switch(alg) {
+    case RA_Linear:
+        laik_log(1, "  reduce: linear");
+        exec_reduce_linear(tc, a);
+        break;
+    case RA_RecDoubling:
+        laik_log(1, "  reduce: recursive doubling");
+        exec_reduce_rd(tc, a);
+        break;
+    case RA_Ring:
+        laik_log(1, "  reduce: ring");
+        exec_reduce_ring(tc, a);
+        break;
+    case RA_Nodes:
+        laik_log(1, "  reduce: node-aware, %d leaders", leaders);
+        exec_reduce_nodes(tc, a, leader);
+        break;
+    default:
+        laik_log(1, "  reduce: binomial tree");
+        exec_reduce_tree(tc, a);
+        break;
+    }
+}
+
+
+// open connections to peers referenced by actions in <as>
+static
+void connect_aseq(InstData* d, Laik_ActionSeq* as)
+{
+    bool want[MAX_PEERS];
+    memset(want, 0, sizeof(want));
+
+    Laik_Action* a = as->action;
+    for(unsigned int i = 0; i < as->actionCount; i++, a = nextAction(a)) {
+        Laik_TransitionContext* tc = as->context[a->tid];
+        Laik_Transition* t = tc->transition;
+        switch(a->type) {
+        case LAIK_AT_MapPackAndSend: {
+            Laik_A_MapPackAndSend* aa = (Laik_A_MapPackAndSend*) a;
+            want[laik_group_locationid(t->group, aa->to_rank)] = true;
+            break;
+        }
+        case LAIK_AT_MapRecvAndUnpack: {
+            Laik_A_MapRecvAndUnpack* aa = (Laik_A_MapRecvAndUnpack*) a;
+            want[laik_group_locationid(t->group, aa->from_rank)] = true;
+            break;
+        }
+        case LAIK_AT_MapGroupReduce: {
+            // communication partners depend on reduction algorithm
+            Laik_BackendAction* aa = (Laik_BackendAction*) a;
+            for(int task = 0; task < t->group->size; task++)
+                if (laik_trans_isInGroup(t, aa->inputGroup, task) ||
+                    laik_trans_isInGroup(t, aa->outputGroup, task))
+                    want[laik_group_locationid(t->group, task)] = true;
+            break;
+        }
+        default:
+            break;
+        }
+    }
+    connect_peers(d, want);
+}
+
+static
+void exec_aseq(Laik_ActionSeq* as)
 {
     if (as->actionCount == 0) {
         laik_log(1, "TCP2 exec: nothing to do\n");
@@ -2340,11 +4381,21 @@ void tcp2_exec(Laik_ActionSeq* as)
 
         laik_aseq_calc_stats(as);
         as->backend = 0; // this tells LAIK that no cleanup needed
+
+        InstData* d = (InstData*)instance->backend_data;
+        if (d->connect_mode == CM_Neighbors)
+            connect_aseq(d, as);
     }
 
-    Laik_TransitionContext* tc = as->context[0];
+    // compression statistics are collected per execution
+    InstData* d = (InstData*)instance->backend_data;
+    d->exec_as = as;
+    as->byteCompRawCount = 0;
+    as->byteCompCount = 0;
+
     Laik_Action* a = as->action;
     for(unsigned int i = 0; i < as->actionCount; i++, a = nextAction(a)) {
+        Laik_TransitionContext* tc = as->context[a->tid];
         switch(a->type) {
         case LAIK_AT_MapPackAndSend: {
             Laik_A_MapPackAndSend* aa = (Laik_A_MapPackAndSend*) a;
@@ -2380,9 +4431,12 @@ void tcp2_exec(Laik_ActionSeq* as)
             break;
         }
     }
+    d->exec_as = 0;
 }
 
-void tcp2_sync(Laik_KVStore* kvs)
+// KVS sync with text commands via master, used if binary data is disabled
+static
+void sync_kvs_text(Laik_KVStore* kvs)
 {
     char msg[100];
     InstData* d = (InstData*)instance->backend_data;
@@ -2467,7 +4521,171 @@ void tcp2_sync(Laik_KVStore* kvs)
     d->kvs = 0;
 }
 
-void tcp2_make_progress()
+// send KVS changes <c> as one binary frame to <lid>
+static
+void send_kvs_changes(InstData* d, int lid, Laik_KVS_Changes* c)
+{
+    uint32_t cnt[2] = { (uint32_t) c->offUsed, (uint32_t) c->dataUsed };
+    uint64_t len = sizeof(cnt) + cnt[0] * sizeof(int) + cnt[1];
+    char hdr[9];
+    hdr[0] = 'K';
+    for(int i = 1; i < 9; i++)
+        hdr[i] = (char) ((len >> (8 * (i - 1))) & 255);
+
+    laik_log(1, "TCP2 sending %d KVS changes (%d bytes) to LID %d",
+             c->offUsed / 2, c->dataUsed, lid);
+    struct iovec iov[4];
+    iov[0].iov_base = hdr;
+    iov[0].iov_len = sizeof(hdr);
+    iov[1].iov_base = cnt;
+    iov[1].iov_len = sizeof(cnt);
+    iov[2].iov_base = c->off;
+    iov[2].iov_len = cnt[0] * sizeof(int);
+    iov[3].iov_base = c->data;
+    iov[3].iov_len = cnt[1];
+    send_binv(d, lid, iov, 4);
+}
+
+// wait for frame with KVS changes from <lid>, store into <c> (sorted)
+static
+void recv_kvs_changes(InstData* d, int lid, Laik_KVS_Changes* c)
+{
+    Peer* p = &(d->peer[lid]);
+    while((p->kvs_buf == 0) || (p->kvs_got < p->kvs_len)) {
+        if ((p->state == PS_Error) || (p->state == PS_Dead)) {
+            laik_panic("TCP2 lost connection during KVS sync");
+            exit(1); // not actually needed, laik_panic never returns
+        }
+        run_loop(d);
+    }
+
+    uint32_t cnt[2];
+    assert(p->kvs_len >= sizeof(cnt));
+    memcpy(cnt, p->kvs_buf, sizeof(cnt));
+    assert(p->kvs_len == sizeof(cnt) + cnt[0] * sizeof(int) + cnt[1]);
+    laik_log(1, "TCP2 got %d KVS changes (%d bytes) from LID %d",
+             cnt[0] / 2, cnt[1], lid);
+
+    laik_kvs_changes_set_size(c, 0, 0); // fresh reuse
+    if (cnt[0] > 0) {
+        laik_kvs_changes_ensure_size(c, (int) cnt[0], (int) cnt[1]);
+        memcpy(c->off, p->kvs_buf + sizeof(cnt), cnt[0] * sizeof(int));
+        memcpy(c->data, p->kvs_buf + sizeof(cnt) + cnt[0] * sizeof(int), cnt[1]);
+        laik_kvs_changes_set_size(c, (int) cnt[0], (int) cnt[1]);
+        laik_kvs_changes_sort(c);
+    }
+    free(p->kvs_buf);
+    p->kvs_buf = 0;
+}
+
+// KVS sync via binomial tree over processes of world: merged changes are
+// gathered at process 0 and broadcast back, both in log(size) steps
+static
+void sync_kvs(Laik_KVStore* kvs)
+{
+    InstData* d = (InstData*)instance->backend_data;
+    Laik_Group* world = instance->world;
+    int myid = world->myid;
+    int size = world->size;
+    if (myid < 0) return; // not part of world
+
+    for(int i = 0; i < size; i++) {
+        int lid = laik_group_locationid(world, i);
+        if (!d->peer[lid].accepts_bin_data) {
+            sync_kvs_text(kvs);
+            return;
+        }
+    }
+
+    // own changes: latest value of each updated entry, sorted for merging
+    Laik_KVS_Changes own, merged, recvd;
+    laik_kvs_changes_init(&own);
+    laik_kvs_changes_init(&merged);
+    laik_kvs_changes_init(&recvd);
+    int count = 0;
+    for(unsigned int i = 0; i < kvs->used; i++) {
+        Laik_KVS_Entry* e = &(kvs->entry[i]);
+        if (!e->updated || (e->value == 0)) continue;
+        laik_kvs_changes_add(&own, e->key, (int) e->vlen, e->value, true, false);
+        count++;
+    }
+    laik_kvs_changes_sort(&own);
+    laik_log(1, "TCP2 syncing KVS '%s' with %d own changes", kvs->name, count);
+
+    // gather: merge changes from children (myid + mask), send to parent
+    Laik_KVS_Changes *src = &merged, *dst = &own, *tmp;
+    int mask = 1;
+    while(mask < size) {
+        if (myid & mask) {
+            send_kvs_changes(d, laik_group_locationid(world, myid - mask), dst);
+            break;
+        }
+        if (myid + mask < size) {
+            recv_kvs_changes(d, laik_group_locationid(world, myid + mask), &recvd);
+            // swap src/dst: now merging can overwrite dst
+            tmp = src; src = dst; dst = tmp;
+            laik_kvs_changes_merge(dst, src, &recvd);
+        }
+        mask <<= 1;
+    }
+
+    // broadcast: get final changes from parent, forward to children
+    Laik_KVS_Changes* res = dst;
+    if (myid > 0) {
+        recv_kvs_changes(d, laik_group_locationid(world, myid - mask), &recvd);
+        res = &recvd;
+    }
+    for(mask >>= 1; mask > 0; mask >>= 1)
+        if (myid + mask < size)
+            send_kvs_changes(d, laik_group_locationid(world, myid + mask), res);
+
+    laik_kvs_changes_apply(res, kvs);
+    laik_log(1, "TCP2 synced %d changes for KVS %s", res->offUsed / 2, kvs->name);
+
+    laik_kvs_changes_free(&own);
+    laik_kvs_changes_free(&merged);
+    laik_kvs_changes_free(&recvd);
+}
+
+// wait until all eager data sent was consumed by receivers, signaled by
+// returned credit. Without this, we may close connections before receivers
+// even accepted them. Similarly, wait for answers to shared memory requests:
+// closing a connection with unread input resets it, dropping data in flight
+void tcp2_finalize(Laik_Instance* inst)
+{
+    InstData* d = (InstData*)inst->backend_data;
+    if (d->use_thread)
+        stop_progress_thread(d);
+    free(d->zbuf);
+    d->zbuf = 0;
+
+    for(int lid = 0; lid <= d->maxid; lid++) {
+        Peer* p = &(d->peer[lid]);
+        if (lid == d->mylid) continue;
+        while(((p->scredit < d->credit) || (p->shm_state == SHM_Pending)) &&
+              (p->fd >= 0) && (p->state != PS_Error) && (p->state != PS_Dead))
+            run_loop(d);
+        free(p->ebuf);
+        p->ebuf = 0;
+
+        // the peer keeps its mapping of rings still in use
+        if (p->sname) {
+            shm_unlink(p->sname);
+            free(p->sname);
+            p->sname = 0;
+        }
+        if (p->sring)
+            munmap(p->sring, sizeof(ShmRing) + p->sring->size);
+        if (p->rring)
+            munmap(p->rring, sizeof(ShmRing) + p->rring->size);
+        p->sring = 0;
+        p->rring = 0;
+        p->shm_state = SHM_None;
+    }
+}
+
+static
+void make_progress()
 {
     // process incoming commands
     InstData* d = (InstData*)instance->backend_data;
@@ -2475,19 +4693,20 @@ void tcp2_make_progress()
 
     // collect register requests into join list
     // make sure to do this only once: change state
-    for(int fd = 0; fd < MAX_FDS; fd++) {
-        switch(d->fds[fd].state) {
+    for(int fd = 0; fd < d->fdsSize; fd++) {
+        if (!d->fds[fd]) continue;
+        switch(d->fds[fd]->state) {
             case PS_RegReceived:
-                d->fds[fd].state = PS_RegReceived2;
-                laik_add_join_req(instance, &(d->fds[fd]));
+                d->fds[fd]->state = PS_RegReceived2;
+                laik_add_join_req(instance, d->fds[fd]);
                 break;
             case PS_CutoffReceived:
                 // replay
                 laik_log(1, "TCP2 make progress: replay cutoff '%s' from FD %d",
-                        d->fds[fd].cmd, fd);
-                got_cutoff(d, fd, d->fds[fd].cmd);
-                free(d->fds[fd].cmd);
-                d->fds[fd].cmd = 0;
+                        d->fds[fd]->cmd, fd);
+                got_cutoff(d, fd, d->fds[fd]->cmd);
+                free(d->fds[fd]->cmd);
+                d->fds[fd]->cmd = 0;
                 break;
             default:
                 break;
@@ -2495,7 +4714,8 @@ void tcp2_make_progress()
     }
 }
 
-void tcp2_finish_resize()
+static
+void finish_resize()
 {
     // a resize must have been started
     assert(instance->world && instance->world->parent);
@@ -2516,7 +4736,8 @@ void tcp2_finish_resize()
 
 
 // return new group on process size change (global sync)
-Laik_Group* tcp2_resize(Laik_ResizeRequests* resizeReqs)
+static
+Laik_Group* resize_world(Laik_ResizeRequests* resizeReqs)
 {
     char msg[150];
 
@@ -2640,8 +4861,8 @@ Laik_Group* tcp2_resize(Laik_ResizeRequests* resizeReqs)
             Laik_ResizeRequest* req = &(resizeReqs->req[i]);
             if (req->is_join_req) {
                 FDState* fds = (FDState*) req->backend_data;
-                int fd = fds - d->fds;
-                assert(&(d->fds[fd]) == fds);
+                int fd = fds->fd;
+                assert(d->fds[fd] == fds);
                 assert(fds->state == PS_RegReceived2);
                 assert(fds->lid < 0);
                 assert(fds->cmd);
@@ -2680,7 +4901,7 @@ Laik_Group* tcp2_resize(Laik_ResizeRequests* resizeReqs)
         // <lid> is an old process
         sprintf(msg, "id %d %s %s %d %s", lid,
                 d->peer[lid].location, d->peer[lid].host, d->peer[lid].port,
-                d->peer[lid].accepts_bin_data ? "b":"-");
+                peer_flags(&(d->peer[lid])));
         for(int to_lid = 1; to_lid <= d->maxid; to_lid++) {
             if (d->peer[to_lid].state != PS_RegAccepted) continue;
             assert(lid != to_lid);
@@ -2693,7 +4914,7 @@ Laik_Group* tcp2_resize(Laik_ResizeRequests* resizeReqs)
         if (d->peer[lid].state != PS_RegAccepted) continue;
         sprintf(msg, "newid %d %s %s %d %s", lid,
                 d->peer[lid].location, d->peer[lid].host, d->peer[lid].port,
-                d->peer[lid].accepts_bin_data ? "b":"-");
+                peer_flags(&(d->peer[lid])));
         for(int to_lid = 1; to_lid <= d->maxid; to_lid++) {
             if (d->peer[to_lid].state == PS_Dead) continue;
             if (lid == to_lid) continue;
@@ -2746,7 +4967,7 @@ Laik_Group* tcp2_resize(Laik_ResizeRequests* resizeReqs)
 
     // finish resize
     if ((added > 0) || (to_remove > 0)) epoch++;
-    sprintf(msg, "phase %d %d", phase, epoch);
+    sprintf(msg, "phase %d %d %llu", phase, epoch, (unsigned long long) d->credit);
     for(int lid = 1; lid <= d->maxid; lid++) {
         if (d->peer[lid].state == PS_Dead) continue;
         send_cmd(d, lid, msg);
@@ -2810,4 +5031,50 @@ Laik_Group* tcp2_resize(Laik_ResizeRequests* resizeReqs)
     return g;
 }
 
+
+// backend interface: instance data is locked against the progress thread
+
+void tcp2_exec(Laik_ActionSeq* as)
+{
+    InstData* d = (InstData*)instance->backend_data;
+    lock_inst(d);
+    exec_aseq(as);
+    unlock_inst(d);
+}
+
+void tcp2_sync(Laik_KVStore* kvs)
+{
+    InstData* d = (InstData*)instance->backend_data;
+    lock_inst(d);
+    sync_kvs(kvs);
+    unlock_inst(d);
+}
+
+void tcp2_make_progress()
+{
+    InstData* d = (InstData*)instance->backend_data;
+    lock_inst(d);
+    make_progress();
+    unlock_inst(d);
+}
+
+void tcp2_finish_resize()
+{
+    InstData* d = (InstData*)instance->backend_data;
+    lock_inst(d);
+    finish_resize();
+    unlock_inst(d);
+}
+
+Laik_Group* tcp2_resize(Laik_ResizeRequests* resizeReqs)
+{
+    InstData* d = (InstData*)instance->backend_data;
+    lock_inst(d);
+    Laik_Group* g = resize_world(resizeReqs);
+    if (g && (d->connect_mode == CM_All))
+        connect_all(d);
+    unlock_inst(d);
+    return g;
+}
+
 #endif // USE_TCP2
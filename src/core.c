@@ -281,6 +281,19 @@ void laik_addDataForInstance(Laik_Instance* inst, Laik_Data* d)
     inst->data_count++;
 }
 
+void laik_removeDataFromInstance(Laik_Instance* inst, Laik_Data* d)
+{
+    int i;
+    for(i = 0; i < inst->data_count; i++)
+        if (inst->data[i] == d) break;
+    assert(i < inst->data_count); // not found, should not happen
+
+    // keep order of remaining containers
+    for(i++; i < inst->data_count; i++)
+        inst->data[i - 1] = inst->data[i];
+    inst->data_count--;
+}
+
 
 // create a group to be used in this LAIK instance
 Laik_Group* laik_create_group(Laik_Instance* i, int maxsize)
@@ -25,17 +25,25 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <pthread.h>
+#include <unistd.h>
 
 
 // provided allocators
 Laik_Allocator *laik_allocator_def = 0;
 
+// reuse transitions/action sequences when switching (LAIK_TRANSCACHE)
+static bool transCacheEnabled = true;
+
 
 // initialize the LAIK data module, called from laik_new_instance
 void laik_data_init()
 {
     laik_type_init();
 
+    char* str = getenv("LAIK_TRANSCACHE");
+    if (str) transCacheEnabled = (atoi(str) != 0);
+
     // default allocator used by containers
     laik_allocator_def = laik_new_allocator_def();
 }
@@ -76,6 +84,12 @@ Laik_SwitchStat* laik_newSwitchStat()
     ss->initOpCount = 0;
     ss->reduceOpCount = 0;
     ss->byteBufCopyCount = 0;
+    ss->byteCompRawCount = 0;
+    ss->byteCompCount = 0;
+
+    ss->transCacheHits = 0;
+    ss->aseqCacheHits = 0;
+    ss->transCacheMisses = 0;
 
     return ss;
 }
@@ -107,6 +121,12 @@ void laik_addSwitchStat(Laik_SwitchStat* target, Laik_SwitchStat* src)
     target->initOpCount        += src->initOpCount;
     target->reduceOpCount      += src->reduceOpCount;
     target->byteBufCopyCount   += src->byteBufCopyCount;
+    target->byteCompRawCount   += src->byteCompRawCount;
+    target->byteCompCount      += src->byteCompCount;
+
+    target->transCacheHits     += src->transCacheHits;
+    target->aseqCacheHits      += src->aseqCacheHits;
+    target->transCacheMisses   += src->transCacheMisses;
 }
 
 void laik_switchstat_addASeq(Laik_SwitchStat* target, Laik_ActionSeq* as)
@@ -128,6 +148,8 @@ void laik_switchstat_addASeq(Laik_SwitchStat* target, Laik_ActionSeq* as)
     target->initOpCount        += as->initOpCount;
     target->reduceOpCount      += as->reduceOpCount;
     target->byteBufCopyCount   += as->byteBufCopyCount;
+    target->byteCompRawCount   += as->byteCompRawCount;
+    target->byteCompCount      += as->byteCompCount;
 }
 
 void laik_switchstat_malloc(Laik_SwitchStat* ss, uint64_t bytes)
@@ -185,6 +207,11 @@ Laik_Data* laik_new_data(Laik_Space* space, Laik_Type* type)
     d->map0_base = 0;
     d->map0_size = 0;
 
+    for(int i = 0; i < TRANSCACHE_ENTRIES; i++)
+        d->transCache[i].t = 0;
+    d->transCacheUse = 0;
+    d->pendingSwitch = 0;
+
     laik_log(1, "new data '%s':\n"
              "  type '%s' (elemsize %d), space '%s' (%lu elems, %.3f MB)\n",
              d->name, type->name, d->elemsize, space->name,
@@ -774,10 +801,39 @@ Laik_ActionSeq* createTransASeq(Laik_Data* d, Laik_Transition* t,
     return as;
 }
 
+// create action sequence for transition and let backend prepare it for
+// given mappings. Mappings are remembered in context: executing the
+// sequence is only allowed with same mappings. <reuse> tells the backend
+// whether the sequence will be executed multiple times
+static
+Laik_ActionSeq* prepareTransASeq(Laik_Data* d, Laik_Transition* t,
+                                 Laik_MappingList* fromList,
+                                 Laik_MappingList* toList, bool reuse)
+{
+    Laik_ActionSeq* as = createTransASeq(d, t, fromList, toList);
+    as->reuse = reuse;
+    const Laik_Backend* backend = d->space->inst->backend;
+    if (backend->prepare) {
+        (backend->prepare)(as);
+
+        // remember mappings at prepare time
+        Laik_TransitionContext* tc = as->context[0];
+        tc->prepFromList = fromList;
+        tc->prepToList = toList;
+    }
+    else {
+        // for statistics: usually called in backend prepare function
+        laik_aseq_calc_stats(as);
+    }
 
+    return as;
+}
+
+
+// first part of doing a transition on a container: allocate new mappings
 static
-void doTransition(Laik_Data* d, Laik_Transition* t, Laik_ActionSeq* as,
-                  Laik_MappingList* fromList, Laik_MappingList* toList)
+void startTransition(Laik_Data* d, Laik_Transition* t,
+                     Laik_MappingList* fromList, Laik_MappingList* toList)
 {
     if (d->stat) {
         d->stat->switches++;
@@ -785,14 +841,8 @@ void doTransition(Laik_Data* d, Laik_Transition* t, Laik_ActionSeq* as,
             d->stat->switches_noactions++;
     }
 
-    if (t == 0) {
-        // no transition to exec, just free old mappings
-
-        // only free mappings if not part of a reservation
-        if (fromList->res == 0)
-            freeMappingList(fromList, d->stat);
-        return;
-    }
+    // no transition to exec: nothing to prepare
+    if (t == 0) return;
 
     // be careful when reusing mappings:
     // the backend wants to send/receive data in arbitrary order
@@ -805,20 +855,112 @@ void doTransition(Laik_Data* d, Laik_Transition* t, Laik_ActionSeq* as,
 
     // allocate space for mappings for which reuse is not possible
     allocateMappings(toList, d->stat);
+}
+
+// local copy/init actions of a transition
+static
+void localTransitionOps(Laik_Data* d, Laik_Transition* t,
+                        Laik_MappingList* fromList, Laik_MappingList* toList)
+{
+    // local copy actions
+    if (t->localCount > 0)
+        copyMaps(t, toList, fromList, d->stat);
+
+    // local init action
+    if (t->initCount > 0)
+        initMaps(t, toList, fromList, d->stat);
+}
+
+// free old mappings after a transition
+static
+void freeOldMappings(Laik_Data* d, Laik_MappingList* fromList)
+{
+    if (fromList) {
+        // only free mappings if not part of a reservation
+        if (fromList->res == 0)
+            freeMappingList(fromList, d->stat);
+    }
+}
+
+// last part of doing a transition on a container, after the backend
+// executed the action sequence: local copy/init actions, free old mappings
+static
+void finishTransition(Laik_Data* d, Laik_Transition* t,
+                      Laik_MappingList* fromList, Laik_MappingList* toList)
+{
+    if (t)
+        localTransitionOps(d, t, fromList, toList);
+
+    // free old mapping/partitioning
+    freeOldMappings(d, fromList);
+}
+
+// call backend function <f> on action sequence <as>, with profiling
+static
+void callBackend(Laik_Instance* inst,
+                 void (*f)(Laik_ActionSeq*), Laik_ActionSeq* as)
+{
+    if (inst->profiling->do_profiling)
+        inst->profiling->timer_backend = laik_wtime();
+
+    f(as);
+
+    if (inst->profiling->do_profiling)
+        inst->profiling->time_backend += laik_wtime() - inst->profiling->timer_backend;
+}
+
+// let backend execute an action sequence
+static
+void execASeq(Laik_Instance* inst, Laik_ActionSeq* as)
+{
+    callBackend(inst, inst->backend->exec, as);
+}
+
+// provide current mappings to the context of an already prepared action
+// sequence <as>, which must have actions for transition <t> on <d>
+static
+void setASeqMappings(Laik_ActionSeq* as, Laik_Data* d, Laik_Transition* t,
+                     Laik_MappingList* fromList, Laik_MappingList* toList)
+{
+    Laik_TransitionContext* tc = as->context[0];
+    assert(tc->data == d);
+    assert(tc->transition == t);
+    tc->toList = toList;
+    tc->fromList = fromList;
+    // if sequence was prepared with mappings, they must be the same
+    if (tc->prepFromList) assert(tc->prepFromList == fromList);
+    if (tc->prepToList) assert(tc->prepToList == toList);
+}
+
+// no other switch of a container allowed while a split-phase switch is
+// outstanding
+static
+void checkNoPendingSwitch(Laik_Data* d, const char* func)
+{
+    if (d->pendingSwitch) {
+        laik_log(LAIK_LL_Panic, "%s: split-phase switch of data '%s' pending",
+                 func, d->name);
+        exit(1);
+    }
+}
+
+static
+void doTransition(Laik_Data* d, Laik_Transition* t, Laik_ActionSeq* as,
+                  Laik_MappingList* fromList, Laik_MappingList* toList)
+{
+    startTransition(d, t, fromList, toList);
+
+    if (t == 0) {
+        // no transition to exec, just free old mappings
+        finishTransition(d, t, fromList, toList);
+        return;
+    }
 
     bool doASeqCleanup = false;
     if (as) {
         // we are given a prepared action sequence:
         // check that <as> has actions for given transition
-        Laik_TransitionContext* tc = as->context[0];
-        assert(tc->data == d);
-        assert(tc->transition == t);
-        // provide current mappings to context
-        tc->toList = toList;
-        tc->fromList = fromList;
-        // if sequence was prepared with mappings, they must be the same
-        if (tc->prepFromList) assert(tc->prepFromList == fromList);
-        if (tc->prepToList) assert(tc->prepToList == toList);
+        setASeqMappings(as, d, t, fromList, toList);
     }
     else {
         // create the action sequence for requested transition on the fly
@@ -837,16 +979,7 @@ void doTransition(Laik_Data* d, Laik_Transition* t, Laik_ActionSeq* as,
 
     if (t->sendCount + t->recvCount + t->redCount > 0) {
         // let backend do send/recv/reduce actions
-
-        Laik_Instance* inst = d->space->inst;
-        if (inst->profiling->do_profiling)
-            inst->profiling->timer_backend = laik_wtime();
-
-        (inst->backend->exec)(as);
-
-        if (inst->profiling->do_profiling)
-            inst->profiling->time_backend += laik_wtime() - inst->profiling->timer_backend;
-
+        execASeq(d->space->inst, as);
     }
 
     if (d->stat)
@@ -855,22 +988,422 @@ void doTransition(Laik_Data* d, Laik_Transition* t, Laik_ActionSeq* as,
     if (doASeqCleanup)
         laik_aseq_free(as);
 
-    // local copy actions
-    if (t->localCount > 0)
-        copyMaps(t, toList, fromList, d->stat);
+    finishTransition(d, t, fromList, toList);
+}
 
-    // local init action
-    if (t->initCount > 0)
-        initMaps(t, toList, fromList, d->stat);
 
-    // free old mapping/partitioning
-    if (fromList) {
-        // only free mappings if not part of a reservation
-        if (fromList->res == 0)
-            freeMappingList(fromList, d->stat);
+//
+// Batch cache
+//
+// Action sequences combining transitions of multiple containers in a
+// batch switch (see laik_switchto_batch) are cached as well, keyed by the
+// switch requests combined into one sequence, ie. the tuples (data,
+// from/to partitioning, data flow, reduction operation). As for single
+// containers, this is only done if mappings are stable. Transitions used
+// are owned by the transition caches of the containers: when any of them
+// gets freed, cached sequences using it are dropped.
+
+#define BATCHCACHE_ENTRIES 4
+
+// one switch request combined into a cached batch action sequence
+typedef struct _BatchCacheKey {
+    Laik_Data* data;
+    Laik_Partitioning *fromP, *toP;
+    Laik_DataFlow flow;
+    Laik_ReductionOperation redOp;
+    Laik_Transition* t; // from transition cache of <data>, 0 if nothing to do
+    Laik_MappingList *fromList, *toList;
+} BatchCacheKey;
+
+typedef struct _BatchCacheEntry {
+    int count; // number of requests combined, entry unused if 0
+    BatchCacheKey key[ASEQ_CONTEXTS_MAX];
+    Laik_ActionSeq* as;
+    bool doExec; // any transition with send/recv/reduce actions?
+    unsigned int lastUse; // for LRU replacement
+} BatchCacheEntry;
+
+static BatchCacheEntry batchCache[BATCHCACHE_ENTRIES];
+static unsigned int batchCacheUse = 0;
+
+static
+void freeBatchCacheEntry(BatchCacheEntry* e)
+{
+    laik_aseq_free(e->as);
+    e->as = 0;
+    e->count = 0;
+}
+
+// drop cached batch action sequences referring to container <d>,
+// partitioning <p>, transition <t>, or mappings of reservation <r>
+// (ignored if 0)
+static
+void invalidateBatchCache(Laik_Data* d, Laik_Partitioning* p,
+                          Laik_Transition* t, Laik_Reservation* r)
+{
+    for(int i = 0; i < BATCHCACHE_ENTRIES; i++) {
+        BatchCacheEntry* e = &(batchCache[i]);
+        for(int j = 0; j < e->count; j++) {
+            BatchCacheKey* k = &(e->key[j]);
+            if ((d && (k->data == d)) ||
+                (p && ((k->fromP == p) || (k->toP == p))) ||
+                (t && (k->t == t)) ||
+                (r && ((k->fromList && (k->fromList->res == r)) ||
+                       (k->toList && (k->toList->res == r))))) {
+                freeBatchCacheEntry(e);
+                break;
+            }
+        }
+    }
+}
+
+// find cached action sequence for batch of <count> requests given by <key>
+static
+BatchCacheEntry* findBatchCacheEntry(int count, BatchCacheKey* key)
+{
+    batchCacheUse++;
+    for(int i = 0; i < BATCHCACHE_ENTRIES; i++) {
+        BatchCacheEntry* e = &(batchCache[i]);
+        if (e->count != count) continue;
+
+        int j;
+        for(j = 0; j < count; j++) {
+            BatchCacheKey* k1 = &(e->key[j]);
+            BatchCacheKey* k2 = &(key[j]);
+            if ((k1->data != k2->data) ||
+                (k1->fromP != k2->fromP) || (k1->toP != k2->toP) ||
+                (k1->flow != k2->flow) || (k1->redOp != k2->redOp) ||
+                (k1->t != k2->t) ||
+                (k1->fromList != k2->fromList) || (k1->toList != k2->toList))
+                break;
+        }
+        if (j < count) continue;
+
+        e->lastUse = batchCacheUse;
+        return e;
+    }
+    return 0;
+}
+
+// insert action sequence <as> for batch given by <key> into cache,
+// replacing the least recently used entry if cache is full
+static
+void insertBatchCacheEntry(int count, BatchCacheKey* key,
+                           Laik_ActionSeq* as, bool doExec)
+{
+    BatchCacheEntry* victim = 0;
+    for(int i = 0; i < BATCHCACHE_ENTRIES; i++) {
+        BatchCacheEntry* e = &(batchCache[i]);
+        if (e->count == 0) {
+            victim = e;
+            break;
+        }
+        if (!victim || (e->lastUse < victim->lastUse))
+            victim = e;
+    }
+
+    if (victim->count > 0) {
+        laik_log(1, "batch cache: evict sequence of %d switches",
+                 victim->count);
+        freeBatchCacheEntry(victim);
+    }
+    victim->count = count;
+    for(int j = 0; j < count; j++)
+        victim->key[j] = key[j];
+    victim->as = as;
+    victim->doExec = doExec;
+    victim->lastUse = batchCacheUse;
+}
+
+
+//
+// Transition cache
+//
+// Switching between the same partitionings happens again and again in
+// iterative applications. To avoid recalculating transitions and action
+// sequences on each switch, they are cached per container, keyed by
+// (from/to partitioning, data flow, reduction operation). Prepared
+// action sequences have addresses of mappings embedded, and thus are
+// only kept if mappings are stable, ie. allocated from reservations.
+
+static
+void freeTransCacheEntry(Laik_TransCacheEntry* e)
+{
+    invalidateBatchCache(0, 0, e->t, 0);
+    if (e->as) laik_aseq_free(e->as);
+    laik_free_transition(e->t);
+    e->t = 0;
+    e->as = 0;
+}
+
+// remove all cached transitions of container <d>
+static
+void flushTransCache(Laik_Data* d)
+{
+    for(int i = 0; i < TRANSCACHE_ENTRIES; i++)
+        if (d->transCache[i].t)
+            freeTransCacheEntry(&(d->transCache[i]));
+}
+
+// invalidate cached transitions referring to partitioning <p>
+void laik_data_invalidate_partitioning(Laik_Partitioning* p)
+{
+    Laik_Instance* inst = p->space->inst;
+    invalidateBatchCache(0, p, 0, 0);
+    for(int i = 0; i < inst->data_count; i++) {
+        Laik_Data* d = inst->data[i];
+        for(int j = 0; j < TRANSCACHE_ENTRIES; j++) {
+            Laik_TransCacheEntry* e = &(d->transCache[j]);
+            if (e->t == 0) continue;
+            if ((e->fromP != p) && (e->toP != p)) continue;
+
+            laik_log(1, "transition cache of data '%s': invalidate '%s'",
+                     d->name, e->t->name);
+            freeTransCacheEntry(e);
+        }
+    }
+}
+
+// drop action sequences prepared for mappings of reservation <r>
+static
+void invalidateReservationASeqs(Laik_Reservation* r)
+{
+    Laik_Data* d = r->data;
+    invalidateBatchCache(0, 0, 0, r);
+    for(int i = 0; i < TRANSCACHE_ENTRIES; i++) {
+        Laik_TransCacheEntry* e = &(d->transCache[i]);
+        if (e->as == 0) continue;
+        if ((e->fromList && (e->fromList->res == r)) ||
+            (e->toList && (e->toList->res == r))) {
+            laik_aseq_free(e->as);
+            e->as = 0;
+        }
+    }
+}
+
+// mappings are stable if allocated from a reservation
+static
+bool isStableMappingList(Laik_MappingList* ml)
+{
+    return (ml == 0) || (ml->res != 0);
+}
+
+// find cache entry for transition of container <d>, 0 if not found
+static
+Laik_TransCacheEntry* findTransCacheEntry(Laik_Data* d,
+                                          Laik_Partitioning* fromP,
+                                          Laik_Partitioning* toP,
+                                          Laik_DataFlow flow,
+                                          Laik_ReductionOperation redOp)
+{
+    Laik_Group* group = fromP ? fromP->group : toP->group;
+    for(int i = 0; i < TRANSCACHE_ENTRIES; i++) {
+        Laik_TransCacheEntry* e = &(d->transCache[i]);
+        if (e->t == 0) continue;
+        if ((e->fromP == fromP) && (e->toP == toP) &&
+            (e->flow == flow) && (e->redOp == redOp) &&
+            (e->t->group == group))
+            return e;
     }
+    return 0;
 }
 
+// insert transition <t> into cache of container <d>, replacing the
+// least recently used entry if cache is full
+static
+Laik_TransCacheEntry* insertTransCacheEntry(Laik_Data* d, Laik_Transition* t)
+{
+    Laik_TransCacheEntry* victim = 0;
+    for(int i = 0; i < TRANSCACHE_ENTRIES; i++) {
+        Laik_TransCacheEntry* e = &(d->transCache[i]);
+        if (e->t == 0) {
+            victim = e;
+            break;
+        }
+        if (!victim || (e->lastUse < victim->lastUse))
+            victim = e;
+    }
+
+    if (victim->t) {
+        laik_log(1, "transition cache of data '%s': evict '%s'",
+                 d->name, victim->t->name);
+        freeTransCacheEntry(victim);
+    }
+    victim->fromP = t->fromPartitioning;
+    victim->toP = t->toPartitioning;
+    victim->flow = t->flow;
+    victim->redOp = t->redOp;
+    victim->t = t;
+    victim->as = 0;
+    victim->fromList = 0;
+    victim->toList = 0;
+    victim->lastUse = d->transCacheUse;
+
+    return victim;
+}
+
+// get cache entry for switching container <d> to partitioning <toP>.
+// Calculates and inserts the transition if not found. Returns 0 if the
+// transition is invalid (this task not part of the group)
+static
+Laik_TransCacheEntry* getTransCacheEntry(Laik_Data* d, Laik_Partitioning* toP,
+                                         Laik_DataFlow flow,
+                                         Laik_ReductionOperation redOp)
+{
+    Laik_Partitioning* fromP = d->activePartitioning;
+
+    d->transCacheUse++;
+    Laik_TransCacheEntry* e = findTransCacheEntry(d, fromP, toP, flow, redOp);
+    if (e) {
+        e->lastUse = d->transCacheUse;
+        if (d->stat) d->stat->transCacheHits++;
+        return e;
+    }
+
+    if (d->stat) d->stat->transCacheMisses++;
+    Laik_Transition* t = do_calc_transition(d->space, fromP, toP, flow, redOp);
+    if (t == 0) return 0;
+
+    return insertTransCacheEntry(d, t);
+}
+
+// get prepared action sequence for cache entry <e> and given mappings.
+// Returns 0 if mappings are not stable: an action sequence then needs
+// to be created for each switch
+static
+Laik_ActionSeq* getTransCacheASeq(Laik_Data* d, Laik_TransCacheEntry* e,
+                                  Laik_MappingList* fromList,
+                                  Laik_MappingList* toList)
+{
+    if (!isStableMappingList(fromList) || !isStableMappingList(toList))
+        return 0;
+
+    if (e->as && (e->fromList == fromList) && (e->toList == toList)) {
+        if (d->stat) d->stat->aseqCacheHits++;
+        return e->as;
+    }
+
+    // mappings changed (e.g. other reservation), prepare again
+    if (e->as) laik_aseq_free(e->as);
+    e->as = prepareTransASeq(d, e->t, fromList, toList, true);
+    e->fromList = fromList;
+    e->toList = toList;
+
+    return e->as;
+}
+
+
+// planning of switches in advance, using worker threads
+
+// a transition to calculate by a worker thread
+typedef struct _PlanItem {
+    Laik_SwitchRequest* req;
+    Laik_Transition* t;
+} PlanItem;
+
+// work shared among worker threads
+typedef struct _PlanWork {
+    PlanItem* item;
+    int count;
+    int next; // next item to work on, atomically incremented
+} PlanWork;
+
+static
+void* planWorker(void* arg)
+{
+    PlanWork* w = (PlanWork*) arg;
+
+    // each thread needs its own planner context
+    Laik_TransPlanner* tp = laik_transplanner_new();
+    while(1) {
+        int i = __sync_fetch_and_add(&(w->next), 1);
+        if (i >= w->count) break;
+
+        PlanItem* pi = &(w->item[i]);
+        Laik_SwitchRequest* r = pi->req;
+        pi->t = laik_transplanner_calc(tp, r->data->space, r->fromP, r->toP,
+                                       r->flow, r->redOp);
+    }
+    laik_transplanner_free(tp);
+
+    return 0;
+}
+
+// calculate transitions for switches in advance, concurrently using
+// <threads> worker threads, and store them in transition caches
+void laik_plan_switches(int n, Laik_SwitchRequest* req, int threads)
+{
+    if (!transCacheEnabled) return;
+
+    // collect transitions not yet in caches
+    PlanWork w;
+    w.item = malloc(n * sizeof(PlanItem));
+    if (!w.item) {
+        laik_panic("Out of memory allocating memory for planning switches");
+        exit(1); // not actually needed, laik_panic never returns
+    }
+    w.count = 0;
+    w.next = 0;
+    for(int i = 0; i < n; i++) {
+        Laik_SwitchRequest* r = &(req[i]);
+        assert(r->toP != 0);
+        // switches between different groups are not cached
+        if (r->fromP && (r->fromP->group != r->toP->group)) continue;
+        if (findTransCacheEntry(r->data, r->fromP, r->toP,
+                                r->flow, r->redOp)) continue;
+
+        // lazy calculations must be done before running concurrently
+        laik_transplanner_prepare(r->fromP, r->toP);
+
+        w.item[w.count].req = r;
+        w.item[w.count].t = 0;
+        w.count++;
+    }
+
+    if (threads <= 0)
+        threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads > w.count) threads = w.count;
+    // debug logging during calculation is not thread-safe
+    if (laik_log_shown(1)) threads = 1;
+
+    laik_log(1, "plan %d switches: %d transitions to calculate, %d threads",
+             n, w.count, threads);
+
+    if (threads <= 1)
+        planWorker(&w);
+    else {
+        pthread_t* thread = malloc(threads * sizeof(pthread_t));
+        assert(thread != 0);
+        for(int i = 0; i < threads; i++) {
+            int err = pthread_create(&(thread[i]), 0, planWorker, &w);
+            if (err) {
+                laik_panic("Cannot create thread for planning switches");
+                exit(1); // not actually needed, laik_panic never returns
+            }
+        }
+        for(int i = 0; i < threads; i++)
+            pthread_join(thread[i], 0);
+        free(thread);
+    }
+
+    // store calculated transitions in caches of containers
+    for(int i = 0; i < w.count; i++) {
+        PlanItem* pi = &(w.item[i]);
+        if (pi->t == 0) continue; // this task not part of group
+
+        Laik_SwitchRequest* r = pi->req;
+        // same switch may be requested multiple times
+        if (findTransCacheEntry(r->data, r->fromP, r->toP,
+                                r->flow, r->redOp)) {
+            laik_free_transition(pi->t);
+            continue;
+        }
+        insertTransCacheEntry(r->data, pi->t);
+    }
+    free(w.item);
+}
+
+
 // make data container aware of reservation
 void laik_data_use_reservation(Laik_Data* d, Laik_Reservation* r)
 {
@@ -937,6 +1470,9 @@ void laik_reservation_add(Laik_Reservation* r, Laik_Partitioning* p)
 // free reservation and the memory space allocated
 void laik_reservation_free(Laik_Reservation* r)
 {
+    // cached action sequences may refer to mappings of this reservation
+    invalidateReservationASeqs(r);
+
     for(int i = 0; i < r->count; i++) {
         assert(r->entry[i].mList != 0);
         free(r->entry[i].mList);
@@ -1194,6 +1730,8 @@ void laik_exec_transition(Laik_Data* d, Laik_Transition* t)
         laik_log_flush(" on data '%s'", d->name);
     }
 
+    checkNoPendingSwitch(d, "laik_exec_transition");
+
     // we only can execute transtion if start state in transition is correct
     if (d->activePartitioning != t->fromPartitioning) {
         laik_panic("laik_exec_transition starts in wrong partitioning!");
@@ -1224,20 +1762,7 @@ Laik_ActionSeq* laik_calc_actions(Laik_Data* d,
         toList = laik_reservation_getMList(toRes, t->toPartitioning);
 
 
-    Laik_ActionSeq* as = createTransASeq(d, t, fromList, toList);
-    const Laik_Backend* backend = d->space->inst->backend;
-    if (backend->prepare) {
-        (backend->prepare)(as);
-
-        // remember mappings at prepare time
-        Laik_TransitionContext* tc = as->context[0];
-        tc->prepFromList = fromList;
-        tc->prepToList = toList;
-    }
-    else {
-        // for statistics: usually called in backend prepare function
-        laik_aseq_calc_stats(as);
-    }
+    Laik_ActionSeq* as = prepareTransASeq(d, t, fromList, toList, true);
 
     if (laik_log_begin(2)) {
         laik_log_append("calculated ");
@@ -1261,6 +1786,8 @@ void laik_exec_actions(Laik_ActionSeq* as)
         laik_log_flush(" on data '%s'", d->name);
     }
 
+    checkNoPendingSwitch(d, "laik_exec_actions");
+
     // we only can execute transtion if start state in transition is correct
     if (d->activePartitioning != t->fromPartitioning) {
         laik_panic("laik_exec_actions starts in wrong partitioning!");
@@ -1295,6 +1822,8 @@ void laik_switchto_partitioning(Laik_Data* d,
                                 Laik_Partitioning* toP, Laik_DataFlow flow,
                                 Laik_ReductionOperation redOp)
 {
+    checkNoPendingSwitch(d, "laik_switchto_partitioning");
+
     // calculate actions to be done for switching
 
     Laik_Group *toGroup = 0, *fromGroup = 0, *commonGroup = 0;
@@ -1316,11 +1845,25 @@ void laik_switchto_partitioning(Laik_Data* d,
     }
 
     Laik_MappingList* toList = prepareMaps(d, toP);
-    Laik_Transition* t = do_calc_transition(d->space,
-                                            d->activePartitioning, toP,
-                                            flow, redOp);
 
-    doTransition(d, t, 0, d->activeMappings, toList);
+    if (transCacheEnabled && !commonGroup) {
+        // use cached transition, and action sequence if mappings are stable
+        Laik_TransCacheEntry* e = getTransCacheEntry(d, toP, flow, redOp);
+        Laik_Transition* t = e ? e->t : 0;
+        Laik_ActionSeq* as = 0;
+        if (t)
+            as = getTransCacheASeq(d, e, d->activeMappings, toList);
+
+        doTransition(d, t, as, d->activeMappings, toList);
+    }
+    else {
+        Laik_Transition* t = do_calc_transition(d->space,
+                                                d->activePartitioning, toP,
+                                                flow, redOp);
+
+        doTransition(d, t, 0, d->activeMappings, toList);
+        laik_free_transition(t);
+    }
 
     // if we migrated to common group before, migrate back
     if (commonGroup) {
@@ -1334,6 +1877,326 @@ void laik_switchto_partitioning(Laik_Data* d,
 }
 
 
+// switch multiple containers at once.
+// Transitions of all containers are executed with one action sequence,
+// enabling the backend to combine data going to the same peer into one
+// message. As an action sequence can have at most ASEQ_CONTEXTS_MAX
+// transition contexts, larger batches are split into multiple sequences.
+// Requests which cannot be part of a combined sequence (group change, or
+// an earlier request for the same container not yet done) are done
+// afterwards one by one. If mappings are stable (from reservations),
+// combined action sequences are cached for repeated batches (see batch
+// cache above)
+void laik_switchto_batch(int n, Laik_SwitchRequest* req)
+{
+    if (n <= 0) return;
+
+    // per request in batch: transition, mappings before/after switch
+    Laik_Transition** t = malloc(n * sizeof(Laik_Transition*));
+    Laik_MappingList** fromList = malloc(n * sizeof(Laik_MappingList*));
+    Laik_MappingList** toList = malloc(n * sizeof(Laik_MappingList*));
+    bool* inBatch = malloc(n * sizeof(bool));
+    bool* done = malloc(n * sizeof(bool));
+    if (!t || !fromList || !toList || !inBatch || !done) {
+        laik_panic("Out of memory allocating memory for batch switch");
+        exit(1); // not actually needed, laik_panic never returns
+    }
+
+    for(int i = 0; i < n; i++) {
+        Laik_Data* d = req[i].data;
+        done[i] = false;
+
+        checkNoPendingSwitch(d, "laik_switchto_batch");
+        if (req[i].fromP && (req[i].fromP != d->activePartitioning)) {
+            laik_log(LAIK_LL_Panic,
+                     "laik_switchto_batch: data '%s' not in start partitioning",
+                     d->name);
+            exit(1);
+        }
+        if (!d->activePartitioning && !req[i].toP) {
+            // nothing to switch from/to
+            done[i] = true;
+        }
+    }
+
+    while(1) {
+        // select requests for the batch: all transitions must be on same
+        // group, at most ASEQ_CONTEXTS_MAX of them
+        Laik_Group* group = 0;
+        Laik_Data* first = 0;
+        int count = 0;
+        for(int i = 0; i < n; i++) {
+            inBatch[i] = false;
+            if (done[i] || (count == ASEQ_CONTEXTS_MAX)) continue;
+
+            Laik_Data* d = req[i].data;
+            Laik_Partitioning* fromP = d->activePartitioning;
+            Laik_Partitioning* toP = req[i].toP;
+            if (fromP && toP && (fromP->group != toP->group)) continue;
+            Laik_Group* g = toP ? toP->group : fromP->group;
+            if (group && (g != group)) continue;
+
+            bool seen = false;
+            for(int j = 0; j < i; j++)
+                if (!done[j] && (req[j].data == d)) seen = true;
+            if (seen) continue;
+
+            group = g;
+            if (!first) first = d;
+            inBatch[i] = true;
+            count++;
+        }
+        if (count == 0) break;
+
+        // calculate transitions (from cache if enabled), allocate mappings.
+        // Key for batch cache: only used with cached transitions and
+        // stable mappings
+        BatchCacheKey key[ASEQ_CONTEXTS_MAX];
+        int keyCount = 0;
+        bool cacheable = transCacheEnabled;
+        for(int i = 0; i < n; i++) {
+            if (!inBatch[i]) continue;
+            Laik_Data* d = req[i].data;
+
+            toList[i] = prepareMaps(d, req[i].toP);
+            fromList[i] = d->activeMappings;
+            if (transCacheEnabled) {
+                Laik_TransCacheEntry* e;
+                e = getTransCacheEntry(d, req[i].toP, req[i].flow, req[i].redOp);
+                t[i] = e ? e->t : 0;
+            }
+            else
+                t[i] = do_calc_transition(d->space, d->activePartitioning,
+                                          req[i].toP, req[i].flow, req[i].redOp);
+
+            if (!isStableMappingList(fromList[i]) ||
+                !isStableMappingList(toList[i]))
+                cacheable = false;
+            BatchCacheKey* k = &(key[keyCount++]);
+            k->data = d;
+            k->fromP = d->activePartitioning;
+            k->toP = req[i].toP;
+            k->flow = req[i].flow;
+            k->redOp = req[i].redOp;
+            k->t = t[i];
+            k->fromList = fromList[i];
+            k->toList = toList[i];
+
+            startTransition(d, t[i], fromList[i], toList[i]);
+        }
+
+        Laik_Instance* inst = first->space->inst;
+        BatchCacheEntry* be = cacheable ? findBatchCacheEntry(keyCount, key) : 0;
+        Laik_ActionSeq* as;
+        bool doExec = false;
+        if (be) {
+            // same batch done before with same mappings: reuse sequence
+            as = be->as;
+            doExec = be->doExec;
+            if (first->stat) first->stat->aseqCacheHits++;
+        }
+        else {
+            // one action sequence with a context for each transition
+            as = laik_aseq_new(inst);
+            as->reuse = cacheable;
+            for(int i = 0; i < n; i++) {
+                if (!inBatch[i] || (t[i] == 0)) continue;
+
+                int tid = laik_aseq_addTContext(as, req[i].data, t[i],
+                                                fromList[i], toList[i]);
+                laik_aseq_addTExec(as, tid);
+                if (t[i]->sendCount + t[i]->recvCount + t[i]->redCount > 0)
+                    doExec = true;
+            }
+            laik_aseq_activateNewActions(as);
+
+            if (as->contextCount > 0) {
+                if (inst->backend->prepare)
+                    (inst->backend->prepare)(as);
+                else {
+                    // for statistics: usually called in backend prepare function
+                    laik_aseq_calc_stats(as);
+                }
+            }
+            if (cacheable)
+                insertBatchCacheEntry(keyCount, key, as, doExec);
+        }
+
+        if (as->contextCount > 0) {
+            if (laik_log_begin(1)) {
+                laik_log_append("batch switch of %d containers: ",
+                                as->contextCount);
+                laik_log_ActionSeq(as, laik_log_shown(1));
+                laik_log_flush(0);
+            }
+
+            if (doExec)
+                execASeq(inst, as);
+
+            // statistics of combined sequence go to first container
+            if (first->stat)
+                laik_switchstat_addASeq(first->stat, as);
+        }
+        if (!cacheable)
+            laik_aseq_free(as);
+
+        for(int i = 0; i < n; i++) {
+            if (!inBatch[i]) continue;
+            Laik_Data* d = req[i].data;
+
+            finishTransition(d, t[i], fromList[i], toList[i]);
+            if (!transCacheEnabled)
+                laik_free_transition(t[i]);
+
+            // set new mapping/partitioning active
+            d->activePartitioning = req[i].toP;
+            d->activeMappings = toList[i];
+            done[i] = true;
+        }
+    }
+
+    // remaining requests are done one by one, in given order
+    for(int i = 0; i < n; i++) {
+        if (done[i]) continue;
+        laik_switchto_partitioning(req[i].data, req[i].toP,
+                                   req[i].flow, req[i].redOp);
+    }
+
+    free(t);
+    free(fromList);
+    free(toList);
+    free(inBatch);
+    free(done);
+}
+
+// start a split-phase switch of container <d> to partitioning <toP>
+Laik_SwitchHandle* laik_switch_begin(Laik_Data* d, Laik_Partitioning* toP,
+                                     Laik_DataFlow flow,
+                                     Laik_ReductionOperation redOp)
+{
+    checkNoPendingSwitch(d, "laik_switch_begin");
+
+    Laik_SwitchHandle* h = malloc(sizeof(Laik_SwitchHandle));
+    if (!h) {
+        laik_panic("Out of memory allocating Laik_SwitchHandle object");
+        exit(1); // not actually needed, laik_panic never returns
+    }
+    h->data = d;
+    h->t = 0;
+    h->as = 0;
+    h->fromList = 0;
+    h->toList = 0;
+    h->ownTransition = false;
+    h->ownASeq = false;
+    h->commPending = false;
+
+    Laik_Partitioning* fromP = d->activePartitioning;
+    if (fromP && toP && (fromP->group != toP->group)) {
+        // group change: no split-phase support, do complete switch now
+        laik_switchto_partitioning(d, toP, flow, redOp);
+    }
+    else if (fromP || toP) {
+        Laik_Instance* inst = d->space->inst;
+        const Laik_Backend* backend = inst->backend;
+
+        h->fromList = d->activeMappings;
+        h->toList = prepareMaps(d, toP);
+
+        Laik_TransCacheEntry* e = 0;
+        if (transCacheEnabled) {
+            e = getTransCacheEntry(d, toP, flow, redOp);
+            h->t = e ? e->t : 0;
+        }
+        else {
+            h->t = do_calc_transition(d->space, fromP, toP, flow, redOp);
+            h->ownTransition = true;
+        }
+        Laik_Transition* t = h->t;
+
+        startTransition(d, t, h->fromList, h->toList);
+
+        if (t) {
+            // prepared on all processes as with complete switches:
+            // backends may do collective setup when preparing
+            if (e)
+                h->as = getTransCacheASeq(d, e, h->fromList, h->toList);
+            if (h->as)
+                setASeqMappings(h->as, d, t, h->fromList, h->toList);
+            else {
+                h->as = prepareTransASeq(d, t, h->fromList, h->toList,
+                                         false);
+                h->ownASeq = true;
+            }
+        }
+
+        if (t && (t->sendCount + t->recvCount + t->redCount > 0)) {
+            // without split-phase support, execution is completed here
+            if (backend->exec_start) {
+                callBackend(inst, backend->exec_start, h->as);
+                h->commPending = true;
+            }
+            else
+                execASeq(inst, h->as);
+        }
+
+        // local copy/init actions, while messages are in flight
+        if (t)
+            localTransitionOps(d, t, h->fromList, h->toList);
+
+        // set new mapping/partitioning active
+        d->activePartitioning = toP;
+        d->activeMappings = h->toList;
+    }
+
+    d->pendingSwitch = h;
+    return h;
+}
+
+// make progress on a split-phase switch, return true if completed
+bool laik_switch_test(Laik_SwitchHandle* h)
+{
+    if (!h->commPending) return true;
+
+    Laik_Instance* inst = h->data->space->inst;
+    if (!inst->backend->exec_test) return false;
+
+    if (inst->profiling->do_profiling)
+        inst->profiling->timer_backend = laik_wtime();
+
+    if ((inst->backend->exec_test)(h->as))
+        h->commPending = false;
+
+    if (inst->profiling->do_profiling)
+        inst->profiling->time_backend += laik_wtime() - inst->profiling->timer_backend;
+
+    return !h->commPending;
+}
+
+// complete a split-phase switch and free the handle
+void laik_switch_end(Laik_SwitchHandle* h)
+{
+    Laik_Data* d = h->data;
+    assert(d->pendingSwitch == h);
+
+    if (h->commPending) {
+        Laik_Instance* inst = d->space->inst;
+        if (inst->backend->exec_finish)
+            callBackend(inst, inst->backend->exec_finish, h->as);
+    }
+
+    if (h->as && d->stat)
+        laik_switchstat_addASeq(d->stat, h->as);
+    if (h->ownASeq)
+        laik_aseq_free(h->as);
+    if (h->ownTransition && h->t)
+        laik_free_transition(h->t);
+
+    freeOldMappings(d, h->fromList);
+
+    d->pendingSwitch = 0;
+    free(h);
+}
+
 // switch to another data flow, keep partitioning
 void laik_switchto_flow(Laik_Data* d,
                         Laik_DataFlow flow, Laik_ReductionOperation redOp)
@@ -1618,6 +2481,10 @@ void laik_free(Laik_Data* d)
 {
     // TODO: free space, partitionings
 
+    flushTransCache(d);
+    invalidateBatchCache(d, 0, 0, 0);
+    laik_removeDataFromInstance(d->space->inst, d);
+
     free(d);
 }
 
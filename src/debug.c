@@ -320,6 +320,10 @@ void laik_log_SwitchStat(Laik_SwitchStat* ss)
 {
     laik_log_append("%d switches (%d without actions, %d transitions)\n",
                     ss->switches, ss->switches_noactions, ss->transitionCount);
+    if (ss->transCacheHits + ss->transCacheMisses > 0)
+        laik_log_append("    trans cache: %d hits (%d with action seq), %d misses\n",
+                        ss->transCacheHits, ss->aseqCacheHits,
+                        ss->transCacheMisses);
     if (ss->switches == ss->switches_noactions) return;
 
     if (ss->mallocCount > 0) {
@@ -380,6 +384,14 @@ void laik_log_SwitchStat(Laik_SwitchStat* ss)
         laik_log_PrettyInt(ss->byteBufCopyCount);
         laik_log_append("B\n");
     }
+    if (ss->byteCompRawCount > 0) {
+        laik_log_append("    compress: ");
+        laik_log_PrettyInt(ss->byteCompRawCount);
+        laik_log_append("B raw => ");
+        laik_log_PrettyInt(ss->byteCompCount);
+        laik_log_append("B (%.1f%%)\n",
+                        100.0 * ss->byteCompCount / ss->byteCompRawCount);
+    }
 }
 
 char* laik_at_str(Laik_ActionType t)
@@ -729,11 +741,10 @@ void laik_log_ActionSeq(Laik_ActionSeq *as, bool showDetails)
     Laik_TransitionContext* tc = 0;
     for(int i = 0; i < as->contextCount; i++) {
         tc = as->context[i];
-        laik_log_append("  transition %d: ", 0);
+        laik_log_append("  transition %d: ", i);
         laik_log_Transition(tc->transition, false);
         laik_log_append(" on data '%s'\n", tc->data->name);
     }
-    assert(as->contextCount == 1);
     if (!showDetails) return;
 
     for(int i = 0; i < as->bufferCount; i++) {
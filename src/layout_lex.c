@@ -172,6 +172,37 @@ bool reuse_lex(Laik_Layout* l, int n, Laik_Layout* old, int nold)
 }
 
 
+// copy <n> consecutive elements of size <elemsize>.
+// Short runs (e.g. columns of 2d/3d halos) of common element sizes are
+// copied with fixed-size moves inlined by the compiler, avoiding one
+// library call per run; long runs use one bulk memcpy
+static inline
+void copy_elems(char* to, const char* from, uint64_t n, unsigned int elemsize)
+{
+    if (n * elemsize > 64) {
+        memcpy(to, from, n * elemsize);
+        return;
+    }
+
+    switch(elemsize) {
+    case 4:
+        for(uint64_t i = 0; i < n; i++)
+            memcpy(to + 4 * i, from + 4 * i, 4);
+        break;
+    case 8:
+        for(uint64_t i = 0; i < n; i++)
+            memcpy(to + 8 * i, from + 8 * i, 8);
+        break;
+    case 16:
+        for(uint64_t i = 0; i < n; i++)
+            memcpy(to + 16 * i, from + 16 * i, 16);
+        break;
+    default:
+        memcpy(to, from, n * elemsize);
+        break;
+    }
+}
+
 static
 void copy_lex(Laik_Range* range,
               Laik_Mapping* from, Laik_Mapping* to)
@@ -222,7 +253,7 @@ void copy_lex(Laik_Range* range,
         char *fromPtr2 = fromPtr;
         char *toPtr2 = toPtr;
         for(int64_t i2 = 0; i2 < count.i[1]; i2++) {
-            memcpy(toPtr2, fromPtr2, count.i[0] * elemsize);
+            copy_elems(toPtr2, fromPtr2, count.i[0], elemsize);
             fromPtr2 += fromLayoutEntry->stride[1] * elemsize;
             toPtr2   += toLayoutEntry->stride[1] * elemsize;
         }
@@ -303,28 +334,28 @@ unsigned int pack_lex(Laik_Mapping* m, Laik_Range* s,
     bool stop = false;
     for(; i2 < to2; i2++) {
         for(; i1 < to1; i1++) {
-            for(; i0 < to0; i0++) {
-                if (size < elemsize) {
-                    stop = true;
-                    break;
-                }
+            // elements left in this x-run, limited by buffer space
+            uint64_t n = (uint64_t) (to0 - i0);
+            if (n * elemsize > size) {
+                n = size / elemsize;
+                stop = true;
+            }
 
 #if DEBUG_PACK
-                laik_log(1, "packing (%lu/%lu/%lu) off %lu: %.3f, left %d",
-                         i0, i1, i2,
-                         (idxPtr - m->base)/elemsize, *(double*)idxPtr,
-                         size - elemsize);
+            laik_log(1, "packing (%lu/%lu/%lu) off %lu: %lu elems, left %d",
+                     i0, i1, i2, (idxPtr - m->base)/elemsize, n,
+                     size - (unsigned int) (n * elemsize));
 #endif
 
-                // copy element into buffer
-                memcpy(buf, idxPtr, elemsize);
+            // copy run of elements into buffer
+            copy_elems(buf, idxPtr, n, elemsize);
 
-                idxPtr += elemsize; // stride[0] is 1
-                size -= elemsize;
-                buf += elemsize;
-                count++;
+            idxPtr += n * elemsize; // stride[0] is 1
+            size -= (unsigned int) (n * elemsize);
+            buf += n * elemsize;
+            count += n;
+            i0 += n;
 
-            }
             if (stop) break;
             idxPtr += skip0 * elemsize;
             i0 = from0;
@@ -426,27 +457,28 @@ unsigned int unpack_lex(Laik_Mapping* m, Laik_Range* s,
     bool stop = false;
     for(; i2 < to2; i2++) {
         for(; i1 < to1; i1++) {
-            for(; i0 < to0; i0++) {
-                if (size < elemsize) {
-                    stop = true;
-                    break;
-                }
+            // elements left in this x-run, limited by buffer content
+            uint64_t n = (uint64_t) (to0 - i0);
+            if (n * elemsize > size) {
+                n = size / elemsize;
+                stop = true;
+            }
 
 #ifdef DEBUG_UNPACK
-                laik_log(1, "unpacking (%lu/%lu/%lu) off %lu: %.3f, left %d",
-                         i0, i1, i2,
-                         (idxPtr - m->base)/elemsize, *(double*)buf,
-                         size - elemsize);
+            laik_log(1, "unpacking (%lu/%lu/%lu) off %lu: %lu elems, left %d",
+                     i0, i1, i2, (idxPtr - m->base)/elemsize, n,
+                     size - (unsigned int) (n * elemsize));
 #endif
-                // copy element from buffer into local data
-                memcpy(idxPtr, buf, elemsize);
 
-                idxPtr += elemsize; // stride[0] is 1
-                size -= elemsize;
-                buf += elemsize;
-                count++;
+            // copy run of elements from buffer into local data
+            copy_elems(idxPtr, buf, n, elemsize);
+
+            idxPtr += n * elemsize; // stride[0] is 1
+            size -= (unsigned int) (n * elemsize);
+            buf += n * elemsize;
+            count += n;
+            i0 += n;
 
-            }
             if (stop) break;
             idxPtr += skip0 * elemsize;
             i0 = from0;
@@ -531,6 +563,77 @@ Laik_Layout* laik_new_layout_lex(int n, Laik_Range* ranges)
 }
 
 
+// is <l> a lexicographical layout?
+bool laik_layout_is_lex(Laik_Layout* l)
+{
+    return laik_is_layout_lex(l) != 0;
+}
+
+// is range <r> stored contiguously in lex layout <l>, map <n>?
+// This is the case e.g. for full rows of a 2d range, or full planes of
+// a 3d range. Then, lexicographical traversal of <r> (as used for packing)
+// is the same as memory order, and if <off> is given, it is set to the
+// offset of the first index of <r>.
+bool laik_layout_lex_contiguous(Laik_Layout* l, int n, Laik_Range* r, int64_t* off)
+{
+    Laik_Layout_Lex* ll = laik_is_layout_lex(l);
+    if (!ll) return false;
+    assert((n >= 0) && (n < l->map_count));
+
+    // offsets of first and last index must differ by element count
+    Laik_Index last;
+    for(int d = 0; d < l->dims; d++)
+        last.i[d] = r->to.i[d] - 1;
+    int64_t first = offset_lex(l, n, &(r->from));
+    if (offset_lex(l, n, &last) - first + 1 != (int64_t) laik_range_size(r))
+        return false;
+
+    if (off) *off = first;
+    return true;
+}
+
+// is range <r> stored in lex layout <l>, map <n>, as equally sized
+// contiguous blocks with a single stride? This is the case e.g. for partial
+// rows of a 2d range, or for full rows in some planes of a 3d range. Then,
+// set <off> to the offset of the first index of <r>, <count> to the number
+// of blocks, <blocklen> to the elements per block, and <stride> to the
+// distance of consecutive blocks (in elements). Contiguous ranges result
+// in <count> 1
+bool laik_layout_lex_strided(Laik_Layout* l, int n, Laik_Range* r,
+                             int64_t* off, uint64_t* count,
+                             uint64_t* blocklen, uint64_t* stride)
+{
+    Laik_Layout_Lex* ll = laik_is_layout_lex(l);
+    if (!ll) return false;
+    assert((n >= 0) && (n < l->map_count));
+
+    // merge inner dimensions filling strides into a contiguous block,
+    // dimensions of size 1 can be ignored
+    int d = 0;
+    *blocklen = 1;
+    for(; d < l->dims; d++) {
+        uint64_t size = (uint64_t) (r->to.i[d] - r->from.i[d]);
+        if (size == 1) continue;
+        if (ll->e[n].stride[d] != *blocklen) break;
+        *blocklen *= size;
+    }
+    // remaining dimensions must merge into one stride
+    *count = 1;
+    *stride = *blocklen;
+    for(; d < l->dims; d++) {
+        uint64_t size = (uint64_t) (r->to.i[d] - r->from.i[d]);
+        if (size == 1) continue;
+        if (*count == 1)
+            *stride = ll->e[n].stride[d];
+        else if (ll->e[n].stride[d] != *stride * *count)
+            return false;
+        *count *= size;
+    }
+
+    if (off) *off = offset_lex(l, n, &(r->from));
+    return true;
+}
+
 // return stride for dimension <d> in lex layout map <n>
 uint64_t laik_layout_lex_stride(Laik_Layout* l, int n, int d)
 {
@@ -293,6 +293,9 @@ Laik_Partitioning* laik_clone_empty_partitioning(Laik_Partitioning* p)
 // free resources allocated for a partitioning object
 void laik_free_partitioning(Laik_Partitioning* p)
 {
+    // cached transitions must not refer to freed partitioning
+    laik_data_invalidate_partitioning(p);
+
     RangeList_Entry* e = p->rangeList;
     while(e) {
         laik_rangelist_free(e->ranges);
@@ -591,6 +594,9 @@ void laik_partitioning_migrate(Laik_Partitioning* p, Laik_Group* newg)
     Laik_Group* oldg = p->group;
     if (oldg == newg) return;
 
+    // ranges get changed, cached transitions become invalid
+    laik_data_invalidate_partitioning(p);
+
     int* fromOld; // mapping of IDs from old group to new group
 
     if (newg->parent == oldg) {
@@ -48,6 +48,9 @@ Laik_RangeList* laik_rangelist_new(Laik_Space* space, unsigned int tid_count)
     list->map_off = 0;
     list->map_count = 0;
 
+    // spatial index calculated on first intersection query
+    list->idx = 0;
+
     return list;
 }
 
@@ -57,6 +60,7 @@ void laik_rangelist_free(Laik_RangeList* list)
     free(list->tss1d);
     free(list->off);
     free(list->map_off);
+    free(list->idx);
 }
 
 // does this cover the full space with one range for each process?
@@ -163,14 +167,21 @@ Laik_TaskRange* laik_rangelist_tidrange(Laik_RangeList* list, int tid, int n)
 // print verbose debug output?
 //#define DEBUG_COVERSPACE 1
 
-// TODO: use dynamic list
-#define COVERLIST_MAX 100
-static Laik_Range notcovered[COVERLIST_MAX];
-static int notcovered_count;
+// list grows dynamically, with many tasks the not-covered front is large
+static Laik_Range* notcovered = 0;
+static int notcovered_count = 0, notcovered_size = 0;
 
 static void appendToNotcovered(Laik_Range* s)
 {
-    assert(notcovered_count < COVERLIST_MAX);
+    if (notcovered_count == notcovered_size) {
+        // enlarge list
+        notcovered_size = (notcovered_size + 50) * 2;
+        notcovered = realloc(notcovered, notcovered_size * sizeof(Laik_Range));
+        if (!notcovered) {
+            laik_panic("Out of memory allocating memory for coversSpace");
+            exit(1); // not actually needed, laik_panic never returns
+        }
+    }
     notcovered[notcovered_count] = *s;
     notcovered_count++;
 }
@@ -246,7 +257,9 @@ bool laik_rangelist_coversSpace(Laik_RangeList* list)
 
         int count = notcovered_count; // number of ranges to visit
         for(int j = 0; j < count; j++) {
-            Laik_Range* orig = &(notcovered[j]);
+            // copy: appending may move the list
+            Laik_Range origRange = notcovered[j];
+            Laik_Range* orig = &origRange;
 
             if (laik_range_intersect(orig, toRemove) == 0) {
                 // range to remove does not overlap with orig: keep original
@@ -701,4 +714,80 @@ void laik_rangelist_migrate(Laik_RangeList* list, int* idmap, unsigned int new_c
     list->tid_count = new_count;
     sortRanges(list);
     updateOffsets(list);
+
+    // range offsets changed, spatial index needs recalculation
+    free(list->idx);
+    list->idx = 0;
+}
+
+
+// spatial index for intersection queries
+
+static int idx_cmp(const void *p1, const void *p2)
+{
+    const Laik_RangeIdxEntry* e1 = (const Laik_RangeIdxEntry*) p1;
+    const Laik_RangeIdxEntry* e2 = (const Laik_RangeIdxEntry*) p2;
+    if (e1->from != e2->from)
+        return (e1->from < e2->from) ? -1 : 1;
+    // keep order of range list for same start
+    return (e1->off < e2->off) ? -1 : 1;
+}
+
+void laik_rangelist_updateIndex(Laik_RangeList* list)
+{
+    // already calculated?
+    if (list->idx) return;
+
+    assert(list->off != 0);
+    assert(list->tss1d == 0);
+
+    list->idx = malloc((list->count + 1) * sizeof(Laik_RangeIdxEntry));
+    if (!list->idx) {
+        laik_panic("Out of memory allocating space for Laik_RangeList");
+        exit(1); // not actually needed, laik_panic never returns
+    }
+
+    for(unsigned int o = 0; o < list->count; o++) {
+        list->idx[o].from = list->trange[o].range.from.i[0];
+        list->idx[o].off = o;
+    }
+    qsort(list->idx, list->count, sizeof(Laik_RangeIdxEntry), idx_cmp);
+
+    // running maximum of range ends is monotonic, allows binary search
+    int64_t maxTo = INT64_MIN;
+    for(unsigned int i = 0; i < list->count; i++) {
+        int64_t to = list->trange[list->idx[i].off].range.to.i[0];
+        if (to > maxTo) maxTo = to;
+        list->idx[i].maxTo = maxTo;
+    }
+}
+
+// find ranges in <list> which may intersect with <range>.
+// Ranges before the first candidate end before <range> starts in dim 0,
+// ranges after the last candidate start after <range> ends in dim 0.
+// Candidates still need to be checked for intersection in all dims
+unsigned int laik_rangelist_candidates(Laik_RangeList* list,
+                                       const Laik_Range* range,
+                                       unsigned int* first)
+{
+    if (!list->idx)
+        laik_rangelist_updateIndex(list);
+
+    // first entry with maxTo > range start
+    unsigned int lo = 0, hi = list->count;
+    while(lo < hi) {
+        unsigned int mid = (lo + hi) / 2;
+        if (list->idx[mid].maxTo > range->from.i[0]) hi = mid;
+        else lo = mid + 1;
+    }
+    *first = lo;
+
+    // first entry with start >= range end
+    hi = list->count;
+    while(lo < hi) {
+        unsigned int mid = (lo + hi) / 2;
+        if (list->idx[mid].from >= range->to.i[0]) hi = mid;
+        else lo = mid + 1;
+    }
+    return lo - *first;
 }
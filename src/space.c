@@ -173,35 +173,43 @@ bool intersectRange(int64_t from1, int64_t to1, int64_t from2, int64_t to2,
     return true;
 }
 
-// get the intersection of two ranges; return 0 if intersection is empty
-Laik_Range* laik_range_intersect(const Laik_Range* r1, const Laik_Range* r2)
+// get the intersection of two ranges, written to <r>;
+// return 0 if intersection is empty, otherwise <r>
+Laik_Range* laik_range_intersect_r(const Laik_Range* r1, const Laik_Range* r2,
+                                   Laik_Range* r)
 {
-    static Laik_Range r;
-
     // intersection with invalid range gives invalid range
     if ((r1->space == 0) || (r2->space == 0)) {
-        r.space = 0;
-        return &r;
+        r->space = 0;
+        return r;
     }
 
     assert(r1->space == r2->space);
     int dims = r1->space->dims;
-    r.space = r1->space;
+    r->space = r1->space;
 
     if (!intersectRange(r1->from.i[0], r1->to.i[0],
                         r2->from.i[0], r2->to.i[0],
-                        &(r.from.i[0]), &(r.to.i[0])) ) return 0;
+                        &(r->from.i[0]), &(r->to.i[0])) ) return 0;
     if (dims>1) {
         if (!intersectRange(r1->from.i[1], r1->to.i[1],
                             r2->from.i[1], r2->to.i[1],
-                            &(r.from.i[1]), &(r.to.i[1])) ) return 0;
+                            &(r->from.i[1]), &(r->to.i[1])) ) return 0;
         if (dims>2) {
             if (!intersectRange(r1->from.i[2], r1->to.i[2],
                                 r2->from.i[2], r2->to.i[2],
-                                &(r.from.i[2]), &(r.to.i[2])) ) return 0;
+                                &(r->from.i[2]), &(r->to.i[2])) ) return 0;
         }
     }
-    return &r;
+    return r;
+}
+
+// get the intersection of two ranges; return 0 if intersection is empty
+// (result is stored in a static range, see laik_range_intersect_r)
+Laik_Range* laik_range_intersect(const Laik_Range* r1, const Laik_Range* r2)
+{
+    static Laik_Range r;
+    return laik_range_intersect_r(r1, r2, &r);
 }
 
 // expand range <dst> such that it contains <src>
@@ -682,41 +690,110 @@ bool laik_index_global2local(Laik_Partitioning* p,
 // helper functions for laik_calc_transition
 
 // TODO:
-// - quadratic complexity for 2d/3d spaces
 // - for 1d, does not cope with overlapping ranges belonging to same task
 
 // print verbose debug output for creating ranges for reductions?
 #define DEBUG_REDUCTIONRANGES 1
 
 
-static TaskGroup* groupList = 0;
-static int groupListSize = 0, groupListCount = 0;
+// range borders used for reductions: only for 1d
+typedef struct _RangeBorder {
+    int64_t b;
+    int task;
+    int rangeNo, mapNo;
+    unsigned int isStart :1;
+    unsigned int isInput :1;
+} RangeBorder;
+
+// pairs of range offsets (own range, range of other task) found to
+// intersect, to be sorted by task before appending send/recv operations
+typedef struct _RangePair {
+    int task;
+    unsigned int o1, o2;
+} RangePair;
+
+// context for calculating transitions, with temporary buffers.
+// Buffers are kept between calculations using the same planner.
+// Using a separate planner in each thread allows to calculate
+// transitions concurrently
+struct _Laik_TransPlanner {
+    TaskGroup* groupList;
+    int groupListSize, groupListCount;
+
+    RangeBorder* borderList;
+    int borderListSize, borderListCount;
+
+    struct localTOp *localBuf;
+    struct initTOp  *initBuf;
+    struct sendTOp  *sendBuf;
+    struct recvTOp  *recvBuf;
+    struct redTOp   *redBuf;
+    int localBufSize, localBufCount;
+    int initBufSize, initBufCount;
+    int sendBufSize, sendBufCount;
+    int recvBufSize, recvBufCount;
+    int redBufSize, redBufCount;
+
+    RangePair* pairList;
+    int pairListSize, pairListCount;
+
+    // tasks with a range equal to a given range, usually very few
+    int* eqTaskList;
+    int eqTaskListSize, eqTaskListCount;
+};
+
+Laik_TransPlanner* laik_transplanner_new()
+{
+    Laik_TransPlanner* tp = calloc(1, sizeof(Laik_TransPlanner));
+    if (!tp) {
+        laik_panic("Out of memory allocating Laik_TransPlanner object");
+        exit(1); // not actually needed, laik_panic never returns
+    }
+    return tp;
+}
+
+void laik_transplanner_free(Laik_TransPlanner* tp)
+{
+    for(int i = 0; i < tp->groupListCount; i++)
+        free(tp->groupList[i].task);
+    free(tp->groupList);
+    free(tp->borderList);
+    free(tp->localBuf);
+    free(tp->initBuf);
+    free(tp->sendBuf);
+    free(tp->recvBuf);
+    free(tp->redBuf);
+    free(tp->pairList);
+    free(tp->eqTaskList);
+    free(tp);
+}
+
 
 static
-void cleanGroupList()
+void cleanGroupList(Laik_TransPlanner* tp)
 {
-    for(int i = 0; i < groupListCount; i++)
-        free(groupList[i].task);
-    groupListCount = 0;
+    for(int i = 0; i < tp->groupListCount; i++)
+        free(tp->groupList[i].task);
+    tp->groupListCount = 0;
 
-    // we keep the groupList array
+    // we keep the tp->groupList array
 }
 
 static
-TaskGroup* newTaskGroup(int* group)
+TaskGroup* newTaskGroup(Laik_TransPlanner* tp, int* group)
 {
-    if (groupListCount == groupListSize) {
+    if (tp->groupListCount == tp->groupListSize) {
         // enlarge group list
-        groupListSize = (groupListSize + 10) * 2;
-        groupList = realloc(groupList, groupListSize * sizeof(TaskGroup));
-        if (!groupList) {
+        tp->groupListSize = (tp->groupListSize + 10) * 2;
+        tp->groupList = realloc(tp->groupList, tp->groupListSize * sizeof(TaskGroup));
+        if (!tp->groupList) {
             laik_panic("Out of memory allocating memory for Laik_Transition");
             exit(1); // not actually needed, laik_panic never returns
         }
     }
-    TaskGroup* g = &(groupList[groupListCount]);
-    if (group) *group = groupListCount;
-    groupListCount++;
+    TaskGroup* g = &(tp->groupList[tp->groupListCount]);
+    if (group) *group = tp->groupListCount;
+    tp->groupListCount++;
 
     g->count = 0; // invalid
     g->task = 0;
@@ -724,15 +801,15 @@ TaskGroup* newTaskGroup(int* group)
     return g;
 }
 
-static int getTaskGroupSingle(int task)
+static int getTaskGroupSingle(Laik_TransPlanner* tp, int task)
 {
     // already existing?
-    for(int i = 0; i < groupListCount; i++)
-        if ((groupList[i].count == 1) && (groupList[i].task[0] == task))
+    for(int i = 0; i < tp->groupListCount; i++)
+        if ((tp->groupList[i].count == 1) && (tp->groupList[i].task[0] == task))
             return i;
 
     int group;
-    TaskGroup* g = newTaskGroup(&group);
+    TaskGroup* g = newTaskGroup(tp, &group);
 
     g->count = 1;
     g->task = malloc(sizeof(int));
@@ -742,21 +819,21 @@ static int getTaskGroupSingle(int task)
     return group;
 }
 
-// append given task group if not already in groupList, return index
-static int getTaskGroup(TaskGroup* tg)
+// append given task group if not already in tp->groupList, return index
+static int getTaskGroup(Laik_TransPlanner* tp, TaskGroup* tg)
 {
     // already existing?
     int i, j;
-    for(i = 0; i < groupListCount; i++) {
-        if (tg->count != groupList[i].count) continue;
+    for(i = 0; i < tp->groupListCount; i++) {
+        if (tg->count != tp->groupList[i].count) continue;
         for(j = 0; j < tg->count; j++)
-            if (tg->task[j] != groupList[i].task[j]) break;
+            if (tg->task[j] != tp->groupList[i].task[j]) break;
         if (j == tg->count)
             return i; // found
     }
 
     int group;
-    TaskGroup* g = newTaskGroup(&group);
+    TaskGroup* g = newTaskGroup(tp, &group);
 
     g->count = tg->count;
     int tsize = tg->count * sizeof(int);
@@ -768,48 +845,37 @@ static int getTaskGroup(TaskGroup* tg)
 }
 
 
-// only for 1d
-typedef struct _RangeBorder {
-    int64_t b;
-    int task;
-    int rangeNo, mapNo;
-    unsigned int isStart :1;
-    unsigned int isInput :1;
-} RangeBorder;
-
-static RangeBorder* borderList = 0;
-int borderListSize = 0, borderListCount = 0;
 
 static
-void cleanBorderList()
+void cleanBorderList(Laik_TransPlanner* tp)
 {
-    borderListCount = 0;
+    tp->borderListCount = 0;
 }
 
 static
-void freeBorderList()
+void freeBorderList(Laik_TransPlanner* tp)
 {
-    free(borderList);
-    borderList = 0;
-    borderListCount = 0;
-    borderListSize = 0;
+    free(tp->borderList);
+    tp->borderList = 0;
+    tp->borderListCount = 0;
+    tp->borderListSize = 0;
 }
 
 static
-void appendBorder(int64_t b, int task, int rangeNo, int mapNo,
+void appendBorder(Laik_TransPlanner* tp, int64_t b, int task, int rangeNo, int mapNo,
                   bool isStart, bool isInput)
 {
-    if (borderListCount == borderListSize) {
+    if (tp->borderListCount == tp->borderListSize) {
         // enlarge list
-        borderListSize = (borderListSize + 10) * 2;
-        borderList = realloc(borderList, borderListSize * sizeof(RangeBorder));
-        if (!borderList) {
+        tp->borderListSize = (tp->borderListSize + 10) * 2;
+        tp->borderList = realloc(tp->borderList, tp->borderListSize * sizeof(RangeBorder));
+        if (!tp->borderList) {
             laik_panic("Out of memory allocating memory for Laik_Transition");
             exit(1); // not actually needed, laik_panic never returns
         }
     }
-    RangeBorder *sb = &(borderList[borderListCount]);
-    borderListCount++;
+    RangeBorder *sb = &(tp->borderList[tp->borderListCount]);
+    tp->borderListCount++;
 
     sb->b = b;
     sb->task = task;
@@ -884,50 +950,33 @@ static bool isInTaskGroup(TaskGroup* g, int task)
 
 
 // temporary buffers used when calculating a transition
-static struct localTOp *localBuf = 0;
-static struct initTOp  *initBuf = 0;
-static struct sendTOp  *sendBuf = 0;
-static struct recvTOp  *recvBuf = 0;
-static struct redTOp   *redBuf = 0;
-static int localBufSize = 0, localBufCount = 0;
-static int initBufSize = 0, initBufCount = 0;
-static int sendBufSize = 0, sendBufCount = 0;
-static int recvBufSize = 0, recvBufCount = 0;
-static int redBufSize = 0, redBufCount = 0;
 
 static
-void cleanTOpBufs(bool doFree)
-{
-    localBufCount = 0;
-    initBufCount = 0;
-    sendBufCount = 0;
-    recvBufCount = 0;
-    redBufCount = 0;
-    if (doFree) {
-        free(localBuf); localBufSize = 0;
-        free(initBuf); initBufSize = 0;
-        free(sendBuf); sendBufSize = 0;
-        free(recvBuf); recvBufSize = 0;
-        free(redBuf); redBufSize = 0;
-    }
+void cleanTOpBufs(Laik_TransPlanner* tp)
+{
+    tp->localBufCount = 0;
+    tp->initBufCount = 0;
+    tp->sendBufCount = 0;
+    tp->recvBufCount = 0;
+    tp->redBufCount = 0;
 }
 
 static
-struct localTOp* appendLocalTOp(Laik_Range* range,
+struct localTOp* appendLocalTOp(Laik_TransPlanner* tp, Laik_Range* range,
                                 int fromRangeNo, int toRangeNo,
                                 int fromMapNo, int toMapNo)
 {
-    if (localBufCount == localBufSize) {
+    if (tp->localBufCount == tp->localBufSize) {
         // enlarge temp buffer
-        localBufSize = (localBufSize + 20) * 2;
-        localBuf = realloc(localBuf, localBufSize * sizeof(struct localTOp));
-        if (!localBuf) {
+        tp->localBufSize = (tp->localBufSize + 20) * 2;
+        tp->localBuf = realloc(tp->localBuf, tp->localBufSize * sizeof(struct localTOp));
+        if (!tp->localBuf) {
             laik_panic("Out of memory allocating memory for Laik_Transition");
             exit(1); // not actually needed, laik_panic never returns
         }
     }
-    struct localTOp* op = &(localBuf[localBufCount]);
-    localBufCount++;
+    struct localTOp* op = &(tp->localBuf[tp->localBufCount]);
+    tp->localBufCount++;
 
     op->range = *range;
     op->fromRangeNo = fromRangeNo;
@@ -939,21 +988,21 @@ struct localTOp* appendLocalTOp(Laik_Range* range,
 }
 
 static
-struct initTOp* appendInitTOp(Laik_Range* range,
+struct initTOp* appendInitTOp(Laik_TransPlanner* tp, Laik_Range* range,
                               int rangeNo, int mapNo,
                               Laik_ReductionOperation redOp)
 {
-    if (initBufCount == initBufSize) {
+    if (tp->initBufCount == tp->initBufSize) {
         // enlarge temp buffer
-        initBufSize = (initBufSize + 20) * 2;
-        initBuf = realloc(initBuf, initBufSize * sizeof(struct initTOp));
-        if (!initBuf) {
+        tp->initBufSize = (tp->initBufSize + 20) * 2;
+        tp->initBuf = realloc(tp->initBuf, tp->initBufSize * sizeof(struct initTOp));
+        if (!tp->initBuf) {
             laik_panic("Out of memory allocating memory for Laik_Transition");
             exit(1); // not actually needed, laik_panic never returns
         }
     }
-    struct initTOp* op = &(initBuf[initBufCount]);
-    initBufCount++;
+    struct initTOp* op = &(tp->initBuf[tp->initBufCount]);
+    tp->initBufCount++;
 
     op->range = *range;
     op->rangeNo = rangeNo;
@@ -964,20 +1013,20 @@ struct initTOp* appendInitTOp(Laik_Range* range,
 }
 
 static
-struct sendTOp* appendSendTOp(Laik_Range* range,
+struct sendTOp* appendSendTOp(Laik_TransPlanner* tp, Laik_Range* range,
                               int rangeNo, int mapNo, int toTask)
 {
-    if (sendBufCount == sendBufSize) {
+    if (tp->sendBufCount == tp->sendBufSize) {
         // enlarge temp buffer
-        sendBufSize = (sendBufSize + 20) * 2;
-        sendBuf = realloc(sendBuf, sendBufSize * sizeof(struct sendTOp));
-        if (!sendBuf) {
+        tp->sendBufSize = (tp->sendBufSize + 20) * 2;
+        tp->sendBuf = realloc(tp->sendBuf, tp->sendBufSize * sizeof(struct sendTOp));
+        if (!tp->sendBuf) {
             laik_panic("Out of memory allocating memory for Laik_Transition");
             exit(1); // not actually needed, laik_panic never returns
         }
     }
-    struct sendTOp* op = &(sendBuf[sendBufCount]);
-    sendBufCount++;
+    struct sendTOp* op = &(tp->sendBuf[tp->sendBufCount]);
+    tp->sendBufCount++;
 
     op->range = *range;
     op->rangeNo = rangeNo;
@@ -988,20 +1037,20 @@ struct sendTOp* appendSendTOp(Laik_Range* range,
 }
 
 static
-struct recvTOp* appendRecvTOp(Laik_Range* range,
+struct recvTOp* appendRecvTOp(Laik_TransPlanner* tp, Laik_Range* range,
                               int rangeNo, int mapNo, int fromTask)
 {
-    if (recvBufCount == recvBufSize) {
+    if (tp->recvBufCount == tp->recvBufSize) {
         // enlarge temp buffer
-        recvBufSize = (recvBufSize + 20) * 2;
-        recvBuf = realloc(recvBuf, recvBufSize * sizeof(struct recvTOp));
-        if (!recvBuf) {
+        tp->recvBufSize = (tp->recvBufSize + 20) * 2;
+        tp->recvBuf = realloc(tp->recvBuf, tp->recvBufSize * sizeof(struct recvTOp));
+        if (!tp->recvBuf) {
             laik_panic("Out of memory allocating memory for Laik_Transition");
             exit(1); // not actually needed, laik_panic never returns
         }
     }
-    struct recvTOp* op = &(recvBuf[recvBufCount]);
-    recvBufCount++;
+    struct recvTOp* op = &(tp->recvBuf[tp->recvBufCount]);
+    tp->recvBufCount++;
 
     op->range = *range;
     op->rangeNo = rangeNo;
@@ -1012,23 +1061,23 @@ struct recvTOp* appendRecvTOp(Laik_Range* range,
 }
 
 static
-struct redTOp* appendRedTOp(Laik_Range* range,
+struct redTOp* appendRedTOp(Laik_TransPlanner* tp, Laik_Range* range,
                             Laik_ReductionOperation redOp,
                             int inputGroup, int outputGroup,
                             int myInputRangeNo, int myOutputRangeNo,
                             int myInputMapNo, int myOutputMapNo)
 {
-    if (redBufCount == redBufSize) {
+    if (tp->redBufCount == tp->redBufSize) {
         // enlarge temp buffer
-        redBufSize = (redBufSize + 20) * 2;
-        redBuf = realloc(redBuf, redBufSize * sizeof(struct redTOp));
-        if (!redBuf) {
+        tp->redBufSize = (tp->redBufSize + 20) * 2;
+        tp->redBuf = realloc(tp->redBuf, tp->redBufSize * sizeof(struct redTOp));
+        if (!tp->redBuf) {
             laik_panic("Out of memory allocating memory for Laik_Transition");
             exit(1); // not actually needed, laik_panic never returns
         }
     }
-    struct redTOp* op = &(redBuf[redBufCount]);
-    redBufCount++;
+    struct redTOp* op = &(tp->redBuf[tp->redBufCount]);
+    tp->redBufCount++;
 
     op->range = *range;
     op->redOp = redOp;
@@ -1043,6 +1092,90 @@ struct redTOp* appendRedTOp(Laik_Range* range,
     return op;
 }
 
+
+static
+void cleanPairList(Laik_TransPlanner* tp)
+{
+    tp->pairListCount = 0;
+}
+
+static
+void appendPair(Laik_TransPlanner* tp, int task, unsigned int o1, unsigned int o2)
+{
+    if (tp->pairListCount == tp->pairListSize) {
+        // enlarge list
+        tp->pairListSize = (tp->pairListSize + 20) * 2;
+        tp->pairList = realloc(tp->pairList, tp->pairListSize * sizeof(RangePair));
+        if (!tp->pairList) {
+            laik_panic("Out of memory allocating memory for Laik_Transition");
+            exit(1); // not actually needed, laik_panic never returns
+        }
+    }
+    RangePair* rp = &(tp->pairList[tp->pairListCount]);
+    tp->pairListCount++;
+
+    rp->task = task;
+    rp->o1 = o1;
+    rp->o2 = o2;
+}
+
+static int rp_cmp(const void *p1, const void *p2)
+{
+    const RangePair* rp1 = (const RangePair*) p1;
+    const RangePair* rp2 = (const RangePair*) p2;
+    if (rp1->task != rp2->task) return rp1->task - rp2->task;
+    if (rp1->o1 != rp2->o1) return (rp1->o1 < rp2->o1) ? -1 : 1;
+    if (rp1->o2 != rp2->o2) return (rp1->o2 < rp2->o2) ? -1 : 1;
+    return 0;
+}
+
+static
+void sortPairList(Laik_TransPlanner* tp)
+{
+    qsort(tp->pairList, tp->pairListCount, sizeof(RangePair), rp_cmp);
+}
+
+static
+void cleanEqTaskList(Laik_TransPlanner* tp)
+{
+    tp->eqTaskListCount = 0;
+}
+
+static
+void appendEqTask(Laik_TransPlanner* tp, int task)
+{
+    if (tp->eqTaskListCount == tp->eqTaskListSize) {
+        // enlarge list
+        tp->eqTaskListSize = (tp->eqTaskListSize + 10) * 2;
+        tp->eqTaskList = realloc(tp->eqTaskList, tp->eqTaskListSize * sizeof(int));
+        if (!tp->eqTaskList) {
+            laik_panic("Out of memory allocating memory for Laik_Transition");
+            exit(1); // not actually needed, laik_panic never returns
+        }
+    }
+    tp->eqTaskList[tp->eqTaskListCount++] = task;
+}
+
+static int int_cmp(const void *p1, const void *p2)
+{
+    return *((const int*) p1) - *((const int*) p2);
+}
+
+// sort to allow binary search (all tasks may have same range)
+static
+void sortEqTaskList(Laik_TransPlanner* tp)
+{
+    qsort(tp->eqTaskList, tp->eqTaskListCount, sizeof(int), int_cmp);
+}
+
+static
+bool isInEqTaskList(Laik_TransPlanner* tp, int task)
+{
+    if (tp->eqTaskListCount == 0) return false;
+    return bsearch(&task, tp->eqTaskList, tp->eqTaskListCount,
+                   sizeof(int), int_cmp) != 0;
+}
+
 static
 bool oneInputIsCopy(Laik_ReductionOperation redOp)
 {
@@ -1058,7 +1191,7 @@ bool oneInputIsCopy(Laik_ReductionOperation redOp)
 // TODO: we only support one mapping in each task for reductions
 //       better: support multiple mappings for same index in same task
 static
-void calcAddReductions(int tflags,
+void calcAddReductions(Laik_TransPlanner* tp, int tflags,
                        Laik_Group* group,
                        Laik_ReductionOperation redOp,
                        Laik_Partitioning* fromP, Laik_Partitioning* toP)
@@ -1085,7 +1218,7 @@ void calcAddReductions(int tflags,
     }
 
     // add range borders of all tasks
-    cleanBorderList();
+    cleanBorderList(tp);
     int rangeNo, lastTask, lastMapNo;
     rangeNo = 0;
     lastTask = -1;
@@ -1098,8 +1231,8 @@ void calcAddReductions(int tflags,
             lastTask = ts->task;
             lastMapNo = ts->mapNo;
         }
-        appendBorder(ts->range.from.i[0], ts->task, rangeNo, ts->mapNo, true, true);
-        appendBorder(ts->range.to.i[0], ts->task, rangeNo, ts->mapNo, false, true);
+        appendBorder(tp, ts->range.from.i[0], ts->task, rangeNo, ts->mapNo, true, true);
+        appendBorder(tp, ts->range.to.i[0], ts->task, rangeNo, ts->mapNo, false, true);
         rangeNo++;
     }
     lastTask = -1;
@@ -1112,15 +1245,15 @@ void calcAddReductions(int tflags,
             lastTask = tr->task;
             lastMapNo = tr->mapNo;
         }
-        appendBorder(tr->range.from.i[0], tr->task, rangeNo, tr->mapNo, true, false);
-        appendBorder(tr->range.to.i[0], tr->task, rangeNo, tr->mapNo, false, false);
+        appendBorder(tp, tr->range.from.i[0], tr->task, rangeNo, tr->mapNo, true, false);
+        appendBorder(tp, tr->range.to.i[0], tr->task, rangeNo, tr->mapNo, false, false);
         rangeNo++;
     }
 
-    if (borderListCount == 0) return;
+    if (tp->borderListCount == 0) return;
 
     // order by border to travers in border order
-    qsort(borderList, borderListCount, sizeof(RangeBorder), rb_cmp);
+    qsort(tp->borderList, tp->borderListCount, sizeof(RangeBorder), rb_cmp);
 
 #define MAX_TASKS 65536
     int inputTask[MAX_TASKS], outputTask[MAX_TASKS];
@@ -1142,8 +1275,8 @@ void calcAddReductions(int tflags,
     // all ranges are from same space
     range.space = fromP->space;
 
-    for(int i = 0; i < borderListCount; i++) {
-        RangeBorder* sb = &(borderList[i]);
+    for(int i = 0; i < tp->borderListCount; i++) {
+        RangeBorder* sb = &(tp->borderList[i]);
 
 #ifdef DEBUG_REDUCTIONRANGES
         laik_log(1, "at border %lld, task %d (range %d, map %d): %s for %s",
@@ -1184,9 +1317,9 @@ void calcAddReductions(int tflags,
         }
         assert(isOk);
 
-        if ((i < borderListCount - 1) && (borderList[i + 1].b > sb->b)) {
+        if ((i < tp->borderListCount - 1) && (tp->borderList[i + 1].b > sb->b)) {
             // about to leave a range with given input/output tasks
-            int64_t nextBorder = borderList[i + 1].b;
+            int64_t nextBorder = tp->borderList[i + 1].b;
 
 #ifdef DEBUG_REDUCTIONRANGES
             char* act[] = {"(none)", "input", "output", "in & out"};
@@ -1214,7 +1347,7 @@ void calcAddReductions(int tflags,
                             (outputGroup.task[0] == myid)) {
 
                             // local (copy) operation
-                            appendLocalTOp(&range,
+                            appendLocalTOp(tp, &range,
                                            myInputRangeNo, myOutputRangeNo,
                                            myInputMapNo, myOutputMapNo);
 #ifdef DEBUG_REDUCTIONRANGES
@@ -1233,7 +1366,7 @@ void calcAddReductions(int tflags,
                             for(int out = 0; out < outputGroup.count; out++) {
                                 if (outputGroup.task[out] == myid) {
                                     // local (copy) operation
-                                    appendLocalTOp(&range,
+                                    appendLocalTOp(tp, &range,
                                                    myInputRangeNo, myOutputRangeNo,
                                                    myInputMapNo, myOutputMapNo);
 #ifdef DEBUG_REDUCTIONRANGES
@@ -1248,7 +1381,7 @@ void calcAddReductions(int tflags,
                                 }
 
                                 // send operation
-                                appendSendTOp(&range,
+                                appendSendTOp(tp, &range,
                                               myInputRangeNo, myInputMapNo,
                                               outputGroup.task[out]);
 #ifdef DEBUG_REDUCTIONRANGES
@@ -1270,7 +1403,7 @@ void calcAddReductions(int tflags,
                                 if (outputGroup.task[out] != myid) continue;
 
                                 // receive operation
-                                appendRecvTOp(&range,
+                                appendRecvTOp(tp, &range,
                                               myOutputRangeNo, myOutputMapNo,
                                               inputGroup.task[0]);
 
@@ -1291,21 +1424,21 @@ void calcAddReductions(int tflags,
                 } // one input
 
                 // add reduction operation
-                int in = getTaskGroup(&inputGroup);
-                int out = getTaskGroup(&outputGroup);
+                int in = getTaskGroup(tp, &inputGroup);
+                int out = getTaskGroup(tp, &outputGroup);
 
 #ifdef DEBUG_REDUCTIONRANGES
                 laik_log_begin(1);
                 laik_log_append("  adding reduction (%lu - %lu), in %d:(",
                                 range.from.i[0], range.to.i[0], in);
-                for(int i = 0; i < groupList[in].count; i++) {
+                for(int i = 0; i < tp->groupList[in].count; i++) {
                     if (i > 0) laik_log_append(",");
-                    laik_log_append("T%d", groupList[in].task[i]);
+                    laik_log_append("T%d", tp->groupList[in].task[i]);
                 }
                 laik_log_append("), out %d:(", out);
-                for(int i = 0; i < groupList[out].count; i++) {
+                for(int i = 0; i < tp->groupList[out].count; i++) {
                     if (i > 0) laik_log_append(",");
-                    laik_log_append("T%d", groupList[out].task[i]);
+                    laik_log_append("T%d", tp->groupList[out].task[i]);
                 }
                 laik_log_flush("), in %d/%d out %d/%d (range/map)",
                                myInputRangeNo, myInputMapNo,
@@ -1313,11 +1446,11 @@ void calcAddReductions(int tflags,
 #endif
 
                 // convert to all-group if possible
-                if (groupList[in].count == group->size) in = -1;
-                if (groupList[out].count == group->size) out = -1;
+                if (tp->groupList[in].count == group->size) in = -1;
+                if (tp->groupList[out].count == group->size) out = -1;
 
                 assert(redOp != LAIK_RO_None); // must be a real reduction
-                appendRedTOp(&range, redOp, in, out,
+                appendRedTOp(tp, &range, redOp, in, out,
                              myInputRangeNo, myOutputRangeNo,
                              myInputMapNo, myOutputMapNo);
             }
@@ -1326,24 +1459,26 @@ void calcAddReductions(int tflags,
     // all tasks should be removed from input/output groups
     assert(inputGroup.count == 0);
     assert(outputGroup.count == 0);
-    freeBorderList();
+    freeBorderList(tp);
 }
 
 static int trans_id = 0;
 
-// Calculate communication required for transitioning between partitionings
+// Calculate communication required for transitioning between partitionings,
+// using temporary buffers from planner context <tp>
 Laik_Transition*
-do_calc_transition(Laik_Space* space,
-                   Laik_Partitioning* fromP, Laik_Partitioning* toP,
-                   Laik_DataFlow flow, Laik_ReductionOperation redOp)
+laik_transplanner_calc(Laik_TransPlanner* tp, Laik_Space* space,
+                       Laik_Partitioning* fromP, Laik_Partitioning* toP,
+                       Laik_DataFlow flow, Laik_ReductionOperation redOp)
 {
     Laik_Range* range;
+    Laik_Range isec; // for intersections, may be used concurrently
 
     // flags for transition
     int tflags = 0; //LAIK_TF_KEEP_REDUCTIONS; // no_sendrev_actions
 
-    cleanTOpBufs(false);
-    cleanGroupList();
+    cleanTOpBufs(tp);
+    cleanGroupList(tp);
 
     // make sure requested operation is consistent
     Laik_Group* group = 0;
@@ -1396,7 +1531,7 @@ do_calc_transition(Laik_Space* space,
             if (laik_range_isEmpty(&(toRL->trange[o].range))) continue;
 
             assert(redOp != LAIK_RO_None);
-            appendInitTOp( &(toRL->trange[o].range),
+            appendInitTOp(tp, &(toRL->trange[o].range),
                            o - toRL->off[myid],
                            toRL->trange[o].mapNo,
                            redOp);
@@ -1410,7 +1545,7 @@ do_calc_transition(Laik_Space* space,
 
             // just check for reduction action
             // TODO: Do this always, remove other cases
-            calcAddReductions(tflags, group, redOp, fromP, toP);
+            calcAddReductions(tp, tflags, group, redOp, fromP, toP);
         }
         else {
             // we need intersection of own ranges in fromP/toP
@@ -1426,11 +1561,12 @@ do_calc_transition(Laik_Space* space,
             // reductions are not handled here, but by backend
             for(o1 = fromRL->off[myid]; o1 < fromRL->off[myid+1]; o1++) {
                 for(o2 = toRL->off[myid]; o2 < toRL->off[myid+1]; o2++) {
-                    range = laik_range_intersect(&(fromRL->trange[o1].range),
-                                               &(toRL->trange[o2].range));
+                    range = laik_range_intersect_r(&(fromRL->trange[o1].range),
+                                                   &(toRL->trange[o2].range),
+                                                   &isec);
                     if (range == 0) continue;
 
-                    appendLocalTOp(range,
+                    appendLocalTOp(tp, range,
                                    o1 - fromRL->off[myid],
                                    o2 - toRL->off[myid],
                                    fromRL->trange[o1].mapNo,
@@ -1456,7 +1592,7 @@ do_calc_transition(Laik_Space* space,
                         }
                     }
                     else {
-                        outputGroup = getTaskGroupSingle(task);
+                        outputGroup = getTaskGroupSingle(tp, task);
                         if (taskCount == 1) {
                             // the process group only consists of 1 process:
                             // one output process is equivalent to all
@@ -1470,59 +1606,27 @@ do_calc_transition(Laik_Space* space,
                 if (fromAllto1OrAll) {
                     assert(outputGroup > -2);
                     // complete space, always rangeNo 0 and mapNo 0
-                    appendRedTOp( &(space->range), redOp,
+                    appendRedTOp(tp, &(space->range), redOp,
                                   -1, outputGroup, 0, 0, 0, 0);
                 }
                 else {
                     assert(dims == 1);
-                    calcAddReductions(tflags, group, redOp, fromP, toP);
+                    calcAddReductions(tp, tflags, group, redOp, fromP, toP);
                 }
             }
             else { // no reduction
 
                 // something to receive not coming from a reduction?
-                for(int task = 0; task < taskCount; task++) {
-                    if (task == myid) continue;
-                    for(o1 = toRL->off[myid]; o1 < toRL->off[myid+1]; o1++) {
-
-                        // everything we have local will not have been sent
-                        // TODO: we only check for exact match to catch All
-                        // FIXME: should print out a Warning/Error as the App
-                        //        was requesting for overwriting of values!
-                        range = &(toRL->trange[o1].range);
-                        for(o2 = fromRL->off[myid]; o2 < fromRL->off[myid+1]; o2++) {
-                            if (laik_range_isEqual(range,
-                                                   &(fromRL->trange[o2].range))) {
-                                range = 0;
-                                break;
-                            }
-                        }
-                        if (range == 0) continue;
-
-                        for(o2 = fromRL->off[task]; o2 < fromRL->off[task+1]; o2++) {
-
-                            range = laik_range_intersect(&(fromRL->trange[o2].range),
-                                                       &(toRL->trange[o1].range));
-                            if (range == 0) continue;
-
-                            appendRecvTOp(range, o1 - toRL->off[myid],
-                                          toRL->trange[o1].mapNo, task);
-                        }
-                    }
-                }
-            }
-
-            // something to send?
-            for(int task = 0; task < taskCount; task++) {
-                if (task == myid) continue;
-                for(o1 = fromRL->off[myid]; o1 < fromRL->off[myid+1]; o1++) {
+                // only visit ranges of other tasks which may overlap
+                cleanPairList(tp);
+                for(o1 = toRL->off[myid]; o1 < toRL->off[myid+1]; o1++) {
 
-                    // everything the receiver has local, no need to send
+                    // everything we have local will not have been sent
                     // TODO: we only check for exact match to catch All
                     // FIXME: should print out a Warning/Error as the App
-                    //        requests overwriting of values!
-                    range = &(fromRL->trange[o1].range);
-                    for(o2 = fromRL->off[task]; o2 < fromRL->off[task+1]; o2++) {
+                    //        was requesting for overwriting of values!
+                    range = &(toRL->trange[o1].range);
+                    for(o2 = fromRL->off[myid]; o2 < fromRL->off[myid+1]; o2++) {
                         if (laik_range_isEqual(range,
                                                &(fromRL->trange[o2].range))) {
                             range = 0;
@@ -1531,32 +1635,92 @@ do_calc_transition(Laik_Space* space,
                     }
                     if (range == 0) continue;
 
-                    // we may send multiple messages to same task
-                    for(o2 = toRL->off[task]; o2 < toRL->off[task+1]; o2++) {
-
-                        range = laik_range_intersect(&(fromRL->trange[o1].range),
-                                                   &(toRL->trange[o2].range));
-                        if (range == 0) continue;
+                    unsigned int first;
+                    unsigned int n = laik_rangelist_candidates(fromRL, range, &first);
+                    for(unsigned int k = first; k < first + n; k++) {
+                        o2 = fromRL->idx[k].off;
+                        int task = fromRL->trange[o2].task;
+                        if (task == myid) continue;
+                        if (laik_range_intersect_r(&(fromRL->trange[o2].range),
+                                                   range, &isec) == 0) continue;
 
-                        appendSendTOp(range, o1 - fromRL->off[myid],
-                                      fromRL->trange[o1].mapNo, task);
+                        appendPair(tp, task, o1, o2);
                     }
                 }
+
+                // append in same order as when iterating over tasks
+                sortPairList(tp);
+                for(int i = 0; i < tp->pairListCount; i++) {
+                    RangePair* rp = &(tp->pairList[i]);
+                    range = laik_range_intersect_r(&(fromRL->trange[rp->o2].range),
+                                                   &(toRL->trange[rp->o1].range),
+                                                   &isec);
+                    assert(range != 0);
+
+                    appendRecvTOp(tp, range, rp->o1 - toRL->off[myid],
+                                  toRL->trange[rp->o1].mapNo, rp->task);
+                }
+            }
+
+            // something to send?
+            cleanPairList(tp);
+            for(o1 = fromRL->off[myid]; o1 < fromRL->off[myid+1]; o1++) {
+                range = &(fromRL->trange[o1].range);
+
+                // everything the receiver has local, no need to send
+                // TODO: we only check for exact match to catch All
+                // FIXME: should print out a Warning/Error as the App
+                //        requests overwriting of values!
+                cleanEqTaskList(tp);
+                unsigned int first;
+                unsigned int n = laik_rangelist_candidates(fromRL, range, &first);
+                for(unsigned int k = first; k < first + n; k++) {
+                    o2 = fromRL->idx[k].off;
+                    if (laik_range_isEqual(range, &(fromRL->trange[o2].range)))
+                        appendEqTask(tp, fromRL->trange[o2].task);
+                }
+                sortEqTaskList(tp);
+
+                // we may send multiple messages to same task
+                n = laik_rangelist_candidates(toRL, range, &first);
+                for(unsigned int k = first; k < first + n; k++) {
+                    o2 = toRL->idx[k].off;
+                    int task = toRL->trange[o2].task;
+                    if (task == myid) continue;
+                    if (isInEqTaskList(tp, task)) continue;
+                    if (laik_range_intersect_r(range, &(toRL->trange[o2].range),
+                                               &isec) == 0) continue;
+
+                    appendPair(tp, task, o1, o2);
+                }
+            }
+
+            // append in same order as when iterating over tasks
+            sortPairList(tp);
+            for(int i = 0; i < tp->pairListCount; i++) {
+                RangePair* rp = &(tp->pairList[i]);
+                range = laik_range_intersect_r(&(fromRL->trange[rp->o1].range),
+                                               &(toRL->trange[rp->o2].range),
+                                               &isec);
+                assert(range != 0);
+
+                appendSendTOp(tp, range, rp->o1 - fromRL->off[myid],
+                              fromRL->trange[rp->o1].mapNo, rp->task);
             }
         }
     }
 
     // allocate space as needed
-    int localSize = localBufCount * sizeof(struct localTOp);
-    int initSize  = initBufCount  * sizeof(struct initTOp);
-    int sendSize  = sendBufCount  * sizeof(struct sendTOp);
-    int recvSize  = recvBufCount  * sizeof(struct recvTOp);
-    int redSize   = redBufCount   * sizeof(struct redTOp);
+    int localSize = tp->localBufCount * sizeof(struct localTOp);
+    int initSize  = tp->initBufCount  * sizeof(struct initTOp);
+    int sendSize  = tp->sendBufCount  * sizeof(struct sendTOp);
+    int recvSize  = tp->recvBufCount  * sizeof(struct recvTOp);
+    int redSize   = tp->redBufCount   * sizeof(struct redTOp);
     // we copy group list into transition object
-    int gListSize = groupListCount * sizeof(TaskGroup);
+    int gListSize = tp->groupListCount * sizeof(TaskGroup);
     int tListSize = 0;
-    for (int i = 0; i < groupListCount; i++)
-        tListSize += groupList[i].count * sizeof(int);
+    for (int i = 0; i < tp->groupListCount; i++)
+        tListSize += tp->groupList[i].count * sizeof(int);
 
     int tsize = sizeof(Laik_Transition) + gListSize + tListSize +
                 localSize + initSize + sendSize + recvSize + redSize;
@@ -1577,7 +1741,7 @@ do_calc_transition(Laik_Space* space,
         exit(1); // not actually needed, laik_panic never returns
     }
 
-    t->id = trans_id++;
+    t->id = __sync_fetch_and_add(&trans_id, 1);
     t->name = strdup("trans-0     ");
     sprintf(t->name, "trans-%d", t->id);
 
@@ -1590,33 +1754,33 @@ do_calc_transition(Laik_Space* space,
     t->redOp = redOp;
 
     t->dims = dims;
-    t->actionCount = localBufCount + initBufCount +
-                     sendBufCount + recvBufCount + redBufCount;
+    t->actionCount = tp->localBufCount + tp->initBufCount +
+                     tp->sendBufCount + tp->recvBufCount + tp->redBufCount;
     t->local = (struct localTOp*) (((char*)t) + localOff);
     t->init  = (struct initTOp*)  (((char*)t) + initOff);
     t->send  = (struct sendTOp*)  (((char*)t) + sendOff);
     t->recv  = (struct recvTOp*)  (((char*)t) + recvOff);
     t->red   = (struct redTOp*)   (((char*)t) + redOff);
     t->subgroup = (TaskGroup*)       (((char*)t) + gListOff);
-    t->localCount = localBufCount;
-    t->initCount  = initBufCount;
-    t->sendCount  = sendBufCount;
-    t->recvCount  = recvBufCount;
-    t->redCount   = redBufCount;
-    t->subgroupCount = groupListCount;
-    memcpy(t->local, localBuf, localSize);
-    memcpy(t->init, initBuf,  initSize);
-    memcpy(t->send, sendBuf,  sendSize);
-    memcpy(t->recv, recvBuf,  recvSize);
-    memcpy(t->red,  redBuf,   redSize);
+    t->localCount = tp->localBufCount;
+    t->initCount  = tp->initBufCount;
+    t->sendCount  = tp->sendBufCount;
+    t->recvCount  = tp->recvBufCount;
+    t->redCount   = tp->redBufCount;
+    t->subgroupCount = tp->groupListCount;
+    memcpy(t->local, tp->localBuf, localSize);
+    memcpy(t->init, tp->initBuf,  initSize);
+    memcpy(t->send, tp->sendBuf,  sendSize);
+    memcpy(t->recv, tp->recvBuf,  recvSize);
+    memcpy(t->red,  tp->redBuf,   redSize);
 
     // copy group list and task list of each group into transition object
     char* tList = ((char*)t) + tListOff;
-    for (int i = 0; i < groupListCount; i++) {
-        t->subgroup[i].count = groupList[i].count;
+    for (int i = 0; i < tp->groupListCount; i++) {
+        t->subgroup[i].count = tp->groupList[i].count;
         t->subgroup[i].task = (int*) tList;
-        tListSize = groupList[i].count * sizeof(int);
-        memcpy(tList, groupList[i].task, tListSize);
+        tListSize = tp->groupList[i].count * sizeof(int);
+        memcpy(tList, tp->groupList[i].task, tListSize);
         tList += tListSize;
     }
     assert(tList == ((char*)t) + tsize);
@@ -1631,6 +1795,36 @@ do_calc_transition(Laik_Space* space,
 }
 
 
+// calculate lazily created data of partitionings required for transition
+// calculation. Needs to be done before calculating concurrently
+void laik_transplanner_prepare(Laik_Partitioning* fromP, Laik_Partitioning* toP)
+{
+    // spatial index only used for 2d/3d
+    if (!fromP || !toP || (fromP->space->dims == 1)) return;
+
+    Laik_RangeList* fromRL = laik_partitioning_allranges(fromP);
+    Laik_RangeList* toRL = laik_partitioning_allranges(toP);
+    if (fromRL) laik_rangelist_updateIndex(fromRL);
+    if (toRL) laik_rangelist_updateIndex(toRL);
+}
+
+// planner used for transition calculation from the main thread
+static Laik_TransPlanner* defaultPlanner = 0;
+
+// Calculate communication required for transitioning between partitionings
+Laik_Transition*
+do_calc_transition(Laik_Space* space,
+                   Laik_Partitioning* fromP, Laik_Partitioning* toP,
+                   Laik_DataFlow flow, Laik_ReductionOperation redOp)
+{
+    if (!defaultPlanner)
+        defaultPlanner = laik_transplanner_new();
+
+    return laik_transplanner_calc(defaultPlanner, space,
+                                  fromP, toP, flow, redOp);
+}
+
+
 // Calculate communication required for transitioning between partitionings
 Laik_Transition*
 laik_calc_transition(Laik_Space* space,
@@ -1665,6 +1859,7 @@ void laik_free_transition(Laik_Transition* t)
     if (!t) return;
 
     laik_log(1, "free transition '%s'", t->name);
+    free(t->name);
     free(t);
 }
 
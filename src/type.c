@@ -52,6 +52,64 @@ Laik_Type *laik_Double;
 
 static int type_id = 0;
 
+// In-place variants of the reductions (out == in1), the common case when
+// reducing received data into a mapping. Using restrict pointers, compilers
+// can vectorize the loops without runtime checks for overlapping arrays.
+
+#define REDUCE_INPLACE_LOOPS                                      \
+    case LAIK_RO_Sum:                                             \
+        for(int i = 0; i < count; i++) out[i] += in[i];           \
+        break;                                                    \
+    case LAIK_RO_Prod:                                            \
+        for(int i = 0; i < count; i++) out[i] *= in[i];           \
+        break;                                                    \
+    case LAIK_RO_Min:                                             \
+        for(int i = 0; i < count; i++)                            \
+            out[i] = (out[i] < in[i]) ? out[i] : in[i];           \
+        break;                                                    \
+    case LAIK_RO_Max:                                             \
+        for(int i = 0; i < count; i++)                            \
+            out[i] = (out[i] > in[i]) ? out[i] : in[i];           \
+        break;
+
+// integer types additionally support bitwise reductions
+#define REDUCE_INPLACE_INT(name, T)                               \
+static void name(T* restrict out, const T* restrict in,           \
+                 int count, Laik_ReductionOperation o)            \
+{                                                                 \
+    switch(o) {                                                   \
+    REDUCE_INPLACE_LOOPS                                          \
+    case LAIK_RO_Or:                                              \
+        for(int i = 0; i < count; i++) out[i] |= in[i];           \
+        break;                                                    \
+    case LAIK_RO_And:                                             \
+        for(int i = 0; i < count; i++) out[i] &= in[i];           \
+        break;                                                    \
+    default:                                                      \
+        assert(0);                                                \
+    }                                                             \
+}
+
+#define REDUCE_INPLACE_FP(name, T)                                \
+static void name(T* restrict out, const T* restrict in,           \
+                 int count, Laik_ReductionOperation o)            \
+{                                                                 \
+    switch(o) {                                                   \
+    REDUCE_INPLACE_LOOPS                                          \
+    default:                                                      \
+        assert(0);                                                \
+    }                                                             \
+}
+
+REDUCE_INPLACE_INT(char_reduce_inplace, signed char)
+REDUCE_INPLACE_INT(uchar_reduce_inplace, unsigned char)
+REDUCE_INPLACE_INT(int32_reduce_inplace, int32_t)
+REDUCE_INPLACE_INT(uint32_reduce_inplace, uint32_t)
+REDUCE_INPLACE_INT(int64_reduce_inplace, int64_t)
+REDUCE_INPLACE_INT(uint64_reduce_inplace, uint64_t)
+REDUCE_INPLACE_FP(float_reduce_inplace, float)
+REDUCE_INPLACE_FP(double_reduce_inplace, double)
+
 // laik_Char (signed)
 
 void laik_char_init(void* base, int count, Laik_ReductionOperation o)
@@ -88,6 +146,11 @@ void laik_char_reduce(void* out, const void* in1, const void* in2,
         return;
     }
 
+    if ((out == in1) && (in2 != out)) {
+        char_reduce_inplace(out, in2, count, o);
+        return;
+    }
+
     const signed char* pin1 = in1;
     const signed char* pin2 = in2;
     signed char* pout = out;
@@ -163,6 +226,11 @@ void laik_uchar_reduce(void* out, const void* in1, const void* in2,
         return;
     }
 
+    if ((out == in1) && (in2 != out)) {
+        uchar_reduce_inplace(out, in2, count, o);
+        return;
+    }
+
     const unsigned char* pin1 = in1;
     const unsigned char* pin2 = in2;
     unsigned char* pout = out;
@@ -238,6 +306,11 @@ void laik_int32_reduce(void* out, const void* in1, const void* in2,
         return;
     }
 
+    if ((out == in1) && (in2 != out)) {
+        int32_reduce_inplace(out, in2, count, o);
+        return;
+    }
+
     const int32_t* pin1 = in1;
     const int32_t* pin2 = in2;
     int32_t* pout = out;
@@ -313,6 +386,11 @@ void laik_uint32_reduce(void* out, const void* in1, const void* in2,
         return;
     }
 
+    if ((out == in1) && (in2 != out)) {
+        uint32_reduce_inplace(out, in2, count, o);
+        return;
+    }
+
     const uint32_t* pin1 = in1;
     const uint32_t* pin2 = in2;
     uint32_t* pout = out;
@@ -388,6 +466,11 @@ void laik_int64_reduce(void* out, const void* in1, const void* in2,
         return;
     }
 
+    if ((out == in1) && (in2 != out)) {
+        int64_reduce_inplace(out, in2, count, o);
+        return;
+    }
+
     const int64_t* pin1 = in1;
     const int64_t* pin2 = in2;
     int64_t* pout = out;
@@ -463,6 +546,11 @@ void laik_uint64_reduce(void* out, const void* in1, const void* in2,
         return;
     }
 
+    if ((out == in1) && (in2 != out)) {
+        uint64_reduce_inplace(out, in2, count, o);
+        return;
+    }
+
     const uint64_t* pin1 = in1;
     const uint64_t* pin2 = in2;
     uint64_t* pout = out;
@@ -536,6 +624,11 @@ void laik_double_reduce(void* out, const void* in1, const void* in2,
         return;
     }
 
+    if ((out == in1) && (in2 != out)) {
+        double_reduce_inplace(out, in2, count, o);
+        return;
+    }
+
     const double* pin1 = in1;
     const double* pin2 = in2;
     double* pout = out;
@@ -599,6 +692,11 @@ void laik_float_reduce(void* out, const void* in1, const void* in2,
         return;
     }
 
+    if ((out == in1) && (in2 != out)) {
+        float_reduce_inplace(out, in2, count, o);
+        return;
+    }
+
     const float* pin1 = in1;
     const float* pin2 = in2;
     float* pout = out;
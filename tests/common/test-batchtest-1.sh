@@ -0,0 +1,3 @@
+#!/bin/sh
+${LAUNCHER-./launcher} -n 1 ../src/batchtest > test-batchtest-1.out
+cmp test-batchtest-1.out "$(dirname -- "${0}")/../test-batchtest.expected"
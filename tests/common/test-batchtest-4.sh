@@ -0,0 +1,3 @@
+#!/bin/sh
+${LAUNCHER-./launcher} -n 4 ../src/batchtest > test-batchtest-4.out
+cmp test-batchtest-4.out "$(dirname -- "${0}")/../test-batchtest.expected"
@@ -0,0 +1,3 @@
+#!/bin/sh
+LAIK_BACKEND=mpi ${MPIEXEC-mpiexec} -n 1 ../src/batchtest > test-batchtest-mpi-1.out
+cmp test-batchtest-mpi-1.out "$(dirname -- "${0}")/../test-batchtest.expected"
@@ -0,0 +1,3 @@
+#!/bin/sh
+LAIK_BACKEND=mpi ${MPIEXEC-mpiexec} -n 4 ../src/batchtest > test-batchtest-mpi-4.out
+cmp test-batchtest-mpi-4.out "$(dirname -- "${0}")/../test-batchtest.expected"
@@ -0,0 +1,4 @@
+#!/bin/sh
+# test repartitioning with all-to-all collective for all exchanges
+LAIK_MPI_ALLTOALL=1 LAIK_BACKEND=mpi ${MPIEXEC-mpiexec} -n 4 ../../examples/jac1d 1000 50 10 > test-jac1da2a-1000-repart-mpi-4.out
+cmp test-jac1da2a-1000-repart-mpi-4.out "$(dirname -- "${0}")/test-jac1d-1000-repart.expected"
@@ -0,0 +1,4 @@
+#!/bin/sh
+# test with aggregation of small messages between nodes (2 emulated nodes)
+LAIK_MPI_NODES=2 LAIK_MPI_AGGREGATE=65536 LAIK_BACKEND=mpi ${MPIEXEC-mpiexec} -n 4 ../../examples/jac2d -s 1000 > test-jac2daggr-1000-mpi-4.out
+cmp test-jac2daggr-1000-mpi-4.out "$(dirname -- "${0}")/test-jac2d-1000.expected"
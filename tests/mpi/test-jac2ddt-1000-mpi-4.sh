@@ -0,0 +1,4 @@
+#!/bin/sh
+# test with MPI derived datatypes instead of packing
+LAIK_MPI_DATATYPES=1 LAIK_BACKEND=mpi ${MPIEXEC-mpiexec} -n 4 ../../examples/jac2d -s 1000 > test-jac2ddt-1000-mpi-4.out
+cmp test-jac2ddt-1000-mpi-4.out "$(dirname -- "${0}")/test-jac2d-1000.expected"
@@ -0,0 +1,4 @@
+#!/bin/sh
+# test with non-blocking collectives for reductions (without persistent requests)
+LAIK_MPI_IREDUCE=1 LAIK_MPI_PERSISTENT=0 LAIK_BACKEND=mpi ${MPIEXEC-mpiexec} -n 4 ../../examples/jac2d -s 1000 > test-jac2dired-1000-mpi-4.out
+cmp test-jac2dired-1000-mpi-4.out "$(dirname -- "${0}")/test-jac2d-1000.expected"
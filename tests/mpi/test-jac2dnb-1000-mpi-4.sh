@@ -0,0 +1,4 @@
+#!/bin/sh
+# test with neighborhood collective (with reservation: sequence cached)
+LAIK_MPI_NEIGHBOR=1 LAIK_BACKEND=mpi ${MPIEXEC-mpiexec} -n 4 ../../examples/jac2d -r -s 1000 > test-jac2dnb-1000-mpi-4.out
+cmp test-jac2dnb-1000-mpi-4.out "$(dirname -- "${0}")/test-jac2d-1000.expected"
@@ -0,0 +1,4 @@
+#!/bin/sh
+# test with node-aware own reduction algorithm (2 emulated nodes)
+LAIK_MPI_REDUCE=0 LAIK_MPI_NODES=2 LAIK_BACKEND=mpi ${MPIEXEC-mpiexec} -n 4 ../../examples/jac2d -s 1000 > test-jac2dnodes-1000-mpi-4.out
+cmp test-jac2dnodes-1000-mpi-4.out "$(dirname -- "${0}")/test-jac2d-1000.expected"
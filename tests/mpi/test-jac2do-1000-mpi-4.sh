@@ -0,0 +1,4 @@
+#!/bin/sh
+# test with split-phase halo exchange overlapping computation
+LAIK_BACKEND=mpi ${MPIEXEC-mpiexec} -n 4 ../../examples/jac2d -s -o 1000 > test-jac2do-1000-mpi-4.out
+cmp test-jac2do-1000-mpi-4.out "$(dirname -- "${0}")/test-jac2d-1000.expected"
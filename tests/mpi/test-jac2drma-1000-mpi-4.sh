@@ -0,0 +1,4 @@
+#!/bin/sh
+# test with one-sided communication (MPI_Put in PSCW epochs)
+LAIK_MPI_RMA=1 LAIK_BACKEND=mpi ${MPIEXEC-mpiexec} -n 4 ../../examples/jac2d -s 1000 > test-jac2drma-1000-mpi-4.out
+cmp test-jac2drma-1000-mpi-4.out "$(dirname -- "${0}")/test-jac2d-1000.expected"
@@ -0,0 +1,4 @@
+#!/bin/sh
+# test with aggregation of messages between nodes, reused with persistent requests
+LAIK_MPI_NODES=2 LAIK_MPI_AGGREGATE=100000 LAIK_MPI_PERSISTENT=1 LAIK_BACKEND=mpi ${MPIEXEC-mpiexec} -n 4 ../../examples/jac3d -r -s 100 > test-jac3daggr-100-mpi-4.out
+cmp test-jac3daggr-100-mpi-4.out "$(dirname -- "${0}")/test-jac3d-100.expected"
@@ -0,0 +1,4 @@
+#!/bin/sh
+# test with MPI derived datatypes instead of packing (with reservation)
+LAIK_MPI_DATATYPES=1 LAIK_BACKEND=mpi ${MPIEXEC-mpiexec} -n 4 ../../examples/jac3d -r -s 100 > test-jac3ddt-100-mpi-4.out
+cmp test-jac3ddt-100-mpi-4.out "$(dirname -- "${0}")/test-jac3d-100.expected"
@@ -0,0 +1,5 @@
+#!/bin/sh
+# test with MPI derived datatypes instead of packing (without reservation,
+# with 5 tasks, mixing contiguous and derived datatype messages)
+LAIK_MPI_DATATYPES=1 LAIK_BACKEND=mpi ${MPIEXEC-mpiexec} -n 5 ../../examples/jac3d -s 100 > test-jac3ddt-100-mpi-5.out
+cmp test-jac3ddt-100-mpi-5.out "$(dirname -- "${0}")/test-jac3d-100-5.expected"
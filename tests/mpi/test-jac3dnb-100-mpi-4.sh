@@ -0,0 +1,4 @@
+#!/bin/sh
+# test with neighborhood collective (with reservation: sequence cached)
+LAIK_MPI_NEIGHBOR=1 LAIK_BACKEND=mpi ${MPIEXEC-mpiexec} -n 4 ../../examples/jac3d -r -s 100 > test-jac3dnb-100-mpi-4.out
+cmp test-jac3dnb-100-mpi-4.out "$(dirname -- "${0}")/test-jac3d-100.expected"
@@ -0,0 +1,4 @@
+#!/bin/sh
+# test with pipelined packing and sending in small chunks (with reservation)
+LAIK_MPI_PIPELINE=2 LAIK_MPI_CHUNKSIZE=4096 LAIK_BACKEND=mpi ${MPIEXEC-mpiexec} -n 4 ../../examples/jac3d -r -s 100 > test-jac3dpl-100-mpi-4.out
+cmp test-jac3dpl-100-mpi-4.out "$(dirname -- "${0}")/test-jac3d-100.expected"
@@ -0,0 +1,4 @@
+#!/bin/sh
+# test with one-sided communication (with reservation: windows reused)
+LAIK_MPI_RMA=1 LAIK_BACKEND=mpi ${MPIEXEC-mpiexec} -n 4 ../../examples/jac3d -r -s 100 > test-jac3drma-100-mpi-4.out
+cmp test-jac3drma-100-mpi-4.out "$(dirname -- "${0}")/test-jac3d-100.expected"
@@ -0,0 +1,4 @@
+#!/bin/sh
+# test shrinking in spmv2, with all-to-all collective for dense exchanges
+LAIK_MPI_ALLTOALL=2 LAIK_BACKEND=mpi ${MPIEXEC-mpiexec} -n 4 ../../examples/spmv2 -s 2 10 3000 | LC_ALL='C' sort > test-spmv2a2a-shrink-mpi-4.out
+cmp test-spmv2a2a-shrink-mpi-4.out "$(dirname -- "${0}")/test-spmv2.expected"
@@ -0,0 +1,4 @@
+#!/bin/sh
+# test with non-blocking collectives for reductions
+LAIK_MPI_IREDUCE=1 LAIK_BACKEND=mpi ${MPIEXEC-mpiexec} -n 4 ../../examples/spmv2 10 3000 | LC_ALL='C' sort > test-spmv2ired-mpi-4.out
+cmp test-spmv2ired-mpi-4.out "$(dirname -- "${0}")/test-spmv2.expected"
@@ -0,0 +1,4 @@
+#!/bin/sh
+# test with node-aware own reduction algorithm (2 emulated nodes)
+LAIK_MPI_REDUCE=0 LAIK_MPI_NODES=2 LAIK_BACKEND=mpi ${MPIEXEC-mpiexec} -n 4 ../../examples/spmv2 10 3000 | LC_ALL='C' sort > test-spmv2nodes-mpi-4.out
+cmp test-spmv2nodes-mpi-4.out "$(dirname -- "${0}")/test-spmv2.expected"
@@ -0,0 +1,219 @@
+// Test for switching multiple containers at once (laik_switchto_batch)
+//
+// Halo exchange of multiple fields (of different types) in a 2d space,
+// and a sum reduction of multiple 1d containers, each with one batch switch.
+// Halo exchange is repeated with reserved mappings, using cached sequences.
+// Finally, a batch with more containers than contexts in one action sequence.
+// All values are checked; only the number of errors is printed.
+
+#include <laik.h>
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define FIELDS 4
+#define SIZE   40
+#define RSIZE  10
+#define MANY   100
+#define ITERS  5
+
+// expected value of a field at global position (x,y)
+static double value(int f, int64_t x, int64_t y)
+{
+    return (double) (f * 10000 + y * SIZE + x);
+}
+
+// set values in own partition of 2d field <f>
+static void setField(Laik_Data* d, int f, Laik_Partitioning* p, int isInt)
+{
+    int64_t gx1, gx2, gy1, gy2;
+    uint64_t ysize, ystride, xsize;
+    void* base;
+
+    laik_my_range_2d(p, 0, &gx1, &gx2, &gy1, &gy2);
+    laik_get_map_2d(d, 0, &base, &ysize, &ystride, &xsize);
+    for(int64_t y = gy1; y < gy2; y++) {
+        for(int64_t x = gx1; x < gx2; x++) {
+            uint64_t off = (uint64_t) (y - gy1) * ystride + (uint64_t) (x - gx1);
+            if (isInt)
+                ((int64_t*) base)[off] = (int64_t) value(f, x, y);
+            else
+                ((double*) base)[off] = value(f, x, y);
+        }
+    }
+}
+
+// check values of 2d field <f> in own partition including halo,
+// return number of wrong values
+static int checkField(Laik_Data* d, int f, Laik_Partitioning* p, int isInt)
+{
+    int64_t gx1, gx2, gy1, gy2;
+    uint64_t ysize, ystride, xsize;
+    void* base;
+    int errors = 0;
+
+    laik_my_range_2d(p, 0, &gx1, &gx2, &gy1, &gy2);
+    laik_get_map_2d(d, 0, &base, &ysize, &ystride, &xsize);
+    for(int64_t y = gy1; y < gy2; y++) {
+        for(int64_t x = gx1; x < gx2; x++) {
+            uint64_t off = (uint64_t) (y - gy1) * ystride + (uint64_t) (x - gx1);
+            double v;
+            if (isInt)
+                v = (double) ((int64_t*) base)[off];
+            else
+                v = ((double*) base)[off];
+            if (v != value(f, x, y)) errors++;
+        }
+    }
+    return errors;
+}
+
+int main(int argc, char* argv[])
+{
+    Laik_Instance* inst = laik_init(&argc, &argv);
+    Laik_Group* world = laik_world(inst);
+    int myid = laik_myid(world);
+    int size = laik_size(world);
+    Laik_SwitchRequest req[MANY];
+    int errors = 0;
+
+    // halo exchange of multiple fields, last one of different type
+    Laik_Space* space = laik_new_space_2d(inst, SIZE, SIZE);
+    Laik_Partitioning *pWrite, *pRead;
+    pWrite = laik_new_partitioning(laik_new_bisection_partitioner(),
+                                   world, space, 0);
+    pRead = laik_new_partitioning(laik_new_cornerhalo_partitioner(1),
+                                  world, space, pWrite);
+
+    Laik_Data* field[FIELDS];
+    for(int f = 0; f < FIELDS; f++) {
+        field[f] = laik_new_data(space, (f == FIELDS - 1) ? laik_Int64 : laik_Double);
+        req[f].data = field[f];
+        req[f].fromP = 0;
+        req[f].toP = pWrite;
+        req[f].flow = LAIK_DF_None;
+        req[f].redOp = LAIK_RO_None;
+    }
+    laik_switchto_batch(FIELDS, req);
+    for(int f = 0; f < FIELDS; f++)
+        setField(field[f], f, pWrite, f == FIELDS - 1);
+
+    for(int iter = 0; iter < ITERS; iter++) {
+        if (iter == 2) {
+            // stable mappings from now on: combined sequence gets cached
+            for(int f = 0; f < FIELDS; f++) {
+                Laik_Reservation* r = laik_reservation_new(field[f]);
+                laik_reservation_add(r, pRead);
+                laik_reservation_add(r, pWrite);
+                laik_reservation_alloc(r);
+                laik_data_use_reservation(field[f], r);
+            }
+            // values get lost by switching to reserved mappings
+            for(int f = 0; f < FIELDS; f++) {
+                req[f].fromP = pWrite;
+                req[f].toP = pWrite;
+                req[f].flow = LAIK_DF_None;
+            }
+            laik_switchto_batch(FIELDS, req);
+            for(int f = 0; f < FIELDS; f++)
+                setField(field[f], f, pWrite, f == FIELDS - 1);
+        }
+
+        for(int f = 0; f < FIELDS; f++) {
+            req[f].fromP = pWrite;
+            req[f].toP = pRead;
+            req[f].flow = LAIK_DF_Preserve;
+        }
+        laik_switchto_batch(FIELDS, req);
+        for(int f = 0; f < FIELDS; f++)
+            errors += checkField(field[f], f, pRead, f == FIELDS - 1);
+
+        for(int f = 0; f < FIELDS; f++) {
+            req[f].fromP = pRead;
+            req[f].toP = pWrite;
+        }
+        laik_switchto_batch(FIELDS, req);
+    }
+
+    // sum reduction of multiple 1d containers, using same partitioning
+    Laik_Space* rspace = laik_new_space_1d(inst, RSIZE);
+    Laik_Partitioning* pAll = laik_new_partitioning(laik_All, world, rspace, 0);
+    Laik_Data* red[FIELDS];
+    for(int f = 0; f < FIELDS; f++) {
+        red[f] = laik_new_data(rspace, laik_Double);
+        laik_switchto_partitioning(red[f], pAll, LAIK_DF_None, LAIK_RO_None);
+        double* base;
+        uint64_t count;
+        laik_get_map_1d(red[f], 0, (void**) &base, &count);
+        for(uint64_t i = 0; i < count; i++)
+            base[i] = (double) ((f + 1) * (myid + 1) * (int) (i + 1));
+
+        req[f].data = red[f];
+        req[f].fromP = pAll;
+        req[f].toP = pAll;
+        req[f].flow = LAIK_DF_Preserve;
+        req[f].redOp = LAIK_RO_Sum;
+    }
+    laik_switchto_batch(FIELDS, req);
+    for(int f = 0; f < FIELDS; f++) {
+        double* base;
+        uint64_t count;
+        laik_get_map_1d(red[f], 0, (void**) &base, &count);
+        for(uint64_t i = 0; i < count; i++)
+            if (base[i] != (double) ((f + 1) * (int) (i + 1) * size * (size + 1) / 2))
+                errors++;
+    }
+
+    // batch of many 1d containers: needs multiple action sequences
+    Laik_Data* many[MANY];
+    for(int f = 0; f < MANY; f++) {
+        many[f] = laik_new_data(rspace, laik_Double);
+        req[f].data = many[f];
+        req[f].fromP = 0;
+        req[f].toP = pAll;
+        req[f].flow = LAIK_DF_None;
+        req[f].redOp = LAIK_RO_None;
+    }
+    laik_switchto_batch(MANY, req);
+    for(int f = 0; f < MANY; f++) {
+        double* base;
+        uint64_t count;
+        laik_get_map_1d(many[f], 0, (void**) &base, &count);
+        for(uint64_t i = 0; i < count; i++)
+            base[i] = (double) (f + myid + (int) i);
+
+        req[f].fromP = pAll;
+        req[f].flow = LAIK_DF_Preserve;
+        req[f].redOp = LAIK_RO_Sum;
+    }
+    laik_switchto_batch(MANY, req);
+    int manyErrors = 0;
+    for(int f = 0; f < MANY; f++) {
+        double* base;
+        uint64_t count;
+        laik_get_map_1d(many[f], 0, (void**) &base, &count);
+        for(uint64_t i = 0; i < count; i++)
+            if (base[i] != (double) ((f + (int) i) * size + size * (size - 1) / 2))
+                manyErrors++;
+    }
+
+    // collect errors from all tasks
+    Laik_Data* err = laik_new_data(laik_new_space_1d(inst, 2), laik_Int64);
+    laik_switchto_new_partitioning(err, world, laik_All, LAIK_DF_None, LAIK_RO_None);
+    int64_t* errBase;
+    laik_get_map_1d(err, 0, (void**) &errBase, 0);
+    errBase[0] = errors;
+    errBase[1] = manyErrors;
+    laik_switchto_flow(err, LAIK_DF_Preserve, LAIK_RO_Sum);
+    laik_get_map_1d(err, 0, (void**) &errBase, 0);
+
+    if (myid == 0) {
+        printf("Batch switch of %d containers: %lld errors\n",
+               FIELDS, (long long) errBase[0]);
+        printf("Batch switch of %d containers: %lld errors\n",
+               MANY, (long long) errBase[1]);
+    }
+
+    laik_finalize(inst);
+    return 0;
+}
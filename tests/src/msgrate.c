@@ -0,0 +1,67 @@
+// Message rate benchmark.
+//
+// Repeated halo exchange on a 1d container with only a few elements per
+// process, such that time is dominated by per-message overhead of the
+// backend. In each iteration, every process gets a message from each of
+// its neighbors. Reports messages per second (summed over all processes).
+// Usage: msgrate [<iterations> [<elements per process>]]
+
+#include <laik.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+int main(int argc, char* argv[])
+{
+    Laik_Instance* inst = laik_init(&argc, &argv);
+    Laik_Group* world = laik_world(inst);
+    int myid = laik_myid(world);
+    int size = laik_size(world);
+
+    int iters = 1000, elems = 1;
+    if (argc > 1) iters = atoi(argv[1]);
+    if (argc > 2) elems = atoi(argv[2]);
+    if (iters < 1) iters = 1000;
+    if (elems < 1) elems = 1;
+
+    // two containers as in jac1d: read one with halo, write one without
+    Laik_Space* space = laik_new_space_1d(inst, (int64_t) size * elems);
+    Laik_Data* data1 = laik_new_data(space, laik_Double);
+    Laik_Data* data2 = laik_new_data(space, laik_Double);
+    Laik_Partitioning *pWrite, *pRead;
+    pWrite = laik_new_partitioning(laik_new_block_partitioner1(),
+                                   world, space, 0);
+    pRead = laik_new_partitioning(laik_new_cornerhalo_partitioner(1),
+                                  world, space, pWrite);
+
+    // initialize own values
+    double* base;
+    uint64_t count;
+    laik_switchto_partitioning(data1, pWrite, LAIK_DF_None, LAIK_RO_None);
+    laik_get_map_1d(data1, 0, (void**) &base, &count);
+    for(uint64_t i = 0; i < count; i++)
+        base[i] = (double) myid;
+
+    Laik_Data *dRead = data2, *dWrite = data1;
+    double t = 0.0;
+    // first 10 iterations for warm up: connections get established
+    for(int i = -10; i < iters; i++) {
+        if (i == 0) t = laik_wtime();
+        Laik_Data* d = dRead;
+        dRead = dWrite;
+        dWrite = d;
+        laik_switchto_partitioning(dRead, pRead, LAIK_DF_Preserve, LAIK_RO_None);
+        laik_switchto_partitioning(dWrite, pWrite, LAIK_DF_None, LAIK_RO_None);
+    }
+    t = laik_wtime() - t;
+
+    if (myid == 0) {
+        double msgs = 2.0 * (size - 1) * iters;
+        printf("Message rate with %d procs (%d elems/proc, %d iters): "
+               "%.0f msgs/s (%.3f s)\n",
+               size, elems, iters, msgs / t, t);
+    }
+
+    laik_finalize(inst);
+    return 0;
+}
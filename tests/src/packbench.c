@@ -0,0 +1,141 @@
+// Microbenchmark for packing/unpacking ranges of lexicographical layouts.
+//
+// Runs in one process: a container covering a 1d/2d/3d space is mapped
+// completely, and ranges of different shapes (contiguous, rows, columns,
+// faces and blocks) are packed into a buffer and unpacked back, using the
+// pack/unpack functions of the layout. Reports achieved GB/s.
+// With "-e <bytes>", use elements of given size (default: 8).
+
+#include "laik-internal.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// at least this many bytes are packed/unpacked per measurement
+#define BENCHBYTES (256 * 1024 * 1024)
+
+// pack range <r> of mapping <m> completely into <buf>, return element count
+static uint64_t pack(Laik_Mapping* m, Laik_Range* r, char* buf, unsigned int size)
+{
+    Laik_Index idx = r->from;
+    int dims = r->space->dims;
+    uint64_t count = 0;
+    while(!laik_index_isEqual(dims, &idx, &(r->to))) {
+        unsigned int packed = (m->layout->pack)(m, r, &idx, buf, size);
+        assert(packed > 0);
+        count += packed;
+    }
+    return count;
+}
+
+// unpack <buf> into range <r> of mapping <m>, return element count
+static uint64_t unpack(Laik_Mapping* m, Laik_Range* r, char* buf, unsigned int size)
+{
+    Laik_Index idx = r->from;
+    int dims = r->space->dims;
+    uint64_t count = 0;
+    while(!laik_index_isEqual(dims, &idx, &(r->to))) {
+        unsigned int unpacked = (m->layout->unpack)(m, r, &idx, buf, size);
+        assert(unpacked > 0);
+        count += unpacked;
+    }
+    return count;
+}
+
+// measure pack/unpack of range given by <from>/<to> in mapping of <d>
+static void run(Laik_Data* d, char* name,
+                int64_t x1, int64_t x2, int64_t y1, int64_t y2,
+                int64_t z1, int64_t z2)
+{
+    Laik_Mapping* m = laik_get_map(d, 0);
+    Laik_Range r;
+    Laik_Index from, to;
+    laik_index_init(&from, x1, y1, z1);
+    laik_index_init(&to, x2, y2, z2);
+    laik_range_init(&r, d->space, &from, &to);
+
+    uint64_t count = laik_range_size(&r);
+    unsigned int size = (unsigned int) (count * d->elemsize);
+    char* buf = malloc(size);
+    assert(buf != 0);
+    int reps = (int) (BENCHBYTES / size) + 1;
+
+    uint64_t packed = 0, unpacked = 0;
+    double t1 = laik_wtime();
+    for(int i = 0; i < reps; i++)
+        packed += pack(m, &r, buf, size);
+    double t2 = laik_wtime();
+    for(int i = 0; i < reps; i++)
+        unpacked += unpack(m, &r, buf, size);
+    double t3 = laik_wtime();
+    assert(packed == count * (uint64_t) reps);
+    assert(unpacked == packed);
+
+    double gb = 0.000000001 * size * reps;
+    printf("%dd %-14s %9lu elems: pack %7.2f GB/s, unpack %7.2f GB/s\n",
+           d->space->dims, name, (unsigned long) count,
+           gb / (t2 - t1), gb / (t3 - t2));
+    free(buf);
+}
+
+// container over space <s>, completely mapped in this process
+static Laik_Data* mapped(Laik_Space* s, Laik_Type* t)
+{
+    Laik_Data* d = laik_new_data(s, t);
+    Laik_Group* world = laik_world(s->inst);
+    laik_switchto_new_partitioning(d, world, laik_Master,
+                                   LAIK_DF_None, LAIK_RO_None);
+    return d;
+}
+
+int main(int argc, char* argv[])
+{
+    Laik_Instance* inst = laik_init(&argc, &argv);
+
+    int elemsize = 8;
+    int arg = 1;
+    while((argc > arg) && (argv[arg][0] == '-')) {
+        if ((strcmp(argv[arg], "-e") == 0) && (argc > arg + 1))
+            elemsize = atoi(argv[++arg]);
+        else {
+            printf("Usage: %s [-e <bytes>]\n"
+                   " -e: element size in bytes (default: 8)\n", argv[0]);
+            laik_finalize(inst);
+            return 1;
+        }
+        arg++;
+    }
+    if (elemsize <= 0) elemsize = 8;
+
+    if (laik_myid(laik_world(inst)) > 0) {
+        // only run on one process
+        laik_finalize(inst);
+        return 0;
+    }
+
+    char tname[20];
+    sprintf(tname, "bench%d", elemsize);
+    Laik_Type* t = laik_type_register(tname, elemsize);
+    printf("element size %d bytes\n", elemsize);
+
+    Laik_Data* d1 = mapped(laik_new_space_1d(inst, 1 << 22), t);
+    run(d1, "contiguous", 1000, 1000 + (1 << 20), 0, 1, 0, 1);
+    run(d1, "small", 1000, 1008, 0, 1, 0, 1);
+
+    Laik_Data* d2 = mapped(laik_new_space_2d(inst, 2048, 2048), t);
+    run(d2, "row", 0, 2048, 1000, 1001, 0, 1);
+    run(d2, "column", 1000, 1001, 0, 2048, 0, 1);
+    run(d2, "block 256x256", 1000, 1256, 1000, 1256, 0, 1);
+    run(d2, "block 4x2048", 1000, 1004, 0, 2048, 0, 1);
+
+    Laik_Data* d3 = mapped(laik_new_space_3d(inst, 128, 128, 128), t);
+    run(d3, "face x", 64, 65, 0, 128, 0, 128);
+    run(d3, "face y", 0, 128, 64, 65, 0, 128);
+    run(d3, "face z", 0, 128, 0, 128, 64, 65);
+    run(d3, "block 32^3", 32, 64, 32, 64, 32, 64);
+
+    laik_finalize(inst);
+    return 0;
+}
@@ -0,0 +1,152 @@
+// Scaling benchmark for transition calculation in 2d/3d spaces.
+//
+// Runs in one process: for each given task count, a group of that size
+// is simulated, and partitionings as in jac2d/jac3d (bisection with halo)
+// are calculated. Measures the time to calculate transitions from the
+// view of one task in the middle of the group.
+// With "-p <threads>", additionally measures planning the switches of
+// multiple containers in advance, serially and with given threads.
+
+#include "laik-internal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// create a group with <size> tasks, with this process being task <myid>.
+// other tasks do not exist, only usable for calculating transitions
+static Laik_Group* simulated_group(Laik_Instance* inst, int size, int myid)
+{
+    Laik_Group* g = laik_create_group(inst, size);
+    g->size = size;
+    g->myid = myid;
+    for(int i = 0; i < size; i++)
+        g->locationid[i] = 0;
+    return g;
+}
+
+// plan switches between <p1> and <p2> for <n> new containers in advance,
+// return time needed
+static double plan(Laik_Space* space, Laik_Partitioning* p1,
+                   Laik_Partitioning* p2, int n, int threads)
+{
+    Laik_Data* d[n];
+    Laik_SwitchRequest req[2 * n];
+    for(int i = 0; i < n; i++) {
+        d[i] = laik_new_data(space, laik_Double);
+        req[2*i].data = d[i];
+        req[2*i].fromP = p1;
+        req[2*i].toP = p2;
+        req[2*i].flow = LAIK_DF_Preserve;
+        req[2*i].redOp = LAIK_RO_None;
+        req[2*i+1] = req[2*i];
+        req[2*i+1].fromP = p2;
+        req[2*i+1].toP = p1;
+    }
+
+    double t1 = laik_wtime();
+    laik_plan_switches(2 * n, req, threads);
+    double t2 = laik_wtime();
+
+    for(int i = 0; i < n; i++)
+        laik_free(d[i]);
+
+    return t2 - t1;
+}
+
+static void run(Laik_Instance* inst, int dims, int64_t side, int tasks,
+                int planThreads)
+{
+    Laik_Space* space;
+    if (dims == 3)
+        space = laik_new_space_3d(inst, side, side, side);
+    else
+        space = laik_new_space_2d(inst, side, side);
+
+    Laik_Group* g = simulated_group(inst, tasks, tasks / 2);
+
+    double t1 = laik_wtime();
+    Laik_Partitioning *pWrite, *pRead;
+    pWrite = laik_new_partitioning(laik_new_bisection_partitioner(),
+                                   g, space, 0);
+    pRead = laik_new_partitioning(laik_new_cornerhalo_partitioner(1),
+                                  g, space, pWrite);
+    double t2 = laik_wtime();
+
+    // first calculation includes lazy setup of range lists (e.g. index)
+    Laik_Transition *toRead, *toWrite;
+    double t3 = 0.0;
+    for(int iter = 0; iter < 2; iter++) {
+        if (iter == 1) t3 = laik_wtime();
+        toRead = laik_calc_transition(space, pWrite, pRead,
+                                      LAIK_DF_Preserve, LAIK_RO_None);
+        toWrite = laik_calc_transition(space, pRead, pWrite,
+                                       LAIK_DF_Preserve, LAIK_RO_None);
+        if (iter == 0) {
+            laik_free_transition(toRead);
+            laik_free_transition(toWrite);
+        }
+    }
+    double t4 = laik_wtime();
+
+    printf("%dd, %6d tasks: partitioning %8.3f ms, transitions %8.3f ms"
+           " (first %8.3f ms), %d send, %d recv\n",
+           dims, tasks, 1000.0 * (t2 - t1),
+           1000.0 * (t4 - t3), 1000.0 * (t3 - t2),
+           toRead->sendCount, toRead->recvCount);
+
+    laik_free_transition(toRead);
+    laik_free_transition(toWrite);
+
+    if (planThreads > 0) {
+        double ts = plan(space, pWrite, pRead, 8, 1);
+        double tp = plan(space, pWrite, pRead, 8, planThreads);
+        printf("   plan 16 switches: serial %8.3f ms, %d threads %8.3f ms\n",
+               1000.0 * ts, planThreads, 1000.0 * tp);
+    }
+
+    laik_free_partitioning(pRead);
+    laik_free_partitioning(pWrite);
+}
+
+int main(int argc, char* argv[])
+{
+    Laik_Instance* inst = laik_init(&argc, &argv);
+
+    int dims = 2;
+    int planThreads = 0;
+    int arg = 1;
+    while((argc > arg) && (argv[arg][0] == '-')) {
+        if (strcmp(argv[arg], "-3") == 0)
+            dims = 3;
+        else if ((strcmp(argv[arg], "-p") == 0) && (argc > arg + 1))
+            planThreads = atoi(argv[++arg]);
+        else
+            break;
+        arg++;
+    }
+    if ((argc > arg) && (argv[arg][0] == '-')) {
+        printf("Usage: %s [-3] [-p <threads>] [<task count> ...]\n"
+               " -3: use 3d space (default: 2d)\n"
+               " -p: also measure planning switches with <threads> threads\n"
+               "Default task counts: 1000 10000 100000\n", argv[0]);
+        laik_finalize(inst);
+        return 1;
+    }
+
+    // space large enough to give each task a non-empty partition
+    int64_t side = (dims == 3) ? 200 : 2000;
+
+    if (argc > arg) {
+        for(; arg < argc; arg++)
+            run(inst, dims, side, atoi(argv[arg]), planThreads);
+    }
+    else {
+        run(inst, dims, side, 1000, planThreads);
+        run(inst, dims, side, 10000, planThreads);
+        run(inst, dims, side, 100000, planThreads);
+    }
+
+    laik_finalize(inst);
+    return 0;
+}
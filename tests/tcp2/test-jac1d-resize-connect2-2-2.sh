@@ -0,0 +1,5 @@
+#!/bin/sh
+# test resize with connection mode 2 (see LAIK_TCP2_CONNECT)
+timeout() { perl -e 'alarm shift; exec @ARGV' "$@"; }
+LAIK_TCP2_CONNECT=2 timeout 5 ${LAUNCHER-./launcher} -n 2 -s 2 ../../examples/jac1d 100 50 -10 > test-jac1d-resize-connect2-2-2.out
+cmp test-jac1d-resize-connect2-2-2.out "$(dirname -- "${0}")/test-jac1d-resize-2-2.expected"
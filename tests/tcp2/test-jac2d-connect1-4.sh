@@ -0,0 +1,4 @@
+#!/bin/sh
+# test with connection mode 1 (see LAIK_TCP2_CONNECT), and socket buffer size
+LAIK_TCP2_CONNECT=1 LAIK_TCP2_SOCKBUF=65536 ${LAUNCHER-./launcher} -n 4 ../../examples/jac2d -s 100 > test-jac2d-connect1-4.out
+cmp test-jac2d-connect1-4.out "$(dirname -- "${0}")/../common/test-jac2d-4.expected"
@@ -0,0 +1,4 @@
+#!/bin/sh
+# test with connection mode 2 (see LAIK_TCP2_CONNECT), and socket buffer size
+LAIK_TCP2_CONNECT=2 LAIK_TCP2_SOCKBUF=65536 ${LAUNCHER-./launcher} -n 4 ../../examples/jac2d -s 100 > test-jac2d-connect2-4.out
+cmp test-jac2d-connect2-4.out "$(dirname -- "${0}")/../common/test-jac2d-4.expected"
@@ -0,0 +1,4 @@
+#!/bin/sh
+# test with progress thread, binary data via TCP (no shared memory)
+LAIK_TCP2_THREAD=1 LAIK_TCP2_SHM=0 ${LAUNCHER-./launcher} -n 4 ../../examples/jac2d -s 100 > test-jac2d-thread-4.out
+cmp test-jac2d-thread-4.out "$(dirname -- "${0}")/../common/test-jac2d-4.expected"
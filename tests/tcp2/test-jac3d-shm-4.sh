@@ -0,0 +1,4 @@
+#!/bin/sh
+# test with binary data via shared memory rings between local processes
+LAIK_TCP2_SHM=1048576 ${LAUNCHER-./launcher} -n 4 ../../examples/jac3d -s 100 10 > test-jac3d-shm-4.out
+cmp test-jac3d-shm-4.out "$(dirname -- "${0}")/../common/test-jac3d-4.expected"
@@ -0,0 +1,4 @@
+#!/bin/sh
+# test with compression of binary data frames via TCP (no shared memory)
+LAIK_TCP2_COMPRESS=64 LAIK_TCP2_SHM=0 ${LAUNCHER-./launcher} -n 4 ../../examples/jac3d -s 100 10 > test-jac3d-zip-4.out
+cmp test-jac3d-zip-4.out "$(dirname -- "${0}")/../common/test-jac3d-4.expected"
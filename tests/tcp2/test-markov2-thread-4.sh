@@ -0,0 +1,4 @@
+#!/bin/sh
+# test with progress thread
+LAIK_TCP2_THREAD=1 ${LAUNCHER-./launcher} -n 4 ../../examples/markov2 40 4 > test-markov2-thread-4.out
+cmp test-markov2-thread-4.out "$(dirname -- "${0}")/../common/test-markov2.expected"
@@ -0,0 +1,4 @@
+#!/bin/sh
+# test with compression of binary data frames via TCP (no shared memory)
+LAIK_TCP2_COMPRESS=64 LAIK_TCP2_SHM=0 OMP_NUM_THREADS=1 ${LAUNCHER-./launcher} -n 4 ../../examples/spmv2 10 3000 | LC_ALL='C' sort > test-spmv2-zip-4.out
+cmp test-spmv2-zip-4.out "$(dirname -- "${0}")/../common/test-spmv2-4.expected"
@@ -0,0 +1,3 @@
+#!/bin/sh
+LAIK_BACKEND=single src/batchtest > test-batchtest-single.out
+cmp test-batchtest-single.out "$(dirname -- "${0}")/test-batchtest.expected"